@@ -0,0 +1,33 @@
+create table copyt (c1 int, c2 char(5));
+
+copy copyt from stdin;
+1	one
+2	two\\
+\.
+
+copy copyt from stdin with (format csv);
+3,"th,ee"
+4,""
+\.
+
+copy copyt from stdin;
+5	five
+x	six
+\.
+
+copy copyt from stdin;
+7
+\.
+
+copy copyt from stdin;
+8	eightyeight
+\.
+
+copy copyt from stdin;
+9	\x41\102\1030
+10	\xz\x4a\x6e
+\.
+
+select * from copyt;
+
+copy copyt from;
@@ -0,0 +1,19 @@
+create;
+
+create table;
+
+create table from;
+
+create table t1;
+
+create table t1 ();
+
+create table t1 (c1);
+
+create table t1 (c1 int(5));
+
+create table t1 (int);
+
+create table t1 (c1 int, c2 bigint, c3 smallint, c4 char(5));
+
+select * from t1;
@@ -0,0 +1,15 @@
+-- limit and offset
+select a from foo limit 2;
+
+select a from foo offset 2;
+
+select a from foo limit 1 offset 1;
+
+select a from foo offset 1 limit 1;
+
+select 1 limit 0;
+
+-- invalid row counts
+select a from foo limit -1;
+
+select a from foo limit b;
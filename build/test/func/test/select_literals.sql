@@ -0,0 +1,5 @@
+SELECT 1, 2, 3;
+
+SELECT 'a', 'b', 'c';
+
+SELECT 1 AS first, 2 AS second, 'three' as third;
@@ -0,0 +1,9 @@
+select;
+
+select *;
+
+select * as a from foo;
+
+select from foo;
+
+select a from foo bar;
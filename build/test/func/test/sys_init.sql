@@ -0,0 +1,3 @@
+select * from tables;
+
+select * from columns;
@@ -1,12 +1,33 @@
 #include "connection.h"
 #include "util/mem.h"
 
+size_t max_query_mem = 0;
+
 int conn_init(struct conn *conn, int socket)
 {
-	conn->socket = socket;
-	conn->state  = CONN_CLOSED;
-	conn->query  = NULL;
+	conn->socket	     = socket;
+	conn->state	     = CONN_CLOSED;
+	conn->query	     = NULL;
+	conn->query_offset   = 0;
+	conn->skip_till_sync = 0;
+	conn->recvbuf_start  = 0;
+	conn->recvbuf_end    = 0;
+	conn->sendbuf_len    = 0;
 	kvmap_init(&conn->parameters, 10);
+	kvmap_init(&conn->statements, 1);
+	vec_init(&conn->portals, 1);
 	mem_root_init(&conn->mem_root);
+	mem_root_init_child(&conn->query_mem, &conn->mem_root);
+	mem_root_init_child(&conn->stmt_mem, &conn->query_mem);
+	mem_root_init_child(&conn->row_mem, &conn->stmt_mem);
+	conn->query_mem.limit = max_query_mem;
 	return 0;
 }
+
+void conn_free(struct conn *conn)
+{
+	kvmap_free(&conn->parameters);
+	kvmap_free(&conn->statements);
+	vec_free(&conn->portals);
+	mem_root_clear(&conn->mem_root);
+}
@@ -3,6 +3,10 @@
 
 #include "util/kvmap.h"
 #include "util/mem.h"
+#include "util/vec.h"
+
+/* Size of the send and receive buffers of a connection */
+#define CONN_BUFFER_SIZE 8192
 
 enum conn_state {
 	/*The connection is closed*/
@@ -24,14 +28,47 @@ struct conn {
 
 	/* Current query being processed */
 	char *query;
+	/* Offset of the query in the query string it was sent in, which error
+	 * positions are reported relative to */
+	size_t query_offset;
 
 	/* Map of session parameters */
 	struct kvmap parameters;
 
-	/* Root for query-scoped dynamic allocations */
+	/* Map of prepared statement names to their query strings */
+	struct kvmap statements;
+
+	/* List of struct pgwire_portal, destroyed at the end of each query */
+	struct vec portals;
+
+	/* Set after an error in an extended query message, until the next
+	 * Sync */
+	int skip_till_sync;
+
+	/* Data received from the client that has not been processed yet */
+	u8     recvbuf[CONN_BUFFER_SIZE];
+	size_t recvbuf_start;
+	size_t recvbuf_end;
+
+	/* Messages waiting to be sent to the client */
+	u8     sendbuf[CONN_BUFFER_SIZE];
+	size_t sendbuf_len;
+
+	/* Roots of the dynamic allocations living as long as the connection,
+	 * the current query message, the statement of it being run, and the
+	 * row being sent, each one a child of the previous one */
 	struct mem_root mem_root;
+	struct mem_root query_mem;
+	struct mem_root stmt_mem;
+	struct mem_root row_mem;
 };
 
+/* Memory in bytes a query may use in all, 0 for no limit */
+extern size_t max_query_mem;
+
 int conn_init(struct conn *conn, int socket);
 
+/* Release everything the connection holds, except the connection itself */
+void conn_free(struct conn *conn);
+
 #endif // CONNECTION_H
@@ -3,9 +3,11 @@
 #include <assert.h>
 
 struct dtype dtypes[] = {
+	[DTYPE_BOOL] = {DTYPE_BOOL, "bool", 1},
 	[DTYPE_INT2] = {DTYPE_INT2, "int2", 2},
 	[DTYPE_INT4] = {DTYPE_INT4, "int4", 4},
 	[DTYPE_INT8] = {DTYPE_INT8, "int8", 8},
+	[DTYPE_FLOAT8] = {DTYPE_FLOAT8, "float8", 8},
 	[DTYPE_CHAR] = {DTYPE_CHAR, "char", -1},
 };
 
@@ -20,6 +20,9 @@ extern struct dtype dtypes[];
 enum dtype_oids {
 	DTYPE_INVALID = 0,
 
+	/* boolean, the type of conditions */
+	DTYPE_BOOL = 16,
+
 	/* smallint */
 	DTYPE_INT2 = 21,
 	/* integer */
@@ -27,6 +30,9 @@ enum dtype_oids {
 	/* bigint */
 	DTYPE_INT8 = 20,
 
+	/* double precision, the type of averages */
+	DTYPE_FLOAT8 = 701,
+
 	/* char */
 	DTYPE_CHAR = 18
 };
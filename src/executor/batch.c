@@ -0,0 +1,60 @@
+#include "executor/batch.h"
+
+#include <string.h>
+
+#include "dtype.h"
+#include "util/mem.h"
+
+void vector_init(struct vector *vec, u32 typeoid, i32 typemod)
+{
+	vec->typeoid = typeoid;
+	vec->typemod = typemod;
+	vec->width   = dtype_len(typeoid, typemod);
+	vec->data    = mem_alloc((size_t)BATCH_SIZE * vec->width +
+				 VECTOR_PADDING);
+	vec->nulls   = NULL;
+}
+
+void batch_init(struct batch *batch, u16 ncols)
+{
+	batch->ncols = ncols;
+	batch->cols  = mem_zalloc(sizeof(struct vector) * ncols);
+	batch->nrows = 0;
+	batch->sel   = NULL;
+	batch->nsel  = 0;
+}
+
+struct batch *batch_clone(const struct batch *src)
+{
+	struct batch *dst = mem_alloc(sizeof(struct batch));
+	u16	      count = batch_count(src);
+	u16	      colno;
+	u16	      i;
+
+	batch_init(dst, src->ncols);
+	dst->nrows = count;
+	for (colno = 0; colno < src->ncols; ++colno) {
+		const struct vector *from = &src->cols[colno];
+		struct vector	    *to	  = &dst->cols[colno];
+
+		*to = *from;
+		if (from->data == NULL)
+			continue;
+		to->data = mem_alloc((size_t)count * from->width);
+		if (from->nulls)
+			to->nulls = mem_alloc(count);
+		if (src->sel == NULL) {
+			memcpy(to->data, from->data, (size_t)count * from->width);
+			if (from->nulls)
+				memcpy(to->nulls, from->nulls, count);
+			continue;
+		}
+		for (i = 0; i < count; ++i) {
+			memcpy(vector_at(to, i), vector_at(from, src->sel[i]),
+			       from->width);
+			if (from->nulls)
+				to->nulls[i] = from->nulls[src->sel[i]];
+		}
+	}
+	return dst;
+}
@@ -0,0 +1,73 @@
+/* Batches of rows stored column by column, exchanged between the stages of
+ * query execution */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "univ.h"
+
+/* Maximum number of rows in a batch */
+#define BATCH_SIZE (1024)
+
+/* Bytes allocated past the last value of a vector, so that SIMD code may load
+ * a whole register at any value */
+#define VECTOR_PADDING (16)
+
+/* Type of the values of a column */
+struct coltype {
+	u32 typeoid;
+	i32 typemod;
+};
+
+/* The values of one column for all the rows of a batch */
+struct vector {
+	u32 typeoid;
+	i32 typemod;
+	/* size in bytes of each value */
+	u32 width;
+	/* BATCH_SIZE values, width bytes apart, or NULL if the column is not
+	 * used */
+	u8 *data;
+	/* one flag per value, set if the value is null, or NULL if none is */
+	u8 *nulls;
+};
+
+struct batch {
+	u16	       ncols;
+	struct vector *cols;
+	/* number of rows in the vectors */
+	u16 nrows;
+	/* when set, only the nsel rows listed in sel are part of the batch,
+	 * e.g. after filtering */
+	u16 *sel;
+	u16  nsel;
+};
+
+/* Allocate a vector for values of the given type */
+void vector_init(struct vector *vec, u32 typeoid, i32 typemod);
+
+/* Create a batch of ncols columns. The vectors are left unallocated. */
+void batch_init(struct batch *batch, u16 ncols);
+
+/* Copy the selected rows of a batch into a new batch without a selection
+ * vector. Columns without data are not copied. */
+struct batch *batch_clone(const struct batch *src);
+
+static inline u8 *vector_at(const struct vector *vec, u16 row)
+{
+	return vec->data + (size_t)row * vec->width;
+}
+
+/* Number of rows selected in the batch */
+static inline u16 batch_count(const struct batch *batch)
+{
+	return batch->sel ? batch->nsel : batch->nrows;
+}
+
+/* Index in the vectors of the i-th selected row */
+static inline u16 batch_row(const struct batch *batch, u16 i)
+{
+	return batch->sel ? batch->sel[i] : i;
+}
+
+#endif // BATCH_H
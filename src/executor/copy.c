@@ -0,0 +1,821 @@
+#include "executor/copy.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "dtype.h"
+#include "util/bytes.h"
+#include "util/error.h"
+#include "util/mem.h"
+#include "util/num.h"
+
+extern struct heap *heaps[];
+
+static const u8 binary_signature[] = "PGCOPY\n\377\r\n";
+
+/* Length of the longest text representation of an int8 */
+#define INT8_TEXT_LEN 20
+
+void copy_out_begin(struct copy_out *out, struct copy *copy)
+{
+	struct table *table = copy->table;
+	size_t	      off   = 0;
+	u16	      colno;
+
+	memset(out, 0, sizeof(struct copy_out));
+	out->copy    = copy;
+	out->offsets = mem_alloc(sizeof(size_t) * table->ncols);
+
+	/* Field count, plus length of each field for binary */
+	out->maxrowlen = 2;
+	for (colno = 0; colno < table->ncols; ++colno) {
+		struct column *col = &table->cols[colno];
+		size_t	       len = dtype_len(col->typeoid, col->typemod);
+
+		out->offsets[colno] = off;
+		off += len;
+
+		if (copy->format == COPY_FORMAT_BINARY)
+			out->maxrowlen += 4 + len;
+		else if (col->typeoid == DTYPE_CHAR)
+			/* each byte can be escaped, plus quotes and a delimiter */
+			out->maxrowlen += 2 * len + 3;
+		else
+			out->maxrowlen += INT8_TEXT_LEN + 1;
+	}
+	assert(sizeof(binary_signature) + 8 + out->maxrowlen + 2 <=
+	       COPY_CHUNK_SIZE);
+
+	tablescan_begin(&out->iter, table);
+}
+
+static u8 *encode_text(struct column *col, const u8 *data, u8 *ptr)
+{
+	i16 v2;
+	i32 v4;
+	i64 v8;
+	int i;
+
+	switch (col->typeoid) {
+	case DTYPE_INT2:
+		memcpy(&v2, data, sizeof(v2));
+		return (u8 *)ut_format_int((char *)ptr, v2);
+	case DTYPE_INT4:
+		memcpy(&v4, data, sizeof(v4));
+		return (u8 *)ut_format_int((char *)ptr, v4);
+	case DTYPE_INT8:
+		memcpy(&v8, data, sizeof(v8));
+		return (u8 *)ut_format_int((char *)ptr, v8);
+	case DTYPE_CHAR:
+		for (i = 0; i < col->typemod && data[i] != '\0'; ++i) {
+			switch (data[i]) {
+			case '\\':
+				*ptr++ = '\\';
+				*ptr++ = '\\';
+				break;
+			case '\t':
+				*ptr++ = '\\';
+				*ptr++ = 't';
+				break;
+			case '\n':
+				*ptr++ = '\\';
+				*ptr++ = 'n';
+				break;
+			case '\r':
+				*ptr++ = '\\';
+				*ptr++ = 'r';
+				break;
+			default:
+				*ptr++ = data[i];
+				break;
+			}
+		}
+		return ptr;
+	default:
+		errlog(PANIC, errmsg("Serialization for dtype %u not implemented",
+				     col->typeoid));
+		return ptr;
+	}
+}
+
+static u8 *encode_csv(struct column *col, const u8 *data, u8 *ptr)
+{
+	size_t len;
+	size_t i;
+	int    quote;
+
+	if (col->typeoid != DTYPE_CHAR)
+		return encode_text(col, data, ptr);
+
+	len = strnlen((const char *)data, col->typemod);
+	/* empty strings are quoted to tell them apart from NULL */
+	quote = len == 0;
+	for (i = 0; i < len && !quote; ++i)
+		quote = data[i] == ',' || data[i] == '"' || data[i] == '\n' ||
+			data[i] == '\r';
+	if (!quote) {
+		memcpy(ptr, data, len);
+		return ptr + len;
+	}
+	*ptr++ = '"';
+	for (i = 0; i < len; ++i) {
+		if (data[i] == '"')
+			*ptr++ = '"';
+		*ptr++ = data[i];
+	}
+	*ptr++ = '"';
+	return ptr;
+}
+
+static u8 *encode_binary(struct column *col, const u8 *data, u8 *ptr)
+{
+	i16    v2;
+	i32    v4;
+	i64    v8;
+	size_t len;
+
+	switch (col->typeoid) {
+	case DTYPE_INT2:
+		memcpy(&v2, data, sizeof(v2));
+		ptr = ut_write_4(ptr, sizeof(v2));
+		return ut_write_2(ptr, v2);
+	case DTYPE_INT4:
+		memcpy(&v4, data, sizeof(v4));
+		ptr = ut_write_4(ptr, sizeof(v4));
+		return ut_write_4(ptr, v4);
+	case DTYPE_INT8:
+		memcpy(&v8, data, sizeof(v8));
+		ptr = ut_write_4(ptr, sizeof(v8));
+		return ut_write_8(ptr, v8);
+	case DTYPE_CHAR:
+		len = strnlen((const char *)data, col->typemod);
+		ptr = ut_write_4(ptr, len);
+		memcpy(ptr, data, len);
+		return ptr + len;
+	default:
+		errlog(PANIC, errmsg("Serialization for dtype %u not implemented",
+				     col->typeoid));
+		return ptr;
+	}
+}
+
+static u8 *encode_row(struct copy_out *out, const u8 *tup, u8 *ptr)
+{
+	struct table *table = out->copy->table;
+	u16	      colno;
+
+	if (out->copy->format == COPY_FORMAT_BINARY) {
+		ptr = ut_write_2(ptr, table->ncols);
+		for (colno = 0; colno < table->ncols; ++colno)
+			ptr = encode_binary(&table->cols[colno],
+					    tup + out->offsets[colno], ptr);
+		return ptr;
+	}
+
+	for (colno = 0; colno < table->ncols; ++colno) {
+		struct column *col  = &table->cols[colno];
+		const u8      *data = tup + out->offsets[colno];
+
+		if (out->copy->format == COPY_FORMAT_CSV) {
+			if (colno > 0)
+				*ptr++ = ',';
+			ptr = encode_csv(col, data, ptr);
+		} else {
+			if (colno > 0)
+				*ptr++ = '\t';
+			ptr = encode_text(col, data, ptr);
+		}
+	}
+	*ptr++ = '\n';
+	return ptr;
+}
+
+size_t copy_out_next(struct copy_out *out, u8 *buf)
+{
+	u8 *ptr = buf;
+	u8 *end = buf + COPY_CHUNK_SIZE;
+
+	if (out->eof)
+		return 0;
+
+	if (!out->started && out->copy->format == COPY_FORMAT_BINARY) {
+		memcpy(ptr, binary_signature, sizeof(binary_signature));
+		ptr += sizeof(binary_signature);
+		/* flags field and header extension length */
+		ptr = ut_write_4(ptr, 0);
+		ptr = ut_write_4(ptr, 0);
+	}
+	out->started = 1;
+
+	for (;;) {
+		if (!out->pending) {
+			if (tablescan_next(&out->iter) == -1) {
+				out->eof = 1;
+				break;
+			}
+			out->pending = 1;
+		}
+		/* leave room for the binary trailer */
+		if (end - ptr < out->maxrowlen + 2)
+			return ptr - buf;
+		ptr	     = encode_row(out, out->iter.tup, ptr);
+		out->pending = 0;
+		out->nrows++;
+	}
+
+	if (out->copy->format == COPY_FORMAT_BINARY)
+		ptr = ut_write_2(ptr, (u16)-1);
+	return ptr - buf;
+}
+
+void copy_out_end(struct copy_out *out)
+{
+	tablescan_end(&out->iter);
+}
+
+void copy_in_begin(struct copy_in *in, struct copy *copy)
+{
+	struct table *table = copy->table;
+	u16	      colno;
+
+	memset(in, 0, sizeof(struct copy_in));
+	in->copy    = copy;
+	in->offsets = mem_alloc(sizeof(size_t) * table->ncols);
+	for (colno = 0; colno < table->ncols; ++colno) {
+		struct column *col = &table->cols[colno];
+
+		in->offsets[colno] = in->tupsize;
+		in->tupsize += dtype_len(col->typeoid, col->typemod);
+	}
+	in->tup	  = mem_alloc(in->tupsize);
+	in->field = mem_alloc(PAGE_SIZE);
+	vec_init(&in->pages, 1);
+}
+
+/* Describe where in the input an error happened */
+static const char *copy_context(struct copy_in *in)
+{
+	size_t len = strlen(in->copy->table->name) + 32;
+	char  *ctx = mem_alloc(len);
+
+	snprintf(ctx, len, "COPY %s, line %llu", in->copy->table->name,
+		 (unsigned long long)in->nrows + 1);
+	return ctx;
+}
+
+static int bad_format(struct copy_in *in, const char *msg)
+{
+	errlog(ERROR, errcode(ER_BAD_COPY_FILE_FORMAT), errmsg("%s", msg),
+	       errdetail(copy_context(in)));
+	return 1;
+}
+
+static int null_value(struct copy_in *in, u16 colno)
+{
+	errlog(ERROR, errcode(ER_FEATURE_NOT_SUPPORTED),
+	       errmsg("Null value in column %s is not supported",
+		      in->copy->table->cols[colno].name),
+	       errdetail(copy_context(in)));
+	return 1;
+}
+
+/* Store the text representation of a field into the tuple being built */
+static int store_field(struct copy_in *in, u16 colno, const u8 *data,
+		       size_t len)
+{
+	struct column *col = &in->copy->table->cols[colno];
+	u8	      *dst = in->tup + in->offsets[colno];
+	i64	       val = 0;
+	i16	       v2;
+	i32	       v4;
+	int	       rc;
+
+	switch (col->typeoid) {
+	case DTYPE_INT2:
+		rc = ut_parse_int((const char *)data, len, INT16_MIN,
+				  INT16_MAX, &val);
+		v2 = val;
+		memcpy(dst, &v2, sizeof(v2));
+		break;
+	case DTYPE_INT4:
+		rc = ut_parse_int((const char *)data, len, INT32_MIN,
+				  INT32_MAX, &val);
+		v4 = val;
+		memcpy(dst, &v4, sizeof(v4));
+		break;
+	case DTYPE_INT8:
+		rc = ut_parse_int((const char *)data, len, INT64_MIN,
+				  INT64_MAX, &val);
+		memcpy(dst, &val, sizeof(val));
+		break;
+	case DTYPE_CHAR:
+		if (len > col->typemod) {
+			errlog(ERROR, errcode(ER_STRING_DATA_RIGHT_TRUNCATION),
+			       errmsg("Value too long for type char(%d)",
+				      col->typemod),
+			       errdetail(copy_context(in)));
+			return 1;
+		}
+		memcpy(dst, data, len);
+		memset(dst + len, 0, col->typemod - len);
+		return 0;
+	default:
+		errlog(PANIC, errmsg("Deserialization for dtype %u not implemented",
+				     col->typeoid));
+		return 1;
+	}
+
+	if (rc == 1) {
+		errlog(ERROR, errcode(ER_INVALID_TEXT_REPRESENTATION),
+		       errmsg("Invalid input syntax for type %s: \"%.*s\"",
+			      dtypes[col->typeoid].name, (int)len, data),
+		       errdetail(copy_context(in)));
+		return 1;
+	} else if (rc == 2) {
+		errlog(ERROR, errcode(ER_NUMERIC_VALUE_OUT_OF_RANGE),
+		       errmsg("Value \"%.*s\" is out of range for type %s",
+			      (int)len, data, dtypes[col->typeoid].name),
+		       errdetail(copy_context(in)));
+		return 1;
+	}
+	return 0;
+}
+
+/* Store the binary representation of a field into the tuple being built */
+static int store_binary_field(struct copy_in *in, u16 colno, const u8 *data,
+			      u32 len)
+{
+	struct column *col = &in->copy->table->cols[colno];
+	u8	      *dst = in->tup + in->offsets[colno];
+	u16	       v2;
+	u32	       v4;
+	u32	       lo;
+	u64	       v8;
+
+	if (col->typeoid == DTYPE_CHAR)
+		return store_field(in, colno, data, len);
+
+	if (len != dtype_len(col->typeoid, col->typemod))
+		return bad_format(in, "Incorrect binary data format");
+	switch (col->typeoid) {
+	case DTYPE_INT2:
+		ut_read_2(data, &v2);
+		memcpy(dst, &v2, sizeof(v2));
+		break;
+	case DTYPE_INT4:
+		ut_read_4(data, &v4);
+		memcpy(dst, &v4, sizeof(v4));
+		break;
+	case DTYPE_INT8:
+		ut_read_4(data, &v4);
+		ut_read_4(data + 4, &lo);
+		v8 = (u64)v4 << 32 | lo;
+		memcpy(dst, &v8, sizeof(v8));
+		break;
+	}
+	return 0;
+}
+
+/* Append the tuple built from the current row to the staged pages */
+static void add_row(struct copy_in *in)
+{
+	if (in->page == NULL ||
+	    heap_page_free_space(in->page) < in->tupsize) {
+		if (in->page != NULL)
+			vec_push(&in->pages, in->page);
+		in->page = malloc(PAGE_SIZE);
+		heap_page_init(in->page);
+	}
+	heap_page_add_tuple(in->page, in->tup, in->tupsize);
+	in->nrows++;
+}
+
+static int check_field_count(struct copy_in *in, u16 nfields)
+{
+	struct table *table = in->copy->table;
+	char	      msg[128];
+
+	if (nfields > table->ncols)
+		return bad_format(in, "Extra data after last expected column");
+	if (nfields < table->ncols) {
+		snprintf(msg, sizeof(msg), "Missing data for column %s",
+			 table->cols[nfields].name);
+		return bad_format(in, msg);
+	}
+	return 0;
+}
+
+static int is_end_marker(const u8 *ptr, const u8 *end)
+{
+	if (end - ptr == 3 && ptr[2] == '\r')
+		end--;
+	return end - ptr == 2 && ptr[0] == '\\' && ptr[1] == '.';
+}
+
+static int hex_digit(u8 c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/* Decode the character escaped by a backslash at ptr[-1] into *c, returning
+ * the end of the sequence. As in PostgreSQL, the escapes are those of C, with
+ * one to three octal digits or x and one or two hex digits for any byte, and
+ * any other character stands for itself. */
+static const u8 *text_escape(const u8 *ptr, const u8 *end, u8 *c)
+{
+	int i;
+
+	*c = *ptr++;
+	switch (*c) {
+	case 'b':
+		*c = '\b';
+		break;
+	case 'f':
+		*c = '\f';
+		break;
+	case 'n':
+		*c = '\n';
+		break;
+	case 'r':
+		*c = '\r';
+		break;
+	case 't':
+		*c = '\t';
+		break;
+	case 'v':
+		*c = '\v';
+		break;
+	case 'x':
+		if (ptr == end || hex_digit(*ptr) < 0)
+			break;
+		*c = hex_digit(*ptr++);
+		if (ptr < end && hex_digit(*ptr) >= 0)
+			*c = *c * 16 + hex_digit(*ptr++);
+		break;
+	case '0':
+	case '1':
+	case '2':
+	case '3':
+	case '4':
+	case '5':
+	case '6':
+	case '7':
+		/* the value wraps around to a byte like in PostgreSQL */
+		*c -= '0';
+		for (i = 1; i < 3 && ptr < end && *ptr >= '0' && *ptr <= '7';
+		     ++i)
+			*c = *c * 8 + *ptr++ - '0';
+		break;
+	}
+	return ptr;
+}
+
+/* Load a line of the text format, without its line terminator */
+static int parse_text_line(struct copy_in *in, const u8 *ptr, const u8 *end)
+{
+	u16    colno = 0;
+	size_t len;
+	u8     c;
+
+	if (end > ptr && end[-1] == '\r')
+		end--;
+	for (;;) {
+		if (end - ptr >= 2 && ptr[0] == '\\' && ptr[1] == 'N' &&
+		    (end - ptr == 2 || ptr[2] == '\t'))
+			return null_value(in, colno);
+
+		len = 0;
+		while (ptr < end && *ptr != '\t') {
+			c = *ptr++;
+			if (c == '\\' && ptr < end)
+				ptr = text_escape(ptr, end, &c);
+			if (len == PAGE_SIZE)
+				return bad_format(in, "Field is too long");
+			in->field[len++] = c;
+		}
+
+		if (colno >= in->copy->table->ncols)
+			return check_field_count(in, colno + 1);
+		if (store_field(in, colno, in->field, len))
+			return 1;
+		colno++;
+		if (ptr == end)
+			break;
+		/* skip the delimiter */
+		ptr++;
+	}
+	if (check_field_count(in, colno))
+		return 1;
+	add_row(in);
+	return 0;
+}
+
+static ssize_t parse_text(struct copy_in *in, const u8 *buf, size_t len,
+			  int final)
+{
+	const u8 *ptr = buf;
+	const u8 *end = buf + len;
+	const u8 *eol;
+
+	while (ptr < end && !in->eof) {
+		eol = memchr(ptr, '\n', end - ptr);
+		if (eol == NULL) {
+			if (!final)
+				break;
+			eol = end;
+		}
+		if (is_end_marker(ptr, eol))
+			in->eof = 1;
+		else if (parse_text_line(in, ptr, eol))
+			return -1;
+		ptr = eol < end ? eol + 1 : end;
+	}
+	return ptr - buf;
+}
+
+/* Load a row of the CSV format, which may span several lines when fields are
+ * quoted. Returns 2 if more input is needed to complete the row. */
+static int parse_csv_row(struct copy_in *in, const u8 *ptr, const u8 *end,
+			 int final, const u8 **next)
+{
+	u16    colno = 0;
+	size_t len;
+	int    quoted;
+	int    has_quotes;
+
+	for (;;) {
+		len	   = 0;
+		quoted	   = 0;
+		has_quotes = 0;
+		for (;;) {
+			if (ptr == end) {
+				if (!final)
+					return 2;
+				if (quoted)
+					return bad_format(
+						in, "Unterminated CSV quoted field");
+				break;
+			}
+			if (quoted && *ptr == '"') {
+				if (ptr + 1 == end && !final)
+					return 2;
+				if (ptr + 1 < end && ptr[1] == '"')
+					ptr++;
+				else {
+					quoted = 0;
+					ptr++;
+					continue;
+				}
+			} else if (!quoted) {
+				if (*ptr == ',' || *ptr == '\n' || *ptr == '\r')
+					break;
+				if (*ptr == '"') {
+					quoted = has_quotes = 1;
+					ptr++;
+					continue;
+				}
+			}
+			if (len == PAGE_SIZE)
+				return bad_format(in, "Field is too long");
+			in->field[len++] = *ptr++;
+		}
+
+		if (colno >= in->copy->table->ncols)
+			return check_field_count(in, colno + 1);
+		if (len == 0 && !has_quotes)
+			return null_value(in, colno);
+		if (store_field(in, colno, in->field, len))
+			return 1;
+		colno++;
+		if (ptr == end || *ptr != ',')
+			break;
+		ptr++;
+	}
+
+	if (ptr < end && *ptr == '\r')
+		ptr++;
+	if (ptr < end && *ptr == '\n')
+		ptr++;
+	else if (ptr == end && !final)
+		return 2;
+	if (check_field_count(in, colno))
+		return 1;
+	add_row(in);
+	*next = ptr;
+	return 0;
+}
+
+static ssize_t parse_csv(struct copy_in *in, const u8 *buf, size_t len,
+			 int final)
+{
+	const u8 *ptr = buf;
+	const u8 *end = buf + len;
+	const u8 *eol;
+	int	  rc;
+
+	while (ptr < end && !in->eof) {
+		/* the end marker must be alone on its line */
+		if (end - ptr >= 2 && ptr[0] == '\\' && ptr[1] == '.') {
+			eol = memchr(ptr, '\n', end - ptr);
+			if (eol == NULL && !final)
+				break;
+			if (is_end_marker(ptr, eol ? eol : end)) {
+				in->eof = 1;
+				ptr	= eol ? eol + 1 : end;
+				break;
+			}
+		}
+		rc = parse_csv_row(in, ptr, end, final, &ptr);
+		if (rc == 1)
+			return -1;
+		if (rc == 2)
+			break;
+	}
+	return ptr - buf;
+}
+
+static ssize_t parse_binary(struct copy_in *in, const u8 *buf, size_t len,
+			    int final)
+{
+	const u8 *ptr = buf;
+	const u8 *end = buf + len;
+	const u8 *p;
+	u32	  flags;
+	u32	  extlen;
+	u32	  fieldlen;
+	u16	  nfields;
+	u16	  colno;
+
+	if (!in->header_done) {
+		/* signature, flags field and header extension length */
+		if (end - ptr < sizeof(binary_signature) + 8)
+			goto incomplete;
+		if (memcmp(ptr, binary_signature, sizeof(binary_signature)) !=
+		    0) {
+			bad_format(in, "COPY file signature not recognized");
+			return -1;
+		}
+		ut_read_4(ptr + sizeof(binary_signature), &flags);
+		ut_read_4(ptr + sizeof(binary_signature) + 4, &extlen);
+		if (flags & (1 << 16)) {
+			bad_format(in, "COPY file with OIDs is not supported");
+			return -1;
+		}
+		if (end - ptr - sizeof(binary_signature) - 8 < extlen)
+			goto incomplete;
+		ptr += sizeof(binary_signature) + 8 + extlen;
+		in->header_done = 1;
+	}
+
+	while (!in->eof) {
+		if (end - ptr < 2)
+			goto incomplete;
+		ut_read_2(ptr, &nfields);
+		if (nfields == (u16)-1) {
+			in->eof = 1;
+			return end - buf;
+		}
+		if (check_field_count(in, nfields))
+			return -1;
+
+		/* make sure the whole row is there before loading it */
+		p = ptr + 2;
+		for (colno = 0; colno < nfields; ++colno) {
+			if (end - p < 4)
+				goto incomplete;
+			ut_read_4(p, &fieldlen);
+			p += 4;
+			if (fieldlen == (u32)-1)
+				continue;
+			if (end - p < fieldlen)
+				goto incomplete;
+			p += fieldlen;
+		}
+
+		p = ptr + 2;
+		for (colno = 0; colno < nfields; ++colno) {
+			ut_read_4(p, &fieldlen);
+			p += 4;
+			if (fieldlen == (u32)-1) {
+				null_value(in, colno);
+				return -1;
+			}
+			if (store_binary_field(in, colno, p, fieldlen))
+				return -1;
+			p += fieldlen;
+		}
+		add_row(in);
+		ptr = p;
+	}
+	return end - buf;
+
+incomplete:
+	if (final) {
+		bad_format(in, "Unexpected EOF in COPY data");
+		return -1;
+	}
+	return ptr - buf;
+}
+
+/* Load the complete rows at the beginning of buf. Returns the number of bytes
+ * consumed, or -1 on error. When final is set there is no more input and
+ * incomplete rows are an error. */
+static ssize_t parse_rows(struct copy_in *in, const u8 *buf, size_t len,
+			  int final)
+{
+	switch (in->copy->format) {
+	case COPY_FORMAT_TEXT:
+		return parse_text(in, buf, len, final);
+	case COPY_FORMAT_CSV:
+		return parse_csv(in, buf, len, final);
+	case COPY_FORMAT_BINARY:
+		return parse_binary(in, buf, len, final);
+	}
+	return -1;
+}
+
+static void append_pending(struct copy_in *in, const u8 *data, size_t len)
+{
+	if (in->pending_len + len > in->pending_cap) {
+		in->pending_cap = in->pending_cap ? in->pending_cap : 1024;
+		while (in->pending_len + len > in->pending_cap)
+			in->pending_cap *= 2;
+		in->pending = realloc(in->pending, in->pending_cap);
+	}
+	memcpy(in->pending + in->pending_len, data, len);
+	in->pending_len += len;
+}
+
+int copy_in_data(struct copy_in *in, const u8 *data, size_t len)
+{
+	ssize_t n;
+
+	if (in->eof)
+		return 0;
+
+	/* fast path: parse straight from the message when nothing is left over
+	 * from the previous chunk */
+	if (in->pending_len == 0) {
+		n = parse_rows(in, data, len, 0);
+		if (n < 0)
+			return 1;
+		append_pending(in, data + n, len - n);
+		return 0;
+	}
+
+	append_pending(in, data, len);
+	n = parse_rows(in, in->pending, in->pending_len, 0);
+	if (n < 0)
+		return 1;
+	memmove(in->pending, in->pending + n, in->pending_len - n);
+	in->pending_len -= n;
+	return 0;
+}
+
+int copy_in_end(struct copy_in *in)
+{
+	struct heap *heap = heaps[in->copy->table->oid];
+	size_t	     i;
+
+	if (!in->eof && (in->pending_len > 0 ||
+			 (in->copy->format == COPY_FORMAT_BINARY &&
+			  !in->header_done))) {
+		if (parse_rows(in, in->pending, in->pending_len, 1) < 0) {
+			copy_in_abort(in);
+			return 1;
+		}
+	}
+
+	if (in->page != NULL)
+		vec_push(&in->pages, in->page);
+	for (i = 0; i < in->pages.size; ++i)
+		heap_add_page(heap, in->pages.data[i]);
+	in->page = NULL;
+	vec_free(&in->pages);
+	free(in->pending);
+	in->pending = NULL;
+	return 0;
+}
+
+void copy_in_abort(struct copy_in *in)
+{
+	size_t i;
+
+	for (i = 0; i < in->pages.size; ++i)
+		free(in->pages.data[i]);
+	vec_free(&in->pages);
+	free(in->page);
+	free(in->pending);
+	in->page    = NULL;
+	in->pending = NULL;
+}
@@ -0,0 +1,97 @@
+/* Bulk transfer of table data with COPY */
+
+#ifndef COPY_H
+#define COPY_H
+
+#include "executor/tablescan.h"
+#include "parser/parser.h"
+#include "storage/heap.h"
+#include "table.h"
+#include "univ.h"
+#include "util/vec.h"
+
+/* Size of the chunks of data produced by COPY TO. Must be large enough to
+ * hold the encoding of any single row. */
+#define COPY_CHUNK_SIZE (65536)
+
+enum copy_format { COPY_FORMAT_TEXT, COPY_FORMAT_CSV, COPY_FORMAT_BINARY };
+
+/* A fully-resolved representation of a copy statement */
+struct copy {
+	enum sql_command command;
+
+	struct table *table;
+
+	/* nonzero for COPY FROM STDIN, zero for COPY TO STDOUT */
+	int from;
+
+	enum copy_format format;
+};
+
+/* State of a COPY TO in progress */
+struct copy_out {
+	struct copy	     *copy;
+	struct tablescan_iter iter;
+	/* offset of each column within a tuple */
+	size_t *offsets;
+	/* upper bound on the encoded size of a single row */
+	size_t maxrowlen;
+	/* the current tuple of iter has not been encoded yet */
+	int pending;
+	int started;
+	int eof;
+	/* number of rows encoded so far */
+	u64 nrows;
+};
+
+/* Start copying the rows of the table out */
+void copy_out_begin(struct copy_out *out, struct copy *copy);
+
+/* Encode as many rows as fit in buf, which must be at least COPY_CHUNK_SIZE
+ * bytes. Returns the number of bytes written, or 0 once all rows are done. */
+size_t copy_out_next(struct copy_out *out, u8 *buf);
+
+void copy_out_end(struct copy_out *out);
+
+/* State of a COPY FROM in progress */
+struct copy_in {
+	struct copy *copy;
+	/* offset of each column within a tuple */
+	size_t *offsets;
+	/* size of a tuple of the table */
+	size_t tupsize;
+	/* tuple being built from the current row */
+	u8 *tup;
+	/* scratch space for unescaping a field */
+	u8 *field;
+	/* page being filled, and the full pages not yet added to the heap
+	 * (list of struct heap_page) */
+	struct heap_page *page;
+	struct vec	  pages;
+	/* input following the last complete row, waiting for more data */
+	u8    *pending;
+	size_t pending_len;
+	size_t pending_cap;
+	/* the binary file header has been read */
+	int header_done;
+	/* the end of data marker has been read */
+	int eof;
+	/* number of rows loaded so far */
+	u64 nrows;
+};
+
+/* Start loading rows into the table */
+void copy_in_begin(struct copy_in *in, struct copy *copy);
+
+/* Load the rows from the next chunk of input data. Rows may span chunks.
+ * Returns nonzero on error. */
+int copy_in_data(struct copy_in *in, const u8 *data, size_t len);
+
+/* Finish loading once all data has been received, adding the new rows to the
+ * table. Nothing is added if an error is returned. */
+int copy_in_end(struct copy_in *in);
+
+/* Discard the rows loaded so far */
+void copy_in_abort(struct copy_in *in);
+
+#endif // COPY_H
@@ -13,12 +13,10 @@
 #include "connection.h"
 #include "parser/parser.h"
 
-extern struct heap_page *heap_pages[];
-
 int sql_create_table(struct create *create)
 {
 	struct table table;
-	struct heap_page *heap;
+	struct heap *heap;
 	int i;
 
 	assert(create->command == COM_CREATE);
@@ -33,12 +31,15 @@ int sql_create_table(struct create *create)
 		table.cols[i].typeoid = col->typeoid;
 	}
 
-	if (sys_add_table(&table))
+	heap = malloc(sizeof(struct heap));
+	heap_init(heap);
+	/* the catalog keeps its own copy of the columns */
+	if (sys_add_table(&table, heap)) {
+		free(table.cols);
+		free(heap);
 		return 1;
-
-	heap = malloc(PAGE_SIZE);
-	heap_page_init(heap);
-	heap_pages[table.oid] = heap;
+	}
+	free(table.cols);
 
 	return 0;
 }
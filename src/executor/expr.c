@@ -0,0 +1,676 @@
+#include "executor/expr.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "dtype.h"
+#include "util/error.h"
+#include "util/mem.h"
+
+/* Opcodes of integer arithmetic come in threes, one for each integer type of
+ * the result, in the order given by int_index() */
+enum expr_opcode {
+	OPC_LOAD_INT2,
+	OPC_LOAD_INT4,
+	OPC_LOAD_INT8,
+	OPC_LOAD_CHAR,
+	OPC_CONST_INT,
+	OPC_CONST_CHAR,
+	OPC_ADD_INT2,
+	OPC_ADD_INT4,
+	OPC_ADD_INT8,
+	OPC_SUB_INT2,
+	OPC_SUB_INT4,
+	OPC_SUB_INT8,
+	OPC_MUL_INT2,
+	OPC_MUL_INT4,
+	OPC_MUL_INT8,
+	OPC_DIV_INT2,
+	OPC_DIV_INT4,
+	OPC_DIV_INT8,
+	OPC_NEG_INT2,
+	OPC_NEG_INT4,
+	OPC_NEG_INT8,
+	OPC_MOD_INT,
+	/* comparisons, in the order of enum expr_op */
+	OPC_EQ_INT,
+	OPC_NE_INT,
+	OPC_LT_INT,
+	OPC_LE_INT,
+	OPC_GT_INT,
+	OPC_GE_INT,
+	OPC_EQ_CHAR,
+	OPC_NE_CHAR,
+	OPC_LT_CHAR,
+	OPC_LE_CHAR,
+	OPC_GT_CHAR,
+	OPC_GE_CHAR,
+	OPC_LIKE_CHAR,
+	OPC_NOT,
+	/* skip to instruction b if register a is false, resp. true */
+	OPC_JUMP_FALSE,
+	OPC_JUMP_TRUE,
+	/* programs reading nullable columns: a value starts out not null, and
+	 * is set to null, skipping to instruction b, as soon as source a is
+	 * null for the row */
+	OPC_CLEAR_NULL,
+	OPC_JUMP_NULL,
+	/* three-valued variants of the logical operators, for such programs */
+	OPC_NOT3,
+	OPC_AND3,
+	OPC_OR3,
+	OPC_JUMP_FALSE3,
+	OPC_JUMP_TRUE3
+};
+
+struct expr_insn {
+	u8  opcode;
+	/* destination register */
+	u16 dst;
+	/* operand registers, or index of the source for loads */
+	u16 a;
+	u16 b;
+	/* loads read len bytes at srcs[a] + off + row * stride */
+	u32 off;
+	u32 stride;
+	u32 len;
+	/* value of constants */
+	union expr_reg val;
+};
+
+struct compiler {
+	struct expr_prog *prog;
+	/* table whose tuples are evaluated, NULL for batches */
+	struct table *table;
+	const u16    *offsets;
+	/* tables whose columns may be null, NULL if none */
+	const u8 *nullable;
+	/* register of the value being computed, which is null if any column
+	 * it reads is, and the jumps to patch to the end of its instructions */
+	int  in_value;
+	u16  value_dst;
+	u16 *jumps;
+	u16  njumps;
+};
+
+static int int_index(u32 typeoid)
+{
+	switch (typeoid) {
+	case DTYPE_INT2:
+		return 0;
+	case DTYPE_INT4:
+		return 1;
+	default:
+		assert(typeoid == DTYPE_INT8);
+		return 2;
+	}
+}
+
+static u16 count_nodes(struct expr *expr)
+{
+	if (expr->type != EXPR_OP)
+		return 1;
+	return 1 + count_nodes(expr->left) +
+	       (expr->right ? count_nodes(expr->right) : 0);
+}
+
+static struct expr_insn *emit(struct compiler *c, u8 opcode, u16 dst)
+{
+	struct expr_insn *insn = &c->prog->insns[c->prog->ninsns++];
+
+	memset(insn, 0, sizeof(struct expr_insn));
+	insn->opcode = opcode;
+	insn->dst    = dst;
+	return insn;
+}
+
+/* Characters of a char value, without the padding */
+static u32 char_len(const u8 *str, u32 width)
+{
+	const u8 *end = memchr(str, '\0', width);
+	u32	  len = end ? end - str : width;
+
+	while (len > 0 && str[len - 1] == ' ')
+		--len;
+	return len;
+}
+
+static void compile_column(struct compiler *c, struct expr *expr, u16 dst)
+{
+	struct expr_insn *insn;
+	u8		  opcode;
+	u16		  colno;
+
+	if (expr->typeoid == DTYPE_CHAR)
+		opcode = OPC_LOAD_CHAR;
+	else
+		opcode = OPC_LOAD_INT2 + int_index(expr->typeoid);
+	insn	  = emit(c, opcode, dst);
+	insn->len = dtype_len(expr->typeoid, expr->typemod);
+	if (c->table) {
+		for (colno = 0; colno < expr->colno; ++colno)
+			insn->off += dtype_len(c->table->cols[colno].typeoid,
+					       c->table->cols[colno].typemod);
+	} else {
+		insn->a	     = c->offsets[expr->tableno] + expr->colno;
+		insn->stride = insn->len;
+		if (c->nullable && c->nullable[expr->tableno]) {
+			c->jumps[c->njumps++] = c->prog->ninsns;
+			emit(c, OPC_JUMP_NULL, c->value_dst)->a = insn->a;
+		}
+	}
+}
+
+static int is_logical(struct expr *expr)
+{
+	return expr->type == EXPR_OP &&
+	       (expr->op == EXPR_AND || expr->op == EXPR_OR ||
+		expr->op == EXPR_NOT);
+}
+
+static int reads_nullable(struct compiler *c, struct expr *expr)
+{
+	switch (expr->type) {
+	case EXPR_CONST:
+		return 0;
+	case EXPR_COLUMN:
+		return c->nullable && c->table == NULL &&
+		       c->nullable[expr->tableno];
+	case EXPR_OP:
+		break;
+	}
+	return reads_nullable(c, expr->left) ||
+	       (expr->right && reads_nullable(c, expr->right));
+}
+
+static void compile(struct compiler *c, struct expr *expr, u16 dst);
+
+/* Emit an operand of a three-valued logical operator, whose null flag must be
+ * set even if it reads no nullable column */
+static void compile_operand(struct compiler *c, struct expr *expr, u16 dst)
+{
+	if (!reads_nullable(c, expr))
+		emit(c, OPC_CLEAR_NULL, dst);
+	compile(c, expr, dst);
+}
+
+/* Emit the three-valued logical operators, for programs reading nullable
+ * columns. The right operand goes to another register, as the result depends
+ * on both operands when the left one is null. */
+static void compile_logical3(struct compiler *c, struct expr *expr, u16 dst)
+{
+	struct expr_insn *jump;
+	struct expr_insn *insn;
+	u16		  tmp;
+
+	compile_operand(c, expr->left, dst);
+	if (expr->op == EXPR_NOT) {
+		emit(c, OPC_NOT3, dst)->a = dst;
+		return;
+	}
+	jump = emit(c,
+		    expr->op == EXPR_AND ? OPC_JUMP_FALSE3 : OPC_JUMP_TRUE3,
+		    dst);
+	jump->a = dst;
+	tmp	= c->prog->nregs++;
+	compile_operand(c, expr->right, tmp);
+	insn	= emit(c, expr->op == EXPR_AND ? OPC_AND3 : OPC_OR3, dst);
+	insn->a = dst;
+	insn->b = tmp;
+	jump->b = c->prog->ninsns;
+}
+
+/* Emit the instructions of a value read from nullable columns, which is null
+ * as soon as one of them is */
+static void compile_nullable(struct compiler *c, struct expr *expr, u16 dst)
+{
+	u16 i;
+
+	emit(c, OPC_CLEAR_NULL, dst);
+	c->in_value  = 1;
+	c->value_dst = dst;
+	c->njumps    = 0;
+	compile(c, expr, dst);
+	for (i = 0; i < c->njumps; ++i)
+		c->prog->insns[c->jumps[i]].b = c->prog->ninsns;
+	c->in_value = 0;
+}
+
+/* Emit the instructions leaving the value of expr in register dst */
+static void compile(struct compiler *c, struct expr *expr, u16 dst)
+{
+	struct expr_insn *insn;
+	u16		  tmp;
+
+	if (!c->in_value && reads_nullable(c, expr)) {
+		if (is_logical(expr))
+			compile_logical3(c, expr, dst);
+		else
+			compile_nullable(c, expr, dst);
+		return;
+	}
+
+	switch (expr->type) {
+	case EXPR_CONST:
+		if (expr->typeoid == DTYPE_CHAR) {
+			insn	      = emit(c, OPC_CONST_CHAR, dst);
+			insn->val.str = (const u8 *)expr->val_str;
+			insn->val.len = char_len(insn->val.str, expr->typemod);
+		} else {
+			insn		  = emit(c, OPC_CONST_INT, dst);
+			insn->val.val_int = expr->val_int;
+		}
+		return;
+	case EXPR_COLUMN:
+		compile_column(c, expr, dst);
+		return;
+	case EXPR_OP:
+		break;
+	}
+
+	switch (expr->op) {
+	case EXPR_AND:
+	case EXPR_OR:
+		/* the right operand is skipped when the left one decides */
+		compile(c, expr->left, dst);
+		insn = emit(c,
+			    expr->op == EXPR_AND ? OPC_JUMP_FALSE : OPC_JUMP_TRUE,
+			    dst);
+		insn->a = dst;
+		compile(c, expr->right, dst);
+		insn->b = c->prog->ninsns;
+		return;
+	case EXPR_NOT:
+		compile(c, expr->left, dst);
+		emit(c, OPC_NOT, dst)->a = dst;
+		return;
+	case EXPR_NEG:
+		compile(c, expr->left, dst);
+		emit(c, OPC_NEG_INT2 + int_index(expr->typeoid), dst)->a = dst;
+		return;
+	default:
+		break;
+	}
+
+	tmp = c->prog->nregs++;
+	compile(c, expr->left, dst);
+	compile(c, expr->right, tmp);
+	switch (expr->op) {
+	case EXPR_ADD:
+		insn = emit(c, OPC_ADD_INT2 + int_index(expr->typeoid), dst);
+		break;
+	case EXPR_SUB:
+		insn = emit(c, OPC_SUB_INT2 + int_index(expr->typeoid), dst);
+		break;
+	case EXPR_MUL:
+		insn = emit(c, OPC_MUL_INT2 + int_index(expr->typeoid), dst);
+		break;
+	case EXPR_DIV:
+		insn = emit(c, OPC_DIV_INT2 + int_index(expr->typeoid), dst);
+		break;
+	case EXPR_MOD:
+		insn = emit(c, OPC_MOD_INT, dst);
+		break;
+	case EXPR_LIKE:
+		insn = emit(c, OPC_LIKE_CHAR, dst);
+		break;
+	default:
+		insn = emit(c,
+			    (expr->left->typeoid == DTYPE_CHAR ? OPC_EQ_CHAR :
+								 OPC_EQ_INT) +
+				    expr->op - EXPR_EQ,
+			    dst);
+		break;
+	}
+	insn->a = dst;
+	insn->b = tmp;
+}
+
+static struct expr_prog *compile_prog(struct compiler *c, struct expr *expr)
+{
+	struct expr_prog *prog = mem_zalloc(sizeof(struct expr_prog));
+	u16		  nnodes = count_nodes(expr);
+
+	/* a column read as a value of its own takes three instructions */
+	prog->insns = mem_alloc(sizeof(struct expr_insn) * 3 * nnodes);
+	prog->nregs = 1;
+	c->prog	    = prog;
+	c->jumps    = mem_alloc(sizeof(u16) * nnodes);
+	compile(c, expr, 0);
+	prog->regs  = mem_alloc(sizeof(union expr_reg) * prog->nregs);
+	prog->nulls = mem_zalloc(prog->nregs);
+	return prog;
+}
+
+struct expr_prog *expr_compile_tuple(struct expr *expr, struct table *table)
+{
+	struct compiler c = { .table = table };
+
+	return compile_prog(&c, expr);
+}
+
+struct expr_prog *expr_compile_batch(struct expr *expr, const u16 *offsets,
+				     const u8 *nullable)
+{
+	struct compiler c = { .offsets = offsets, .nullable = nullable };
+
+	return compile_prog(&c, expr);
+}
+
+static int cmp_char(const union expr_reg *a, const union expr_reg *b)
+{
+	int cmp = memcmp(a->str, b->str, a->len < b->len ? a->len : b->len);
+
+	if (cmp != 0)
+		return cmp;
+	return (a->len > b->len) - (a->len < b->len);
+}
+
+/* Match a string against a LIKE pattern. On a mismatch after a %, the
+ * match resumes one character further after that %. */
+static int like_match(const union expr_reg *str, const union expr_reg *pat)
+{
+	u32 s	   = 0;
+	u32 p	   = 0;
+	u32 star   = UINT32_MAX;
+	u32 resume = 0;
+
+	while (s < str->len) {
+		if (p < pat->len && pat->str[p] == '%') {
+			star   = p++;
+			resume = s;
+		} else if (p < pat->len &&
+			   (pat->str[p] == '_' || pat->str[p] == str->str[s])) {
+			++s;
+			++p;
+		} else if (star != UINT32_MAX) {
+			p = star + 1;
+			s = ++resume;
+		} else {
+			return 0;
+		}
+	}
+	while (p < pat->len && pat->str[p] == '%')
+		++p;
+	return p == pat->len;
+}
+
+static int out_of_range(const char *type)
+{
+	errlog(ERROR, errcode(ER_NUMERIC_VALUE_OUT_OF_RANGE),
+	       errmsg("Value is out of range for type %s", type));
+	return -1;
+}
+
+static int division_by_zero(void)
+{
+	errlog(ERROR, errcode(ER_DIVISION_BY_ZERO),
+	       errmsg("Division by zero"));
+	return -1;
+}
+
+/* Arithmetic on int2 and int4 cannot overflow 64 bits, only the range of the
+ * result type needs checking */
+#define NARROW_ARITH(opc, op, min, max, name)                       \
+	case opc:                                                   \
+		res = r[in->a].val_int op r[in->b].val_int;         \
+		if (res < min || res > max)                         \
+			return out_of_range(name);                  \
+		r[in->dst].val_int = res;                           \
+		break
+#define NARROW_DIV(opc, min, max, name)                             \
+	case opc:                                                   \
+		if (r[in->b].val_int == 0)                          \
+			return division_by_zero();                  \
+		res = r[in->a].val_int / r[in->b].val_int;          \
+		if (res < min || res > max)                         \
+			return out_of_range(name);                  \
+		r[in->dst].val_int = res;                           \
+		break
+#define NARROW_NEG(opc, min, max, name)                             \
+	case opc:                                                   \
+		res = -r[in->a].val_int;                            \
+		if (res < min || res > max)                         \
+			return out_of_range(name);                  \
+		r[in->dst].val_int = res;                           \
+		break
+#define INT8_ARITH(opc, fn)                                                 \
+	case opc:                                                           \
+		if (fn(r[in->a].val_int, r[in->b].val_int, &r[in->dst].val_int)) \
+			return out_of_range("int8");                      \
+		break
+#define INT_CMP(opc, op)                                                    \
+	case opc:                                                           \
+		r[in->dst].val_int = r[in->a].val_int op r[in->b].val_int; \
+		break
+#define CHAR_CMP(opc, op)                                                   \
+	case opc:                                                           \
+		r[in->dst].val_int = cmp_char(&r[in->a], &r[in->b]) op 0;  \
+		break
+
+/* Run a program, leaving its result in the first register. Returns -1 on
+ * error. */
+static int run(struct expr_prog *prog, u8 *const *srcs, u8 *const *nulls,
+	       u16 row)
+{
+	union expr_reg		*r = prog->regs;
+	u8			*n = prog->nulls;
+	const struct expr_insn *in;
+	const u8	       *p;
+	i16			v2;
+	i32			v4;
+	i64			res;
+	u16			pc = 0;
+
+	while (pc < prog->ninsns) {
+		in = &prog->insns[pc++];
+		switch (in->opcode) {
+		case OPC_LOAD_INT2:
+			p = srcs[in->a] + in->off + (size_t)row * in->stride;
+			memcpy(&v2, p, 2);
+			r[in->dst].val_int = v2;
+			break;
+		case OPC_LOAD_INT4:
+			p = srcs[in->a] + in->off + (size_t)row * in->stride;
+			memcpy(&v4, p, 4);
+			r[in->dst].val_int = v4;
+			break;
+		case OPC_LOAD_INT8:
+			p = srcs[in->a] + in->off + (size_t)row * in->stride;
+			memcpy(&r[in->dst].val_int, p, 8);
+			break;
+		case OPC_LOAD_CHAR:
+			p = srcs[in->a] + in->off + (size_t)row * in->stride;
+			r[in->dst].str = p;
+			r[in->dst].len = char_len(p, in->len);
+			break;
+		case OPC_CONST_INT:
+		case OPC_CONST_CHAR:
+			r[in->dst] = in->val;
+			break;
+		NARROW_ARITH(OPC_ADD_INT2, +, INT16_MIN, INT16_MAX, "int2");
+		NARROW_ARITH(OPC_ADD_INT4, +, INT32_MIN, INT32_MAX, "int4");
+		INT8_ARITH(OPC_ADD_INT8, __builtin_add_overflow);
+		NARROW_ARITH(OPC_SUB_INT2, -, INT16_MIN, INT16_MAX, "int2");
+		NARROW_ARITH(OPC_SUB_INT4, -, INT32_MIN, INT32_MAX, "int4");
+		INT8_ARITH(OPC_SUB_INT8, __builtin_sub_overflow);
+		NARROW_ARITH(OPC_MUL_INT2, *, INT16_MIN, INT16_MAX, "int2");
+		NARROW_ARITH(OPC_MUL_INT4, *, INT32_MIN, INT32_MAX, "int4");
+		INT8_ARITH(OPC_MUL_INT8, __builtin_mul_overflow);
+		NARROW_DIV(OPC_DIV_INT2, INT16_MIN, INT16_MAX, "int2");
+		NARROW_DIV(OPC_DIV_INT4, INT32_MIN, INT32_MAX, "int4");
+		case OPC_DIV_INT8:
+			if (r[in->b].val_int == 0)
+				return division_by_zero();
+			if (r[in->b].val_int == -1) {
+				if (r[in->a].val_int == INT64_MIN)
+					return out_of_range("int8");
+				r[in->dst].val_int = -r[in->a].val_int;
+			} else {
+				r[in->dst].val_int =
+					r[in->a].val_int / r[in->b].val_int;
+			}
+			break;
+		NARROW_NEG(OPC_NEG_INT2, INT16_MIN, INT16_MAX, "int2");
+		NARROW_NEG(OPC_NEG_INT4, INT32_MIN, INT32_MAX, "int4");
+		case OPC_NEG_INT8:
+			if (r[in->a].val_int == INT64_MIN)
+				return out_of_range("int8");
+			r[in->dst].val_int = -r[in->a].val_int;
+			break;
+		case OPC_MOD_INT:
+			if (r[in->b].val_int == 0)
+				return division_by_zero();
+			/* INT64_MIN % -1 traps */
+			if (r[in->b].val_int == -1)
+				r[in->dst].val_int = 0;
+			else
+				r[in->dst].val_int =
+					r[in->a].val_int % r[in->b].val_int;
+			break;
+		INT_CMP(OPC_EQ_INT, ==);
+		INT_CMP(OPC_NE_INT, !=);
+		INT_CMP(OPC_LT_INT, <);
+		INT_CMP(OPC_LE_INT, <=);
+		INT_CMP(OPC_GT_INT, >);
+		INT_CMP(OPC_GE_INT, >=);
+		CHAR_CMP(OPC_EQ_CHAR, ==);
+		CHAR_CMP(OPC_NE_CHAR, !=);
+		CHAR_CMP(OPC_LT_CHAR, <);
+		CHAR_CMP(OPC_LE_CHAR, <=);
+		CHAR_CMP(OPC_GT_CHAR, >);
+		CHAR_CMP(OPC_GE_CHAR, >=);
+		case OPC_LIKE_CHAR:
+			r[in->dst].val_int = like_match(&r[in->a], &r[in->b]);
+			break;
+		case OPC_NOT:
+			r[in->dst].val_int = !r[in->a].val_int;
+			break;
+		case OPC_JUMP_FALSE:
+			if (!r[in->a].val_int)
+				pc = in->b;
+			break;
+		case OPC_JUMP_TRUE:
+			if (r[in->a].val_int)
+				pc = in->b;
+			break;
+		case OPC_CLEAR_NULL:
+			n[in->dst] = 0;
+			break;
+		case OPC_JUMP_NULL:
+			if (nulls && nulls[in->a] && nulls[in->a][row]) {
+				n[in->dst] = 1;
+				pc	   = in->b;
+			}
+			break;
+		case OPC_NOT3:
+			r[in->dst].val_int = !r[in->a].val_int;
+			n[in->dst]	   = n[in->a];
+			break;
+		case OPC_AND3:
+			/* the left operand is true or null */
+			if (!n[in->b] && !r[in->b].val_int) {
+				r[in->dst].val_int = 0;
+				n[in->dst]	   = 0;
+			} else {
+				r[in->dst].val_int = 1;
+				n[in->dst]	   = n[in->a] || n[in->b];
+			}
+			break;
+		case OPC_OR3:
+			/* the left operand is false or null */
+			if (!n[in->b] && r[in->b].val_int) {
+				r[in->dst].val_int = 1;
+				n[in->dst]	   = 0;
+			} else {
+				r[in->dst].val_int = 0;
+				n[in->dst]	   = n[in->a] || n[in->b];
+			}
+			break;
+		case OPC_JUMP_FALSE3:
+			if (!n[in->a] && !r[in->a].val_int)
+				pc = in->b;
+			break;
+		case OPC_JUMP_TRUE3:
+			if (!n[in->a] && r[in->a].val_int)
+				pc = in->b;
+			break;
+		default:
+			errlog(FATAL, errmsg("Unexpected opcode %d", in->opcode));
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int expr_eval_bool(struct expr_prog *prog, u8 *const *srcs, u8 *const *nulls,
+		   u16 row)
+{
+	if (run(prog, srcs, nulls, row))
+		return -1;
+	return !prog->nulls[0] && prog->regs[0].val_int != 0;
+}
+
+const union expr_reg *expr_eval(struct expr_prog *prog, u8 *const *srcs,
+				u8 *const *nulls, u16 row, u8 *isnull)
+{
+	if (run(prog, srcs, nulls, row))
+		return NULL;
+	*isnull = prog->nulls[0];
+	return &prog->regs[0];
+}
+
+int expr_table(struct expr *expr)
+{
+	int left;
+	int right;
+
+	switch (expr->type) {
+	case EXPR_CONST:
+		return -1;
+	case EXPR_COLUMN:
+		return expr->tableno;
+	case EXPR_OP:
+		break;
+	}
+	left  = expr_table(expr->left);
+	right = expr->right ? expr_table(expr->right) : -1;
+	if (left == -2 || right == -2 || (left >= 0 && right >= 0 && left != right))
+		return -2;
+	return left >= 0 ? left : right;
+}
+
+int expr_last_table(struct expr *expr)
+{
+	int left;
+	int right;
+
+	switch (expr->type) {
+	case EXPR_CONST:
+		return -1;
+	case EXPR_COLUMN:
+		return expr->tableno;
+	case EXPR_OP:
+		break;
+	}
+	left  = expr_last_table(expr->left);
+	right = expr->right ? expr_last_table(expr->right) : -1;
+	return left > right ? left : right;
+}
+
+void expr_columns(struct expr *expr, u16 tableno, u8 *needed)
+{
+	switch (expr->type) {
+	case EXPR_CONST:
+		break;
+	case EXPR_COLUMN:
+		if (expr->tableno == tableno)
+			needed[expr->colno] = 1;
+		break;
+	case EXPR_OP:
+		expr_columns(expr->left, tableno, needed);
+		if (expr->right)
+			expr_columns(expr->right, tableno, needed);
+		break;
+	}
+}
@@ -0,0 +1,131 @@
+/* Scalar expressions, and the programs they are compiled into for evaluation
+ * on each row */
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include "table.h"
+#include "univ.h"
+
+enum expr_type { EXPR_CONST, EXPR_COLUMN, EXPR_OP };
+
+enum expr_op {
+	EXPR_ADD,
+	EXPR_SUB,
+	EXPR_MUL,
+	EXPR_DIV,
+	EXPR_MOD,
+	EXPR_NEG,
+	EXPR_EQ,
+	EXPR_NE,
+	EXPR_LT,
+	EXPR_LE,
+	EXPR_GT,
+	EXPR_GE,
+	/* pattern match, % matches any characters and _ any one */
+	EXPR_LIKE,
+	EXPR_AND,
+	EXPR_OR,
+	EXPR_NOT
+};
+
+/* A type-checked expression */
+struct expr {
+	enum expr_type type;
+	/* type of the value of the expression */
+	u32 typeoid;
+	i32 typemod;
+	union {
+		/* EXPR_CONST: integer or boolean value, or typemod characters
+		 * of val_str */
+		struct {
+			i64	    val_int;
+			const char *val_str;
+		};
+		/* EXPR_COLUMN: column of a table of the from list */
+		struct {
+			u16 tableno;
+			u16 colno;
+		};
+		/* EXPR_OP: right is NULL for unary operators */
+		struct {
+			enum expr_op op;
+			struct expr *left;
+			struct expr *right;
+		};
+	};
+};
+
+/* Value of an expression while a program runs */
+union expr_reg {
+	i64 val_int;
+	struct {
+		const u8 *str;
+		u32	  len;
+	};
+};
+
+struct expr_insn;
+
+/* An expression compiled into a flat list of instructions, each specialized
+ * on the types of its operands */
+struct expr_prog {
+	u16		  ninsns;
+	struct expr_insn *insns;
+	/* scratch registers, the result is left in the first one */
+	u16		nregs;
+	union expr_reg *regs;
+	/* whether each register holds null, only set by programs reading
+	 * nullable columns */
+	u8 *nulls;
+};
+
+/* An aggregate function of the select list */
+enum agg_func { AGG_COUNT, AGG_SUM, AGG_MIN, AGG_MAX, AGG_AVG };
+
+struct agg_call {
+	enum agg_func func;
+	/* argument, NULL for count(*) */
+	struct expr *arg;
+	/* type of the result */
+	u32 typeoid;
+	i32 typemod;
+};
+
+/* Compile an expression referencing a single table of the from list, to be
+ * evaluated on the tuples of that table */
+struct expr_prog *expr_compile_tuple(struct expr *expr, struct table *table);
+
+/* Compile an expression to be evaluated on the rows of batches, where the
+ * columns of the table at index t of the from list start at offsets[t]. The
+ * columns of the tables flagged in nullable may hold nulls, which propagate
+ * through operators as in SQL. nullable may be NULL if there are none. */
+struct expr_prog *expr_compile_batch(struct expr *expr, const u16 *offsets,
+				     const u8 *nullable);
+
+/* Evaluate a program on a row. For programs compiled on tuples, srcs[0] is
+ * the tuple, nulls is NULL and row is 0. For programs compiled on batches,
+ * srcs and nulls hold the data and null flags of each column of the batch.
+ * Returns 1 if the expression is true, 0 if false or null, and -1 on
+ * error. */
+int expr_eval_bool(struct expr_prog *prog, u8 *const *srcs, u8 *const *nulls,
+		   u16 row);
+
+/* Evaluate a program computing an integer or char value on a row, setting
+ * *isnull if the value is null. The result is valid until the next
+ * evaluation. Returns NULL on error. */
+const union expr_reg *expr_eval(struct expr_prog *prog, u8 *const *srcs,
+				u8 *const *nulls, u16 row, u8 *isnull);
+
+/* Index in the from list of the last table the expression references, -1 if
+ * it references none */
+int expr_last_table(struct expr *expr);
+
+/* Index in the from list of the only table the expression references, -1 if
+ * it references none and -2 if several */
+int expr_table(struct expr *expr);
+
+/* Flag the columns of table tableno that the expression references */
+void expr_columns(struct expr *expr, u16 tableno, u8 *needed);
+
+#endif // EXPR_H
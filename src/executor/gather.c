@@ -0,0 +1,241 @@
+#include "executor/operator.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include "util/error.h"
+#include "util/mem.h"
+
+/* Gathering the rows of plans run by worker threads. A worker hands over the
+ * batches of its plan one at a time, and waits until the gather has consumed
+ * one before asking its plan for the next. */
+
+struct gather_op;
+
+struct gather_worker {
+	struct gather_op *gather;
+	struct operator	 *plan;
+	pthread_t	  thread;
+	/* root of the allocations of the plan while on the worker thread */
+	struct mem_root mem_root;
+	/* the following are protected by the lock of the gather */
+	/* batch handed over and not yet consumed, NULL if none */
+	struct batch *batch;
+	/* the plan has returned its last batch, or failed */
+	int done;
+	int failed;
+	/* error raised by the plan if it failed */
+	struct err err;
+};
+
+struct gather_op {
+	struct operator	      op;
+	u16		      nworkers;
+	struct gather_worker *workers;
+	/* number of plans opened and of threads started */
+	u16 nopened;
+	u16 nstarted;
+	/* worker whose batch was returned last, to be released on the next
+	 * call, NULL if none */
+	struct gather_worker *current;
+	/* worker to look at first for a batch, so that none is starved */
+	u16 next_worker;
+	pthread_mutex_t lock;
+	/* signaled when a worker hands over a batch or is done */
+	pthread_cond_t ready;
+	/* signaled when batches are consumed, or the workers may start or
+	 * must stop */
+	pthread_cond_t consumed;
+	/* set once every worker is started, so that the plans may wait for
+	 * each other */
+	int running;
+	/* set when the gather is closed before the workers are done */
+	int stop;
+};
+
+static void *gather_worker_main(void *arg)
+{
+	struct gather_worker *w	     = arg;
+	struct gather_op     *gather = w->gather;
+	struct batch	     *batch;
+	struct err	     *err;
+	int		      rc;
+
+	mem_root_set(&w->mem_root);
+	pthread_mutex_lock(&gather->lock);
+	while (!gather->running && !gather->stop)
+		pthread_cond_wait(&gather->consumed, &gather->lock);
+	rc = gather->stop;
+	pthread_mutex_unlock(&gather->lock);
+	if (rc)
+		return NULL;
+
+	for (;;) {
+		rc = op_next(w->plan, &batch);
+
+		pthread_mutex_lock(&gather->lock);
+		if (rc || batch == NULL) {
+			if (rc && (err = errbuf_pop()) != NULL) {
+				w->err	  = *err;
+				w->failed = 1;
+			} else if (rc) {
+				w->failed = 1;
+			}
+			w->done = 1;
+			pthread_cond_signal(&gather->ready);
+			pthread_mutex_unlock(&gather->lock);
+			break;
+		}
+		w->batch = batch;
+		pthread_cond_signal(&gather->ready);
+		while (w->batch != NULL && !gather->stop)
+			pthread_cond_wait(&gather->consumed, &gather->lock);
+		rc = gather->stop;
+		pthread_mutex_unlock(&gather->lock);
+		if (rc)
+			break;
+	}
+	return NULL;
+}
+
+static int gather_open(struct operator *op)
+{
+	struct gather_op *gather = (struct gather_op *)op;
+	u16		  i;
+
+	for (; gather->nopened < gather->nworkers; ++gather->nopened) {
+		if (op_open(gather->workers[gather->nopened].plan))
+			return 1;
+	}
+	for (i = 0; i < gather->nworkers; ++i) {
+		struct gather_worker *w = &gather->workers[i];
+
+		/* the memory of the workers counts towards that of the
+		 * query */
+		mem_root_init_child(&w->mem_root, mem_root_get());
+		if (pthread_create(&w->thread, NULL, gather_worker_main, w)) {
+			errlog(ERROR, errcode(ER_INTERNAL_ERROR),
+			       errmsg("Could not start worker thread"));
+			return 1;
+		}
+		gather->nstarted++;
+	}
+	pthread_mutex_lock(&gather->lock);
+	gather->running = 1;
+	pthread_cond_broadcast(&gather->consumed);
+	pthread_mutex_unlock(&gather->lock);
+	return 0;
+}
+
+static int gather_next(struct operator *op, struct batch **batch)
+{
+	struct gather_op     *gather = (struct gather_op *)op;
+	struct gather_worker *w;
+	u16		      ndone;
+	u16		      i;
+
+	pthread_mutex_lock(&gather->lock);
+	if (gather->current) {
+		gather->current->batch = NULL;
+		gather->current	       = NULL;
+		pthread_cond_broadcast(&gather->consumed);
+	}
+	for (;;) {
+		ndone = 0;
+		for (i = 0; i < gather->nworkers; ++i) {
+			w = &gather->workers[(gather->next_worker + i) %
+					     gather->nworkers];
+			if (w->batch != NULL)
+				break;
+			if (w->failed)
+				goto fail;
+			ndone += w->done;
+		}
+		if (i < gather->nworkers)
+			break;
+		if (ndone == gather->nworkers) {
+			pthread_mutex_unlock(&gather->lock);
+			*batch = NULL;
+			return 0;
+		}
+		pthread_cond_wait(&gather->ready, &gather->lock);
+	}
+	gather->next_worker = (w - gather->workers + 1) % gather->nworkers;
+	gather->current	    = w;
+	*batch		    = w->batch;
+	pthread_mutex_unlock(&gather->lock);
+	return 0;
+
+fail:
+	/* the error is reported by the thread of the query */
+	if (w->err.message[0] != '\0')
+		errrestore(&w->err);
+	w->err.message[0] = '\0';
+	pthread_mutex_unlock(&gather->lock);
+	return 1;
+}
+
+static void gather_close(struct operator *op)
+{
+	struct gather_op *gather = (struct gather_op *)op;
+	u16		  i;
+
+	pthread_mutex_lock(&gather->lock);
+	gather->stop = 1;
+	pthread_cond_broadcast(&gather->consumed);
+	pthread_mutex_unlock(&gather->lock);
+	for (i = 0; i < gather->nstarted; ++i)
+		pthread_join(gather->workers[i].thread, NULL);
+	for (i = 0; i < gather->nworkers; ++i) {
+		mem_root_clear(&gather->workers[i].mem_root);
+		mem_root_detach(&gather->workers[i].mem_root);
+	}
+	for (i = 0; i < gather->nopened; ++i)
+		op_close(gather->workers[i].plan);
+	gather->nstarted = 0;
+	gather->nopened	 = 0;
+	pthread_mutex_destroy(&gather->lock);
+	pthread_cond_destroy(&gather->ready);
+	pthread_cond_destroy(&gather->consumed);
+}
+
+static const struct operator_ops gather_ops = {
+	.open  = gather_open,
+	.next  = gather_next,
+	.close = gather_close,
+};
+
+struct operator **gather_plans(struct operator *op, u16 *nworkers)
+{
+	struct gather_op *gather = (struct gather_op *)op;
+	struct operator **plans;
+	u16		  i;
+
+	if (op->ops != &gather_ops)
+		return NULL;
+	plans = mem_alloc(sizeof(struct operator *) * gather->nworkers);
+	for (i = 0; i < gather->nworkers; ++i)
+		plans[i] = gather->workers[i].plan;
+	*nworkers = gather->nworkers;
+	return plans;
+}
+
+struct operator *gather_op_create(struct operator **plans, u16 nworkers)
+{
+	struct gather_op *gather = mem_zalloc(sizeof(struct gather_op));
+	u16		  i;
+
+	gather->op.ops	 = &gather_ops;
+	gather->op.ncols = plans[0]->ncols;
+	gather->op.types = plans[0]->types;
+	gather->nworkers = nworkers;
+	gather->workers	 = mem_zalloc(sizeof(struct gather_worker) * nworkers);
+	for (i = 0; i < nworkers; ++i) {
+		gather->workers[i].gather = gather;
+		gather->workers[i].plan	  = plans[i];
+	}
+	pthread_mutex_init(&gather->lock, NULL);
+	pthread_cond_init(&gather->ready, NULL);
+	pthread_cond_init(&gather->consumed, NULL);
+	return &gather->op;
+}
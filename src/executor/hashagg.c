@@ -0,0 +1,1074 @@
+#include "executor/operator.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtype.h"
+#include "executor/hashtab.h"
+#include "util/error.h"
+#include "util/mem.h"
+
+/* Hash aggregation.
+ *
+ * Each input row is turned into a record of fixed size holding the group
+ * keys followed by the arguments of the aggregates, each one preceded by a
+ * flag set if it is null. The groups are stored one after the
+ * other in an array, each one made of the keys of its records followed by the
+ * states of the aggregates, and are found through an open-addressing table of
+ * hashes and group indexes with linear probing.
+ *
+ * Once the groups would take more than the memory budget, the records of new
+ * groups are written to one of NPARTITIONS temporary files chosen from their
+ * hash, while the existing groups keep being aggregated. Each file is
+ * aggregated on its own after the groups in memory are returned, and may be
+ * split again with the next bits of the hash.
+ *
+ * The parallel operator splits the aggregation in two phases. In the first
+ * one, each worker aggregates the rows of its input into a table of its own.
+ * Once the table is full, its groups are written to the shared temporary
+ * file of the partition of their hash, and it starts over empty. When all
+ * the workers are done, they claim the NPARTITIONS partitions one at a time,
+ * merging the groups of the partition from the tables of every worker and
+ * from its file: the states of the same group are combined. A worker returns
+ * the groups of a partition before claiming the next one, so that the
+ * workers left with small partitions take over the rest of the work. Merges
+ * outgrowing the budget are split through temporary files as above. */
+
+#define NO_GROUP UINT32_MAX
+
+/* A value of the records */
+struct agg_input {
+	/* program computing the value, NULL to copy input column colno */
+	struct expr_prog *prog;
+	u16		  colno;
+	u32		  typeoid;
+	/* size in the records, after the null flag at off */
+	u32 width;
+	u32 off;
+};
+
+struct agg_desc {
+	enum agg_func func;
+	u32	      typeoid;
+	/* the argument in the records, argwidth is 0 for count(*) */
+	u32 argtype;
+	u32 argwidth;
+	u32 argoff;
+	/* position of the state in the groups */
+	u32 off;
+};
+
+/* Slot of the hash table, empty if group is 0 */
+struct agg_slot {
+	u32 hash;
+	/* index of the group plus one */
+	u32 group;
+};
+
+/* Records of a temporary file waiting to be aggregated */
+struct agg_spill {
+	FILE *file;
+	/* depth of the pass that wrote it */
+	u8 depth;
+};
+
+/* The aggregation of records into a table of groups, done by the serial
+ * operator, and by each worker of a parallel one */
+struct agg_work {
+	u16		  nkeys;
+	u16		  naggs;
+	struct agg_input *inputs;
+	struct agg_desc	 *aggs;
+	size_t		  work_mem;
+	/* data and null flags of the input columns, for programs */
+	u8 **srcs;
+	u8 **nulls;
+
+	u32 keywidth;
+	u32 recwidth;
+	u32 groupwidth;
+	/* records of the current input batch, and their hashes and groups */
+	u8  *recs;
+	u64 *hashes;
+	u32 *groups;
+
+	u8		*group_data;
+	u32		 ngroups;
+	u32		 maxgroups;
+	struct agg_slot *slots;
+	u32		 mask;
+	/* bytes of the groups and of the table charged to the memory root */
+	size_t		 charged;
+
+	/* files written by the current pass, NULL if empty */
+	FILE *parts[NPARTITIONS];
+	u8    depth;
+	/* list of struct agg_spill still to aggregate */
+	struct vec spills;
+
+	/* next group to return */
+	u32 emit_pos;
+};
+
+struct hashagg_op {
+	struct operator op;
+	struct agg_work work;
+	struct batch	batch;
+};
+
+static inline u8 *record_at(struct agg_work *agg, u16 i)
+{
+	return agg->recs + (size_t)i * agg->recwidth;
+}
+
+static inline u8 *group_at(struct agg_work *agg, u32 group)
+{
+	return agg->group_data + (size_t)group * agg->groupwidth;
+}
+
+/* Charge the memory root for the groups and the table */
+static void charge(struct agg_work *agg)
+{
+	mem_recharge(&agg->charged,
+		     (size_t)agg->maxgroups * agg->groupwidth +
+			     (size_t)(agg->mask + 1) * sizeof(struct agg_slot));
+}
+
+/* Memory taken by n groups and the table indexing them */
+static size_t groups_size(struct agg_work *agg, u32 n)
+{
+	size_t nslots = agg->mask + 1;
+
+	while ((size_t)n * 2 > nslots)
+		nslots *= 2;
+	return (size_t)n * agg->groupwidth + nslots * sizeof(struct agg_slot);
+}
+
+static void grow_slots(struct agg_work *agg)
+{
+	struct agg_slot *old	= agg->slots;
+	u32		 oldcap = agg->mask + 1;
+	u32		 i;
+	u32		 idx;
+
+	agg->mask  = oldcap * 2 - 1;
+	agg->slots = calloc((size_t)oldcap * 2, sizeof(struct agg_slot));
+	for (i = 0; i < oldcap; ++i) {
+		if (old[i].group == 0)
+			continue;
+		idx = old[i].hash & agg->mask;
+		while (agg->slots[idx].group != 0)
+			idx = (idx + 1) & agg->mask;
+		agg->slots[idx] = old[i];
+	}
+	free(old);	charge(agg);
+}
+
+/* Append a group with the keys of a record and empty states */
+static u32 add_group(struct agg_work *agg, const u8 *rec)
+{
+	u8 *group;
+
+	if (agg->ngroups == agg->maxgroups) {
+		agg->maxgroups	= agg->maxgroups * 2;
+		agg->group_data = realloc(agg->group_data,
+					  (size_t)agg->maxgroups *
+						  agg->groupwidth);
+		charge(agg);
+	}
+	group = group_at(agg, agg->ngroups);
+	memcpy(group, rec, agg->keywidth);
+	memset(group + agg->keywidth, 0, agg->groupwidth - agg->keywidth);
+	return agg->ngroups++;
+}
+
+/* Find the group of a record, creating it if there is room. Returns
+ * NO_GROUP if the record is to be spilled. */
+static u32 find_group(struct agg_work *agg, const u8 *rec, u64 hash)
+{
+	u32 h	= (u32)hash;
+	u32 idx = h & agg->mask;
+	u32 group;
+
+	for (;;) {
+		struct agg_slot *slot = &agg->slots[idx];
+
+		if (slot->group == 0)
+			break;
+		if (slot->hash == h &&
+		    memcmp(group_at(agg, slot->group - 1), rec,
+			   agg->keywidth) == 0)
+			return slot->group - 1;
+		idx = (idx + 1) & agg->mask;
+	}
+
+	if (agg->ngroups > 0 && agg->depth < MAX_DEPTH &&
+	    groups_size(agg, agg->ngroups + 1) > agg->work_mem)
+		return NO_GROUP;
+	if ((agg->ngroups + 1) * 2 > agg->mask + 1) {
+		grow_slots(agg);
+		idx = h & agg->mask;
+		while (agg->slots[idx].group != 0)
+			idx = (idx + 1) & agg->mask;
+	}
+	group		      = add_group(agg, rec);
+	agg->slots[idx].hash  = h;
+	agg->slots[idx].group = group + 1;
+	return group;
+}
+
+static int sum_overflow(void)
+{
+	errlog(ERROR, errcode(ER_NUMERIC_VALUE_OUT_OF_RANGE),
+	       errmsg("Value is out of range for type int8"));
+	return 1;
+}
+
+/* Update the states of an aggregate with the records from first to end of
+ * the batch, in their groups */
+static int update_states(struct agg_work *agg, struct agg_desc *desc,
+			 u16 first, u16 end)
+{
+	const u8 *arg;
+	i64	 *st;
+	i64	  v;
+	int	  cmp;
+	u16	  i;
+
+	for (i = first; i < end; ++i) {
+		if (agg->groups[i] == NO_GROUP)
+			continue;
+		st  = (i64 *)(group_at(agg, agg->groups[i]) + desc->off);
+		arg = record_at(agg, i) + desc->argoff;
+		/* nulls are ignored */
+		if (desc->argwidth > 0 && *arg++)
+			continue;
+		switch (desc->func) {
+		case AGG_COUNT:
+			st[0]++;
+			continue;
+		case AGG_SUM:
+		case AGG_AVG:
+			memcpy(&v, arg, 8);
+			if (__builtin_add_overflow(st[0], v, &st[0]))
+				return sum_overflow();
+			st[1]++;
+			continue;
+		case AGG_MIN:
+		case AGG_MAX:
+			break;
+		}
+
+		/* the value of min and max follows the flag telling whether
+		 * there is one */
+		if (desc->argtype == DTYPE_CHAR) {
+			cmp = memcmp(arg, st + 1, desc->argwidth);
+		} else {
+			memcpy(&v, arg, 8);
+			cmp = v < st[1] ? -1 : v > st[1];
+		}
+		if (desc->func == AGG_MAX)
+			cmp = -cmp;
+		if (!st[0] || cmp < 0)
+			memcpy(st + 1, arg, desc->argwidth);
+		st[0] = 1;
+	}
+	return 0;
+}
+
+/* Aggregate the records of the current batch */
+static int aggregate_records(struct agg_work *agg, u16 nrecs)
+{
+	const u8 *rec;
+	u16	  i;
+	u16	  j;
+
+	if (agg->nkeys == 0) {
+		memset(agg->groups, 0, sizeof(u32) * nrecs);
+	} else {
+		for (i = 0; i < nrecs; ++i) {
+			rec	       = record_at(agg, i);
+			agg->hashes[i] = hashtab_hash(rec, agg->keywidth);
+		}
+		for (i = 0; i < nrecs; ++i) {
+			rec	       = record_at(agg, i);
+			agg->groups[i] = find_group(agg, rec, agg->hashes[i]);
+			if (agg->groups[i] == NO_GROUP &&
+			    hashtab_spill(&agg->parts[hashtab_partition(
+						  agg->hashes[i], agg->depth)],
+					  rec, agg->recwidth))
+				return 1;
+		}
+	}
+	for (j = 0; j < agg->naggs; ++j) {
+		if (update_states(agg, &agg->aggs[j], 0, nrecs))
+			return 1;
+	}
+	return 0;
+}
+
+/* Fill the records from the selected rows of an input batch */
+static int make_records(struct agg_work *agg, struct batch *in, u16 count)
+{
+	const union expr_reg *reg;
+	u16		      colno;
+	u16		      row;
+	u16		      i;
+	u16		      k;
+
+	for (colno = 0; colno < in->ncols; ++colno) {
+		agg->srcs[colno]  = in->cols[colno].data;
+		agg->nulls[colno] = in->cols[colno].nulls;
+	}
+	for (k = 0; k < agg->nkeys + agg->naggs; ++k) {
+		struct agg_input *input = &agg->inputs[k];
+		u8		 *dst	= agg->recs + input->off;
+
+		if (input->width == 0)
+			continue;
+		if (input->prog == NULL) {
+			struct vector *vec = &in->cols[input->colno];
+
+			for (i = 0; i < count; ++i, dst += agg->recwidth) {
+				row    = batch_row(in, i);
+				dst[0] = vec->nulls && vec->nulls[row];
+				hashtab_store(dst + 1, input->typeoid,
+					      input->width,
+					      dst[0] ? NULL :
+						       vector_at(vec, row),
+					      vec->width);
+			}
+			continue;
+		}
+		for (i = 0; i < count; ++i, dst += agg->recwidth) {
+			row = batch_row(in, i);
+			reg = expr_eval(input->prog, agg->srcs, agg->nulls, row,
+					dst);
+			if (reg == NULL)
+				return 1;
+			if (dst[0])
+				memset(dst + 1, 0, input->width);
+			else if (input->typeoid == DTYPE_CHAR)
+				hashtab_store(dst + 1, DTYPE_CHAR,
+					      input->width, reg->str,
+					      reg->len);
+			else
+				memcpy(dst + 1, &reg->val_int, 8);
+		}
+	}
+	return 0;
+}
+
+/* Forget the groups of the table, to start a new pass */
+static void work_reset(struct agg_work *agg, u8 depth)
+{
+	agg->depth    = depth;
+	agg->ngroups  = 0;
+	agg->emit_pos = 0;
+	memset(agg->slots, 0, sizeof(struct agg_slot) * (agg->mask + 1));
+}
+
+/* Aggregate the records of a temporary file, as a new pass */
+static int aggregate_spill(struct agg_work *agg, struct agg_spill *spill)
+{
+	int n;
+
+	work_reset(agg, spill->depth + 1);
+	rewind(spill->file);
+	for (;;) {
+		n = hashtab_read(spill->file, agg->recs, agg->recwidth,
+				 BATCH_SIZE);
+		if (n <= 0)
+			return n < 0;
+		if (aggregate_records(agg, n))
+			return 1;
+	}
+}
+
+/* Queue the files written by the current pass */
+static void end_pass(struct agg_work *agg)
+{
+	struct agg_spill *spill;
+	u32		  part;
+
+	for (part = 0; part < NPARTITIONS; ++part) {
+		if (agg->parts[part] == NULL)
+			continue;
+		spill	     = mem_alloc(sizeof(struct agg_spill));
+		spill->file  = agg->parts[part];
+		spill->depth = agg->depth;
+		vec_push(&agg->spills, spill);
+		agg->parts[part] = NULL;
+	}
+	agg->emit_pos = 0;
+}
+
+/* Allocate the buffers and the table of an aggregation */
+static void work_open(struct agg_work *agg)
+{
+	agg->recs	= mem_alloc((size_t)BATCH_SIZE * agg->recwidth);
+	agg->hashes	= mem_alloc(sizeof(u64) * BATCH_SIZE);
+	agg->groups	= mem_alloc(sizeof(u32) * BATCH_SIZE);
+	agg->maxgroups	= 64;
+	agg->group_data = malloc((size_t)agg->maxgroups * agg->groupwidth);
+	agg->slots	= calloc(128, sizeof(struct agg_slot));
+	agg->mask	= 127;
+	agg->charged	= 0;
+	charge(agg);
+	agg->ngroups	= 0;
+	agg->depth	= 0;
+	agg->emit_pos	= 0;
+	vec_init(&agg->spills, 1);
+	memset(agg->parts, 0, sizeof(agg->parts));
+}
+
+static void work_close(struct agg_work *agg)
+{
+	struct agg_spill *spill;
+	u32		  part;
+
+	for (part = 0; part < NPARTITIONS; ++part) {
+		if (agg->parts[part])
+			fclose(agg->parts[part]);
+		agg->parts[part] = NULL;
+	}
+	if (agg->spills.data) {
+		while ((spill = vec_pop(&agg->spills)) != NULL)
+			fclose(spill->file);
+		vec_free(&agg->spills);
+	}
+	agg->spills.data = NULL;
+	free(agg->group_data);
+	free(agg->slots);
+	agg->group_data = NULL;
+	agg->slots	= NULL;
+	mem_recharge(&agg->charged, 0);
+}
+
+/* Allocate the output vectors of an aggregation */
+static void init_output(struct operator *op, struct agg_work *agg,
+			struct batch *batch)
+{
+	u16 colno;
+
+	batch_init(batch, op->ncols);
+	for (colno = 0; colno < op->ncols; ++colno) {
+		vector_init(&batch->cols[colno], op->types[colno].typeoid,
+			    op->types[colno].typemod);
+		if (colno < agg->nkeys ||
+		    agg->aggs[colno - agg->nkeys].func != AGG_COUNT)
+			batch->cols[colno].nulls = mem_alloc(BATCH_SIZE);
+	}
+}
+
+static int hashagg_open(struct operator *op)
+{
+	struct hashagg_op *h   = (struct hashagg_op *)op;
+	struct agg_work	  *agg = &h->work;
+	struct batch	  *in;
+	u16		   count;
+
+	work_open(agg);
+	/* without keys, there is a single group even if there are no rows */
+	if (agg->nkeys == 0)
+		add_group(agg, agg->recs);
+
+	for (;;) {
+		if (op_next(op->left, &in))
+			return 1;
+		if (in == NULL)
+			break;
+		count = batch_count(in);
+		if (count == 0)
+			continue;
+		if (mem_check_limit() || make_records(agg, in, count) ||
+		    aggregate_records(agg, count))
+			return 1;
+	}
+	end_pass(agg);
+
+	init_output(op, agg, &h->batch);
+	return 0;
+}
+
+/* Set an output value from the state of an aggregate */
+static void finalize(struct agg_desc *desc, const i64 *st,
+		     struct vector *vec, u16 row)
+{
+	double avg;
+	i64    nrows;
+
+	if (desc->func == AGG_COUNT) {
+		memcpy(vector_at(vec, row), st, 8);
+		return;
+	}
+	/* the aggregate of no rows is null */
+	nrows = desc->func == AGG_SUM || desc->func == AGG_AVG ? st[1] : st[0];
+	vec->nulls[row] = nrows == 0;
+	if (vec->nulls[row])
+		return;
+	switch (desc->func) {
+	case AGG_SUM:
+		memcpy(vector_at(vec, row), st, 8);
+		break;
+	case AGG_AVG:
+		avg = (double)st[0] / st[1];
+		memcpy(vector_at(vec, row), &avg, 8);
+		break;
+	default:
+		hashtab_load(vec, row, (const u8 *)(st + 1));
+		break;
+	}
+}
+
+/* Fill a batch with the next groups of the table */
+static void emit_groups(struct agg_work *agg, struct batch *batch)
+{
+	const u8 *group;
+	u16	  n;
+	u16	  i;
+	u16	  k;
+
+	n = agg->ngroups - agg->emit_pos < BATCH_SIZE ?
+		    agg->ngroups - agg->emit_pos :
+		    BATCH_SIZE;
+	for (i = 0; i < n; ++i) {
+		group = group_at(agg, agg->emit_pos + i);
+		for (k = 0; k < agg->nkeys; ++k) {
+			const u8 *key = group + agg->inputs[k].off;
+
+			batch->cols[k].nulls[i] = key[0];
+			hashtab_load(&batch->cols[k], i, key + 1);
+		}
+		for (k = 0; k < agg->naggs; ++k)
+			finalize(&agg->aggs[k],
+				 (const i64 *)(group + agg->aggs[k].off),
+				 &batch->cols[agg->nkeys + k], i);
+	}
+	agg->emit_pos += n;
+	batch->nrows   = n;
+	batch->sel     = NULL;
+}
+
+static int hashagg_next(struct operator *op, struct batch **batch)
+{
+	struct hashagg_op *h   = (struct hashagg_op *)op;
+	struct agg_work	  *agg = &h->work;
+	struct agg_spill  *spill;
+	int		   res;
+
+	while (agg->emit_pos == agg->ngroups) {
+		spill = vec_pop(&agg->spills);
+		if (spill == NULL) {
+			*batch = NULL;
+			return 0;
+		}
+		res = aggregate_spill(agg, spill);
+		fclose(spill->file);
+		if (res)
+			return 1;
+		end_pass(agg);
+	}
+
+	emit_groups(agg, &h->batch);
+	*batch = &h->batch;
+	return 0;
+}
+
+static void hashagg_close(struct operator *op)
+{
+	struct hashagg_op *h = (struct hashagg_op *)op;
+
+	work_close(&h->work);
+}
+
+static const struct operator_ops hashagg_ops = {
+	.open  = hashagg_open,
+	.next  = hashagg_next,
+	.close = hashagg_close,
+};
+
+/* Lay out a value of the records */
+static void add_input(struct agg_work *agg, struct agg_input *input,
+		      struct expr *expr, const u16 *offsets,
+		      const u8 *nullable)
+{
+	input->typeoid = expr->typeoid;
+	input->width   = hashtab_value_width(expr->typeoid, expr->typemod);
+	input->off     = agg->recwidth;
+	if (expr->type == EXPR_COLUMN)
+		input->colno = offsets[expr->tableno] + expr->colno;
+	else
+		input->prog = expr_compile_batch(expr, offsets, nullable);
+	agg->recwidth += 1 + input->width;
+}
+
+/* Lay out the records and the groups of an aggregation of the rows of an
+ * input with ncols columns, and compile the programs computing their
+ * values */
+static void work_init(struct agg_work *agg, u16 ncols, const u16 *offsets,
+		      const u8 *nullable, u16 nkeys, struct expr **keys,
+		      u16 naggs, struct agg_call **aggs, size_t work_mem)
+{
+	struct agg_desc *desc;
+	u32		 off;
+	u16		 k;
+
+	agg->nkeys    = nkeys;
+	agg->naggs    = naggs;
+	agg->work_mem = work_mem;
+	agg->inputs   = mem_zalloc(sizeof(struct agg_input) * (nkeys + naggs));
+	agg->aggs     = mem_zalloc(sizeof(struct agg_desc) * naggs);
+	agg->srcs     = mem_alloc(sizeof(u8 *) * (ncols + 1));
+	agg->nulls    = mem_alloc(sizeof(u8 *) * (ncols + 1));
+
+	for (k = 0; k < nkeys; ++k)
+		add_input(agg, &agg->inputs[k], keys[k], offsets, nullable);
+	agg->keywidth = agg->recwidth;
+
+	/* states start on 8 bytes boundaries after the keys */
+	off = (agg->keywidth + 7) & ~7;
+	for (k = 0; k < naggs; ++k) {
+		desc	      = &agg->aggs[k];
+		desc->func    = aggs[k]->func;
+		desc->typeoid = aggs[k]->typeoid;
+		desc->off     = off;
+		if (aggs[k]->arg) {
+			add_input(agg, &agg->inputs[nkeys + k], aggs[k]->arg,
+				  offsets, nullable);
+			desc->argtype  = agg->inputs[nkeys + k].typeoid;
+			desc->argwidth = agg->inputs[nkeys + k].width;
+			desc->argoff   = agg->inputs[nkeys + k].off;
+		}
+		/* count: the count; sum and avg: the sum and the count; min
+		 * and max: whether there is a value, and the value */
+		if (desc->func == AGG_COUNT)
+			off += 8;
+		else if (desc->func == AGG_MIN || desc->func == AGG_MAX)
+			off += 8 + ((desc->argwidth + 7) & ~7);
+		else
+			off += 16;
+	}
+	agg->groupwidth = off > 0 ? off : 8;
+	if (agg->recwidth == 0)
+		agg->recwidth = 1;
+}
+
+/* Types of the output columns: the keys followed by the aggregates */
+static struct coltype *output_types(u16 nkeys, struct expr **keys, u16 naggs,
+				    struct agg_call **aggs)
+{
+	struct coltype *types = mem_alloc(sizeof(struct coltype) *
+					  (nkeys + naggs));
+	u16		k;
+
+	for (k = 0; k < nkeys; ++k) {
+		types[k].typeoid = keys[k]->typeoid;
+		types[k].typemod = keys[k]->typemod;
+	}
+	for (k = 0; k < naggs; ++k) {
+		types[nkeys + k].typeoid = aggs[k]->typeoid;
+		types[nkeys + k].typemod = aggs[k]->typemod;
+	}
+	return types;
+}
+
+struct operator *hashagg_op_create(struct operator *input, const u16 *offsets,
+				   const u8 *nullable, u16 nkeys,
+				   struct expr **keys, u16 naggs,
+				   struct agg_call **aggs, size_t work_mem)
+{
+	struct hashagg_op *h = mem_zalloc(sizeof(struct hashagg_op));
+
+	h->op.ops   = &hashagg_ops;
+	h->op.ncols = nkeys + naggs;
+	h->op.types = output_types(nkeys, keys, naggs, aggs);
+	h->op.left  = input;
+	work_init(&h->work, input->ncols, offsets, nullable, nkeys, keys, naggs,
+		  aggs, work_mem);
+	return &h->op;
+}
+
+/* Parallel aggregation */
+
+struct pagg_worker_op;
+
+struct pagg_shared {
+	u16			nworkers;
+	struct pagg_worker_op **workers;
+	pthread_mutex_t		lock;
+	/* signaled when the last worker is done with its input */
+	pthread_cond_t done;
+	u16	       ndone;
+	/* set if a worker failed to aggregate its input */
+	int failed;
+	/* groups of the full tables of the workers, by partition, NULL if
+	 * none */
+	FILE *parts[NPARTITIONS];
+	/* next partition to merge */
+	_Atomic u32 next_part;
+};
+
+struct pagg_worker_op {
+	struct operator	    op;
+	struct pagg_shared *shared;
+	/* table the rows of the input are aggregated into */
+	struct agg_work local;
+	/* indexes of the groups of the table by partition, those of partition
+	 * p being from part_start[p] to part_start[p + 1] */
+	u32 *part_groups;
+	u32  part_start[NPARTITIONS + 1];
+	/* table the groups of a partition are merged into, whose records are
+	 * groups */
+	struct agg_work merge;
+	int		merging;
+	struct batch	batch;
+};
+
+/* Combine the states of a group with those of the same group of another
+ * table */
+static int combine_states(struct agg_work *agg, u8 *group, const u8 *other)
+{
+	struct agg_desc *desc;
+	const i64	*src;
+	i64		*st;
+	int		 cmp;
+	u16		 k;
+
+	for (k = 0; k < agg->naggs; ++k) {
+		desc = &agg->aggs[k];
+		st   = (i64 *)(group + desc->off);
+		src  = (const i64 *)(other + desc->off);
+		switch (desc->func) {
+		case AGG_COUNT:
+			st[0] += src[0];
+			continue;
+		case AGG_SUM:
+		case AGG_AVG:
+			if (__builtin_add_overflow(st[0], src[0], &st[0]))
+				return sum_overflow();
+			st[1] += src[1];
+			continue;
+		case AGG_MIN:
+		case AGG_MAX:
+			break;
+		}
+		if (!src[0])
+			continue;
+		if (desc->argtype == DTYPE_CHAR)
+			cmp = memcmp(src + 1, st + 1, desc->argwidth);
+		else
+			cmp = src[1] < st[1] ? -1 : src[1] > st[1];
+		if (desc->func == AGG_MAX)
+			cmp = -cmp;
+		if (!st[0] || cmp < 0)
+			memcpy(st + 1, src + 1, desc->argwidth);
+		st[0] = 1;
+	}
+	return 0;
+}
+
+/* Merge a group of another table into the table, or spill it if there is no
+ * room for it */
+static int merge_group(struct agg_work *agg, const u8 *other)
+{
+	u64 hash = hashtab_hash(other, agg->keywidth);
+	u32 group;
+
+	group = find_group(agg, other, hash);
+	if (group == NO_GROUP)
+		return hashtab_spill(
+			&agg->parts[hashtab_partition(hash, agg->depth)], other,
+			agg->groupwidth);
+	return combine_states(agg, group_at(agg, group), other);
+}
+
+/* Merge the groups of a temporary file into the table */
+static int merge_file(struct agg_work *agg, FILE *file)
+{
+	int n;
+	int i;
+
+	rewind(file);
+	for (;;) {
+		n = hashtab_read(file, agg->recs, agg->groupwidth, BATCH_SIZE);
+		if (n <= 0)
+			return n < 0;
+		for (i = 0; i < n; ++i) {
+			if (merge_group(agg, agg->recs +
+						     (size_t)i * agg->groupwidth))
+				return 1;
+		}
+	}
+}
+
+/* Write the groups of the table of the worker to the files of their
+ * partitions, and empty it */
+static int flush_groups(struct pagg_worker_op *w)
+{
+	struct pagg_shared *shared = w->shared;
+	struct agg_work	   *agg	   = &w->local;
+	const u8	   *group;
+	u32		    part;
+	u32		    g;
+	int		    res = 0;
+
+	pthread_mutex_lock(&shared->lock);
+	for (g = 0; g < agg->ngroups && !res; ++g) {
+		group = group_at(agg, g);
+		part  = hashtab_partition(hashtab_hash(group, agg->keywidth),
+					  0);
+		res   = hashtab_spill(&shared->parts[part], group,
+				      agg->groupwidth);
+	}
+	pthread_mutex_unlock(&shared->lock);
+	work_reset(agg, 0);
+	return res;
+}
+
+/* Aggregate the records of the current batch into the table of the worker,
+ * flushing the table whenever it is full */
+static int preaggregate_records(struct pagg_worker_op *w, u16 nrecs)
+{
+	struct agg_work *agg = &w->local;
+	u16		 first;
+	u16		 i;
+	u16		 j;
+
+	if (agg->nkeys == 0)
+		return aggregate_records(agg, nrecs);
+	for (i = 0; i < nrecs; ++i)
+		agg->hashes[i] = hashtab_hash(record_at(agg, i), agg->keywidth);
+	for (first = 0; first < nrecs; first = i) {
+		for (i = first; i < nrecs; ++i) {
+			agg->groups[i] = find_group(agg, record_at(agg, i),
+						    agg->hashes[i]);
+			if (agg->groups[i] == NO_GROUP)
+				break;
+		}
+		for (j = 0; j < agg->naggs; ++j) {
+			if (update_states(agg, &agg->aggs[j], first, i))
+				return 1;
+		}
+		if (i < nrecs && flush_groups(w))
+			return 1;
+	}
+	return 0;
+}
+
+/* Index the groups left in the table of the worker by partition */
+static void partition_groups(struct pagg_worker_op *w)
+{
+	struct agg_work *agg = &w->local;
+	u32		 pos[NPARTITIONS];
+	u8		*parts;
+	u32		 part;
+	u32		 g;
+
+	memset(w->part_start, 0, sizeof(w->part_start));
+	if (agg->ngroups == 0)
+		return;
+	parts	       = malloc(agg->ngroups);
+	w->part_groups = malloc(sizeof(u32) * agg->ngroups);
+	for (g = 0; g < agg->ngroups; ++g) {
+		parts[g] = hashtab_partition(
+			hashtab_hash(group_at(agg, g), agg->keywidth), 0);
+		w->part_start[parts[g] + 1]++;
+	}
+	for (part = 0; part < NPARTITIONS; ++part) {
+		w->part_start[part + 1] += w->part_start[part];
+		pos[part] = w->part_start[part];
+	}
+	for (g = 0; g < agg->ngroups; ++g)
+		w->part_groups[pos[parts[g]]++] = g;
+	free(parts);
+}
+
+/* Aggregate the rows of the input of the worker into its table */
+static int preaggregate(struct pagg_worker_op *w)
+{
+	struct batch *in;
+	u16	      count;
+
+	for (;;) {
+		if (op_next(w->op.left, &in))
+			return 1;
+		if (in == NULL)
+			break;
+		count = batch_count(in);
+		if (count == 0)
+			continue;
+		if (mem_check_limit() || make_records(&w->local, in, count) ||
+		    preaggregate_records(w, count))
+			return 1;
+	}
+	partition_groups(w);
+	return 0;
+}
+
+/* Wait for the other workers to be done with their input. Returns nonzero if
+ * any of them failed. */
+static int wait_workers(struct pagg_shared *shared, int failed)
+{
+	pthread_mutex_lock(&shared->lock);
+	shared->failed |= failed;
+	if (++shared->ndone == shared->nworkers)
+		pthread_cond_broadcast(&shared->done);
+	while (shared->ndone < shared->nworkers)
+		pthread_cond_wait(&shared->done, &shared->lock);
+	failed = shared->failed;
+	pthread_mutex_unlock(&shared->lock);
+	return failed;
+}
+
+/* Merge the groups of a partition from the tables of all the workers and
+ * from its file */
+static int merge_partition(struct pagg_worker_op *w, u32 part)
+{
+	struct pagg_shared *shared = w->shared;
+	struct agg_work	   *agg	   = &w->merge;
+	u16		    i;
+	u32		    g;
+
+	work_reset(agg, 1);
+	for (i = 0; i < shared->nworkers; ++i) {
+		struct pagg_worker_op *other = shared->workers[i];
+
+		for (g = other->part_start[part];
+		     g < other->part_start[part + 1]; ++g) {
+			if (merge_group(agg, group_at(&other->local,
+						      other->part_groups[g])))
+				return 1;
+		}
+	}
+	if (shared->parts[part] && merge_file(agg, shared->parts[part]))
+		return 1;
+	return 0;
+}
+
+static int pagg_worker_open(struct operator *op)
+{
+	struct pagg_worker_op *w = (struct pagg_worker_op *)op;
+
+	work_open(&w->local);
+	if (w->local.nkeys == 0)
+		add_group(&w->local, w->local.recs);
+	work_open(&w->merge);
+	w->part_groups = NULL;
+	w->merging     = 0;
+	init_output(op, &w->merge, &w->batch);
+	return 0;
+}
+
+static int pagg_worker_next(struct operator *op, struct batch **batch)
+{
+	struct pagg_worker_op *w   = (struct pagg_worker_op *)op;
+	struct agg_work	      *agg = &w->merge;
+	struct agg_spill      *spill;
+	u32		       part;
+	int		       res;
+
+	if (!w->merging) {
+		w->merging = 1;
+		res	   = preaggregate(w);
+		/* the error is reported by the worker which failed only */
+		if (wait_workers(w->shared, res)) {
+			*batch = NULL;
+			return res;
+		}
+	}
+
+	while (agg->emit_pos == agg->ngroups) {
+		spill = vec_pop(&agg->spills);
+		if (spill != NULL) {
+			work_reset(agg, spill->depth + 1);
+			res = merge_file(agg, spill->file);
+			fclose(spill->file);
+			if (res)
+				return 1;
+			end_pass(agg);
+			continue;
+		}
+		part = atomic_fetch_add(&w->shared->next_part, 1);
+		if (part >= NPARTITIONS) {
+			*batch = NULL;
+			return 0;
+		}
+		if (merge_partition(w, part))
+			return 1;
+		end_pass(agg);
+	}
+
+	emit_groups(agg, &w->batch);
+	*batch = &w->batch;
+	return 0;
+}
+
+static void pagg_worker_close(struct operator *op)
+{
+	struct pagg_worker_op *w      = (struct pagg_worker_op *)op;
+	struct pagg_shared    *shared = w->shared;
+	u32		       part;
+
+	work_close(&w->local);
+	work_close(&w->merge);
+	free(w->part_groups);
+	w->part_groups = NULL;
+	/* the shared state is released with the first worker */
+	if (w != shared->workers[0])
+		return;
+	for (part = 0; part < NPARTITIONS; ++part) {
+		if (shared->parts[part])
+			fclose(shared->parts[part]);
+		shared->parts[part] = NULL;
+	}
+	pthread_mutex_destroy(&shared->lock);
+	pthread_cond_destroy(&shared->done);
+}
+
+static const struct operator_ops pagg_worker_ops = {
+	.open  = pagg_worker_open,
+	.next  = pagg_worker_next,
+	.close = pagg_worker_close,
+};
+
+struct operator *parallel_hashagg_op_create(struct operator **plans,
+					    u16 nworkers, const u16 *offsets,
+					    const u8 *nullable, u16 nkeys,
+					    struct expr **keys, u16 naggs,
+					    struct agg_call **aggs,
+					    size_t work_mem)
+{
+	struct pagg_shared    *shared = mem_zalloc(sizeof(struct pagg_shared));
+	struct coltype	      *types;
+	struct pagg_worker_op *w;
+	u16		       i;
+
+	types		 = output_types(nkeys, keys, naggs, aggs);
+	shared->nworkers = nworkers;
+	shared->workers	 = mem_alloc(sizeof(struct pagg_worker_op *) * nworkers);
+	pthread_mutex_init(&shared->lock, NULL);
+	pthread_cond_init(&shared->done, NULL);
+	atomic_init(&shared->next_part, 0);
+	for (i = 0; i < nworkers; ++i) {
+		w	     = mem_zalloc(sizeof(struct pagg_worker_op));
+		w->op.ops    = &pagg_worker_ops;
+		w->op.ncols  = nkeys + naggs;
+		w->op.types  = types;
+		w->op.left   = plans[i];
+		w->shared    = shared;
+		/* each worker compiles its own programs, which hold the
+		 * registers they run on */
+		work_init(&w->local, plans[i]->ncols, offsets, nullable, nkeys,
+			  keys, naggs, aggs, work_mem / nworkers);
+		/* the merge table has the same groups, and reads groups */
+		w->merge	  = w->local;
+		w->merge.recwidth = w->merge.groupwidth;
+		shared->workers[i] = w;
+		plans[i]	   = &w->op;
+	}
+	return gather_op_create(plans, nworkers);
+}
@@ -0,0 +1,760 @@
+#include "executor/operator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtype.h"
+#include "executor/hashtab.h"
+#include "util/error.h"
+#include "util/mem.h"
+
+/* Hash join.
+ *
+ * The rows of both inputs are turned into records of fixed size holding the
+ * keys, laid out the same way on both sides, followed by the columns that
+ * have data, each value preceded by a flag set if it is null. The records of
+ * the build input are stored one after the other in an array, and chained
+ * from the buckets of a table of row indexes. The probe input is then read a
+ * batch at a time, each record walking the chain of its bucket.
+ *
+ * Once the build records would take more than the memory budget, all of them
+ * are written to NPARTITIONS temporary files chosen from their hash, and so
+ * are the probe records afterwards. Each pair of files is then joined on its
+ * own, and may be split again with the next bits of the hash. */
+
+#define UNUSED_COL UINT32_MAX
+
+/* A key of the records */
+struct join_key {
+	/* program computing the value, NULL to copy input column colno */
+	struct expr_prog *prog;
+	u16		  colno;
+	u32		  typeoid;
+};
+
+/* One of the inputs and the layout of its records */
+struct join_side {
+	struct operator *input;
+	struct join_key *keys;
+	/* data and null flags of the input columns, for programs */
+	u8 **srcs;
+	u8 **nulls;
+	/* offset of the null flag of each column in the records, UNUSED_COL if
+	 * the column has no data. Set from the first batch of the input. */
+	u32 *coloff;
+	u32  recwidth;
+	/* records of the current batch */
+	u8 *recs;
+	/* index of the first output column of the input */
+	u16 outcol;
+};
+
+/* Records of a pair of temporary files waiting to be joined */
+struct join_spill {
+	FILE *build;
+	FILE *probe;
+	/* depth of the pass that wrote them */
+	u8 depth;
+};
+
+enum join_state { JOIN_PROBE, JOIN_UNMATCHED, JOIN_NEXT_SPILL, JOIN_DONE };
+
+struct hashjoin_op {
+	struct operator	  op;
+	u16		  nkeys;
+	/* offset of the null flag of each key in the records, and the size of
+	 * the value after it */
+	u32		 *keyoff;
+	u32		 *keylen;
+	u32		  keywidth;
+	struct join_side  sides[2];
+	struct join_side *build;
+	struct join_side *probe;
+	struct expr_prog *cond;
+	/* data and null flags of the output columns, for cond */
+	u8   **outsrcs;
+	u8   **outnulls;
+	int    outer;
+	size_t work_mem;
+
+	/* build records, their hashes, the next record of their chain plus one,
+	 * and whether they matched */
+	u8    *rows;
+	u32   *hashes;
+	u32   *next;
+	u8    *matched;
+	u32    nrows;
+	u32    maxrows;
+	/* first record of each chain plus one */
+	u32   *buckets;
+	u32    mask;
+	/* bytes of the records and of the table charged to the memory root */
+	size_t rows_charged;
+	size_t table_charged;
+
+	/* files written by the current pass, spilling if set */
+	FILE *build_parts[NPARTITIONS];
+	FILE *probe_parts[NPARTITIONS];
+	int   spilling;
+	u8    depth;
+	/* list of struct join_spill still to join */
+	struct vec spills;
+
+	enum join_state state;
+	/* file the probe records are read from, NULL for the probe input */
+	FILE *probe_file;
+	u64  *probe_hashes;
+	u16   probe_count;
+	u16   probe_pos;
+	/* next candidate of the current probe record plus one, and whether it
+	 * was started and matched */
+	u32	     chain;
+	int	     in_chain;
+	int	     probe_matched;
+	/* next build record to check for being unmatched */
+	u32	     unmatched_pos;
+	struct batch batch;
+};
+
+static inline u8 *record_at(const struct join_side *side, u8 *recs, u32 i)
+{
+	return recs + (size_t)i * side->recwidth;
+}
+
+static int has_null_key(struct hashjoin_op *j, const u8 *rec)
+{
+	u16 k;
+
+	for (k = 0; k < j->nkeys; ++k) {
+		if (rec[j->keyoff[k]])
+			return 1;
+	}
+	return 0;
+}
+
+/* Lay out the records of an input after its keys, with the columns of a
+ * batch having data */
+static void lay_out(struct hashjoin_op *j, struct join_side *side,
+		    struct batch *in)
+{
+	u16 colno;
+
+	side->coloff   = mem_alloc(sizeof(u32) * in->ncols);
+	side->recwidth = j->keywidth;
+	for (colno = 0; colno < in->ncols; ++colno) {
+		if (in->cols[colno].data == NULL) {
+			side->coloff[colno] = UNUSED_COL;
+			continue;
+		}
+		side->coloff[colno] = side->recwidth;
+		side->recwidth += 1 + in->cols[colno].width;
+	}
+	if (side->recwidth == 0)
+		side->recwidth = 1;
+	side->recs = mem_alloc((size_t)BATCH_SIZE * side->recwidth);
+}
+
+/* Fill the records of an input from the selected rows of a batch */
+static int make_records(struct hashjoin_op *j, struct join_side *side,
+			struct batch *in, u16 count)
+{
+	const union expr_reg *reg;
+	u8		     *dst;
+	u16		      colno;
+	u16		      row;
+	u16		      i;
+	u16		      k;
+
+	if (side->coloff == NULL)
+		lay_out(j, side, in);
+	for (colno = 0; colno < in->ncols; ++colno) {
+		side->srcs[colno]  = in->cols[colno].data;
+		side->nulls[colno] = in->cols[colno].nulls;
+	}
+	for (k = 0; k < j->nkeys; ++k) {
+		struct join_key *key = &side->keys[k];
+		struct vector	*vec = &in->cols[key->colno];
+
+		dst = side->recs + j->keyoff[k];
+		for (i = 0; i < count; ++i, dst += side->recwidth) {
+			row = batch_row(in, i);
+			if (key->prog == NULL) {
+				dst[0] = vec->nulls && vec->nulls[row];
+				hashtab_store(dst + 1, key->typeoid,
+					      j->keylen[k],
+					      dst[0] ? NULL :
+						       vector_at(vec, row),
+					      vec->width);
+				continue;
+			}
+			reg = expr_eval(key->prog, side->srcs, side->nulls,
+					row, dst);
+			if (reg == NULL)
+				return 1;
+			if (dst[0])
+				memset(dst + 1, 0, j->keylen[k]);
+			else if (key->typeoid == DTYPE_CHAR)
+				hashtab_store(dst + 1, DTYPE_CHAR,
+					      j->keylen[k], reg->str,
+					      reg->len);
+			else
+				memcpy(dst + 1, &reg->val_int, 8);
+		}
+	}
+	for (colno = 0; colno < in->ncols; ++colno) {
+		struct vector *vec = &in->cols[colno];
+
+		if (side->coloff[colno] == UNUSED_COL)
+			continue;
+		dst = side->recs + side->coloff[colno];
+		for (i = 0; i < count; ++i, dst += side->recwidth) {
+			row    = batch_row(in, i);
+			dst[0] = vec->nulls && vec->nulls[row];
+			memcpy(dst + 1, vector_at(vec, row), vec->width);
+		}
+	}
+	return 0;
+}
+
+/* Read the next records of an input, from its operator or from a temporary
+ * file. Returns the number of records, 0 at the end and -1 on error. */
+static int read_records(struct hashjoin_op *j, struct join_side *side,
+			FILE *file)
+{
+	struct batch *in;
+	u16	      count;
+
+	if (file)
+		return hashtab_read(file, side->recs, side->recwidth,
+				    BATCH_SIZE);
+	for (;;) {
+		if (op_next(side->input, &in))
+			return -1;
+		if (in == NULL)
+			return 0;
+		count = batch_count(in);
+		if (count == 0)
+			continue;
+		if (mem_check_limit())
+			return -1;
+		return make_records(j, side, in, count) ? -1 : count;
+	}
+}
+
+/* Memory taken by n build records and the table indexing them */
+static size_t build_size(struct hashjoin_op *j, u32 n)
+{
+	size_t nbuckets = 1;
+
+	while (nbuckets < n)
+		nbuckets *= 2;
+	return (size_t)n * (j->build->recwidth + 2 * sizeof(u32) + 1) +
+	       nbuckets * sizeof(u32);
+}
+
+static int spill_record(FILE **parts, struct join_side *side, const u8 *rec,
+			u64 hash, u8 depth)
+{
+	return hashtab_spill(&parts[hashtab_partition(hash, depth)], rec,
+			     side->recwidth);
+}
+
+/* Write the build records in memory to the files of the current pass, which
+ * gets all of the following ones */
+static int start_spilling(struct hashjoin_op *j)
+{
+	const u8 *rec;
+	u32	  i;
+
+	j->spilling = 1;
+	for (i = 0; i < j->nrows; ++i) {
+		rec = record_at(j->build, j->rows, i);
+		if (spill_record(j->build_parts, j->build, rec,
+				 hashtab_hash(rec, j->keywidth), j->depth))
+			return 1;
+	}
+	j->nrows = 0;
+	return 0;
+}
+
+static int add_build_record(struct hashjoin_op *j, const u8 *rec)
+{
+	if (!j->spilling && j->nkeys > 0 && j->nrows > 0 &&
+	    j->depth < MAX_DEPTH &&
+	    build_size(j, j->nrows + 1) > j->work_mem &&
+	    start_spilling(j))
+		return 1;
+	if (j->spilling)
+		return spill_record(j->build_parts, j->build, rec,
+				    hashtab_hash(rec, j->keywidth), j->depth);
+
+	if (j->nrows == j->maxrows) {
+		j->maxrows = j->maxrows > 0 ? j->maxrows * 2 : 64;
+		j->rows	   = realloc(j->rows,
+				     (size_t)j->maxrows * j->build->recwidth);
+		mem_recharge(&j->rows_charged,
+			     (size_t)j->maxrows * j->build->recwidth);
+	}
+	memcpy(record_at(j->build, j->rows, j->nrows), rec,
+	       j->build->recwidth);
+	j->nrows++;
+	return 0;
+}
+
+/* Chain the build records from the buckets, in their order */
+static void build_table(struct hashjoin_op *j)
+{
+	const u8 *rec;
+	u32	  nbuckets = 1;
+	u32	  b;
+	u32	  i;
+
+	while (nbuckets < j->nrows)
+		nbuckets *= 2;
+	free(j->buckets);
+	free(j->hashes);
+	free(j->next);
+	free(j->matched);
+	j->buckets = calloc(nbuckets, sizeof(u32));
+	j->hashes  = malloc(sizeof(u32) * (j->nrows + 1));
+	j->next	   = malloc(sizeof(u32) * (j->nrows + 1));
+	j->matched = calloc(j->nrows + 1, 1);
+	j->mask	   = nbuckets - 1;
+	mem_recharge(&j->table_charged,
+		     (size_t)nbuckets * sizeof(u32) +
+			     (size_t)(j->nrows + 1) * (2 * sizeof(u32) + 1));
+	for (i = j->nrows; i-- > 0;) {
+		rec	      = record_at(j->build, j->rows, i);
+		j->hashes[i]  = hashtab_hash(rec, j->keywidth);
+		j->next[i]    = 0;
+		if (has_null_key(j, rec))
+			continue;
+		b	      = j->hashes[i] & j->mask;
+		j->next[i]    = j->buckets[b];
+		j->buckets[b] = i + 1;
+	}
+}
+
+/* Read the build records, from the build input or from a temporary file */
+static int build(struct hashjoin_op *j, FILE *file)
+{
+	int n;
+	int i;
+
+	j->nrows    = 0;
+	j->spilling = 0;
+	for (;;) {
+		n = read_records(j, j->build, file);
+		if (n < 0)
+			return 1;
+		if (n == 0)
+			break;
+		for (i = 0; i < n; ++i) {
+			if (add_build_record(
+				    j, record_at(j->build, j->build->recs, i)))
+				return 1;
+		}
+	}
+	if (!j->spilling)
+		build_table(j);
+	return 0;
+}
+
+/* Whether a pair of files can produce rows */
+static int spill_useful(struct hashjoin_op *j, struct join_spill *spill)
+{
+	if (j->outer)
+		return j->build == &j->sides[0] ? spill->build != NULL :
+						  spill->probe != NULL;
+	return spill->build != NULL && spill->probe != NULL;
+}
+
+/* Split the probe records into the files of the current pass, reading them
+ * from the probe input if file is NULL */
+static int partition_probe(struct hashjoin_op *j, FILE *file)
+{
+	const u8 *rec;
+	int	  n;
+	int	  i;
+
+	for (;;) {
+		n = read_records(j, j->probe, file);
+		if (n < 0)
+			return 1;
+		if (n == 0)
+			break;
+		for (i = 0; i < n; ++i) {
+			rec = record_at(j->probe, j->probe->recs, i);
+			if (spill_record(j->probe_parts, j->probe, rec,
+					 hashtab_hash(rec, j->keywidth),
+					 j->depth))
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/* Queue the pairs of files written by the current pass */
+static void end_pass(struct hashjoin_op *j)
+{
+	struct join_spill *spill;
+	u32		   part;
+
+	for (part = 0; part < NPARTITIONS; ++part) {
+		spill	     = mem_alloc(sizeof(struct join_spill));
+		spill->build = j->build_parts[part];
+		spill->probe = j->probe_parts[part];
+		spill->depth = j->depth;
+		j->build_parts[part] = NULL;
+		j->probe_parts[part] = NULL;
+		if (spill_useful(j, spill)) {
+			vec_push(&j->spills, spill);
+			continue;
+		}
+		if (spill->build)
+			fclose(spill->build);
+		if (spill->probe)
+			fclose(spill->probe);
+	}
+	j->state = JOIN_NEXT_SPILL;
+}
+
+/* Join the next pair of files, or split it further */
+static int next_spill(struct hashjoin_op *j)
+{
+	struct join_spill *spill = vec_pop(&j->spills);
+	int		   res;
+
+	if (spill == NULL) {
+		j->state = JOIN_DONE;
+		return 0;
+	}
+	j->depth = spill->depth + 1;
+	res	 = 0;
+	if (spill->build) {
+		rewind(spill->build);
+		res = build(j, spill->build);
+		fclose(spill->build);
+	} else {
+		j->nrows    = 0;
+		j->spilling = 0;
+		build_table(j);
+	}
+	if (spill->probe)
+		rewind(spill->probe);
+	if (res == 0 && j->spilling) {
+		if (spill->probe) {
+			res = partition_probe(j, spill->probe);
+			fclose(spill->probe);
+		}
+		end_pass(j);
+		return res;
+	}
+	j->probe_file	 = spill->probe;
+	j->probe_count	 = 0;
+	j->probe_pos	 = 0;
+	j->in_chain	 = 0;
+	j->unmatched_pos = 0;
+	j->state	 = JOIN_PROBE;
+	if (res == 0 && j->probe_file == NULL)
+		j->state = JOIN_UNMATCHED;
+	return res;
+}
+
+static int hashjoin_open(struct operator *op)
+{
+	struct hashjoin_op *j = (struct hashjoin_op *)op;
+	u16		    colno;
+
+	j->probe_hashes = mem_alloc(sizeof(u64) * BATCH_SIZE);
+	vec_init(&j->spills, 1);
+
+	batch_init(&j->batch, op->ncols);
+	for (colno = 0; colno < op->ncols; ++colno) {
+		struct vector *vec = &j->batch.cols[colno];
+
+		vector_init(vec, op->types[colno].typeoid,
+			    op->types[colno].typemod);
+		vec->nulls	    = mem_zalloc(BATCH_SIZE);
+		j->outsrcs[colno]  = vec->data;
+		j->outnulls[colno] = vec->nulls;
+	}
+
+	/* the first build records tell their width */
+	if (build(j, NULL))
+		return 1;
+	if (j->spilling) {
+		if (partition_probe(j, NULL))
+			return 1;
+		end_pass(j);
+		return 0;
+	}
+	j->state = JOIN_PROBE;
+	return 0;
+}
+
+/* Copy the values of a record into a row of the output, or set them to null
+ * if rec is NULL */
+static void emit_side(struct hashjoin_op *j, struct join_side *side,
+		      const u8 *rec, u16 row)
+{
+	u16 colno;
+
+	for (colno = 0; colno < side->input->ncols; ++colno) {
+		struct vector *vec = &j->batch.cols[side->outcol + colno];
+		u32	       off;
+
+		if (rec == NULL) {
+			vec->nulls[row] = 1;
+			continue;
+		}
+		off = side->coloff[colno];
+		if (off == UNUSED_COL)
+			continue;
+		vec->nulls[row] = rec[off];
+		memcpy(vector_at(vec, row), rec + off + 1, vec->width);
+	}
+}
+
+/* Append a row made of a build and a probe record, either of which may be
+ * NULL for nulls. Returns 1 if the row satisfies the condition, 0 if not and
+ * -1 on error. */
+static int emit(struct hashjoin_op *j, const u8 *build, const u8 *probe)
+{
+	u16 row = j->batch.nrows;
+	int res;
+
+	emit_side(j, j->build, build, row);
+	emit_side(j, j->probe, probe, row);
+	if (j->cond && build && probe) {
+		res = expr_eval_bool(j->cond, j->outsrcs, j->outnulls, row);
+		if (res <= 0)
+			return res;
+	}
+	j->batch.nrows++;
+	return 1;
+}
+
+/* Join the current probe record with its candidates, until the output is
+ * full. Returns nonzero on error. */
+static int probe_record(struct hashjoin_op *j)
+{
+	const u8 *rec  = record_at(j->probe, j->probe->recs, j->probe_pos);
+	u32	  hash = j->probe_hashes[j->probe_pos];
+	const u8 *cand;
+	u32	  b;
+	int	  res;
+
+	if (!j->in_chain) {
+		j->in_chain	 = 1;
+		j->probe_matched = 0;
+		j->chain	 = has_null_key(j, rec) ? 0 :
+							  j->buckets[hash & j->mask];
+	}
+	while (j->chain != 0 && j->batch.nrows < BATCH_SIZE) {
+		b	 = j->chain - 1;
+		j->chain = j->next[b];
+		cand	 = record_at(j->build, j->rows, b);
+		if (j->hashes[b] != (u32)hash ||
+		    memcmp(cand, rec, j->keywidth) != 0)
+			continue;
+		res = emit(j, cand, rec);
+		if (res < 0)
+			return 1;
+		if (res) {
+			j->probe_matched = 1;
+			j->matched[b]	 = 1;
+		}
+	}
+	if (j->chain != 0)
+		return 0;
+
+	/* rows of the left input without a match are kept */
+	if (j->outer && j->probe == &j->sides[0] && !j->probe_matched) {
+		if (j->batch.nrows == BATCH_SIZE)
+			return 0;
+		emit(j, NULL, rec);
+	}
+	j->in_chain = 0;
+	j->probe_pos++;
+	return 0;
+}
+
+static int hashjoin_next(struct operator *op, struct batch **batch)
+{
+	struct hashjoin_op *j = (struct hashjoin_op *)op;
+	int		    n;
+	int		    i;
+
+	j->batch.nrows = 0;
+	while (j->batch.nrows < BATCH_SIZE && j->state != JOIN_DONE) {
+		switch (j->state) {
+		case JOIN_PROBE:
+			if (j->probe_pos < j->probe_count) {
+				if (probe_record(j))
+					return 1;
+				break;
+			}
+			n = read_records(j, j->probe, j->probe_file);
+			if (n < 0)
+				return 1;
+			if (n == 0) {
+				if (j->probe_file)
+					fclose(j->probe_file);
+				j->probe_file	 = NULL;
+				j->unmatched_pos = 0;
+				j->state	 = JOIN_UNMATCHED;
+				break;
+			}
+			for (i = 0; i < n; ++i)
+				j->probe_hashes[i] = hashtab_hash(
+					record_at(j->probe, j->probe->recs, i),
+					j->keywidth);
+			j->probe_count = n;
+			j->probe_pos   = 0;
+			break;
+		case JOIN_UNMATCHED:
+			/* rows of the left input without a match, when it is
+			 * the build input */
+			if (!j->outer || j->build != &j->sides[0] ||
+			    j->unmatched_pos == j->nrows) {
+				j->state = JOIN_NEXT_SPILL;
+				break;
+			}
+			if (!j->matched[j->unmatched_pos])
+				emit(j,
+				     record_at(j->build, j->rows,
+					       j->unmatched_pos),
+				     NULL);
+			j->unmatched_pos++;
+			break;
+		case JOIN_NEXT_SPILL:
+			if (next_spill(j))
+				return 1;
+			break;
+		case JOIN_DONE:
+			break;
+		}
+	}
+
+	*batch = j->batch.nrows > 0 ? &j->batch : NULL;
+	return 0;
+}
+
+static void hashjoin_close(struct operator *op)
+{
+	struct hashjoin_op *j = (struct hashjoin_op *)op;
+	struct join_spill  *spill;
+	u32		    part;
+
+	for (part = 0; part < NPARTITIONS; ++part) {
+		if (j->build_parts[part])
+			fclose(j->build_parts[part]);
+		if (j->probe_parts[part])
+			fclose(j->probe_parts[part]);
+		j->build_parts[part] = NULL;
+		j->probe_parts[part] = NULL;
+	}
+	if (j->probe_file)
+		fclose(j->probe_file);
+	j->probe_file = NULL;
+	while ((spill = vec_pop(&j->spills)) != NULL) {
+		if (spill->build)
+			fclose(spill->build);
+		if (spill->probe)
+			fclose(spill->probe);
+	}
+	vec_free(&j->spills);
+	j->spills.data = NULL;
+	free(j->rows);
+	free(j->hashes);
+	free(j->next);
+	free(j->matched);
+	free(j->buckets);
+	j->rows	   = NULL;
+	j->hashes  = NULL;
+	j->next	   = NULL;
+	j->matched = NULL;
+	j->buckets = NULL;
+	j->maxrows = 0;
+	mem_recharge(&j->rows_charged, 0);
+	mem_recharge(&j->table_charged, 0);
+}
+
+static const struct operator_ops hashjoin_ops = {
+	.open  = hashjoin_open,
+	.next  = hashjoin_next,
+	.close = hashjoin_close,
+};
+
+static void init_side(struct hashjoin_op *j, struct join_side *side,
+		      struct operator *input, const struct join_keys *keys,
+		      u16 outcol)
+{
+	struct expr *expr;
+	u16	     k;
+
+	side->input  = input;
+	side->outcol = outcol;
+	side->keys   = mem_zalloc(sizeof(struct join_key) * j->nkeys);
+	side->srcs   = mem_alloc(sizeof(u8 *) * (input->ncols + 1));
+	side->nulls  = mem_alloc(sizeof(u8 *) * (input->ncols + 1));
+	for (k = 0; k < j->nkeys; ++k) {
+		expr		       = keys->exprs[k];
+		side->keys[k].typeoid = expr->typeoid;
+		if (expr->type == EXPR_COLUMN)
+			side->keys[k].colno =
+				keys->offsets[expr->tableno] + expr->colno;
+		else
+			side->keys[k].prog = expr_compile_batch(
+				expr, keys->offsets, keys->nullable);
+	}
+}
+
+struct operator *hashjoin_op_create(struct operator *left,
+				    struct operator *right,
+				    const struct join_keys *lkeys,
+				    const struct join_keys *rkeys,
+				    struct expr_prog *cond, int outer,
+				    int build_left, size_t work_mem)
+{
+	struct hashjoin_op *j = mem_zalloc(sizeof(struct hashjoin_op));
+	u32		    lwidth;
+	u32		    rwidth;
+	u16		    k;
+
+	j->op.ops   = &hashjoin_ops;
+	j->op.ncols = left->ncols + right->ncols;
+	j->op.types = mem_alloc(sizeof(struct coltype) * j->op.ncols);
+	memcpy(j->op.types, left->types, sizeof(struct coltype) * left->ncols);
+	memcpy(j->op.types + left->ncols, right->types,
+	       sizeof(struct coltype) * right->ncols);
+	j->op.left  = left;
+	j->op.right = right;
+
+	/* keys take the width of the wider side, so that chars of different
+	 * lengths compare equal */
+	j->nkeys  = lkeys->nkeys;
+	j->keyoff = mem_alloc(sizeof(u32) * (j->nkeys + 1));
+	j->keylen = mem_alloc(sizeof(u32) * (j->nkeys + 1));
+	for (k = 0; k < j->nkeys; ++k) {
+		lwidth	     = hashtab_value_width(lkeys->exprs[k]->typeoid,
+						   lkeys->exprs[k]->typemod);
+		rwidth	     = hashtab_value_width(rkeys->exprs[k]->typeoid,
+						   rkeys->exprs[k]->typemod);
+		j->keyoff[k] = j->keywidth;
+		j->keylen[k] = lwidth > rwidth ? lwidth : rwidth;
+		j->keywidth += 1 + j->keylen[k];
+	}
+	init_side(j, &j->sides[0], left, lkeys, 0);
+	init_side(j, &j->sides[1], right, rkeys, left->ncols);
+	j->build    = &j->sides[build_left ? 0 : 1];
+	j->probe    = &j->sides[build_left ? 1 : 0];
+	j->cond	    = cond;
+	j->outer    = outer;
+	j->work_mem = work_mem;
+	j->outsrcs  = mem_alloc(sizeof(u8 *) * (j->op.ncols + 1));
+	j->outnulls = mem_alloc(sizeof(u8 *) * (j->op.ncols + 1));
+	return &j->op;
+}
@@ -0,0 +1,126 @@
+#include "executor/hashtab.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include "dtype.h"
+#include "util/error.h"
+
+u32 hashtab_value_width(u32 typeoid, i32 typemod)
+{
+	return typeoid == DTYPE_CHAR ? dtype_len(typeoid, typemod) : 8;
+}
+
+void hashtab_store(u8 *dst, u32 typeoid, u32 width, const u8 *src, u32 len)
+{
+	i16 v2;
+	i32 v4;
+	i64 v8;
+
+	if (src == NULL) {
+		memset(dst, 0, width);
+		return;
+	}
+	switch (typeoid) {
+	case DTYPE_INT2:
+		memcpy(&v2, src, 2);
+		v8 = v2;
+		break;
+	case DTYPE_INT4:
+		memcpy(&v4, src, 4);
+		v8 = v4;
+		break;
+	case DTYPE_INT8:
+		memcpy(&v8, src, 8);
+		break;
+	default:
+		assert(typeoid == DTYPE_CHAR);
+		len = strnlen((const char *)src, len);
+		while (len > 0 && src[len - 1] == ' ')
+			--len;
+		memcpy(dst, src, len);
+		memset(dst + len, 0, width - len);
+		return;
+	}
+	memcpy(dst, &v8, 8);
+}
+
+void hashtab_load(struct vector *vec, u16 row, const u8 *src)
+{
+	u8 *dst = vector_at(vec, row);
+	i64 v8;
+	i32 v4;
+	i16 v2;
+
+	if (vec->typeoid == DTYPE_CHAR) {
+		memcpy(dst, src, vec->width);
+		return;
+	}
+	memcpy(&v8, src, 8);
+	switch (vec->width) {
+	case 1:
+		*dst = v8;
+		break;
+	case 2:
+		v2 = v8;
+		memcpy(dst, &v2, 2);
+		break;
+	case 4:
+		v4 = v8;
+		memcpy(dst, &v4, 4);
+		break;
+	default:
+		memcpy(dst, &v8, 8);
+		break;
+	}
+}
+
+u64 hashtab_hash(const u8 *key, u32 len)
+{
+	u64 h = len;
+	u64 w;
+
+	for (; len >= 8; key += 8, len -= 8) {
+		memcpy(&w, key, 8);
+		h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+		h ^= h >> 29;
+	}
+	if (len > 0) {
+		w = 0;
+		memcpy(&w, key, len);
+		h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+int hashtab_spill(FILE **file, const u8 *rec, u32 width)
+{
+	if (*file == NULL)
+		*file = tmpfile();
+	if (*file == NULL || fwrite(rec, width, 1, *file) != 1) {
+		errlog(ERROR, errcode(ER_IO_ERROR),
+		       errmsg("Could not write temporary file: %s",
+			      strerror(errno)));
+		return 1;
+	}
+	return 0;
+}
+
+int hashtab_read(FILE *file, u8 *recs, u32 width, u32 n)
+{
+	size_t nread = fread(recs, width, n, file);
+
+	if (nread == 0 && ferror(file)) {
+		errlog(ERROR, errcode(ER_IO_ERROR),
+		       errmsg("Could not read temporary file: %s",
+			      strerror(errno)));
+		return -1;
+	}
+	return nread;
+}
@@ -0,0 +1,51 @@
+/* Helpers shared by the hash tables of joins and aggregations: keys packed
+ * into records of fixed size, and the partitioning of records into temporary
+ * files when a table outgrows its memory budget */
+
+#ifndef HASHTAB_H
+#define HASHTAB_H
+
+#include <stdio.h>
+
+#include "executor/batch.h"
+#include "univ.h"
+
+/* Records are split into this many files by each pass over spilled records,
+ * using the next PARTITION_BITS of their hash */
+#define NPARTITIONS (16)
+#define PARTITION_BITS (4)
+/* past this depth, records are processed in memory regardless of the
+ * budget */
+#define MAX_DEPTH (64 / PARTITION_BITS - 1)
+
+/* Size of a value in the records: 8 for integers, which are widened so that
+ * values of different types compare equal, and the length of chars, which are
+ * stored without padding */
+u32 hashtab_value_width(u32 typeoid, i32 typemod);
+
+/* Store a value of a vector into the records. A null value is stored as
+ * zeroes. */
+void hashtab_store(u8 *dst, u32 typeoid, u32 width, const u8 *src, u32 len);
+
+/* Convert a value of the records back to the type of a vector */
+void hashtab_load(struct vector *vec, u16 row, const u8 *src);
+
+u64 hashtab_hash(const u8 *key, u32 len);
+
+/* Index of the file a record with the given hash goes to when spilled by a
+ * pass at the given depth */
+static inline u32 hashtab_partition(u64 hash, u8 depth)
+{
+	return (hash >> (64 - PARTITION_BITS * (depth + 1))) &
+	       (NPARTITIONS - 1);
+}
+
+/* Append a record to a temporary file, creating it if *file is NULL. Returns
+ * nonzero on error. */
+int hashtab_spill(FILE **file, const u8 *rec, u32 width);
+
+/* Read up to n records from a temporary file into recs. Returns the number of
+ * records read, 0 at the end of the file and -1 on error. */
+int hashtab_read(FILE *file, u8 *recs, u32 width, u32 n);
+
+#endif // HASHTAB_H
@@ -0,0 +1,110 @@
+#include "executor/insert.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dtype.h"
+#include "storage/heap.h"
+#include "util/error.h"
+#include "util/mem.h"
+
+extern struct heap *heaps[];
+
+static int out_of_range(u32 typeoid)
+{
+	errlog(ERROR, errcode(ER_NUMERIC_VALUE_OUT_OF_RANGE),
+	       errmsg("Value is out of range for type %s",
+		      dtypes[typeoid].name));
+	return 1;
+}
+
+/* Evaluate the value of a column and store it at dst. Constants, which most
+ * values are, are stored as they are, anything else is compiled and run. */
+static int store_value(struct table *table, u16 colno, struct expr *expr,
+		       u8 *dst)
+{
+	struct column	      *col     = &table->cols[colno];
+	u8 *const	       srcs[1] = { NULL };
+	const union expr_reg *reg;
+	union expr_reg	       val;
+	u8		       isnull;
+	i16		       v2;
+	i32		       v4;
+
+	if (expr->type == EXPR_CONST && expr->typeoid == DTYPE_CHAR) {
+		val.str = (const u8 *)expr->val_str;
+		val.len = expr->typemod;
+		reg	= &val;
+	} else if (expr->type == EXPR_CONST) {
+		val.val_int = expr->val_int;
+		reg	    = &val;
+	} else {
+		reg = expr_eval(expr_compile_tuple(expr, table), srcs, NULL, 0,
+				&isnull);
+		if (reg == NULL)
+			return 1;
+	}
+
+	switch (col->typeoid) {
+	case DTYPE_INT2:
+		if (reg->val_int < INT16_MIN || reg->val_int > INT16_MAX)
+			return out_of_range(col->typeoid);
+		v2 = reg->val_int;
+		memcpy(dst, &v2, sizeof(v2));
+		return 0;
+	case DTYPE_INT4:
+		if (reg->val_int < INT32_MIN || reg->val_int > INT32_MAX)
+			return out_of_range(col->typeoid);
+		v4 = reg->val_int;
+		memcpy(dst, &v4, sizeof(v4));
+		return 0;
+	case DTYPE_INT8:
+		memcpy(dst, &reg->val_int, sizeof(reg->val_int));
+		return 0;
+	case DTYPE_CHAR:
+		assert(reg->len <= col->typemod);
+		memcpy(dst, reg->str, reg->len);
+		memset(dst + reg->len, 0, col->typemod - reg->len);
+		return 0;
+	default:
+		errlog(PANIC, errmsg("Serialization for dtype %u not implemented",
+				     col->typeoid));
+		return 1;
+	}
+}
+
+int sql_insert(struct insert *insert)
+{
+	struct table  *table = insert->table;
+	struct expr  **value = insert->values;
+	size_t	      *offsets;
+	size_t	       tupsize = 0;
+	u8	      *tups;
+	u8	      *tup;
+	u32	       rowno;
+	u16	       colno;
+
+	assert(insert->command == COM_INSERT);
+
+	/* the layout of the tuples is worked out once for all the rows */
+	offsets = mem_alloc(sizeof(size_t) * table->ncols);
+	for (colno = 0; colno < table->ncols; ++colno) {
+		offsets[colno] = tupsize;
+		tupsize += dtype_len(table->cols[colno].typeoid,
+				     table->cols[colno].typemod);
+	}
+
+	tups = mem_alloc(tupsize * insert->nrows);
+	for (rowno = 0, tup = tups; rowno < insert->nrows;
+	     ++rowno, tup += tupsize) {
+		for (colno = 0; colno < table->ncols; ++colno) {
+			if (store_value(table, colno, *value++,
+					tup + offsets[colno]))
+				return 1;
+		}
+	}
+
+	heap_add_tuples(heaps[table->oid], tups, tupsize, insert->nrows);
+	return 0;
+}
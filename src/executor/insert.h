@@ -0,0 +1,27 @@
+/* Adding rows to a table with INSERT ... VALUES */
+
+#ifndef INSERT_H
+#define INSERT_H
+
+#include "executor/expr.h"
+#include "parser/parser.h"
+#include "table.h"
+#include "univ.h"
+
+/* A fully-resolved representation of an insert statement */
+struct insert {
+	enum sql_command command;
+
+	struct table *table;
+
+	/* values of the rows, one expression per column of the table in the
+	 * order of the columns, row after row */
+	u32	      nrows;
+	struct expr **values;
+};
+
+/* Build the tuples of all the rows, then append them to the heap of the
+ * table. Nothing is added if an error is returned. */
+int sql_insert(struct insert *insert);
+
+#endif // INSERT_H
@@ -0,0 +1,176 @@
+#include "executor/operator.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "util/mem.h"
+
+/* Nested loop join without condition. The right input is materialized, then
+ * every row of the left input is paired with every row of the right. */
+struct nestloop_op {
+	struct operator op;
+	/* list of struct batch holding the rows of the right input */
+	struct vec inner;
+	/* current left batch, and position in it and in the right rows */
+	struct batch *outer;
+	u16	      outer_pos;
+	size_t	      inner_batch;
+	u16	      inner_pos;
+	struct batch  batch;
+};
+
+static int nestloop_open(struct operator *op)
+{
+	struct nestloop_op *nl = (struct nestloop_op *)op;
+	struct batch	   *in;
+
+	vec_init(&nl->inner, 1);
+	for (;;) {
+		if (op_next(op->right, &in))
+			return 1;
+		if (in == NULL)
+			break;
+		if (mem_check_limit())
+			return 1;
+		if (batch_count(in) > 0)
+			vec_push(&nl->inner, batch_clone(in));
+	}
+
+	/* output vectors are allocated on first use, only for the input
+	 * columns that have data */
+	batch_init(&nl->batch, op->ncols);
+	return 0;
+}
+
+/* Set the null flags of n output values from those at src, or all from the
+ * one at src if repeat is set. src is NULL if no value is null. The flags of
+ * the output are allocated on the first null. */
+static void set_nulls(struct vector *dst, u16 row, const u8 *src, u16 n,
+		      int repeat)
+{
+	if (src == NULL && dst->nulls == NULL)
+		return;
+	if (dst->nulls == NULL)
+		dst->nulls = mem_zalloc(BATCH_SIZE);
+	if (src == NULL)
+		memset(dst->nulls + row, 0, n);
+	else if (repeat)
+		memset(dst->nulls + row, *src, n);
+	else
+		memcpy(dst->nulls + row, src, n);
+}
+
+/* Append n rows pairing the current outer row with consecutive inner rows */
+static void nestloop_emit(struct nestloop_op *nl, struct batch *inner, u16 n)
+{
+	struct batch *out   = &nl->batch;
+	u16	      nleft = nl->op.left->ncols;
+	u16	      orow  = batch_row(nl->outer, nl->outer_pos);
+	u16	      colno;
+	u16	      i;
+
+	for (colno = 0; colno < nleft; ++colno) {
+		struct vector *src = &nl->outer->cols[colno];
+		struct vector *dst = &out->cols[colno];
+
+		if (src->data == NULL)
+			continue;
+		if (dst->data == NULL)
+			vector_init(dst, src->typeoid, src->typemod);
+		for (i = 0; i < n; ++i)
+			memcpy(vector_at(dst, out->nrows + i),
+			       vector_at(src, orow), src->width);
+		set_nulls(dst, out->nrows, src->nulls ? src->nulls + orow : NULL,
+			  n, 1);
+	}
+	/* inner batches are compact, so their rows are copied in one go */
+	for (colno = 0; colno < inner->ncols; ++colno) {
+		struct vector *src = &inner->cols[colno];
+		struct vector *dst = &out->cols[nleft + colno];
+
+		if (src->data == NULL)
+			continue;
+		if (dst->data == NULL)
+			vector_init(dst, src->typeoid, src->typemod);
+		memcpy(vector_at(dst, out->nrows), vector_at(src, nl->inner_pos),
+		       (size_t)n * src->width);
+		set_nulls(dst, out->nrows,
+			  src->nulls ? src->nulls + nl->inner_pos : NULL, n, 0);
+	}
+	out->nrows += n;
+}
+
+static int nestloop_next(struct operator *op, struct batch **batch)
+{
+	struct nestloop_op *nl	= (struct nestloop_op *)op;
+	struct batch	   *out = &nl->batch;
+	struct batch	   *inner;
+	u16		    n;
+
+	out->nrows = 0;
+	out->sel   = NULL;
+	if (nl->inner.size == 0) {
+		*batch = NULL;
+		return 0;
+	}
+
+	while (out->nrows < BATCH_SIZE) {
+		if (nl->outer == NULL || nl->outer_pos >= batch_count(nl->outer)) {
+			if (op_next(op->left, &nl->outer))
+				return 1;
+			if (nl->outer == NULL)
+				break;
+			nl->outer_pos	= 0;
+			nl->inner_batch = 0;
+			nl->inner_pos	= 0;
+			continue;
+		}
+
+		inner = nl->inner.data[nl->inner_batch];
+		n     = inner->nrows - nl->inner_pos;
+		if (n > BATCH_SIZE - out->nrows)
+			n = BATCH_SIZE - out->nrows;
+		nestloop_emit(nl, inner, n);
+
+		nl->inner_pos += n;
+		if (nl->inner_pos == inner->nrows) {
+			nl->inner_pos = 0;
+			if (++nl->inner_batch == nl->inner.size) {
+				nl->inner_batch = 0;
+				nl->outer_pos++;
+			}
+		}
+	}
+
+	*batch = out->nrows > 0 ? out : NULL;
+	return 0;
+}
+
+static void nestloop_close(struct operator *op)
+{
+	struct nestloop_op *nl = (struct nestloop_op *)op;
+
+	vec_free(&nl->inner);
+}
+
+static const struct operator_ops nestloop_ops = {
+	.open  = nestloop_open,
+	.next  = nestloop_next,
+	.close = nestloop_close,
+};
+
+struct operator *nestloop_op_create(struct operator *left,
+				    struct operator *right)
+{
+	struct nestloop_op *nl = mem_zalloc(sizeof(struct nestloop_op));
+
+	nl->op.ops   = &nestloop_ops;
+	nl->op.ncols = left->ncols + right->ncols;
+	nl->op.types = mem_alloc(sizeof(struct coltype) * nl->op.ncols);
+	memcpy(nl->op.types, left->types, sizeof(struct coltype) * left->ncols);
+	memcpy(nl->op.types + left->ncols, right->types,
+	       sizeof(struct coltype) * right->ncols);
+	nl->op.left  = left;
+	nl->op.right = right;
+	return &nl->op;
+}
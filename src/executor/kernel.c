@@ -0,0 +1,456 @@
+#include "executor/kernel.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include "dtype.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNEL_X86
+#endif
+
+/* Relations computed by the kernels, the other comparisons are their
+ * negations */
+enum kernel_cmp { CMP_EQ, CMP_GT, CMP_LT };
+
+struct kernel_impl {
+	enum kernel_isa isa;
+	void (*int2)(const i16 *vals, u16 n, enum kernel_cmp cmp, i16 c,
+		     u64 *bits);
+	void (*int4)(const i32 *vals, u16 n, enum kernel_cmp cmp, i32 c,
+		     u64 *bits);
+	void (*int8)(const i64 *vals, u16 n, enum kernel_cmp cmp, i64 c,
+		     u64 *bits);
+	/* values width bytes apart equal to, or starting with, str */
+	void (*chars)(const u8 *vals, u32 width, u16 n, const u8 *str,
+		      u32 len, int prefix, u64 *bits);
+};
+
+/* Scalar versions, also finishing the values past the last whole register
+ * of the SIMD versions. They handle values from to n. */
+
+#define SCALAR_CMP(from, n, vals, cmp, c, bits)                           \
+	do {                                                              \
+		u16 i;                                                    \
+		switch (cmp) {                                            \
+		case CMP_EQ:                                              \
+			for (i = from; i < n; ++i)                        \
+				bits[i / 64] |= (u64)(vals[i] == c)       \
+						<< (i % 64);              \
+			break;                                            \
+		case CMP_GT:                                              \
+			for (i = from; i < n; ++i)                        \
+				bits[i / 64] |= (u64)(vals[i] > c)        \
+						<< (i % 64);              \
+			break;                                            \
+		case CMP_LT:                                              \
+			for (i = from; i < n; ++i)                        \
+				bits[i / 64] |= (u64)(vals[i] < c)        \
+						<< (i % 64);              \
+			break;                                            \
+		}                                                         \
+	} while (0)
+
+static void scalar_int2_from(const i16 *vals, u16 from, u16 n,
+			     enum kernel_cmp cmp, i16 c, u64 *bits)
+{
+	SCALAR_CMP(from, n, vals, cmp, c, bits);
+}
+
+static void scalar_int4_from(const i32 *vals, u16 from, u16 n,
+			     enum kernel_cmp cmp, i32 c, u64 *bits)
+{
+	SCALAR_CMP(from, n, vals, cmp, c, bits);
+}
+
+static void scalar_int8_from(const i64 *vals, u16 from, u16 n,
+			     enum kernel_cmp cmp, i64 c, u64 *bits)
+{
+	SCALAR_CMP(from, n, vals, cmp, c, bits);
+}
+
+static void scalar_int2(const i16 *vals, u16 n, enum kernel_cmp cmp, i16 c,
+			u64 *bits)
+{
+	scalar_int2_from(vals, 0, n, cmp, c, bits);
+}
+
+static void scalar_int4(const i32 *vals, u16 n, enum kernel_cmp cmp, i32 c,
+			u64 *bits)
+{
+	scalar_int4_from(vals, 0, n, cmp, c, bits);
+}
+
+static void scalar_int8(const i64 *vals, u16 n, enum kernel_cmp cmp, i64 c,
+			u64 *bits)
+{
+	scalar_int8_from(vals, 0, n, cmp, c, bits);
+}
+
+/* A char value matches if it starts with str and, unless matching a prefix,
+ * only padding follows */
+static int char_match(const u8 *val, u32 width, const u8 *str, u32 len,
+		      int prefix)
+{
+	u32 i;
+
+	if (memcmp(val, str, len) != 0)
+		return 0;
+	if (prefix)
+		return 1;
+	for (i = len; i < width; ++i) {
+		if (val[i] != '\0' && val[i] != ' ')
+			return 0;
+	}
+	return 1;
+}
+
+static void scalar_chars(const u8 *vals, u32 width, u16 n, const u8 *str,
+			 u32 len, int prefix, u64 *bits)
+{
+	u16 i;
+
+	for (i = 0; i < n; ++i)
+		bits[i / 64] |= (u64)char_match(vals + (size_t)i * width,
+						width, str, len, prefix)
+				<< (i % 64);
+}
+
+static const struct kernel_impl scalar_impl = {
+	.isa   = KERNEL_SCALAR,
+	.int2  = scalar_int2,
+	.int4  = scalar_int4,
+	.int8  = scalar_int8,
+	.chars = scalar_chars,
+};
+
+#ifdef KERNEL_X86
+
+/* Each register of values is compared at once, and the sign bits of the
+ * lanes of the result gathered into bits. Registers are a power of two
+ * values wide, so those bits never straddle two words of the bitmap. */
+
+#define SSE42 __attribute__((target("sse4.2")))
+#define AVX2 __attribute__((target("avx2")))
+
+SSE42 static inline __m128i sse_cmp_epi16(__m128i v, __m128i c,
+					  enum kernel_cmp cmp)
+{
+	if (cmp == CMP_EQ)
+		return _mm_cmpeq_epi16(v, c);
+	return cmp == CMP_GT ? _mm_cmpgt_epi16(v, c) : _mm_cmpgt_epi16(c, v);
+}
+
+SSE42 static void sse_int2(const i16 *vals, u16 n, enum kernel_cmp cmp,
+			   i16 c, u64 *bits)
+{
+	__m128i cv = _mm_set1_epi16(c);
+	__m128i m;
+	u16	i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		m = sse_cmp_epi16(_mm_loadu_si128((const __m128i *)(vals + i)),
+				  cv, cmp);
+		/* narrow the 16-bit lanes to bytes to get one bit each */
+		m = _mm_packs_epi16(m, m);
+		bits[i / 64] |= (u64)(_mm_movemask_epi8(m) & 0xff) << (i % 64);
+	}
+	scalar_int2_from(vals, i, n, cmp, c, bits);
+}
+
+SSE42 static void sse_int4(const i32 *vals, u16 n, enum kernel_cmp cmp,
+			   i32 c, u64 *bits)
+{
+	__m128i cv = _mm_set1_epi32(c);
+	__m128i v;
+	__m128i m;
+	u16	i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		v = _mm_loadu_si128((const __m128i *)(vals + i));
+		if (cmp == CMP_EQ)
+			m = _mm_cmpeq_epi32(v, cv);
+		else if (cmp == CMP_GT)
+			m = _mm_cmpgt_epi32(v, cv);
+		else
+			m = _mm_cmpgt_epi32(cv, v);
+		bits[i / 64] |= (u64)_mm_movemask_ps(_mm_castsi128_ps(m))
+				<< (i % 64);
+	}
+	scalar_int4_from(vals, i, n, cmp, c, bits);
+}
+
+SSE42 static void sse_int8(const i64 *vals, u16 n, enum kernel_cmp cmp,
+			   i64 c, u64 *bits)
+{
+	__m128i cv = _mm_set1_epi64x(c);
+	__m128i v;
+	__m128i m;
+	u16	i;
+
+	for (i = 0; i + 2 <= n; i += 2) {
+		v = _mm_loadu_si128((const __m128i *)(vals + i));
+		if (cmp == CMP_EQ)
+			m = _mm_cmpeq_epi64(v, cv);
+		else if (cmp == CMP_GT)
+			m = _mm_cmpgt_epi64(v, cv);
+		else
+			m = _mm_cmpgt_epi64(cv, v);
+		bits[i / 64] |= (u64)_mm_movemask_pd(_mm_castsi128_pd(m))
+				<< (i % 64);
+	}
+	scalar_int8_from(vals, i, n, cmp, c, bits);
+}
+
+/* Values of up to 16 bytes are compared a whole value at a time. The loads
+ * may read past the last value, into the padding of the vector. */
+SSE42 static void sse_chars(const u8 *vals, u32 width, u16 n, const u8 *str,
+			    u32 len, int prefix, u64 *bits)
+{
+	u8	buf[16] = { 0 };
+	__m128i pat;
+	__m128i v;
+	__m128i pad;
+	u32	strmask;
+	u32	padmask;
+	u32	eq;
+	u32	padding;
+	u64	word = 0;
+	u16	i;
+
+	if (width > 16) {
+		scalar_chars(vals, width, n, str, len, prefix, bits);
+		return;
+	}
+	memcpy(buf, str, len);
+	pat	= _mm_loadu_si128((const __m128i *)buf);
+	strmask = (1u << len) - 1;
+	padmask = prefix ? 0 : ((1u << width) - 1) & ~strmask;
+	for (i = 0; i < n; ++i) {
+		v   = _mm_loadu_si128((const __m128i *)(vals + (size_t)i * width));
+		eq  = _mm_movemask_epi8(_mm_cmpeq_epi8(v, pat));
+		pad = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_setzero_si128()),
+				   _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+		padding = _mm_movemask_epi8(pad);
+		word |= (u64)(((eq & strmask) == strmask) &
+			      ((padding & padmask) == padmask))
+			<< (i % 64);
+		if (i % 64 == 63) {
+			bits[i / 64] = word;
+			word	     = 0;
+		}
+	}
+	if (n % 64)
+		bits[n / 64] = word;
+}
+
+AVX2 static inline __m256i avx2_cmp_epi16(__m256i v, __m256i c,
+					  enum kernel_cmp cmp)
+{
+	if (cmp == CMP_EQ)
+		return _mm256_cmpeq_epi16(v, c);
+	return cmp == CMP_GT ? _mm256_cmpgt_epi16(v, c) :
+			       _mm256_cmpgt_epi16(c, v);
+}
+
+AVX2 static void avx2_int2(const i16 *vals, u16 n, enum kernel_cmp cmp,
+			   i16 c, u64 *bits)
+{
+	__m256i cv = _mm256_set1_epi16(c);
+	__m256i m;
+	u32	mask;
+	u16	i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		m = avx2_cmp_epi16(
+			_mm256_loadu_si256((const __m256i *)(vals + i)), cv,
+			cmp);
+		/* packing works within each 128-bit half, leaving lanes 0-7
+		 * in bytes 0-7 and lanes 8-15 in bytes 16-23 */
+		mask = _mm256_movemask_epi8(_mm256_packs_epi16(m, m));
+		bits[i / 64] |= (u64)((mask & 0xff) | ((mask >> 8) & 0xff00))
+				<< (i % 64);
+	}
+	scalar_int2_from(vals, i, n, cmp, c, bits);
+}
+
+AVX2 static void avx2_int4(const i32 *vals, u16 n, enum kernel_cmp cmp,
+			   i32 c, u64 *bits)
+{
+	__m256i cv = _mm256_set1_epi32(c);
+	__m256i v;
+	__m256i m;
+	u16	i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		v = _mm256_loadu_si256((const __m256i *)(vals + i));
+		if (cmp == CMP_EQ)
+			m = _mm256_cmpeq_epi32(v, cv);
+		else if (cmp == CMP_GT)
+			m = _mm256_cmpgt_epi32(v, cv);
+		else
+			m = _mm256_cmpgt_epi32(cv, v);
+		bits[i / 64] |= (u64)_mm256_movemask_ps(_mm256_castsi256_ps(m))
+				<< (i % 64);
+	}
+	scalar_int4_from(vals, i, n, cmp, c, bits);
+}
+
+AVX2 static void avx2_int8(const i64 *vals, u16 n, enum kernel_cmp cmp,
+			   i64 c, u64 *bits)
+{
+	__m256i cv = _mm256_set1_epi64x(c);
+	__m256i v;
+	__m256i m;
+	u16	i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		v = _mm256_loadu_si256((const __m256i *)(vals + i));
+		if (cmp == CMP_EQ)
+			m = _mm256_cmpeq_epi64(v, cv);
+		else if (cmp == CMP_GT)
+			m = _mm256_cmpgt_epi64(v, cv);
+		else
+			m = _mm256_cmpgt_epi64(cv, v);
+		bits[i / 64] |= (u64)_mm256_movemask_pd(_mm256_castsi256_pd(m))
+				<< (i % 64);
+	}
+	scalar_int8_from(vals, i, n, cmp, c, bits);
+}
+
+static const struct kernel_impl sse42_impl = {
+	.isa   = KERNEL_SSE42,
+	.int2  = sse_int2,
+	.int4  = sse_int4,
+	.int8  = sse_int8,
+	.chars = sse_chars,
+};
+
+/* a char value fits in one SSE register, AVX2 brings nothing for those */
+static const struct kernel_impl avx2_impl = {
+	.isa   = KERNEL_AVX2,
+	.int2  = avx2_int2,
+	.int4  = avx2_int4,
+	.int8  = avx2_int8,
+	.chars = sse_chars,
+};
+
+#endif // KERNEL_X86
+
+static const struct kernel_impl *impl = &scalar_impl;
+static pthread_once_t		 impl_once = PTHREAD_ONCE_INIT;
+
+static const struct kernel_impl *isa_impl(enum kernel_isa isa)
+{
+#ifdef KERNEL_X86
+	__builtin_cpu_init();
+	switch (isa) {
+	case KERNEL_AVX2:
+		return __builtin_cpu_supports("avx2") ? &avx2_impl : NULL;
+	case KERNEL_SSE42:
+		return __builtin_cpu_supports("sse4.2") ? &sse42_impl : NULL;
+	case KERNEL_SCALAR:
+		return &scalar_impl;
+	}
+	return NULL;
+#else
+	return isa == KERNEL_SCALAR ? &scalar_impl : NULL;
+#endif
+}
+
+static void select_impl(void)
+{
+	enum kernel_isa isa;
+
+	for (isa = KERNEL_AVX2; isa > KERNEL_SCALAR; --isa) {
+		if (isa_impl(isa) != NULL)
+			break;
+	}
+	impl = isa_impl(isa);
+}
+
+enum kernel_isa kernel_isa(void)
+{
+	pthread_once(&impl_once, select_impl);
+	return impl->isa;
+}
+
+int kernel_use_isa(enum kernel_isa isa)
+{
+	const struct kernel_impl *found;
+
+	pthread_once(&impl_once, select_impl);
+	found = isa_impl(isa);
+	if (found == NULL)
+		return 1;
+	impl = found;
+	return 0;
+}
+
+const char *kernel_isa_name(enum kernel_isa isa)
+{
+	switch (isa) {
+	case KERNEL_AVX2:
+		return "avx2";
+	case KERNEL_SSE42:
+		return "sse4.2";
+	default:
+		return "scalar";
+	}
+}
+
+void kernel_filter(const struct column_pred *pred, const struct vector *vec,
+		   u16 n, u64 *bits)
+{
+	enum kernel_cmp cmp;
+	int		negate;
+	u16		w;
+
+	pthread_once(&impl_once, select_impl);
+	memset(bits, 0, sizeof(u64) * BITMAP_WORDS);
+
+	switch (pred->op) {
+	case EXPR_NE:
+	case EXPR_EQ:
+		cmp = CMP_EQ;
+		break;
+	case EXPR_GT:
+	case EXPR_LE:
+		cmp = CMP_GT;
+		break;
+	default:
+		cmp = CMP_LT;
+		break;
+	}
+	negate = pred->op == EXPR_NE || pred->op == EXPR_LE ||
+		 pred->op == EXPR_GE;
+
+	switch (vec->typeoid) {
+	case DTYPE_INT2:
+		impl->int2((const i16 *)vec->data, n, cmp, pred->val_int, bits);
+		break;
+	case DTYPE_INT4:
+		impl->int4((const i32 *)vec->data, n, cmp, pred->val_int, bits);
+		break;
+	case DTYPE_INT8:
+		impl->int8((const i64 *)vec->data, n, cmp, pred->val_int, bits);
+		break;
+	case DTYPE_CHAR:
+		/* a longer string matches no value */
+		if (pred->len <= vec->width)
+			impl->chars(vec->data, vec->width, n, pred->str,
+				    pred->len, pred->op == EXPR_LIKE, bits);
+		break;
+	}
+
+	if (negate) {
+		for (w = 0; w < BITMAP_WORDS; ++w)
+			bits[w] = ~bits[w];
+		/* clear the bits past the last value */
+		for (w = (n + 63) / 64; w < BITMAP_WORDS; ++w)
+			bits[w] = 0;
+		if (n % 64)
+			bits[n / 64] &= ((u64)1 << (n % 64)) - 1;
+	}
+}
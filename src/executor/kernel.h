@@ -0,0 +1,44 @@
+/* Filters evaluating a comparison on a whole vector at a time, with the SIMD
+ * instructions of the CPU when it has them */
+
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include "executor/batch.h"
+#include "executor/expr.h"
+#include "univ.h"
+
+/* Number of words of a bitmap holding one bit per row of a batch, row i being
+ * bit i % 64 of word i / 64 */
+#define BITMAP_WORDS (BATCH_SIZE / 64)
+
+/* A comparison of a column with a constant */
+struct column_pred {
+	u16 colno;
+	/* EXPR_EQ to EXPR_GE, or EXPR_LIKE for a prefix match on char */
+	enum expr_op op;
+	/* the constant, which fits the type of the column. For char, the
+	 * string or prefix without padding. */
+	i64	  val_int;
+	const u8 *str;
+	u32	  len;
+};
+
+enum kernel_isa { KERNEL_SCALAR, KERNEL_SSE42, KERNEL_AVX2 };
+
+/* The instruction set the kernels use, by default the best one the CPU
+ * supports */
+enum kernel_isa kernel_isa(void);
+
+/* Make the kernels use the given instruction set. Returns nonzero if the CPU
+ * does not support it. */
+int kernel_use_isa(enum kernel_isa isa);
+
+const char *kernel_isa_name(enum kernel_isa isa);
+
+/* Set the bits of the first n values of vec satisfying the predicate, and
+ * clear all the others */
+void kernel_filter(const struct column_pred *pred, const struct vector *vec,
+		   u16 n, u64 *bits);
+
+#endif // KERNEL_H
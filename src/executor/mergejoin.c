@@ -0,0 +1,475 @@
+#include "executor/operator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtype.h"
+#include "executor/hashtab.h"
+#include "util/mem.h"
+
+/* Merge join.
+ *
+ * Both inputs come sorted on their keys. The keys of each batch are turned
+ * into records laid out the same way on both sides, each key being a flag set
+ * if it is null followed by its value, so that they compare in the order of
+ * the sort. The rows of the right input sharing the key of the current left
+ * row are copied into a group, as records of the columns that have data, and
+ * each left row with that key is paired with every row of the group. Since
+ * the left keys only grow, the right rows before the group are never needed
+ * again. */
+
+#define UNUSED_COL UINT32_MAX
+
+/* A key of the records */
+struct merge_key {
+	/* program computing the value, NULL to copy input column colno */
+	struct expr_prog *prog;
+	u16		  colno;
+	u32		  typeoid;
+};
+
+/* One of the inputs, and the keys of its current batch */
+struct merge_side {
+	struct operator	 *input;
+	struct merge_key *keys;
+	/* data and null flags of the input columns, for programs */
+	u8	    **srcs;
+	u8	    **nulls;
+	struct batch *batch;
+	u8	     *keyrecs;
+	/* selected rows of the batch, and the next one to look at */
+	u16 count;
+	u16 pos;
+	/* the input returned its last batch */
+	int done;
+};
+
+struct mergejoin_op {
+	struct operator	  op;
+	u16		  nkeys;
+	/* offset of the null flag of each key in the records, and the size of
+	 * the value after it */
+	u32		 *keyoff;
+	u32		 *keylen;
+	u32		  keywidth;
+	struct merge_side left;
+	struct merge_side right;
+	struct expr_prog *cond;
+	/* data and null flags of the output columns, for cond */
+	u8 **outsrcs;
+	u8 **outnulls;
+	int  outer;
+
+	/* offset of the null flag of each right column in the records of the
+	 * group, UNUSED_COL if the column has no data. Set from the first
+	 * right batch. */
+	u32 *coloff;
+	u32  recwidth;
+	/* right rows whose key is groupkey */
+	u8    *group;
+	u32    ngroup;
+	u32    maxgroup;
+	/* bytes of the group charged to the memory root */
+	size_t charged;
+	u8    *groupkey;
+	int    has_group;
+	/* the current left row was compared with the group, and the next row
+	 * of the group to pair it with, and whether it matched */
+	int	     in_group;
+	u32	     gpos;
+	int	     matched;
+	struct batch batch;
+};
+
+static int has_null_key(struct mergejoin_op *mj, const u8 *key)
+{
+	u16 k;
+
+	for (k = 0; k < mj->nkeys; ++k) {
+		if (key[mj->keyoff[k]])
+			return 1;
+	}
+	return 0;
+}
+
+/* Compare two keys in the order of the sort, nulls last */
+static int compare_keys(struct mergejoin_op *mj, const u8 *a, const u8 *b)
+{
+	const u8 *ka;
+	const u8 *kb;
+	i64	  va, vb;
+	int	  cmp;
+	u16	  k;
+
+	for (k = 0; k < mj->nkeys; ++k) {
+		ka = a + mj->keyoff[k];
+		kb = b + mj->keyoff[k];
+		if (ka[0] != kb[0])
+			return ka[0] - kb[0];
+		if (ka[0])
+			continue;
+		if (mj->left.keys[k].typeoid == DTYPE_CHAR) {
+			cmp = memcmp(ka + 1, kb + 1, mj->keylen[k]);
+			if (cmp != 0)
+				return cmp;
+			continue;
+		}
+		memcpy(&va, ka + 1, 8);
+		memcpy(&vb, kb + 1, 8);
+		if (va != vb)
+			return va < vb ? -1 : 1;
+	}
+	return 0;
+}
+
+/* Fill the key records of the selected rows of the current batch of an
+ * input */
+static int make_keys(struct mergejoin_op *mj, struct merge_side *side)
+{
+	struct batch	     *in = side->batch;
+	const union expr_reg *reg;
+	u8		     *dst;
+	u16		      colno;
+	u16		      row;
+	u16		      i;
+	u16		      k;
+
+	for (colno = 0; colno < in->ncols; ++colno) {
+		side->srcs[colno]  = in->cols[colno].data;
+		side->nulls[colno] = in->cols[colno].nulls;
+	}
+	for (k = 0; k < mj->nkeys; ++k) {
+		struct merge_key *key = &side->keys[k];
+		struct vector	 *vec = &in->cols[key->colno];
+
+		dst = side->keyrecs + mj->keyoff[k];
+		for (i = 0; i < side->count; ++i, dst += mj->keywidth) {
+			row = batch_row(in, i);
+			if (key->prog == NULL) {
+				dst[0] = vec->nulls && vec->nulls[row];
+				hashtab_store(dst + 1, key->typeoid,
+					      mj->keylen[k],
+					      dst[0] ? NULL :
+						       vector_at(vec, row),
+					      vec->width);
+				continue;
+			}
+			reg = expr_eval(key->prog, side->srcs, side->nulls,
+					row, dst);
+			if (reg == NULL)
+				return 1;
+			if (dst[0])
+				memset(dst + 1, 0, mj->keylen[k]);
+			else if (key->typeoid == DTYPE_CHAR)
+				hashtab_store(dst + 1, DTYPE_CHAR,
+					      mj->keylen[k], reg->str,
+					      reg->len);
+			else
+				memcpy(dst + 1, &reg->val_int, 8);
+		}
+	}
+	return 0;
+}
+
+/* Set *key to the key of the current row of an input, reading its next
+ * batch if needed, or to NULL at the end. Returns nonzero on error. */
+static int current_key(struct mergejoin_op *mj, struct merge_side *side,
+		       const u8 **key)
+{
+	while (side->pos == side->count) {
+		if (side->done) {
+			*key = NULL;
+			return 0;
+		}
+		if (op_next(side->input, &side->batch))
+			return 1;
+		if (side->batch == NULL) {
+			side->done = 1;
+			continue;
+		}
+		side->count = batch_count(side->batch);
+		side->pos   = 0;
+		if (mem_check_limit() || make_keys(mj, side))
+			return 1;
+	}
+	*key = side->keyrecs + (size_t)side->pos * mj->keywidth;
+	return 0;
+}
+
+static inline u8 *group_at(struct mergejoin_op *mj, u32 i)
+{
+	return mj->group + (size_t)i * mj->recwidth;
+}
+
+/* Lay out the records of the group with the columns of a right batch having
+ * data */
+static void lay_out(struct mergejoin_op *mj, struct batch *in)
+{
+	u16 colno;
+
+	mj->coloff   = mem_alloc(sizeof(u32) * in->ncols);
+	mj->recwidth = 0;
+	for (colno = 0; colno < in->ncols; ++colno) {
+		if (in->cols[colno].data == NULL) {
+			mj->coloff[colno] = UNUSED_COL;
+			continue;
+		}
+		mj->coloff[colno] = mj->recwidth;
+		mj->recwidth += 1 + in->cols[colno].width;
+	}
+	if (mj->recwidth == 0)
+		mj->recwidth = 1;
+}
+
+/* Copy the current right row to the group */
+static void add_to_group(struct mergejoin_op *mj)
+{
+	struct batch *in  = mj->right.batch;
+	u16	      row = batch_row(in, mj->right.pos);
+	u8	     *dst;
+	u16	      colno;
+
+	if (mj->coloff == NULL)
+		lay_out(mj, in);
+	if (mj->ngroup == mj->maxgroup) {
+		mj->maxgroup = mj->maxgroup > 0 ? mj->maxgroup * 2 : 64;
+		mj->group    = realloc(mj->group,
+					(size_t)mj->maxgroup * mj->recwidth);
+		mem_recharge(&mj->charged,
+			     (size_t)mj->maxgroup * mj->recwidth);
+	}
+	for (colno = 0; colno < in->ncols; ++colno) {
+		struct vector *vec = &in->cols[colno];
+
+		if (mj->coloff[colno] == UNUSED_COL)
+			continue;
+		dst    = group_at(mj, mj->ngroup) + mj->coloff[colno];
+		dst[0] = vec->nulls && vec->nulls[row];
+		memcpy(dst + 1, vector_at(vec, row), vec->width);
+	}
+	mj->ngroup++;
+}
+
+/* Make the group the right rows with the given key, skipping those with
+ * smaller keys. The group is empty if there are none. */
+static int load_group(struct mergejoin_op *mj, const u8 *key)
+{
+	const u8 *rkey;
+	int	  cmp;
+
+	mj->ngroup    = 0;
+	mj->has_group = 1;
+	memcpy(mj->groupkey, key, mj->keywidth);
+	for (;;) {
+		if (current_key(mj, &mj->right, &rkey))
+			return 1;
+		if (rkey == NULL)
+			return 0;
+		cmp = compare_keys(mj, rkey, key);
+		if (cmp > 0)
+			return 0;
+		if (cmp == 0)
+			add_to_group(mj);
+		mj->right.pos++;
+	}
+}
+
+/* Append a row made of the current left row and a record of the group, or
+ * nulls if rec is NULL. Returns 1 if the row satisfies the condition, 0 if
+ * not and -1 on error. */
+static int emit(struct mergejoin_op *mj, const u8 *rec)
+{
+	struct batch *in    = mj->left.batch;
+	u16	      row   = mj->batch.nrows;
+	u16	      lrow  = batch_row(in, mj->left.pos);
+	u16	      nleft = in->ncols;
+	u16	      colno;
+	u32	      off;
+	int	      res;
+
+	for (colno = 0; colno < nleft; ++colno) {
+		struct vector *src = &in->cols[colno];
+		struct vector *dst = &mj->batch.cols[colno];
+
+		if (src->data == NULL)
+			continue;
+		dst->nulls[row] = src->nulls && src->nulls[lrow];
+		memcpy(vector_at(dst, row), vector_at(src, lrow), src->width);
+	}
+	for (colno = 0; colno < mj->op.ncols - nleft; ++colno) {
+		struct vector *dst = &mj->batch.cols[nleft + colno];
+
+		if (rec == NULL) {
+			dst->nulls[row] = 1;
+			continue;
+		}
+		off = mj->coloff[colno];
+		if (off == UNUSED_COL)
+			continue;
+		dst->nulls[row] = rec[off];
+		memcpy(vector_at(dst, row), rec + off + 1, dst->width);
+	}
+	if (mj->cond && rec) {
+		res = expr_eval_bool(mj->cond, mj->outsrcs, mj->outnulls, row);
+		if (res <= 0)
+			return res;
+	}
+	mj->batch.nrows++;
+	return 1;
+}
+
+static int mergejoin_open(struct operator *op)
+{
+	struct mergejoin_op *mj = (struct mergejoin_op *)op;
+	u16		     colno;
+
+	mj->left.keyrecs  = mem_alloc((size_t)BATCH_SIZE * mj->keywidth);
+	mj->right.keyrecs = mem_alloc((size_t)BATCH_SIZE * mj->keywidth);
+	mj->groupkey	  = mem_alloc(mj->keywidth);
+
+	batch_init(&mj->batch, op->ncols);
+	for (colno = 0; colno < op->ncols; ++colno) {
+		struct vector *vec = &mj->batch.cols[colno];
+
+		vector_init(vec, op->types[colno].typeoid,
+			    op->types[colno].typemod);
+		vec->nulls	    = mem_zalloc(BATCH_SIZE);
+		mj->outsrcs[colno]  = vec->data;
+		mj->outnulls[colno] = vec->nulls;
+	}
+	return 0;
+}
+
+static int mergejoin_next(struct operator *op, struct batch **batch)
+{
+	struct mergejoin_op *mj = (struct mergejoin_op *)op;
+	const u8	    *lkey;
+	int		     match;
+	int		     res;
+
+	mj->batch.nrows = 0;
+	while (mj->batch.nrows < BATCH_SIZE) {
+		if (current_key(mj, &mj->left, &lkey))
+			return 1;
+		if (lkey == NULL)
+			break;
+
+		/* null keys match nothing */
+		match = !has_null_key(mj, lkey);
+		if (!mj->in_group) {
+			mj->in_group = 1;
+			mj->gpos     = 0;
+			mj->matched  = 0;
+			if (match &&
+			    (!mj->has_group ||
+			     compare_keys(mj, lkey, mj->groupkey) != 0) &&
+			    load_group(mj, lkey))
+				return 1;
+		}
+		while (match && mj->gpos < mj->ngroup &&
+		       mj->batch.nrows < BATCH_SIZE) {
+			res = emit(mj, group_at(mj, mj->gpos++));
+			if (res < 0)
+				return 1;
+			mj->matched |= res;
+		}
+		if (match && mj->gpos < mj->ngroup)
+			break;
+
+		/* rows of the left input without a match are kept */
+		if (mj->outer && !mj->matched) {
+			if (mj->batch.nrows == BATCH_SIZE)
+				break;
+			emit(mj, NULL);
+		}
+		mj->in_group = 0;
+		mj->left.pos++;
+	}
+
+	*batch = mj->batch.nrows > 0 ? &mj->batch : NULL;
+	return 0;
+}
+
+static void mergejoin_close(struct operator *op)
+{
+	struct mergejoin_op *mj = (struct mergejoin_op *)op;
+
+	free(mj->group);
+	mj->group    = NULL;
+	mj->maxgroup = 0;
+	mj->ngroup   = 0;
+	mem_recharge(&mj->charged, 0);
+}
+
+static const struct operator_ops mergejoin_ops = {
+	.open  = mergejoin_open,
+	.next  = mergejoin_next,
+	.close = mergejoin_close,
+};
+
+static void init_side(struct mergejoin_op *mj, struct merge_side *side,
+		      struct operator *input, const struct join_keys *keys)
+{
+	struct expr *expr;
+	u16	     k;
+
+	side->input = input;
+	side->keys  = mem_zalloc(sizeof(struct merge_key) * mj->nkeys);
+	side->srcs  = mem_alloc(sizeof(u8 *) * (input->ncols + 1));
+	side->nulls = mem_alloc(sizeof(u8 *) * (input->ncols + 1));
+	for (k = 0; k < mj->nkeys; ++k) {
+		expr		       = keys->exprs[k];
+		side->keys[k].typeoid = expr->typeoid;
+		if (expr->type == EXPR_COLUMN)
+			side->keys[k].colno =
+				keys->offsets[expr->tableno] + expr->colno;
+		else
+			side->keys[k].prog = expr_compile_batch(
+				expr, keys->offsets, keys->nullable);
+	}
+}
+
+struct operator *mergejoin_op_create(struct operator *left,
+				     struct operator *right,
+				     const struct join_keys *lkeys,
+				     const struct join_keys *rkeys,
+				     struct expr_prog *cond, int outer)
+{
+	struct mergejoin_op *mj = mem_zalloc(sizeof(struct mergejoin_op));
+	u32		     lwidth;
+	u32		     rwidth;
+	u16		     k;
+
+	mj->op.ops   = &mergejoin_ops;
+	mj->op.ncols = left->ncols + right->ncols;
+	mj->op.types = mem_alloc(sizeof(struct coltype) * mj->op.ncols);
+	memcpy(mj->op.types, left->types, sizeof(struct coltype) * left->ncols);
+	memcpy(mj->op.types + left->ncols, right->types,
+	       sizeof(struct coltype) * right->ncols);
+	mj->op.left  = left;
+	mj->op.right = right;
+
+	/* keys take the width of the wider side, so that chars of different
+	 * lengths compare equal */
+	mj->nkeys  = lkeys->nkeys;
+	mj->keyoff = mem_alloc(sizeof(u32) * (mj->nkeys + 1));
+	mj->keylen = mem_alloc(sizeof(u32) * (mj->nkeys + 1));
+	for (k = 0; k < mj->nkeys; ++k) {
+		lwidth	      = hashtab_value_width(lkeys->exprs[k]->typeoid,
+						    lkeys->exprs[k]->typemod);
+		rwidth	      = hashtab_value_width(rkeys->exprs[k]->typeoid,
+						    rkeys->exprs[k]->typemod);
+		mj->keyoff[k] = mj->keywidth;
+		mj->keylen[k] = lwidth > rwidth ? lwidth : rwidth;
+		mj->keywidth += 1 + mj->keylen[k];
+	}
+	if (mj->keywidth == 0)
+		mj->keywidth = 1;
+	init_side(mj, &mj->left, left, lkeys);
+	init_side(mj, &mj->right, right, rkeys);
+	mj->cond     = cond;
+	mj->outer    = outer;
+	mj->outsrcs  = mem_alloc(sizeof(u8 *) * (mj->op.ncols + 1));
+	mj->outnulls = mem_alloc(sizeof(u8 *) * (mj->op.ncols + 1));
+	return &mj->op;
+}
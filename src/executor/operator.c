@@ -0,0 +1,361 @@
+#include "executor/operator.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "dtype.h"
+#include "util/mem.h"
+
+int op_open(struct operator *op)
+{
+	if (op->left && op_open(op->left))
+		return 1;
+	if (op->right && op_open(op->right))
+		return 1;
+	return op->ops->open ? op->ops->open(op) : 0;
+}
+
+void op_close(struct operator *op)
+{
+	if (op->ops->close)
+		op->ops->close(op);
+	if (op->left)
+		op_close(op->left);
+	if (op->right)
+		op_close(op->right);
+}
+
+/* Table scan */
+
+struct scan_op {
+	struct operator	      op;
+	struct table	     *table;
+	const u8	     *needed;
+	struct scan_filter   *filter;
+	/* pages shared with the other scans of a gather, NULL if none */
+	struct parallel_scan *pscan;
+	struct tablescan_iter iter;
+	struct batch	      batch;
+	int		      started;
+};
+
+static int scan_open(struct operator *op)
+{
+	struct scan_op *scan = (struct scan_op *)op;
+	u16		colno;
+
+	if (scan->pscan)
+		tablescan_begin_parallel(&scan->iter, scan->table, scan->pscan);
+	else
+		tablescan_begin(&scan->iter, scan->table);
+	scan->started = 1;
+	batch_init(&scan->batch, op->ncols);
+	for (colno = 0; colno < op->ncols; ++colno) {
+		if (scan->needed[colno])
+			vector_init(&scan->batch.cols[colno],
+				    op->types[colno].typeoid,
+				    op->types[colno].typemod);
+	}
+	return 0;
+}
+
+static int scan_next(struct operator *op, struct batch **batch)
+{
+	struct scan_op *scan = (struct scan_op *)op;
+	int		n;
+
+	n = tablescan_next_batch(&scan->iter, &scan->batch, scan->filter);
+	if (n < 0)
+		return 1;
+	*batch = n == 0 ? NULL : &scan->batch;
+	return 0;
+}
+
+static void scan_close(struct operator *op)
+{
+	struct scan_op *scan = (struct scan_op *)op;
+
+	if (scan->started)
+		tablescan_end(&scan->iter);
+	scan->started = 0;
+}
+
+static const struct operator_ops scan_ops = {
+	.open  = scan_open,
+	.next  = scan_next,
+	.close = scan_close,
+};
+
+struct operator *scan_op_create(struct table *table, const u8 *needed,
+				struct scan_filter *filter)
+{
+	struct scan_op *scan = mem_zalloc(sizeof(struct scan_op));
+	u16		colno;
+
+	scan->op.ops   = &scan_ops;
+	scan->op.ncols = table->ncols;
+	scan->op.types = mem_alloc(sizeof(struct coltype) * table->ncols);
+	for (colno = 0; colno < table->ncols; ++colno) {
+		scan->op.types[colno].typeoid = table->cols[colno].typeoid;
+		scan->op.types[colno].typemod = table->cols[colno].typemod;
+	}
+	scan->table  = table;
+	scan->needed = needed;
+	scan->filter = filter;
+	return &scan->op;
+}
+
+struct operator *parallel_scan_op_create(struct table *table,
+					 const u8 *needed,
+					 struct scan_filter *filter,
+					 struct parallel_scan *pscan)
+{
+	struct operator *op = scan_op_create(table, needed, filter);
+
+	((struct scan_op *)op)->pscan = pscan;
+	return op;
+}
+
+/* Single row */
+
+struct result_op {
+	struct operator op;
+	struct batch	batch;
+	int		done;
+};
+
+static int result_next(struct operator *op, struct batch **batch)
+{
+	struct result_op *result = (struct result_op *)op;
+
+	if (result->done) {
+		*batch = NULL;
+		return 0;
+	}
+	batch_init(&result->batch, 0);
+	result->batch.nrows = 1;
+	result->done	    = 1;
+	*batch		    = &result->batch;
+	return 0;
+}
+
+static const struct operator_ops result_ops = {
+	.next = result_next,
+};
+
+struct operator *result_op_create(void)
+{
+	struct result_op *result = mem_zalloc(sizeof(struct result_op));
+
+	result->op.ops = &result_ops;
+	return &result->op;
+}
+
+/* Filter */
+
+struct filter_op {
+	struct operator	  op;
+	struct expr_prog *prog;
+	/* data and null flags of the input columns */
+	u8	    **srcs;
+	u8	    **nulls;
+	struct batch batch;
+	u16	     sel[BATCH_SIZE];
+};
+
+static int filter_next(struct operator *op, struct batch **batch)
+{
+	struct filter_op *filter = (struct filter_op *)op;
+	struct batch	 *in;
+	u16		  count;
+	u16		  nsel;
+	u16		  colno;
+	u16		  row;
+	u16		  i;
+	int		  res;
+
+	if (op_next(op->left, &in))
+		return 1;
+	if (in == NULL) {
+		*batch = NULL;
+		return 0;
+	}
+
+	for (colno = 0; colno < in->ncols; ++colno) {
+		filter->srcs[colno]  = in->cols[colno].data;
+		filter->nulls[colno] = in->cols[colno].nulls;
+	}
+	count = batch_count(in);
+	nsel  = 0;
+	for (i = 0; i < count; ++i) {
+		row = batch_row(in, i);
+		res = expr_eval_bool(filter->prog, filter->srcs, filter->nulls,
+				     row);
+		if (res < 0)
+			return 1;
+		if (res)
+			filter->sel[nsel++] = row;
+	}
+
+	filter->batch	   = *in;
+	filter->batch.sel  = filter->sel;
+	filter->batch.nsel = nsel;
+	*batch		   = &filter->batch;
+	return 0;
+}
+
+static const struct operator_ops filter_ops = {
+	.next = filter_next,
+};
+
+struct operator *filter_op_create(struct operator *input,
+				  struct expr_prog *prog)
+{
+	struct filter_op *filter = mem_zalloc(sizeof(struct filter_op));
+
+	filter->op.ops	 = &filter_ops;
+	filter->op.ncols = input->ncols;
+	filter->op.types = input->types;
+	filter->op.left	 = input;
+	filter->prog	 = prog;
+	filter->srcs	 = mem_alloc(sizeof(u8 *) * (input->ncols + 1));
+	filter->nulls	 = mem_alloc(sizeof(u8 *) * (input->ncols + 1));
+	return &filter->op;
+}
+
+/* Projection */
+
+struct project_op {
+	struct operator	    op;
+	struct project_col *cols;
+	struct batch	    batch;
+};
+
+static int project_open(struct operator *op)
+{
+	struct project_op *project = (struct project_op *)op;
+
+	batch_init(&project->batch, op->ncols);
+	return 0;
+}
+
+static int project_next(struct operator *op, struct batch **batch)
+{
+	struct project_op *project = (struct project_op *)op;
+	struct batch	  *in;
+	u16		   colno;
+
+	if (op_next(op->left, &in))
+		return 1;
+	if (in == NULL) {
+		*batch = NULL;
+		return 0;
+	}
+
+	/* Input columns are passed through without copying */
+	for (colno = 0; colno < op->ncols; ++colno) {
+		struct project_col *col = &project->cols[colno];
+
+		if (col->constant)
+			project->batch.cols[colno] = *col->constant;
+		else
+			project->batch.cols[colno] = in->cols[col->input];
+	}
+	project->batch.nrows = in->nrows;
+	project->batch.sel   = in->sel;
+	project->batch.nsel  = in->nsel;
+	*batch		     = &project->batch;
+	return 0;
+}
+
+static const struct operator_ops project_ops = {
+	.open = project_open,
+	.next = project_next,
+};
+
+struct operator *project_op_create(struct operator *input, u16 ncols,
+				   struct project_col *cols,
+				   struct coltype *types)
+{
+	struct project_op *project = mem_zalloc(sizeof(struct project_op));
+
+	project->op.ops	  = &project_ops;
+	project->op.ncols = ncols;
+	project->op.types = types;
+	project->op.left  = input;
+	project->cols	  = cols;
+	return &project->op;
+}
+
+/* Limit and offset */
+
+struct limit_op {
+	struct operator op;
+	i64		limit;
+	/* rows left to skip */
+	i64	     offset;
+	u64	     nrows;
+	struct batch batch;
+	u16	     sel[BATCH_SIZE];
+};
+
+static int limit_next(struct operator *op, struct batch **batch)
+{
+	struct limit_op *lim = (struct limit_op *)op;
+	struct batch	*in;
+	u16		 count;
+	u16		 skip;
+	u16		 take;
+	u16		 i;
+
+	for (;;) {
+		if (lim->limit >= 0 && lim->nrows >= lim->limit) {
+			*batch = NULL;
+			return 0;
+		}
+		if (op_next(op->left, &in))
+			return 1;
+		if (in == NULL) {
+			*batch = NULL;
+			return 0;
+		}
+
+		count = batch_count(in);
+		skip  = lim->offset < count ? lim->offset : count;
+		lim->offset -= skip;
+		take = count - skip;
+		if (lim->limit >= 0 && lim->nrows + take > lim->limit)
+			take = lim->limit - lim->nrows;
+		if (take > 0)
+			break;
+	}
+
+	lim->batch = *in;
+	if (skip > 0 || take < count) {
+		for (i = 0; i < take; ++i)
+			lim->sel[i] = batch_row(in, skip + i);
+		lim->batch.sel	= lim->sel;
+		lim->batch.nsel = take;
+	}
+	lim->nrows += take;
+	*batch = &lim->batch;
+	return 0;
+}
+
+static const struct operator_ops limit_ops = {
+	.next = limit_next,
+};
+
+struct operator *limit_op_create(struct operator *input, i64 limit,
+				 i64 offset)
+{
+	struct limit_op *lim = mem_zalloc(sizeof(struct limit_op));
+
+	lim->op.ops   = &limit_ops;
+	lim->op.ncols = input->ncols;
+	lim->op.types = input->types;
+	lim->op.left  = input;
+	lim->limit    = limit;
+	lim->offset   = offset;
+	return &lim->op;
+}
@@ -0,0 +1,178 @@
+/* Physical query plans: trees of operators exchanging batches of rows */
+
+#ifndef OPERATOR_H
+#define OPERATOR_H
+
+#include "executor/batch.h"
+#include "executor/expr.h"
+#include "executor/tablescan.h"
+#include "table.h"
+#include "univ.h"
+#include "util/vec.h"
+
+/* Memory in bytes an operator may use for its hash tables before spilling to
+ * temporary files */
+#define WORK_MEM (4 * 1024 * 1024)
+
+struct operator;
+
+struct operator_ops {
+	/* Prepare the node for producing rows. Its inputs are already open. */
+	int (*open)(struct operator *op);
+	/* Set batch to the next batch of rows, or to NULL after the last one.
+	 * The batch belongs to the node and is only valid until the next call.
+	 * It may have no rows selected. Returns nonzero on error. */
+	int (*next)(struct operator *op, struct batch **batch);
+	/* Release the resources of the node, if any */
+	void (*close)(struct operator *op);
+};
+
+/* A node of a plan. Each kind of node embeds it as its first member. */
+struct operator {
+	const struct operator_ops *ops;
+	/* types of the output columns */
+	u16		ncols;
+	struct coltype *types;
+	/* input nodes, NULL if unused */
+	struct operator *left;
+	struct operator *right;
+};
+
+/* Open a node and its inputs */
+int op_open(struct operator *op);
+
+static inline int op_next(struct operator *op, struct batch **batch)
+{
+	return op->ops->next(op, batch);
+}
+
+/* Close a node and its inputs */
+void op_close(struct operator *op);
+
+/* Read the rows of a table. Only the columns flagged in needed are decoded,
+ * the vectors of the others have no data. If filter is set, only the tuples
+ * satisfying it are returned. */
+struct operator *scan_op_create(struct table *table, const u8 *needed,
+				struct scan_filter *filter);
+
+/* Read the share of the pages of pscan claimed by this scan, as part of a
+ * parallel scan. The filter must not be shared with the other scans. */
+struct operator *parallel_scan_op_create(struct table *table,
+					 const u8 *needed,
+					 struct scan_filter *filter,
+					 struct parallel_scan *pscan);
+
+/* Run each of the nworkers plans on a thread of its own, and return their
+ * rows in the order they come. The plans are opened and closed on the thread
+ * of the gather, and what they allocate while producing rows is released when
+ * it is closed. The plans only start running once every worker is started,
+ * so that they may wait for each other. Each worker hands its batches over
+ * without copying them, so it waits for the gather to consume a batch before
+ * producing the next one. */
+struct operator *gather_op_create(struct operator **plans, u16 nworkers);
+
+/* The plans run by the workers of a gather, or NULL if op is not one */
+struct operator **gather_plans(struct operator *op, u16 *nworkers);
+
+/* Produce a single row without columns, for selects without FROM */
+struct operator *result_op_create(void);
+
+/* Select the rows of the input satisfying a program compiled on batches */
+struct operator *filter_op_create(struct operator *input,
+				  struct expr_prog *prog);
+
+/* An output column of a projection */
+struct project_col {
+	/* the same value for every row, or NULL to take an input column */
+	struct vector *constant;
+	/* index of the input column */
+	u16 input;
+};
+
+/* Compute the output columns from the columns of the input */
+struct operator *project_op_create(struct operator *input, u16 ncols,
+				   struct project_col *cols,
+				   struct coltype *types);
+
+/* Skip the first offset rows, and stop after limit rows (-1 for no limit) */
+struct operator *limit_op_create(struct operator *input, i64 limit,
+				 i64 offset);
+
+/* Pair every row of the left input with every row of the right input. The
+ * output has the columns of the left input followed by those of the right. */
+struct operator *nestloop_op_create(struct operator *left,
+				    struct operator *right);
+
+/* Values the rows of an input of a join are matched on, compiled on its
+ * batches with the given column offsets and nullable tables */
+struct join_keys {
+	u16	      nkeys;
+	struct expr **exprs;
+	const u16    *offsets;
+	const u8     *nullable;
+};
+
+/* Join the rows of the left and right inputs whose keys are all equal, and
+ * which satisfy cond if it is not NULL. Null keys match nothing. If outer is
+ * set, the rows of the left input without a match are also returned, with
+ * nulls for the right columns. The hash table is built from the right input,
+ * or from the left one if build_left is set. If it does not fit in work_mem
+ * bytes, both inputs are split into temporary files and joined one pair of
+ * files at a time. The output has the columns of the left input followed by
+ * those of the right, in no particular order. */
+struct operator *hashjoin_op_create(struct operator *left,
+				    struct operator *right,
+				    const struct join_keys *lkeys,
+				    const struct join_keys *rkeys,
+				    struct expr_prog *cond, int outer,
+				    int build_left, size_t work_mem);
+
+/* Join the rows of the left and right inputs like hashjoin_op_create, from
+ * inputs sorted on their keys in ascending order with nulls last, as by
+ * sort_op_create. The rows of the right input sharing a key are kept in
+ * memory while the left rows with that key are paired with them. The output
+ * has the columns of the left input followed by those of the right, in the
+ * order of the keys. */
+struct operator *mergejoin_op_create(struct operator *left,
+				     struct operator *right,
+				     const struct join_keys *lkeys,
+				     const struct join_keys *rkeys,
+				     struct expr_prog *cond, int outer);
+
+/* Group the rows of the input by the values of the keys, and compute the
+ * aggregates of each group. The keys and the arguments of the aggregates are
+ * compiled on batches with the given column offsets and nullable tables. The
+ * output has the keys followed by the results of the aggregates, in no
+ * particular order. Without keys, a single row is returned even if the input
+ * is empty. The groups that do not fit in work_mem bytes are aggregated
+ * afterwards from temporary files. */
+struct operator *hashagg_op_create(struct operator *input, const u16 *offsets,
+				   const u8 *nullable, u16 nkeys,
+				   struct expr **keys, u16 naggs,
+				   struct agg_call **aggs, size_t work_mem);
+
+/* Compute the same aggregation as hashagg_op_create, on the rows of the
+ * nworkers plans run by the workers of a gather. Each worker aggregates the
+ * rows of its plan into a table of its own, then the workers merge the groups
+ * of every table one partition of the hashes at a time, claiming the next
+ * partition when they are done with one. Each table may take work_mem bytes
+ * divided by the number of workers. */
+struct operator *parallel_hashagg_op_create(struct operator **plans,
+					    u16 nworkers, const u16 *offsets,
+					    const u8 *nullable, u16 nkeys,
+					    struct expr **keys, u16 naggs,
+					    struct agg_call **aggs,
+					    size_t work_mem);
+
+/* Sort the rows of the input on the values of the keys, compiled on its
+ * batches with the given column offsets and nullable tables. Nulls come after
+ * the other values, or before them for the keys flagged in desc, which are
+ * sorted in descending order. If bound is not negative, only the first bound
+ * rows are returned. The rows that do not fit in work_mem bytes are sorted in
+ * runs written to temporary files, then merged. */
+struct operator *sort_op_create(struct operator *input, const u16 *offsets,
+				const u8 *nullable, u16 nkeys,
+				struct expr **keys, const u8 *desc, i64 bound,
+				size_t work_mem);
+
+#endif // OPERATOR_H
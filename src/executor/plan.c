@@ -0,0 +1,706 @@
+#include "executor/plan.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "dtype.h"
+#include "storage/heap.h"
+#include "util/error.h"
+#include "util/mem.h"
+
+extern struct heap *heaps[];
+
+int    max_parallel_workers = 1;
+size_t work_mem		    = WORK_MEM;
+
+/* Fill a vector with copies of a literal, so that it can stand as a column of
+ * any batch */
+static struct vector *make_literal_vector(struct select_col *scol)
+{
+	struct vector *vec = mem_alloc(sizeof(struct vector));
+	i16	       v2  = scol->val_int;
+	i32	       v4  = scol->val_int;
+	i64	       v8  = scol->val_int;
+	u8	      *val;
+	u16	       i;
+
+	vector_init(vec, scol->typeoid, scol->typemod);
+	switch (scol->typeoid) {
+	case DTYPE_INT2:
+		val = (u8 *)&v2;
+		break;
+	case DTYPE_INT4:
+		val = (u8 *)&v4;
+		break;
+	case DTYPE_INT8:
+		val = (u8 *)&v8;
+		break;
+	case DTYPE_CHAR:
+		val = (u8 *)scol->val_str;
+		break;
+	default:
+		errlog(FATAL,
+		       errmsg("Unexpected literal of type %d", scol->typeoid));
+		return vec;
+	}
+	for (i = 0; i < BATCH_SIZE; ++i)
+		memcpy(vector_at(vec, i), val, vec->width);
+	return vec;
+}
+
+/* Split a condition into the list of its AND-ed terms */
+static void split_conjuncts(struct expr *expr, struct vec *list)
+{
+	if (expr->type == EXPR_OP && expr->op == EXPR_AND) {
+		split_conjuncts(expr->left, list);
+		split_conjuncts(expr->right, list);
+	} else {
+		vec_push(list, expr);
+	}
+}
+
+/* AND two conditions together, left may be NULL */
+static struct expr *make_and(struct expr *left, struct expr *right)
+{
+	struct expr *expr;
+
+	if (left == NULL)
+		return right;
+	expr	      = mem_zalloc(sizeof(struct expr));
+	expr->type    = EXPR_OP;
+	expr->typeoid = DTYPE_BOOL;
+	expr->typemod = -1;
+	expr->op      = EXPR_AND;
+	expr->left    = left;
+	expr->right   = right;
+	return expr;
+}
+
+static enum expr_op commute(enum expr_op op)
+{
+	switch (op) {
+	case EXPR_LT:
+		return EXPR_GT;
+	case EXPR_LE:
+		return EXPR_GE;
+	case EXPR_GT:
+		return EXPR_LT;
+	case EXPR_GE:
+		return EXPR_LE;
+	default:
+		return op;
+	}
+}
+
+static int int_fits(u32 typeoid, i64 val)
+{
+	switch (typeoid) {
+	case DTYPE_INT2:
+		return val >= INT16_MIN && val <= INT16_MAX;
+	case DTYPE_INT4:
+		return val >= INT32_MIN && val <= INT32_MAX;
+	default:
+		return 1;
+	}
+}
+
+/* Turn a term comparing a column with a constant into a predicate evaluated
+ * a vector at a time. For char, only equality and LIKE patterns that are
+ * plain strings or prefixes are supported. Returns zero if the term does not
+ * qualify. */
+static int make_column_pred(struct expr *expr, struct column_pred *pred)
+{
+	struct expr  *col;
+	struct expr  *cst;
+	enum expr_op  op;
+	const char   *str;
+	u32	      len;
+	u32	      i;
+
+	if (expr->type != EXPR_OP || expr->op < EXPR_EQ ||
+	    expr->op > EXPR_LIKE)
+		return 0;
+	op = expr->op;
+	if (expr->left->type == EXPR_COLUMN &&
+	    expr->right->type == EXPR_CONST) {
+		col = expr->left;
+		cst = expr->right;
+	} else if (op != EXPR_LIKE && expr->right->type == EXPR_COLUMN &&
+		   expr->left->type == EXPR_CONST) {
+		col = expr->right;
+		cst = expr->left;
+		op  = commute(op);
+	} else {
+		return 0;
+	}
+
+	memset(pred, 0, sizeof(struct column_pred));
+	pred->colno = col->colno;
+	if (col->typeoid != DTYPE_CHAR) {
+		if (!int_fits(col->typeoid, cst->val_int))
+			return 0;
+		pred->op      = op;
+		pred->val_int = cst->val_int;
+		return 1;
+	}
+
+	str = cst->val_str;
+	len = cst->typemod;
+	if (op == EXPR_LIKE) {
+		for (i = 0; i < len && str[i] != '%' && str[i] != '_'; ++i)
+			;
+		if (i < len) {
+			/* only trailing %, after a prefix not ending with
+			 * padding */
+			if (i == 0 || str[i - 1] == ' ' ||
+			    strspn(str + i, "%") != len - i)
+				return 0;
+			len = i;
+		} else {
+			op = EXPR_EQ;
+		}
+	} else if (op != EXPR_EQ && op != EXPR_NE) {
+		return 0;
+	}
+	if (op != EXPR_LIKE) {
+		while (len > 0 && str[len - 1] == ' ')
+			--len;
+	}
+	pred->op  = op;
+	pred->str = (const u8 *)str;
+	pred->len = len;
+	return 1;
+}
+
+/* Flag the columns of each table of the from list that an expression
+ * references */
+static void mark_columns(struct select *select, struct expr *expr,
+			 u8 **needed)
+{
+	u16 tableno;
+
+	for (tableno = 0; tableno < select->from.size; ++tableno)
+		expr_columns(expr, tableno, needed[tableno]);
+}
+
+/* Build the filter of the scan of a table from the terms of the WHERE clause
+ * referencing only that table. Returns NULL if there are none. */
+static struct scan_filter *make_scan_filter(struct table *table,
+					    struct vec *terms)
+{
+	struct scan_filter *filter;
+	struct column	   *col;
+	struct expr	   *rest = NULL;
+	size_t		    i;
+
+	if (terms->size == 0)
+		return NULL;
+	filter	      = mem_zalloc(sizeof(struct scan_filter));
+	filter->preds = mem_alloc(sizeof(struct column_pred) * terms->size);
+	filter->vecs  = mem_alloc(sizeof(struct vector) * terms->size);
+	for (i = 0; i < terms->size; ++i) {
+		struct column_pred *pred = &filter->preds[filter->npreds];
+
+		if (!make_column_pred(terms->data[i], pred)) {
+			rest = make_and(rest, terms->data[i]);
+			continue;
+		}
+		col = &table->cols[pred->colno];
+		vector_init(&filter->vecs[filter->npreds], col->typeoid,
+			    col->typemod);
+		filter->npreds++;
+	}
+	if (rest)
+		filter->prog = expr_compile_tuple(rest, table);
+	return filter;
+}
+
+/* Scan a table with the terms of the WHERE clause referencing only it. A
+ * table large enough to give each worker a few chunks of pages is scanned by
+ * several threads, each with its own filter, and their rows are gathered. */
+static struct operator *plan_scan(struct table *table, const u8 *needed,
+				  struct vec *terms)
+{
+	struct parallel_scan *pscan;
+	struct operator	    **plans;
+	size_t		      nworkers;
+	u16		      w;
+
+	nworkers = heap_count_pages(heaps[table->oid]) /
+		   (2 * PARALLEL_SCAN_CHUNK);
+	if (nworkers > max_parallel_workers)
+		nworkers = max_parallel_workers;
+	if (nworkers < 2)
+		return scan_op_create(table, needed,
+				      make_scan_filter(table, terms));
+
+	pscan = mem_alloc(sizeof(struct parallel_scan));
+	parallel_scan_init(pscan, table);
+	plans = mem_alloc(sizeof(struct operator *) * nworkers);
+	for (w = 0; w < nworkers; ++w)
+		plans[w] = parallel_scan_op_create(
+			table, needed, make_scan_filter(table, terms), pscan);
+	return gather_op_create(plans, nworkers);
+}
+
+/* Whether a term of a join condition is an equality between a value of the
+ * tables before table tableno and a value of that table. If so, they are
+ * stored in *left and *right. */
+static int is_join_key(struct expr *expr, u16 tableno, struct expr **left,
+		       struct expr **right)
+{
+	int last;
+
+	if (expr->type != EXPR_OP || expr->op != EXPR_EQ)
+		return 0;
+	*left  = expr->left;
+	*right = expr->right;
+	if (expr_table(*left) == tableno) {
+		*left  = expr->right;
+		*right = expr->left;
+	}
+	last = expr_last_table(*left);
+	return last >= 0 && last < tableno && expr_table(*right) == tableno;
+}
+
+/* Size in bytes of the rows of a table, all columns decoded */
+static size_t row_width(struct table *table)
+{
+	size_t width = 0;
+	u16    colno;
+
+	for (colno = 0; colno < table->ncols; ++colno)
+		width += dtype_len(table->cols[colno].typeoid,
+				   table->cols[colno].typemod);
+	return width;
+}
+
+/* The keys the rows of a plan come sorted on, as by sort_on_keys. The rows of
+ * an inner merge join are also sorted on the keys of its right input, equal to
+ * those of the left one. */
+struct plan_order {
+	u16	      nkeys;
+	struct expr **exprs;
+	/* the equal keys, or NULL */
+	struct expr **equal;
+};
+
+static int same_column(struct expr *a, struct expr *b)
+{
+	return a->type == EXPR_COLUMN && b->type == EXPR_COLUMN &&
+	       a->tableno == b->tableno && a->colno == b->colno;
+}
+
+/* Whether the rows of a plan sorted in order are sorted on the left join
+ * keys. The keys only need to be the first ones of the order in some order,
+ * so both sides are permuted to match. */
+static int sorted_on_keys(const struct plan_order *order,
+			  struct join_keys *lkeys, struct join_keys *rkeys)
+{
+	struct expr *tmp;
+	u16	     i;
+	u16	     j;
+
+	if (order == NULL || order->nkeys < lkeys->nkeys)
+		return 0;
+	for (i = 0; i < lkeys->nkeys; ++i) {
+		for (j = i; j < lkeys->nkeys; ++j) {
+			if (same_column(lkeys->exprs[j], order->exprs[i]) ||
+			    (order->equal &&
+			     same_column(lkeys->exprs[j], order->equal[i])))
+				break;
+		}
+		if (j == lkeys->nkeys)
+			return 0;
+		tmp		= lkeys->exprs[i];
+		lkeys->exprs[i] = lkeys->exprs[j];
+		lkeys->exprs[j] = tmp;
+		tmp		= rkeys->exprs[i];
+		rkeys->exprs[i] = rkeys->exprs[j];
+		rkeys->exprs[j] = tmp;
+	}
+	return 1;
+}
+
+/* Sort the rows of an input on join keys, in the order a merge join reads
+ * them */
+static struct operator *sort_on_keys(struct operator *input,
+				     const struct join_keys *keys)
+{
+	return sort_op_create(input, keys->offsets, keys->nullable, keys->nkeys,
+			      keys->exprs, mem_zalloc(keys->nkeys + 1), -1,
+			      work_mem);
+}
+
+/* Join the rows of table tableno to those of the tables before it, on the
+ * terms of the join condition. The equalities between the two sides are the
+ * keys of a hash join built on the side expected to have fewer rows. When
+ * even that side is not expected to fit in the memory budget, both sides
+ * would be split into temporary files, so they are sorted and merged instead.
+ * The left side is not sorted again when it comes from a merge join on the
+ * same keys. An inner join without keys is a nested loop. *nrows and *width
+ * are updated with the number of rows expected from the join and their size,
+ * and *order with the keys its rows are sorted on. */
+static struct operator *plan_join(struct select *select, struct operator *left,
+				  struct operator *scan, u16 tableno,
+				  struct vec *terms, const u16 *offsets,
+				  const u8 *nullable, size_t *nrows,
+				  size_t *width, struct plan_order **order)
+{
+	struct select_join *join  = select->joins.data[tableno];
+	struct table	   *table = select->from.data[tableno];
+	struct operator	   *plan;
+	struct join_keys   *lkeys;
+	struct join_keys   *rkeys;
+	struct expr	   *cond = NULL;
+	struct expr_prog   *prog = NULL;
+	size_t		    right_rows;
+	size_t		    right_width;
+	size_t		    left_size;
+	size_t		    right_size;
+	size_t		    i;
+	int		    build_left;
+
+	lkeys	     = mem_zalloc(sizeof(struct join_keys));
+	rkeys	     = mem_zalloc(sizeof(struct join_keys));
+	lkeys->exprs = mem_alloc(sizeof(struct expr *) * (terms->size + 1));
+	rkeys->exprs = mem_alloc(sizeof(struct expr *) * (terms->size + 1));
+	for (i = 0; i < terms->size; ++i) {
+		if (is_join_key(terms->data[i], tableno,
+				&lkeys->exprs[lkeys->nkeys],
+				&rkeys->exprs[rkeys->nkeys])) {
+			lkeys->nkeys++;
+			rkeys->nkeys++;
+		} else {
+			cond = make_and(cond, terms->data[i]);
+		}
+	}
+	if (cond)
+		prog = expr_compile_batch(cond, offsets, nullable);
+
+	right_rows  = heap_count_tuples(heaps[table->oid]);
+	right_width = row_width(table);
+	left_size   = *nrows * *width;
+	right_size  = right_rows * right_width;
+	*width += right_width;
+	if (lkeys->nkeys == 0 && join->type == JOIN_INNER) {
+		*order = NULL;
+		*nrows *= right_rows;
+		plan = nestloop_op_create(left, scan);
+		return prog ? filter_op_create(plan, prog) : plan;
+	}
+
+	/* the columns of the table start at 0 in the rows of its scan */
+	lkeys->offsets	= offsets;
+	lkeys->nullable = nullable;
+	rkeys->offsets	= mem_zalloc(sizeof(u16) * (tableno + 1));
+	build_left	= *nrows < right_rows;
+	if (right_rows > *nrows)
+		*nrows = right_rows;
+	if (left_size > work_mem && right_size > work_mem) {
+		if (!sorted_on_keys(*order, lkeys, rkeys))
+			left = sort_on_keys(left, lkeys);
+		*order		= mem_alloc(sizeof(struct plan_order));
+		(*order)->nkeys = lkeys->nkeys;
+		(*order)->exprs = lkeys->exprs;
+		(*order)->equal =
+			join->type == JOIN_INNER ? rkeys->exprs : NULL;
+		return mergejoin_op_create(left, sort_on_keys(scan, rkeys),
+					   lkeys, rkeys, prog,
+					   join->type == JOIN_LEFT);
+	}
+	*order = NULL;
+	return hashjoin_op_create(left, scan, lkeys, rkeys, prog,
+				  join->type == JOIN_LEFT, build_left,
+				  work_mem);
+}
+
+/* Add a term of the WHERE clause or of the condition of an inner join to the
+ * filter of the scan of the only table it references, or to the terms of the
+ * join of the last table it references. Terms referencing the nullable side
+ * of a left join, or no table, are ANDed into *rest for evaluation after the
+ * joins. */
+static void place_term(struct select *select, struct expr *expr,
+		       struct vec *terms, struct vec *join_terms,
+		       struct expr **rest)
+{
+	struct select_join *join;
+	int		    last = expr_last_table(expr);
+
+	if (last < 0) {
+		*rest = make_and(*rest, expr);
+		return;
+	}
+	join = select->joins.data[last];
+	if (join->type == JOIN_LEFT)
+		*rest = make_and(*rest, expr);
+	else if (expr_table(expr) == last)
+		vec_push(&terms[last], expr);
+	else
+		vec_push(&join_terms[last], expr);
+}
+
+/* Scan each table of the from list, reading only the columns the query uses,
+ * and join their rows in order. The columns of the tables follow each other
+ * in the output, starting at offsets[tableno], and those of the tables on the
+ * right of a left join are flagged in nullable.
+ *
+ * The terms of the WHERE clause referencing a single table are evaluated by
+ * its scan, the comparisons of a column with a constant first since they
+ * cannot fail. So are those of the conditions of the joins referencing the
+ * table being joined. The terms referencing several tables are evaluated by
+ * the join of the last one, and the others are ANDed into *rest for
+ * evaluation on the output. */
+static struct operator *plan_from(struct select *select, u16 *offsets,
+				  u8 *nullable, struct expr **rest)
+{
+	struct operator	   *plan  = NULL;
+	struct plan_order  *order = NULL;
+	struct operator	   *scan;
+	struct select_join *join;
+	struct vec	   *terms;
+	struct vec	   *join_terms;
+	struct vec	    conjuncts;
+	struct vec	    on;
+	u8		  **needed;
+	u16		    tableno;
+	u16		    colno;
+	u16		    ncols = 0;
+	size_t		    nrows = 0;
+	size_t		    width = 0;
+	size_t		    i;
+
+	*rest = NULL;
+	vec_init(&conjuncts, 1);
+	if (select->where)
+		split_conjuncts(select->where, &conjuncts);
+
+	if (select->from.size == 0) {
+		for (i = 0; i < conjuncts.size; ++i)
+			*rest = make_and(*rest, conjuncts.data[i]);
+		vec_free(&conjuncts);
+		return result_op_create();
+	}
+
+	needed	   = mem_alloc(sizeof(u8 *) * select->from.size);
+	terms	   = mem_alloc(sizeof(struct vec) * select->from.size);
+	join_terms = mem_alloc(sizeof(struct vec) * select->from.size);
+	for (tableno = 0; tableno < select->from.size; ++tableno) {
+		struct table *table = select->from.data[tableno];
+
+		needed[tableno] = mem_zalloc(table->ncols);
+		vec_init(&terms[tableno], 1);
+		vec_init(&join_terms[tableno], 1);
+	}
+	for (colno = 0; colno < select->select_list.size; ++colno) {
+		struct select_col *scol = select->select_list.data[colno];
+
+		if (scol->type == SELECT_COL_FIELD)
+			needed[scol->tableno][scol->colno] = 1;
+	}
+	for (i = 0; i < select->group_by.size; ++i) {
+		for (tableno = 0; tableno < select->from.size; ++tableno)
+			expr_columns(select->group_by.data[i], tableno,
+				     needed[tableno]);
+	}
+	for (i = 0; i < select->aggs.size; ++i) {
+		struct agg_call *agg = select->aggs.data[i];
+
+		for (tableno = 0; agg->arg && tableno < select->from.size;
+		     ++tableno)
+			expr_columns(agg->arg, tableno, needed[tableno]);
+	}
+	for (i = 0; i < select->order_by.size; ++i) {
+		struct select_order *order = select->order_by.data[i];
+
+		if (order->expr)
+			mark_columns(select, order->expr, needed);
+	}
+
+	/* the condition of an inner join filters its rows like the WHERE
+	 * clause does, while that of a left join only decides which rows of
+	 * the right table match */
+	for (tableno = 0; tableno < select->from.size; ++tableno) {
+		join = select->joins.data[tableno];
+		if (join->on == NULL)
+			continue;
+		if (join->type == JOIN_INNER) {
+			split_conjuncts(join->on, &conjuncts);
+			continue;
+		}
+		vec_init(&on, 1);
+		split_conjuncts(join->on, &on);
+		for (i = 0; i < on.size; ++i) {
+			if (expr_table(on.data[i]) == tableno)
+				vec_push(&terms[tableno], on.data[i]);
+			else
+				vec_push(&join_terms[tableno], on.data[i]);
+		}
+		vec_free(&on);
+	}
+	for (i = 0; i < conjuncts.size; ++i)
+		place_term(select, conjuncts.data[i], terms, join_terms, rest);
+	vec_free(&conjuncts);
+	for (tableno = 0; tableno < select->from.size; ++tableno) {
+		for (i = 0; i < join_terms[tableno].size; ++i)
+			mark_columns(select, join_terms[tableno].data[i],
+				     needed);
+	}
+	if (*rest)
+		mark_columns(select, *rest, needed);
+
+	for (tableno = 0; tableno < select->from.size; ++tableno) {
+		struct table *table = select->from.data[tableno];
+
+		scan = plan_scan(table, needed[tableno], &terms[tableno]);
+		vec_free(&terms[tableno]);
+		offsets[tableno] = ncols;
+		ncols += table->ncols;
+		if (plan == NULL) {
+			plan  = scan;
+			nrows = heap_count_tuples(heaps[table->oid]);
+			width = row_width(table);
+		} else {
+			plan = plan_join(select, plan, scan, tableno,
+					 &join_terms[tableno], offsets,
+					 nullable, &nrows, &width, &order);
+		}
+		vec_free(&join_terms[tableno]);
+		join		  = select->joins.data[tableno];
+		nullable[tableno] = join->type == JOIN_LEFT;
+	}
+	return plan;
+}
+
+/* Index of the GROUP BY expression a column refers to */
+static u16 group_key(struct select *select, u16 tableno, u16 colno)
+{
+	struct expr *expr;
+	u16	     k;
+
+	for (k = 0;; ++k) {
+		expr = select->group_by.data[k];
+		if (expr->type == EXPR_COLUMN && expr->tableno == tableno &&
+		    expr->colno == colno)
+			return k;
+	}
+}
+
+/* Sort the rows on the items of the ORDER BY clause. The rows of a grouped
+ * query are those of the aggregation, whose columns are the keys followed by
+ * the aggregates. */
+static struct operator *plan_sort(struct select *select,
+				  struct operator *plan, const u16 *offsets,
+				  const u8 *nullable, int grouped)
+{
+	static const u16     agg_offsets[] = { 0 };
+	struct select_order *order;
+	struct expr	   **keys;
+	struct expr	    *key;
+	u8		    *desc;
+	u16		     nkeys = select->order_by.size;
+	u16		     k;
+	i64		     bound = -1;
+
+	keys = mem_alloc(sizeof(struct expr *) * nkeys);
+	desc = mem_alloc(nkeys);
+	for (k = 0; k < nkeys; ++k) {
+		order	= select->order_by.data[k];
+		keys[k] = order->expr;
+		desc[k] = order->desc;
+		if (!grouped)
+			continue;
+		key	  = mem_zalloc(sizeof(struct expr));
+		key->type = EXPR_COLUMN;
+		if (order->expr)
+			key->colno = group_key(select, order->expr->tableno,
+					       order->expr->colno);
+		else
+			key->colno = select->group_by.size + order->aggno;
+		key->typeoid = plan->types[key->colno].typeoid;
+		key->typemod = plan->types[key->colno].typemod;
+		keys[k]	     = key;
+	}
+	if (grouped)
+		offsets = agg_offsets;
+
+	/* only the rows up to the limit are needed */
+	if (select->limit >= 0 && select->limit <= INT64_MAX - select->offset)
+		bound = select->limit + select->offset;
+	return sort_op_create(plan, offsets, nullable, nkeys, keys, desc, bound,
+			      work_mem);
+}
+
+/* Group the rows and compute the aggregates. The rows of a parallel scan are
+ * aggregated by its workers, rather than gathered first. */
+static struct operator *plan_agg(struct select *select, struct operator *plan,
+				 const u16 *offsets, const u8 *nullable)
+{
+	struct operator **plans;
+	u16		  nworkers;
+
+	plans = gather_plans(plan, &nworkers);
+	if (plans)
+		return parallel_hashagg_op_create(
+			plans, nworkers, offsets, nullable,
+			select->group_by.size,
+			(struct expr **)select->group_by.data,
+			select->aggs.size,
+			(struct agg_call **)select->aggs.data, work_mem);
+	return hashagg_op_create(plan, offsets, nullable, select->group_by.size,
+				 (struct expr **)select->group_by.data,
+				 select->aggs.size,
+				 (struct agg_call **)select->aggs.data,
+				 work_mem);
+}
+
+struct operator *plan_select(struct select *select)
+{
+	struct operator	   *plan;
+	struct project_col *cols;
+	struct coltype	   *types;
+	u16		   *offsets;
+	u8		   *nullable;
+	struct expr	   *rest;
+	u16		    ncols = select->select_list.size;
+	u16		    nkeys = select->group_by.size;
+	u16		    colno;
+	int		    grouped;
+
+	offsets	 = mem_alloc(sizeof(u16) * (select->from.size + 1));
+	nullable = mem_zalloc(select->from.size + 1);
+	plan	 = plan_from(select, offsets, nullable, &rest);
+	if (rest)
+		plan = filter_op_create(plan, expr_compile_batch(rest, offsets,
+								 nullable));
+
+	grouped = nkeys > 0 || select->aggs.size > 0;
+	if (grouped)
+		plan = plan_agg(select, plan, offsets, nullable);
+	if (select->order_by.size > 0)
+		plan = plan_sort(select, plan, offsets, nullable, grouped);
+
+	cols  = mem_zalloc(sizeof(struct project_col) * ncols);
+	types = mem_alloc(sizeof(struct coltype) * ncols);
+	for (colno = 0; colno < ncols; ++colno) {
+		struct select_col *scol = select->select_list.data[colno];
+
+		types[colno].typeoid = scol->typeoid;
+		types[colno].typemod = scol->typemod;
+		if (scol->type == SELECT_COL_LITERAL)
+			cols[colno].constant = make_literal_vector(scol);
+		else if (scol->type == SELECT_COL_AGG)
+			cols[colno].input = nkeys + scol->aggno;
+		else if (grouped)
+			cols[colno].input =
+				group_key(select, scol->tableno, scol->colno);
+		else
+			cols[colno].input =
+				offsets[scol->tableno] + scol->colno;
+	}
+	plan = project_op_create(plan, ncols, cols, types);
+
+	if (select->limit >= 0 || select->offset > 0)
+		plan = limit_op_create(plan, select->limit, select->offset);
+	return plan;
+}
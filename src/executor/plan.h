@@ -0,0 +1,20 @@
+/* Turning resolved queries into trees of operators */
+
+#ifndef PLAN_H
+#define PLAN_H
+
+#include "executor/operator.h"
+#include "executor/select.h"
+
+/* Maximum number of threads scanning a table for a query, 1 to scan tables
+ * on the thread of the query only */
+extern int max_parallel_workers;
+
+/* Memory in bytes each operator of a plan may use before spilling to
+ * temporary files, WORK_MEM unless configured */
+extern size_t work_mem;
+
+/* Build the plan computing the result of a select */
+struct operator *plan_select(struct select *select);
+
+#endif // PLAN_H
@@ -1,12 +1,15 @@
 #ifndef SELECT_H
 #define SELECT_H
 
-#include "executor/tablescan.h"
+#include "executor/batch.h"
 #include "parser/parser.h"
 #include "storage/heap.h"
 #include "table.h"
 #include "util/vec.h"
 
+struct expr;
+struct operator;
+
 /* A fully-resolved representation of a select query */
 struct select {
 	enum sql_command sql_command;
@@ -16,9 +19,43 @@ struct select {
 
 	/* list of struct table */
 	struct vec from;
+	/* how each table of the from list is joined to the ones before it,
+	 * list of struct select_join */
+	struct vec joins;
+
+	/* condition of the WHERE clause, NULL if none */
+	struct expr *where;
+
+	/* expressions of the GROUP BY clause, list of struct expr */
+	struct vec group_by;
+	/* aggregates of the select list, list of struct agg_call. The rows
+	 * are grouped if there are any, even without GROUP BY. */
+	struct vec aggs;
+
+	/* items of the ORDER BY clause, list of struct select_order */
+	struct vec order_by;
+
+	/* maximum number of rows to return, -1 for all */
+	i64 limit;
+	/* number of rows to skip */
+	i64 offset;
 };
 
-enum select_col_type { SELECT_COL_LITERAL, SELECT_COL_FIELD };
+struct select_join {
+	enum join_type type;
+	/* condition of the ON clause, NULL if none */
+	struct expr *on;
+};
+
+struct select_order {
+	/* value to sort on, NULL to sort on the aggregate aggno */
+	struct expr *expr;
+	u16	     aggno;
+	/* nonzero for DESC */
+	int desc;
+};
+
+enum select_col_type { SELECT_COL_LITERAL, SELECT_COL_FIELD, SELECT_COL_AGG };
 
 /* An output column of the query */
 struct select_col {
@@ -31,14 +68,19 @@ struct select_col {
 		struct {
 			char *fieldname;
 			u32   tableoid;
-			u32   colno;
+			/* index of the table in the from list */
+			u16 tableno;
+			u32 colno;
 		};
+		/* index of the aggregate in the aggs list */
+		u16 aggno;
 	};
 	char *name;
 };
 
 struct row_field {
 	u32   len;
+	/* NULL if the value is null */
 	u8   *data;
 };
 
@@ -47,14 +89,27 @@ struct row {
 	struct row_field *fields;
 };
 
+/* Runs the plan of a select, handing out the result rows one by one */
 struct cursor {
-	struct select	      *select;
-	struct tablescan_iter *iter;
-	int		       eof;
+	struct select	*select;
+	struct operator *plan;
+	/* current batch of result rows, NULL at eof */
+	struct batch *batch;
+	/* index of the next row of the batch to return */
+	u16 pos;
+	int eof;
+	/* fields of the row returned by cursor_next */
+	struct row_field *fields;
 };
 
+/* Plan the select and start running it */
 int sql_select(struct select *select, struct cursor *cur);
 
+/* Get the next result row. Returns 0 if there is one, 1 at eof and -1 on
+ * error. */
 int cursor_next(struct cursor *cur, struct row *row);
 
+/* Stop running the select and release its resources */
+void cursor_close(struct cursor *cur);
+
 #endif
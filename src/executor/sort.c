@@ -0,0 +1,697 @@
+#include "executor/operator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtype.h"
+#include "executor/hashtab.h"
+#include "util/error.h"
+#include "util/mem.h"
+
+/* Sort.
+ *
+ * The rows of the input are turned into records of fixed size starting with
+ * their keys, normalized so that records compare with a memcmp of their first
+ * keywidth bytes: each key is a flag set if it is null, followed by integers
+ * in big-endian order with their sign bit flipped, or chars without their
+ * padding, all of its bytes inverted for descending order. The columns that
+ * have data follow, each value preceded by its null flag.
+ *
+ * The records are sorted in memory as long as they fit in the budget. Past
+ * that, each time the budget is reached the records are sorted and written to
+ * a temporary file as a run, and the runs are then merged, several passes
+ * being made if there are too many of them to be merged at once. When only
+ * the first rows are needed and they fit in memory, a heap of the smallest
+ * records replaces the runs. */
+
+#define UNUSED_COL UINT32_MAX
+/* Records read at a time from each run of a merge */
+#define RUN_BUFFER (64)
+/* Maximum number of runs merged at once */
+#define MAX_FANIN (64)
+
+struct sort_key {
+	/* program computing the value, NULL to copy input column colno */
+	struct expr_prog *prog;
+	u16		  colno;
+	u32		  typeoid;
+	/* offset of the null flag in the records, and size of the value after
+	 * it */
+	u32 off;
+	u32 len;
+	int desc;
+};
+
+/* A run being merged, and its records read so far */
+struct sort_run {
+	FILE *file;
+	u8   *recs;
+	u32   nrecs;
+	u32   pos;
+};
+
+enum sort_state { SORT_MEMORY, SORT_MERGE, SORT_DONE };
+
+struct sort_op {
+	struct operator	 op;
+	u16		 nkeys;
+	struct sort_key *keys;
+	u32		 keywidth;
+	/* data and null flags of the input columns, for programs */
+	u8 **srcs;
+	u8 **nulls;
+	/* offset of the null flag of each column in the records, UNUSED_COL if
+	 * the column has no data. Set from the first batch of the input. */
+	u32   *coloff;
+	u32    recwidth;
+	/* records of the current input batch */
+	u8    *inrecs;
+	i64    bound;
+	size_t work_mem;
+
+	/* records in memory, and pointers to them in sorted order once
+	 * sorted */
+	u8    *recs;
+	u8   **sorted;
+	u32    nrecs;
+	u32    maxrecs;
+	/* whether sorted is a heap of the bound smallest records so far */
+	int    top_n;
+	/* bytes of recs and sorted charged to the memory root */
+	size_t charged;
+
+	/* files of the runs in the order they were written, list of FILE */
+	struct vec runs;
+	/* runs of the current merge, and a heap of their indexes ordered by
+	 * their current record */
+	struct sort_run *merge;
+	u32		*heap;
+	u32		 nheap;
+	/* whether the current record of the top run was returned */
+	int		 advance;
+	/* file an intermediate merge is writing */
+	FILE		*merge_out;
+
+	enum sort_state state;
+	/* next record of sorted to return */
+	u32		pos;
+	i64		nreturned;
+	struct batch	batch;
+};
+
+static inline u8 *record_at(struct sort_op *s, u8 *recs, u32 i)
+{
+	return recs + (size_t)i * s->recwidth;
+}
+
+static inline int compare(struct sort_op *s, const u8 *a, const u8 *b)
+{
+	return memcmp(a, b, s->keywidth);
+}
+
+/* Memory taken by n records in memory and the pointers sorting them */
+static size_t records_size(struct sort_op *s, u32 n)
+{
+	return (size_t)n * (s->recwidth + 2 * sizeof(u8 *));
+}
+
+/* Sort pointers to records, keeping equal records in their order. tmp has
+ * room for n / 2 pointers. */
+static void sort_records(struct sort_op *s, u8 **recs, u8 **tmp, u32 n)
+{
+	u8 *rec;
+	u32 half;
+	u32 i, j, k;
+
+	if (n <= 16) {
+		for (i = 1; i < n; ++i) {
+			rec = recs[i];
+			for (j = i; j > 0 && compare(s, recs[j - 1], rec) > 0;
+			     --j)
+				recs[j] = recs[j - 1];
+			recs[j] = rec;
+		}
+		return;
+	}
+	half = n / 2;
+	sort_records(s, recs, tmp, half);
+	sort_records(s, recs + half, tmp, n - half);
+	if (compare(s, recs[half - 1], recs[half]) <= 0)
+		return;
+	memcpy(tmp, recs, sizeof(u8 *) * half);
+	for (i = 0, j = half, k = 0; i < half && j < n;)
+		recs[k++] = compare(s, tmp[i], recs[j]) <= 0 ? tmp[i++] :
+							       recs[j++];
+	while (i < half)
+		recs[k++] = tmp[i++];
+}
+
+/* Sort the records in memory into sorted */
+static void sort_memory(struct sort_op *s)
+{
+	u8 **tmp;
+	u32  i;
+
+	if (!s->top_n) {
+		for (i = 0; i < s->nrecs; ++i)
+			s->sorted[i] = record_at(s, s->recs, i);
+	}
+	tmp = malloc(sizeof(u8 *) * (s->nrecs / 2 + 1));
+	sort_records(s, s->sorted, tmp, s->nrecs);
+	free(tmp);
+}
+
+/* Sort the records in memory into a new run */
+static int write_run(struct sort_op *s)
+{
+	FILE *file = NULL;
+	int   err  = 0;
+	u32   i;
+
+	sort_memory(s);
+	for (i = 0; i < s->nrecs && !err; ++i)
+		err = hashtab_spill(&file, s->sorted[i], s->recwidth);
+	if (file) {
+		rewind(file);
+		vec_push(&s->runs, file);
+	}
+	s->nrecs = 0;
+	return err;
+}
+
+/* Number of records that fit in the budget, at least one */
+static u32 max_records(struct sort_op *s)
+{
+	size_t n = s->work_mem / records_size(s, 1);
+
+	if (n == 0)
+		return 1;
+	return n < UINT32_MAX ? n : UINT32_MAX;
+}
+
+/* Add a record to those in memory, which never take more than the budget:
+ * their arrays grow up to max_records, and are written out as a run once
+ * full */
+static int add_record(struct sort_op *s, const u8 *rec)
+{
+	u32 cap = max_records(s);
+
+	if (s->nrecs == cap && write_run(s))
+		return 1;
+	if (s->nrecs == s->maxrecs) {
+		s->maxrecs = s->maxrecs > 0 ? s->maxrecs * 2 : 64;
+		if (s->maxrecs > cap)
+			s->maxrecs = cap;
+		mem_recharge(&s->charged, records_size(s, s->maxrecs));
+		s->recs	  = realloc(s->recs, (size_t)s->maxrecs * s->recwidth);
+		s->sorted = realloc(s->sorted, sizeof(u8 *) * s->maxrecs);
+	}
+	memcpy(record_at(s, s->recs, s->nrecs), rec, s->recwidth);
+	s->nrecs++;
+	return 0;
+}
+
+static void swap(u8 **a, u8 **b)
+{
+	u8 *tmp = *a;
+
+	*a = *b;
+	*b = tmp;
+}
+
+/* Keep the record if it is one of the bound smallest so far. The heap has
+ * the largest record on top. */
+static void add_top_n(struct sort_op *s, const u8 *rec)
+{
+	u8 **heap = s->sorted;
+	u32  i	  = 0;
+	u32  child;
+
+	if (s->nrecs < s->bound) {
+		i	= s->nrecs++;
+		heap[i] = record_at(s, s->recs, i);
+		memcpy(heap[i], rec, s->recwidth);
+		for (; i > 0 && compare(s, heap[(i - 1) / 2], heap[i]) < 0;
+		     i = (i - 1) / 2)
+			swap(&heap[(i - 1) / 2], &heap[i]);
+		return;
+	}
+	if (s->nrecs == 0 || compare(s, rec, heap[0]) >= 0)
+		return;
+	memcpy(heap[0], rec, s->recwidth);
+	for (;;) {
+		child = 2 * i + 1;
+		if (child >= s->nrecs)
+			break;
+		if (child + 1 < s->nrecs &&
+		    compare(s, heap[child + 1], heap[child]) > 0)
+			child++;
+		if (compare(s, heap[i], heap[child]) >= 0)
+			break;
+		swap(&heap[i], &heap[child]);
+		i = child;
+	}
+}
+
+/* Lay out the records after the keys, with the columns of a batch having
+ * data, and choose between a heap and runs */
+static void lay_out(struct sort_op *s, struct batch *in)
+{
+	u16 colno;
+
+	s->coloff   = mem_alloc(sizeof(u32) * in->ncols);
+	s->recwidth = s->keywidth;
+	for (colno = 0; colno < in->ncols; ++colno) {
+		if (in->cols[colno].data == NULL) {
+			s->coloff[colno] = UNUSED_COL;
+			continue;
+		}
+		s->coloff[colno] = s->recwidth;
+		s->recwidth += 1 + in->cols[colno].width;
+	}
+	if (s->recwidth == 0)
+		s->recwidth = 1;
+	s->inrecs = mem_alloc((size_t)BATCH_SIZE * s->recwidth);
+
+	if (s->bound >= 0 &&
+	    s->bound <= s->work_mem / (s->recwidth + 2 * sizeof(u8 *))) {
+		s->top_n  = 1;
+		s->recs	  = malloc((size_t)s->bound * s->recwidth + 1);
+		s->sorted = malloc(sizeof(u8 *) * (s->bound + 1));
+		mem_recharge(&s->charged, (size_t)s->bound * (s->recwidth +
+							      sizeof(u8 *)));
+	}
+}
+
+static void encode_int(u8 *dst, i64 val, u32 len)
+{
+	u64 u = (u64)val ^ ((u64)1 << (8 * len - 1));
+
+	while (len-- > 0) {
+		dst[len] = u;
+		u >>= 8;
+	}
+}
+
+/* Normalize a key value into the records. src is NULL for nulls. */
+static void encode_key(struct sort_key *key, u8 *dst, const u8 *src,
+		       u32 srclen, i64 val)
+{
+	u32 i;
+
+	dst[0] = src == NULL;
+	if (src == NULL)
+		memset(dst + 1, 0, key->len);
+	else if (key->typeoid == DTYPE_CHAR)
+		hashtab_store(dst + 1, DTYPE_CHAR, key->len, src,
+			      srclen < key->len ? srclen : key->len);
+	else
+		encode_int(dst + 1, val, key->len);
+	if (key->desc) {
+		for (i = 0; i <= key->len; ++i)
+			dst[i] = ~dst[i];
+	}
+}
+
+/* Fill the records from the selected rows of a batch */
+static int make_records(struct sort_op *s, struct batch *in, u16 count)
+{
+	const union expr_reg *reg;
+	const u8	     *src;
+	u8		     *dst;
+	u8		      isnull;
+	u8		      buf[8];
+	i64		      val = 0;
+	u16		      colno;
+	u16		      row;
+	u16		      i;
+	u16		      k;
+
+	if (s->coloff == NULL)
+		lay_out(s, in);
+	for (colno = 0; colno < in->ncols; ++colno) {
+		s->srcs[colno]	= in->cols[colno].data;
+		s->nulls[colno] = in->cols[colno].nulls;
+	}
+	for (k = 0; k < s->nkeys; ++k) {
+		struct sort_key *key = &s->keys[k];
+		struct vector	*vec = &in->cols[key->colno];
+
+		dst = s->inrecs + key->off;
+		for (i = 0; i < count; ++i, dst += s->recwidth) {
+			row = batch_row(in, i);
+			if (key->prog == NULL) {
+				src = vec->nulls && vec->nulls[row] ?
+					      NULL :
+					      vector_at(vec, row);
+				if (src && key->typeoid != DTYPE_CHAR) {
+					hashtab_store(buf, key->typeoid, 8,
+						      src, vec->width);
+					memcpy(&val, buf, 8);
+				}
+				encode_key(key, dst, src, vec->width, val);
+				continue;
+			}
+			reg = expr_eval(key->prog, s->srcs, s->nulls, row,
+					&isnull);
+			if (reg == NULL)
+				return 1;
+			if (key->typeoid == DTYPE_CHAR)
+				encode_key(key, dst, isnull ? NULL : reg->str,
+					   reg->len, 0);
+			else
+				encode_key(key, dst,
+					   isnull ? NULL : (const u8 *)reg, 0,
+					   reg->val_int);
+		}
+	}
+	for (colno = 0; colno < in->ncols; ++colno) {
+		struct vector *vec = &in->cols[colno];
+
+		if (s->coloff[colno] == UNUSED_COL)
+			continue;
+		dst = s->inrecs + s->coloff[colno];
+		for (i = 0; i < count; ++i, dst += s->recwidth) {
+			row    = batch_row(in, i);
+			dst[0] = vec->nulls && vec->nulls[row];
+			memcpy(dst + 1, vector_at(vec, row), vec->width);
+		}
+	}
+	return 0;
+}
+
+static inline u8 *run_record(struct sort_op *s, u32 r)
+{
+	struct sort_run *run = &s->merge[r];
+
+	return record_at(s, run->recs, run->pos);
+}
+
+/* Order of the runs in the heap of a merge: by their current record, and
+ * then by their order so that equal records keep theirs */
+static int run_less(struct sort_op *s, u32 a, u32 b)
+{
+	int c = compare(s, run_record(s, a), run_record(s, b));
+
+	return c < 0 || (c == 0 && a < b);
+}
+
+static void sift_down(struct sort_op *s, u32 i)
+{
+	u32 child;
+	u32 tmp;
+
+	for (;;) {
+		child = 2 * i + 1;
+		if (child >= s->nheap)
+			return;
+		if (child + 1 < s->nheap &&
+		    run_less(s, s->heap[child + 1], s->heap[child]))
+			child++;
+		if (!run_less(s, s->heap[child], s->heap[i]))
+			return;
+		tmp	       = s->heap[i];
+		s->heap[i]     = s->heap[child];
+		s->heap[child] = tmp;
+		i	       = child;
+	}
+}
+
+/* Read the next records of a run. Returns 0 at its end, 1 if there are more,
+ * -1 on error. */
+static int fill_run(struct sort_op *s, struct sort_run *run)
+{
+	int n = hashtab_read(run->file, run->recs, s->recwidth, RUN_BUFFER);
+
+	if (n < 0)
+		return -1;
+	run->nrecs = n;
+	run->pos   = 0;
+	return n > 0;
+}
+
+/* Start merging n runs, from the first one of the list */
+static int start_merge(struct sort_op *s, u32 first, u32 n)
+{
+	int ret;
+	u32 r;
+
+	s->nheap   = 0;
+	s->advance = 0;
+	for (r = 0; r < n; ++r) {
+		s->merge[r].file = s->runs.data[first + r];
+		if (s->merge[r].recs == NULL)
+			s->merge[r].recs =
+				mem_alloc((size_t)RUN_BUFFER * s->recwidth);
+		ret = fill_run(s, &s->merge[r]);
+		if (ret < 0)
+			return 1;
+		if (ret > 0)
+			s->heap[s->nheap++] = r;
+	}
+	for (r = s->nheap / 2; r-- > 0;)
+		sift_down(s, r);
+	return 0;
+}
+
+/* Get the next record of the merge, NULL at its end */
+static int merge_next(struct sort_op *s, const u8 **rec)
+{
+	struct sort_run *run;
+	int		 ret;
+
+	if (s->advance && s->nheap > 0) {
+		run = &s->merge[s->heap[0]];
+		if (++run->pos == run->nrecs) {
+			ret = fill_run(s, run);
+			if (ret < 0)
+				return 1;
+			if (ret == 0)
+				s->heap[0] = s->heap[--s->nheap];
+		}
+		sift_down(s, 0);
+	}
+	s->advance = 1;
+	*rec	   = s->nheap > 0 ? run_record(s, s->heap[0]) : NULL;
+	return 0;
+}
+
+/* Merge groups of runs until they can all be merged at once */
+static int merge_runs(struct sort_op *s, u32 fanin)
+{
+	const u8 *rec;
+	u32	  first;
+	u32	  nruns;
+	u32	  out;
+	u32	  n;
+	u32	  r;
+
+	while (s->runs.size > fanin) {
+		nruns = s->runs.size;
+		for (first = 0, out = 0; first < nruns; first += n, ++out) {
+			n = nruns - first < fanin ? nruns - first : fanin;
+			if (n == 1) {
+				s->runs.data[out] = s->runs.data[first];
+				if (out != first)
+					s->runs.data[first] = NULL;
+				continue;
+			}
+			if (start_merge(s, first, n))
+				return 1;
+			for (;;) {
+				if (merge_next(s, &rec))
+					return 1;
+				if (rec == NULL)
+					break;
+				if (hashtab_spill(&s->merge_out, rec,
+						  s->recwidth))
+					return 1;
+			}
+			for (r = 0; r < n; ++r) {
+				fclose(s->runs.data[first + r]);
+				s->runs.data[first + r] = NULL;
+			}
+			rewind(s->merge_out);
+			s->runs.data[out] = s->merge_out;
+			s->merge_out	  = NULL;
+		}
+		s->runs.size = out;
+	}
+	return 0;
+}
+
+/* Sort all of the input */
+static int sort_input(struct sort_op *s)
+{
+	struct batch *in;
+	u32	      fanin;
+	u16	      count;
+	u16	      i;
+
+	for (;;) {
+		if (op_next(s->op.left, &in))
+			return 1;
+		if (in == NULL)
+			break;
+		count = batch_count(in);
+		if (count == 0)
+			continue;
+		if (mem_check_limit() || make_records(s, in, count))
+			return 1;
+		for (i = 0; i < count; ++i) {
+			if (s->top_n)
+				add_top_n(s, record_at(s, s->inrecs, i));
+			else if (add_record(s, record_at(s, s->inrecs, i)))
+				return 1;
+		}
+	}
+
+	if (s->runs.size == 0) {
+		sort_memory(s);
+		s->state = SORT_MEMORY;
+		return 0;
+	}
+	if (s->nrecs > 0 && write_run(s))
+		return 1;
+	fanin = s->work_mem / ((size_t)RUN_BUFFER * s->recwidth);
+	fanin = fanin < 2 ? 2 : fanin > MAX_FANIN ? MAX_FANIN : fanin;
+	if (merge_runs(s, fanin) || start_merge(s, 0, s->runs.size))
+		return 1;
+	s->state = SORT_MERGE;
+	return 0;
+}
+
+static int sort_open(struct operator *op)
+{
+	struct sort_op *s = (struct sort_op *)op;
+	u16		colno;
+
+	vec_init(&s->runs, 1);
+	s->merge = mem_zalloc(sizeof(struct sort_run) * MAX_FANIN);
+	s->heap	 = mem_alloc(sizeof(u32) * MAX_FANIN);
+
+	batch_init(&s->batch, op->ncols);
+	for (colno = 0; colno < op->ncols; ++colno) {
+		struct vector *vec = &s->batch.cols[colno];
+
+		vector_init(vec, op->types[colno].typeoid,
+			    op->types[colno].typemod);
+		vec->nulls = mem_zalloc(BATCH_SIZE);
+	}
+
+	if (s->bound == 0) {
+		s->state = SORT_DONE;
+		return 0;
+	}
+	return sort_input(s);
+}
+
+static void load_record(struct sort_op *s, const u8 *rec, u16 row)
+{
+	struct vector *vec;
+	const u8      *src;
+	u16	       colno;
+
+	for (colno = 0; colno < s->op.ncols; ++colno) {
+		if (s->coloff[colno] == UNUSED_COL)
+			continue;
+		vec		= &s->batch.cols[colno];
+		src		= rec + s->coloff[colno];
+		vec->nulls[row] = src[0];
+		memcpy(vector_at(vec, row), src + 1, vec->width);
+	}
+}
+
+static int sort_next(struct operator *op, struct batch **batch)
+{
+	struct sort_op *s = (struct sort_op *)op;
+	const u8       *rec;
+	u16		n = 0;
+
+	while (n < BATCH_SIZE && s->state != SORT_DONE) {
+		if (s->bound >= 0 && s->nreturned == s->bound) {
+			s->state = SORT_DONE;
+			break;
+		}
+		if (s->state == SORT_MEMORY) {
+			rec = s->pos < s->nrecs ? s->sorted[s->pos++] : NULL;
+		} else if (merge_next(s, &rec)) {
+			return 1;
+		}
+		if (rec == NULL) {
+			s->state = SORT_DONE;
+			break;
+		}
+		load_record(s, rec, n++);
+		s->nreturned++;
+	}
+	s->batch.nrows = n;
+	*batch	       = n > 0 ? &s->batch : NULL;
+	return 0;
+}
+
+static void sort_close(struct operator *op)
+{
+	struct sort_op *s = (struct sort_op *)op;
+	size_t		i;
+
+	for (i = 0; i < s->runs.size; ++i) {
+		if (s->runs.data[i])
+			fclose(s->runs.data[i]);
+	}
+	vec_free(&s->runs);
+	s->runs.data = NULL;
+	s->runs.size = 0;
+	if (s->merge_out)
+		fclose(s->merge_out);
+	s->merge_out = NULL;
+	free(s->recs);
+	free(s->sorted);
+	s->recs	   = NULL;
+	s->sorted  = NULL;
+	s->maxrecs = 0;
+	mem_recharge(&s->charged, 0);
+}
+
+static const struct operator_ops sort_ops = {
+	.open  = sort_open,
+	.next  = sort_next,
+	.close = sort_close,
+};
+
+struct operator *sort_op_create(struct operator *input, const u16 *offsets,
+				const u8 *nullable, u16 nkeys,
+				struct expr **keys, const u8 *desc, i64 bound,
+				size_t work_mem)
+{
+	struct sort_op *s = mem_zalloc(sizeof(struct sort_op));
+	struct expr    *expr;
+	u16		k;
+
+	s->op.ops   = &sort_ops;
+	s->op.ncols = input->ncols;
+	s->op.types = input->types;
+	s->op.left  = input;
+	s->nkeys    = nkeys;
+	s->keys	    = mem_zalloc(sizeof(struct sort_key) * (nkeys + 1));
+	s->srcs	    = mem_alloc(sizeof(u8 *) * (input->ncols + 1));
+	s->nulls    = mem_alloc(sizeof(u8 *) * (input->ncols + 1));
+	s->bound    = bound;
+	s->work_mem = work_mem;
+	for (k = 0; k < nkeys; ++k) {
+		expr		   = keys[k];
+		s->keys[k].typeoid = expr->typeoid;
+		s->keys[k].len	   = dtype_len(expr->typeoid, expr->typemod);
+		s->keys[k].off	   = s->keywidth;
+		s->keys[k].desc	   = desc[k];
+		if (expr->type == EXPR_COLUMN)
+			s->keys[k].colno =
+				offsets[expr->tableno] + expr->colno;
+		else
+			s->keys[k].prog =
+				expr_compile_batch(expr, offsets, nullable);
+		s->keywidth += 1 + s->keys[k].len;
+	}
+	return &s->op;
+}
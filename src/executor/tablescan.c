@@ -1,37 +1,231 @@
 #include "tablescan.h"
 
 #include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "dtype.h"
 #include "storage/heap.h"
 
-extern struct heap_page *heap_pages[];
+extern struct heap *heaps[];
+
+static int tablescan_set_page(struct tablescan_iter *iter, size_t pageno)
+{
+	struct heap_page *page;
+	u16		  slotcnt;
+
+	page = heap_get_page(iter->heap, pageno, &slotcnt);
+	if (page == NULL)
+		return 1;
+	iter->pageno  = pageno;
+	iter->page    = page;
+	iter->slotno  = 0;
+	iter->slotcnt = slotcnt;
+	return 0;
+}
 
 void tablescan_begin(struct tablescan_iter *iter, struct table *table)
 {
 	assert(table);
 	iter->table = table;
-	iter->page = heap_pages[table->oid];
-	assert(iter->page);
+	iter->heap = heaps[table->oid];
+	assert(iter->heap);
+	iter->pscan = NULL;
+	iter->page = NULL;
+	iter->pageno = 0;
+	iter->endpage = SIZE_MAX;
 	iter->slotno = 0;
-	iter->slotcnt = heap_page_slot_count(iter->page);
+	iter->slotcnt = 0;
+	tablescan_set_page(iter, 0);
 	iter->tup = NULL;
 	iter->tupsize = -1;
 }
 
+void parallel_scan_init(struct parallel_scan *pscan, struct table *table)
+{
+	assert(heaps[table->oid]);
+	atomic_init(&pscan->next_page, 0);
+	pscan->npages = heap_count_pages(heaps[table->oid]);
+}
+
+void tablescan_begin_parallel(struct tablescan_iter *iter, struct table *table,
+			      struct parallel_scan *pscan)
+{
+	assert(table);
+	iter->table = table;
+	iter->heap = heaps[table->oid];
+	assert(iter->heap);
+	iter->pscan = pscan;
+	/* the first chunk is claimed by the first call to tablescan_next */
+	iter->page = NULL;
+	iter->pageno = 0;
+	iter->endpage = 0;
+	iter->slotno = 0;
+	iter->slotcnt = 0;
+	iter->tup = NULL;
+	iter->tupsize = -1;
+}
+
+/* Move to the next page of the range claimed, or claim the next chunk of the
+ * parallel scan. Returns nonzero past the last page. */
+static int tablescan_next_page(struct tablescan_iter *iter)
+{
+	size_t start;
+
+	if (iter->page != NULL && iter->pageno + 1 < iter->endpage)
+		return tablescan_set_page(iter, iter->pageno + 1);
+	if (iter->pscan == NULL)
+		return 1;
+	start = atomic_fetch_add(&iter->pscan->next_page, PARALLEL_SCAN_CHUNK);
+	if (start >= iter->pscan->npages)
+		return 1;
+	iter->endpage = start + PARALLEL_SCAN_CHUNK;
+	if (iter->endpage > iter->pscan->npages)
+		iter->endpage = iter->pscan->npages;
+	return tablescan_set_page(iter, start);
+}
+
 int tablescan_next(struct tablescan_iter *iter)
 {
-	if (iter->slotno >= iter->slotcnt) {
-		iter->tup = NULL;
-		iter->tupsize = -1;
-	} else {
-		iter->tupsize = heap_page_read_tuple(iter->page, iter->slotno, &iter->tup);
-		iter->slotno++;
+	while (iter->slotno >= iter->slotcnt) {
+		if (tablescan_next_page(iter)) {
+			iter->tup = NULL;
+			iter->tupsize = -1;
+			return iter->tupsize;
+		}
 	}
+	iter->tupsize = heap_page_read_tuple(iter->page, iter->slotno, &iter->tup);
+	iter->slotno++;
 	return iter->tupsize;
 }
 
+/* Copy one column of each tuple into a vector. Specialized on the common
+ * widths so the copies compile to single loads and stores. */
+static void decode_column(u8 **tups, u16 ntups, size_t off,
+			  struct vector *vec)
+{
+	u8 *dst = vec->data;
+	u16 i;
+
+	switch (vec->width) {
+	case 2:
+		for (i = 0; i < ntups; ++i)
+			memcpy(dst + 2 * i, tups[i] + off, 2);
+		break;
+	case 4:
+		for (i = 0; i < ntups; ++i)
+			memcpy(dst + 4 * i, tups[i] + off, 4);
+		break;
+	case 8:
+		for (i = 0; i < ntups; ++i)
+			memcpy(dst + 8 * i, tups[i] + off, 8);
+		break;
+	default:
+		for (i = 0; i < ntups; ++i)
+			memcpy(dst + (size_t)vec->width * i, tups[i] + off,
+			       vec->width);
+		break;
+	}
+}
+
+static size_t column_offset(struct table *table, u16 colno)
+{
+	size_t off = 0;
+	u16    c;
+
+	for (c = 0; c < colno; ++c)
+		off += dtype_len(table->cols[c].typeoid, table->cols[c].typemod);
+	return off;
+}
+
+/* Keep the tuples satisfying the filter, in place. The comparisons produce a
+ * bitmap of the tuples, which the rest of the condition is evaluated on.
+ * Returns the number of tuples kept, or -1 on error. */
+static int filter_tuples(struct table *table, struct scan_filter *filter,
+			 u8 **tups, u16 ntups)
+{
+	u64 bits[BITMAP_WORDS];
+	u64 pbits[BITMAP_WORDS];
+	u64 word;
+	u16 nkept = 0;
+	u16 i;
+	u16 w;
+	int res;
+
+	if (filter->npreds == 0)
+		memset(bits, 0xff, sizeof(bits));
+	for (i = 0; i < filter->npreds; ++i) {
+		struct column_pred *pred = &filter->preds[i];
+
+		decode_column(tups, ntups, column_offset(table, pred->colno),
+			      &filter->vecs[i]);
+		kernel_filter(pred, &filter->vecs[i], ntups,
+			      i == 0 ? bits : pbits);
+		for (w = 0; i > 0 && w < BITMAP_WORDS; ++w)
+			bits[w] &= pbits[w];
+	}
+
+	for (w = 0; w * 64 < ntups; ++w) {
+		for (word = bits[w]; word != 0; word &= word - 1) {
+			i = w * 64 + __builtin_ctzll(word);
+			if (i >= ntups)
+				break;
+			if (filter->prog) {
+				res = expr_eval_bool(filter->prog, &tups[i],
+						     NULL, 0);
+				if (res < 0)
+					return -1;
+				if (res == 0)
+					continue;
+			}
+			tups[nkept++] = tups[i];
+		}
+	}
+	return nkept;
+}
+
+int tablescan_next_batch(struct tablescan_iter *iter, struct batch *batch,
+			 struct scan_filter *filter)
+{
+	struct table *table = iter->table;
+	u8	     *tups[BATCH_SIZE];
+	u16	      ntups;
+	size_t	      off = 0;
+	u16	      colno;
+	int	      res;
+
+	assert(batch->ncols == table->ncols);
+
+	/* the filter runs before decoding, so that rejected tuples never are */
+	for (;;) {
+		ntups = 0;
+		while (ntups < BATCH_SIZE && tablescan_next(iter) != -1)
+			tups[ntups++] = iter->tup;
+		if (filter == NULL || ntups == 0)
+			break;
+		res = filter_tuples(table, filter, tups, ntups);
+		if (res < 0)
+			return -1;
+		ntups = res;
+		if (ntups > 0)
+			break;
+	}
+
+	for (colno = 0; colno < table->ncols; ++colno) {
+		struct column *col = &table->cols[colno];
+
+		if (batch->cols[colno].data != NULL)
+			decode_column(tups, ntups, off, &batch->cols[colno]);
+		off += dtype_len(col->typeoid, col->typemod);
+	}
+	batch->nrows = ntups;
+	batch->sel   = NULL;
+	batch->nsel  = 0;
+	return ntups;
+}
+
 void tablescan_end(struct tablescan_iter *iter)
 {
 }
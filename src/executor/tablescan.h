@@ -3,24 +3,76 @@
 #ifndef TABLESCAN_H
 #define TABLESCAN_H
 
+#include "executor/batch.h"
+#include "executor/expr.h"
+#include "executor/kernel.h"
 #include "univ.h"
+#include "storage/heap.h"
 #include "table.h"
 
+/* Number of consecutive pages a parallel scan claims at a time */
+#define PARALLEL_SCAN_CHUNK (8)
+
+/* The pages of a heap shared by the scans of several threads. Each scan
+ * claims the next chunk of pages not yet claimed by any of them, so that
+ * every page is read exactly once. */
+struct parallel_scan {
+	/* first page not yet claimed */
+	_Atomic size_t next_page;
+	/* pages of the heap when the scan started, pages added afterwards are
+	 * not read */
+	size_t npages;
+};
+
 struct tablescan_iter {
 	struct table *table;
+	struct heap *heap;
+	/* pages shared with other scans, NULL if the scan reads all of them */
+	struct parallel_scan *pscan;
+	/* current page and its index in the heap */
 	struct heap_page *page;
+	size_t	      pageno;
+	/* end of the range of pages claimed from pscan */
+	size_t	      endpage;
 	u16	      slotno;
 	u16           slotcnt;
 	u8		 *tup;
 	i32 tupsize;
 };
 
+/* A condition on the tuples of a scan */
+struct scan_filter {
+	/* comparisons evaluated a vector at a time, first */
+	u16		    npreds;
+	struct column_pred *preds;
+	/* vectors the columns of the comparisons are decoded into */
+	struct vector *vecs;
+	/* the rest of the condition, evaluated on the remaining tuples, NULL
+	 * if none */
+	struct expr_prog *prog;
+};
+
 /* Initialize a tablescan on a table */
 void tablescan_begin(struct tablescan_iter *iter, struct table *table);
 
+/* Share the pages of a table between the scans begun on pscan */
+void parallel_scan_init(struct parallel_scan *pscan, struct table *table);
+
+/* Initialize a tablescan reading the pages of a parallel scan. It may be run
+ * on any thread. */
+void tablescan_begin_parallel(struct tablescan_iter *iter, struct table *table,
+			      struct parallel_scan *pscan);
+
 /* Get the next tuple. Returns the size of the tuple or -1 if eof */
 int tablescan_next(struct tablescan_iter *iter);
 
+/* Fill a batch with the next tuples, one vector per column of the table.
+ * Only the columns whose vector has been allocated are decoded. If filter is
+ * set, only the tuples satisfying it are kept. Returns the number of rows
+ * read, 0 at eof and -1 on error. */
+int tablescan_next_batch(struct tablescan_iter *iter, struct batch *batch,
+			 struct scan_filter *filter);
+
 /* Dispose the tablescan object */
 void tablescan_end(struct tablescan_iter *iter);
 
@@ -1,128 +1,236 @@
 #include "lex.h"
 
 #include <assert.h>
-#include <ctype.h>
-#include <stdlib.h>
 #include <string.h>
 
-/* Must match order of keywords in token_class in lex.h */
-static const char *keyword_names[] = { "AS", "BIGINT", "CHAR", "CREATE", "FROM", "INT", "SELECT", "SMALLINT", "TABLE" };
+#include "util/num.h"
+
+/* Classes of the characters the scanner tells apart */
+enum char_class {
+	CC_OTHER = 0,
+	CC_SPACE = 1,
+	CC_DIGIT = 2,
+	CC_ALPHA = 4,
+};
+
+#define S CC_SPACE
+#define D CC_DIGIT
+#define A CC_ALPHA
+
+/* Class of each character, those above 127 are of no class */
+static const u8 char_class[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, S, S, S, S, S, 0, 0, /* control */
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* control */
+	S, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /*  !"#$%&'()*+,-./ */
+	D, D, D, D, D, D, D, D, D, D, 0, 0, 0, 0, 0, 0, /* 0123456789:;<=>? */
+	0, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, /* @ABCDEFGHIJKLMNO */
+	A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, 0, /* PQRSTUVWXYZ[\]^_ */
+	0, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, /* `abcdefghijklmno */
+	A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, 0, /* pqrstuvwxyz{|}~  */
+};
+
+#undef S
+#undef D
+#undef A
+
+/* Tokens made of a single character whatever follows it */
+static const u8 char_token[256] = {
+	[','] = TK_COMMA,
+	[';'] = TK_SEMICOLON,
+	['.'] = TK_DOT,
+	['('] = TK_PAREN_OPEN,
+	[')'] = TK_PAREN_CLOSE,
+	['+'] = TK_PLUS,
+	['*'] = TK_STAR,
+	['/'] = TK_SLASH,
+	['%'] = TK_PERCENT,
+	['='] = TK_EQ,
+};
+
+/* Keywords are grouped by length, so that a word is only compared with the
+ * few keywords of its own length, and each of those only past its first
+ * character when that one matches. A new keyword goes in the group of its
+ * length, a group ending with a NULL name. */
+struct keyword {
+	/* lower-case name */
+	const char	*name;
+	enum token_class tclass;
+};
+
+static const struct keyword keywords2[] = {
+	{ "as", TK_AS }, { "by", TK_BY }, { "on", TK_ON },
+	{ "or", TK_OR }, { "to", TK_TO }, { NULL, 0 },
+};
+
+static const struct keyword keywords3[] = {
+	{ "and", TK_AND }, { "asc", TK_ASC }, { "int", TK_INT },
+	{ "not", TK_NOT }, { NULL, 0 },
+};
+
+static const struct keyword keywords4[] = {
+	{ "char", TK_CHAR }, { "copy", TK_COPY }, { "desc", TK_DESC },
+	{ "from", TK_FROM }, { "into", TK_INTO }, { "join", TK_JOIN },
+	{ "left", TK_LEFT }, { "like", TK_LIKE }, { "with", TK_WITH },
+	{ NULL, 0 },
+};
+
+static const struct keyword keywords5[] = {
+	{ "group", TK_GROUP }, { "inner", TK_INNER }, { "limit", TK_LIMIT },
+	{ "order", TK_ORDER }, { "outer", TK_OUTER }, { "stdin", TK_STDIN },
+	{ "table", TK_TABLE }, { "where", TK_WHERE }, { NULL, 0 },
+};
+
+static const struct keyword keywords6[] = {
+	{ "bigint", TK_BIGINT }, { "create", TK_CREATE },
+	{ "insert", TK_INSERT }, { "offset", TK_OFFSET },
+	{ "select", TK_SELECT }, { "stdout", TK_STDOUT },
+	{ "values", TK_VALUES }, { NULL, 0 },
+};
+
+static const struct keyword keywords8[] = {
+	{ "smallint", TK_SMALLINT }, { NULL, 0 },
+};
+
+/* Folding to lower case only needs one bit, as identifiers are made of
+ * letters and digits */
+#define FOLD(c) ((u8)(c) | 0x20)
+
+static enum token_class keyword_class(const char *str, size_t len)
+{
+	const struct keyword *kw;
+	size_t		      i;
+
+	switch (len) {
+	case 2:
+		kw = keywords2;
+		break;
+	case 3:
+		kw = keywords3;
+		break;
+	case 4:
+		kw = keywords4;
+		break;
+	case 5:
+		kw = keywords5;
+		break;
+	case 6:
+		kw = keywords6;
+		break;
+	case 8:
+		kw = keywords8;
+		break;
+	default:
+		return TK_IDENT;
+	}
+	for (; kw->name != NULL; ++kw) {
+		if (FOLD(str[0]) != (u8)kw->name[0])
+			continue;
+		for (i = 1; i < len && FOLD(str[i]) == (u8)kw->name[i]; ++i)
+			;
+		if (i == len)
+			return kw->tclass;
+	}
+	return TK_IDENT;
+}
+
+/* Length of the run of characters of the given classes starting at str */
+static size_t span(const char *str, u8 classes)
+{
+	size_t i = 0;
+
+	while (char_class[(u8)str[i]] & classes)
+		++i;
+	return i;
+}
 
 static size_t scan(const char *str, enum token_class *type)
 {
-	u16  i;
-	u16  k;
+	u8     c;
+	size_t i;
 
 	if (str == NULL || str[0] == '\0') {
 		*type = TK_EOF;
 		return 0;
 	}
 
-	if (isspace(str[0])) {
-		for (i = 1; isspace(str[i]); ++i)
-			;
+	c = str[0];
+	switch (char_class[c]) {
+	case CC_SPACE:
 		*type = TK_SPACE;
+		return span(str, CC_SPACE);
+	case CC_DIGIT:
+		*type = TK_NUM;
+		return span(str, CC_DIGIT);
+	case CC_ALPHA:
+		i     = span(str, CC_ALPHA | CC_DIGIT);
+		*type = keyword_class(str, i);
 		return i;
 	}
 
-	switch (str[0]) {
-	case ',':
-		*type = TK_COMMA;
-		return 1;
-	case ';':
-		*type = TK_SEMICOLON;
-		return 1;
-	case '.':
-		*type = TK_DOT;
-		return 1;
-	case '(':
-		*type = TK_PAREN_OPEN;
-		return 1;
-	case ')':
-		*type = TK_PAREN_CLOSE;
-		return 1;
-	case '+':
-		*type = TK_PLUS;
+	if (char_token[c] != TK_INVALID) {
+		*type = char_token[c];
 		return 1;
+	}
+
+	switch (c) {
 	case '-':
-		if (isnumber(str[1])) {
-			for (i = 2; isnumber(str[i]); ++i)
-				;
+		if (char_class[(u8)str[1]] == CC_DIGIT) {
 			*type = TK_NUM;
-			return i;
-		} else {
-			*type = TK_MINUS;
-			return 1;
+			return 1 + span(str + 1, CC_DIGIT);
 		}
-		break;
-	case '*':
-		*type = TK_STAR;
+		*type = TK_MINUS;
 		return 1;
-	}
-
-	if (isnumber(str[0])) {
-		for (i = 1; isnumber(str[i]); ++i)
-			;
-		*type = TK_NUM;
-		return i;
-	}
-
-	if (str[0] == '\'') {
-		for (i = 1; str[i] != '\'' && str[i] != '\0'; ++i)
-			;
-		if (str[i] == '\0')
-			*type = TK_INVALID;
-		else {
-			*type = TK_STR;
-			++i;
+	case '<':
+		if (str[1] == '=') {
+			*type = TK_LE;
+			return 2;
+		} else if (str[1] == '>') {
+			*type = TK_NE;
+			return 2;
 		}
-		return i;
-	}
-
-	if (str[0] == '"') {
-		for (i = 1; str[i] != '"' && str[i] != '\0'; ++i)
+		*type = TK_LT;
+		return 1;
+	case '>':
+		if (str[1] == '=') {
+			*type = TK_GE;
+			return 2;
+		}
+		*type = TK_GT;
+		return 1;
+	case '!':
+		if (str[1] == '=') {
+			*type = TK_NE;
+			return 2;
+		}
+		*type = TK_INVALID;
+		return 1;
+	case '\'':
+	case '"':
+		for (i = 1; str[i] != c && str[i] != '\0'; ++i)
 			;
-		if (str[i] == '\0')
+		if (str[i] == '\0') {
 			*type = TK_INVALID;
-		else {
-			*type = TK_IDENT;
-			++i;
+			return i;
 		}
-		return i;
-	}
-
-	if (!isalpha(str[0])) {
+		/* quoted identifiers are never keywords */
+		*type = c == '\'' ? TK_STR : TK_IDENT;
+		return i + 1;
+	default:
 		*type = TK_INVALID;
 		return 1;
 	}
-
-	for (i = 1; isalnum(str[i]); ++i)
-		;
-	*type = TK_IDENT;
-
-	for (k = 0; k < sizeof(keyword_names) / sizeof(keyword_names[0]); ++k) {
-		if (strlen(keyword_names[k]) > i)
-			continue;
-		if (strncasecmp(str, keyword_names[k], i) == 0) {
-			*type = TK_AS + k;
-			break;
-		}
-	}
-
-	return i;
 }
 
 static void evaluate(char const *str, size_t len, struct lex_token *token)
 {
-	char *buf;
+	i64 val;
 
 	switch (token->tclass) {
 	case TK_NUM:
-		buf = malloc(len + 1);
-		memcpy(buf, str, len);
-		buf[len]       = '\0';
-		token->val_int = atoi(buf);
-		free(buf);
+		/* numbers are digits only, too many of them saturate */
+		if (ut_parse_int(str, len, INT64_MIN, INT64_MAX, &val))
+			val = INT64_MAX;
+		token->val_int = val;
 		break;
 	case TK_STR:
 		token->val_str.str = str + 1; /*skip open quote*/
@@ -155,3 +263,22 @@ void lex_next_token(struct lex *lex)
 	lex->str += tsz;
 	lex->pos += tsz;
 }
+
+int lex_split_statement(const char *str, size_t *begin, size_t *end)
+{
+	struct lex lex;
+	int	   empty;
+
+	lex_init(&lex, str);
+	do
+		lex_next_token(&lex);
+	while (lex.token.tclass == TK_SPACE);
+	*begin = lex.token.begin;
+	empty  = lex.token.tclass == TK_SEMICOLON ||
+		lex.token.tclass == TK_EOF;
+
+	while (lex.token.tclass != TK_SEMICOLON && lex.token.tclass != TK_EOF)
+		lex_next_token(&lex);
+	*end = lex.token.end;
+	return !empty;
+}
@@ -26,16 +26,52 @@ enum token_class {
 	TK_PLUS,
 	TK_MINUS,
 	TK_STAR,
+	TK_SLASH,
+	TK_PERCENT,
 
+	TK_EQ,
+	/* <> or != */
+	TK_NE,
+	TK_LT,
+	TK_LE,
+	TK_GT,
+	TK_GE,
+
+	/* Keywords, in alphabetical order */
+	TK_AND,
 	TK_AS,
+	TK_ASC,
 	TK_BIGINT,
+	TK_BY,
 	TK_CHAR,
+	TK_COPY,
 	TK_CREATE,
+	TK_DESC,
 	TK_FROM,
+	TK_GROUP,
+	TK_INNER,
+	TK_INSERT,
 	TK_INT,
+	TK_INTO,
+	TK_JOIN,
+	TK_LEFT,
+	TK_LIKE,
+	TK_LIMIT,
+	TK_NOT,
+	TK_OFFSET,
+	TK_ON,
+	TK_OR,
+	TK_ORDER,
+	TK_OUTER,
 	TK_SELECT,
 	TK_SMALLINT,
-	TK_TABLE
+	TK_STDIN,
+	TK_STDOUT,
+	TK_TABLE,
+	TK_TO,
+	TK_VALUES,
+	TK_WHERE,
+	TK_WITH
 };
 
 struct lex_str {
@@ -64,4 +100,9 @@ void lex_init(struct lex *lex, const char *str);
 /* Read the next token and advance the lexer past that token */
 void lex_next_token(struct lex *lex);
 
+/* Find the first of the statements of str, which are separated by semicolons
+ * outside of quotes. Its first token is at *begin, and it ends at *end, past
+ * its semicolon if it has one. Returns zero if the statement is empty. */
+int lex_split_statement(const char *str, size_t *begin, size_t *end);
+
 #endif // LEX_H
@@ -5,18 +5,30 @@
 #include "parser/parser.h"
 #include "util/vec.h"
 
+struct pt_expr;
+
 struct pt_select {
 	/* list of pt_select_expr */
 	struct vec select_list;
 	/* list of pt_table */
 	struct vec from;
+	/* condition of the WHERE clause, NULL if not specified */
+	struct pt_expr *where;
+	/* list of pt_expr of the GROUP BY clause */
+	struct vec group_by;
+	/* list of pt_order of the ORDER BY clause */
+	struct vec order_by;
+	/* LIMIT and OFFSET clauses, -1 if not specified */
+	i64 limit;
+	i64 offset;
 };
 
 enum pt_select_expr_type {
 	SELECT_EXPR_STAR,
 	SELECT_EXPR_NUM,
 	SELECT_EXPR_STR,
-	SELECT_EXPR_FIELD
+	SELECT_EXPR_FIELD,
+	SELECT_EXPR_AGG
 };
 
 struct pt_select_expr {
@@ -24,13 +36,64 @@ struct pt_select_expr {
         union {
                 int val_int;
                 struct lex_str val_str;
-		struct lex_str fieldname;
+		struct {
+			struct lex_str fieldname;
+			/* table qualifying the field, empty if none */
+			struct lex_str tablename;
+		};
+		/* call of an aggregate function, arg is NULL for * */
+		struct {
+			struct lex_str	funcname;
+			struct pt_expr *arg;
+			/* position in the query, for error reports */
+			size_t pos;
+		};
 	};
 	struct lex_str name;
 };
 
+enum pt_expr_type {
+	PT_EXPR_NUM,
+	PT_EXPR_STR,
+	PT_EXPR_FIELD,
+	PT_EXPR_UNARY,
+	PT_EXPR_BINARY
+};
+
+/* An operand or operation of a condition */
+struct pt_expr {
+	enum pt_expr_type type;
+	/* position in the query, for error reports */
+	size_t pos;
+	union {
+		i64	       val_int;
+		struct lex_str val_str;
+		struct {
+			struct lex_str fieldname;
+			/* table qualifying the field, empty if none */
+			struct lex_str tablename;
+		};
+		/* right is NULL for unary operators */
+		struct {
+			enum token_class op;
+			struct pt_expr	*left;
+			struct pt_expr	*right;
+		};
+	};
+};
+
+/* An item of the ORDER BY clause */
+struct pt_order {
+	struct pt_expr *expr;
+	/* nonzero for DESC */
+	int desc;
+};
+
 struct pt_table {
 	struct lex_str name;
+	enum join_type join;
+	/* condition of the ON clause, NULL after a comma */
+	struct pt_expr *on;
 };
 
 struct pt_create {
@@ -44,11 +107,32 @@ struct pt_table_col {
 	int *arg;
 };
 
+struct pt_copy {
+	struct lex_str table_name;
+	/* nonzero for COPY ... FROM, zero for COPY ... TO */
+	int from;
+	/* value of the FORMAT option, empty if not specified */
+	struct lex_str format;
+};
+
+struct pt_insert {
+	struct lex_str table_name;
+	/* list of struct lex_str of the column list, empty if not specified */
+	struct vec columns;
+	/* list of the rows of the VALUES clause, each a struct vec of
+	 * pt_expr */
+	struct vec rows;
+	/* position of the VALUES clause, for error reports */
+	size_t pos;
+};
+
 struct pt {
 	enum sql_command command;
 	union {
 		struct pt_select select;
 		struct pt_create create;
+		struct pt_copy	 copy;
+		struct pt_insert insert;
 	};
 };
 
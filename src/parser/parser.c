@@ -9,8 +9,11 @@
 
 #include "connection.h"
 #include "dtype.h"
-#include "executor/select.h"
+#include "executor/copy.h"
 #include "executor/create.h"
+#include "executor/expr.h"
+#include "executor/insert.h"
+#include "executor/select.h"
 #include "lex.h"
 #include "parser/parse_tree.h"
 #include "pgwire.h"
@@ -35,17 +38,60 @@ static void token_next_skip_space(struct lex *lex)
 	}
 }
 
+static int parse_expr(struct lex *lex, struct pt_expr **res);
+
+/* Parse the rest of a table.field name, from the dot */
+static int parse_qualified_name(struct lex *lex, struct pt_select_expr *expr)
+{
+	token_next_skip_space(lex);
+	if (lex->token.tclass != TK_IDENT) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected column name"), errpos_from_lex(lex));
+		return 1;
+	}
+	expr->tablename = expr->fieldname;
+	expr->fieldname = lex->token.val_str;
+	token_next_skip_space(lex);
+	return 0;
+}
+
+/* Parse the argument of a call of an aggregate function, from the open
+ * parenthesis */
+static int parse_agg_call(struct lex *lex, struct pt_select_expr *expr)
+{
+	struct lex_str funcname = expr->fieldname;
+
+	expr->type     = SELECT_EXPR_AGG;
+	expr->funcname = funcname;
+	expr->arg      = NULL;
+	token_next_skip_space(lex);
+	if (lex->token.tclass == TK_STAR)
+		token_next_skip_space(lex);
+	else if (parse_expr(lex, &expr->arg))
+		return 1;
+	if (lex->token.tclass != TK_PAREN_CLOSE) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected close parenthesis"),
+		       errpos_from_lex(lex));
+		return 1;
+	}
+	token_next_skip_space(lex);
+	return 0;
+}
+
 static int parse_select_exprs(struct lex *lex, struct pt_select *select)
 {
 	struct pt_select_expr *select_expr;
+	size_t		       pos;
 
-	vec_init(&select->select_list, 1);
+	vec_init_mem(&select->select_list, 1);
 
 	for (;;) {
 		select_expr = mem_alloc(sizeof(struct pt_select_expr));
 		memset(select_expr, 0, sizeof(struct pt_select_expr));
 
 		token_next_skip_space(lex);
+		pos = lex->token.begin + 1;
 		switch (lex->token.tclass) {
 		case TK_STAR:
 			select_expr->type = SELECT_EXPR_STAR;
@@ -71,6 +117,16 @@ static int parse_select_exprs(struct lex *lex, struct pt_select *select)
 		}
 
 		token_next_skip_space(lex);
+		if (select_expr->type == SELECT_EXPR_FIELD &&
+		    lex->token.tclass == TK_PAREN_OPEN) {
+			if (parse_agg_call(lex, select_expr))
+				return 1;
+			select_expr->pos = pos;
+		}
+		if (select_expr->type == SELECT_EXPR_FIELD &&
+		    lex->token.tclass == TK_DOT &&
+		    parse_qualified_name(lex, select_expr))
+			return 1;
 		if (lex->token.tclass == TK_AS) {
 			if (select_expr->type == SELECT_EXPR_STAR) {
 				errlog(ERROR, errcode(ER_SYNTAX_ERROR),
@@ -102,31 +158,112 @@ static int parse_select_exprs(struct lex *lex, struct pt_select *select)
 	return 0;
 }
 
+static int expect_token(struct lex *lex, enum token_class tclass,
+			const char *detail)
+{
+	if (lex->token.tclass == tclass) {
+		token_next_skip_space(lex);
+		return 0;
+	}
+	errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+	       errdetail(detail), errpos_from_lex(lex));
+	return 1;
+}
+
 static int parse_tables(struct lex *lex, struct pt_select *select)
 {
 	struct pt_table *table;
+	enum join_type	 join = JOIN_INNER;
+	int		 on   = 0;
 
+	vec_init_mem(&select->from, 1);
 	token_next_skip_space(lex);
-	if (lex->token.tclass != TK_IDENT) {
-		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
-		       errdetail("Expected table name"), errpos_from_lex(lex));
-		return 1;
+	for (;;) {
+		if (lex->token.tclass != TK_IDENT) {
+			errlog(ERROR, errcode(ER_SYNTAX_ERROR),
+			       errmsg("Syntax error"),
+			       errdetail("Expected table name"),
+			       errpos_from_lex(lex));
+			return 1;
+		}
+		table	    = mem_zalloc(sizeof(struct pt_table));
+		table->name = lex->token.val_str;
+		table->join = join;
+		vec_push(&select->from, table);
+		token_next_skip_space(lex);
+		if (on && (expect_token(lex, TK_ON, "Expected ON") ||
+			   parse_expr(lex, &table->on)))
+			return 1;
+
+		/* the next table follows a comma, [INNER] JOIN or
+		 * LEFT [OUTER] JOIN */
+		join = JOIN_INNER;
+		on   = 0;
+		if (lex->token.tclass == TK_COMMA) {
+			token_next_skip_space(lex);
+			continue;
+		}
+		if (lex->token.tclass == TK_INNER) {
+			token_next_skip_space(lex);
+		} else if (lex->token.tclass == TK_LEFT) {
+			join = JOIN_LEFT;
+			token_next_skip_space(lex);
+			if (lex->token.tclass == TK_OUTER)
+				token_next_skip_space(lex);
+		} else if (lex->token.tclass != TK_JOIN) {
+			return 0;
+		}
+		if (expect_token(lex, TK_JOIN, "Expected JOIN"))
+			return 1;
+		on = 1;
 	}
+}
+
+/* Parse the number of rows of a LIMIT or OFFSET clause */
+static int parse_row_count(struct lex *lex, i64 *count)
+{
 	token_next_skip_space(lex);
-	if (lex->token.tclass == TK_COMMA) {
-		errlog(ERROR, errcode(ER_FEATURE_NOT_SUPPORTED),
-		       errmsg("Syntax error"),
-		       errdetail("Joins not implemented"),
+	if (lex->token.tclass != TK_NUM) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected number of rows"),
 		       errpos_from_lex(lex));
 		return 1;
 	}
-	table = mem_zalloc(sizeof(struct pt_table));
-	table->name = lex->token.val_str;
-	vec_init(&select->from, 1);
-	vec_push(&select->from, table);
+	*count = (i64)lex->token.val_int;
+	token_next_skip_space(lex);
 	return 0;
 }
 
+static int parse_limit(struct lex *lex, struct pt_select *select)
+{
+	select->limit  = -1;
+	select->offset = -1;
+	for (;;) {
+		if (lex->token.tclass == TK_LIMIT && select->limit == -1) {
+			if (parse_row_count(lex, &select->limit))
+				return 1;
+			if (select->limit < 0) {
+				errlog(ERROR,
+				       errcode(ER_INVALID_ROW_COUNT_IN_LIMIT),
+				       errmsg("LIMIT must not be negative"));
+				return 1;
+			}
+		} else if (lex->token.tclass == TK_OFFSET &&
+			   select->offset == -1) {
+			if (parse_row_count(lex, &select->offset))
+				return 1;
+			if (select->offset < 0) {
+				errlog(ERROR,
+				       errcode(ER_INVALID_ROW_COUNT_IN_RESULT_OFFSET),
+				       errmsg("OFFSET must not be negative"));
+				return 1;
+			}
+		} else {
+			return 0;
+		}
+	}
+}
+
 static struct table *open_table(const struct lex_str *lname)
 {
 	char	     *name = strndup(lname->str, lname->len);
@@ -140,32 +277,313 @@ static struct table *open_table(const struct lex_str *lname)
 	return table;
 }
 
-static int parse_select(struct lex *lex, struct pt_select *select)
+static struct pt_expr *make_expr(enum pt_expr_type type, size_t pos)
 {
-	if (parse_select_exprs(lex, select))
-		return 1;
-	assert(select->select_list.size > 0);
+	struct pt_expr *expr = mem_zalloc(sizeof(struct pt_expr));
 
-	if (lex->token.tclass == TK_SEMICOLON || lex->token.tclass == TK_EOF) {
-		if (((struct pt_select_expr *)select->select_list.data[0])
-			    ->type == SELECT_EXPR_STAR) {
+	expr->type = type;
+	expr->pos  = pos;
+	return expr;
+}
+
+static struct pt_expr *make_op(enum token_class op, size_t pos,
+			       struct pt_expr *left, struct pt_expr *right)
+{
+	struct pt_expr *expr =
+		make_expr(right ? PT_EXPR_BINARY : PT_EXPR_UNARY, pos);
+
+	expr->op    = op;
+	expr->left  = left;
+	expr->right = right;
+	return expr;
+}
+
+static int parse_primary(struct lex *lex, struct pt_expr **res)
+{
+	struct pt_expr *expr;
+	size_t		pos = lex->token.begin + 1;
+
+	switch (lex->token.tclass) {
+	case TK_NUM:
+		expr	      = make_expr(PT_EXPR_NUM, pos);
+		expr->val_int = (i64)lex->token.val_int;
+		break;
+	case TK_STR:
+		expr	      = make_expr(PT_EXPR_STR, pos);
+		expr->val_str = lex->token.val_str;
+		break;
+	case TK_IDENT:
+		expr		= make_expr(PT_EXPR_FIELD, pos);
+		expr->fieldname = lex->token.val_str;
+		token_next_skip_space(lex);
+		if (lex->token.tclass != TK_DOT) {
+			*res = expr;
+			return 0;
+		}
+		token_next_skip_space(lex);
+		if (lex->token.tclass != TK_IDENT) {
+			errlog(ERROR, errcode(ER_SYNTAX_ERROR),
+			       errmsg("Syntax error"),
+			       errdetail("Expected column name"),
+			       errpos_from_lex(lex));
+			return 1;
+		}
+		expr->tablename = expr->fieldname;
+		expr->fieldname = lex->token.val_str;
+		break;
+	case TK_PAREN_OPEN:
+		token_next_skip_space(lex);
+		if (parse_expr(lex, &expr))
+			return 1;
+		if (lex->token.tclass != TK_PAREN_CLOSE) {
 			errlog(ERROR, errcode(ER_SYNTAX_ERROR),
 			       errmsg("Syntax error"),
-			       errdetail("Expected FROM clause after SELECT *"),
+			       errdetail("Expected close parenthesis"),
 			       errpos_from_lex(lex));
 			return 1;
 		}
+		break;
+	default:
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected expression"), errpos_from_lex(lex));
+		return 1;
+	}
+	token_next_skip_space(lex);
+	*res = expr;
+	return 0;
+}
+
+static int parse_unary(struct lex *lex, struct pt_expr **res)
+{
+	size_t pos = lex->token.begin + 1;
+
+	if (lex->token.tclass != TK_MINUS)
+		return parse_primary(lex, res);
+	token_next_skip_space(lex);
+	if (parse_unary(lex, res))
+		return 1;
+	*res = make_op(TK_MINUS, pos, *res, NULL);
+	return 0;
+}
+
+static int parse_term(struct lex *lex, struct pt_expr **res)
+{
+	struct pt_expr	*right;
+	enum token_class op;
+	size_t		 pos;
+
+	if (parse_unary(lex, res))
+		return 1;
+	while (lex->token.tclass == TK_STAR || lex->token.tclass == TK_SLASH ||
+	       lex->token.tclass == TK_PERCENT) {
+		op  = lex->token.tclass;
+		pos = lex->token.begin + 1;
+		token_next_skip_space(lex);
+		if (parse_unary(lex, &right))
+			return 1;
+		*res = make_op(op, pos, *res, right);
+	}
+	return 0;
+}
+
+/* The lexer reads a minus sign followed by digits as a negative number, which
+ * after an operand is really a subtraction */
+static int is_signed_num(struct lex *lex)
+{
+	return lex->token.tclass == TK_NUM &&
+	       lex->str[lex->token.begin - lex->pos] == '-';
+}
+
+static int parse_sum(struct lex *lex, struct pt_expr **res)
+{
+	struct pt_expr	*right;
+	enum token_class op;
+	size_t		 pos;
+
+	if (parse_term(lex, res))
+		return 1;
+	for (;;) {
+		op  = lex->token.tclass;
+		pos = lex->token.begin + 1;
+		if (op == TK_PLUS || op == TK_MINUS) {
+			token_next_skip_space(lex);
+		} else if (is_signed_num(lex)) {
+			op		    = TK_MINUS;
+			lex->token.val_int  = -lex->token.val_int;
+			lex->token.begin   += 1;
+		} else {
+			return 0;
+		}
+		if (parse_term(lex, &right))
+			return 1;
+		*res = make_op(op, pos, *res, right);
+	}
+}
+
+static int is_comparison(enum token_class tclass)
+{
+	return (tclass >= TK_EQ && tclass <= TK_GE) || tclass == TK_LIKE;
+}
+
+static int parse_comparison(struct lex *lex, struct pt_expr **res)
+{
+	struct pt_expr	*right;
+	enum token_class op;
+	size_t		 pos;
+
+	if (parse_sum(lex, res))
+		return 1;
+	if (!is_comparison(lex->token.tclass))
 		return 0;
+	op  = lex->token.tclass;
+	pos = lex->token.begin + 1;
+	token_next_skip_space(lex);
+	if (parse_sum(lex, &right))
+		return 1;
+	*res = make_op(op, pos, *res, right);
+	return 0;
+}
+
+static int parse_not(struct lex *lex, struct pt_expr **res)
+{
+	size_t pos = lex->token.begin + 1;
+
+	if (lex->token.tclass != TK_NOT)
+		return parse_comparison(lex, res);
+	token_next_skip_space(lex);
+	if (parse_not(lex, res))
+		return 1;
+	*res = make_op(TK_NOT, pos, *res, NULL);
+	return 0;
+}
+
+static int parse_and(struct lex *lex, struct pt_expr **res)
+{
+	struct pt_expr *right;
+	size_t		pos;
+
+	if (parse_not(lex, res))
+		return 1;
+	while (lex->token.tclass == TK_AND) {
+		pos = lex->token.begin + 1;
+		token_next_skip_space(lex);
+		if (parse_not(lex, &right))
+			return 1;
+		*res = make_op(TK_AND, pos, *res, right);
+	}
+	return 0;
+}
+
+/* Parse an expression starting at the current token, by order of increasing
+ * precedence: OR, AND, NOT, comparisons, + and -, *, / and %, unary minus */
+static int parse_expr(struct lex *lex, struct pt_expr **res)
+{
+	struct pt_expr *right;
+	size_t		pos;
+
+	if (parse_and(lex, res))
+		return 1;
+	while (lex->token.tclass == TK_OR) {
+		pos = lex->token.begin + 1;
+		token_next_skip_space(lex);
+		if (parse_and(lex, &right))
+			return 1;
+		*res = make_op(TK_OR, pos, *res, right);
+	}
+	return 0;
+}
+
+static int parse_group_by(struct lex *lex, struct pt_select *select)
+{
+	struct pt_expr *expr;
+
+	assert(lex->token.tclass == TK_GROUP);
+	token_next_skip_space(lex);
+	if (lex->token.tclass != TK_BY) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected BY after GROUP"),
+		       errpos_from_lex(lex));
+		return 1;
+	}
+	vec_init_mem(&select->group_by, 1);
+	do {
+		token_next_skip_space(lex);
+		if (parse_expr(lex, &expr))
+			return 1;
+		vec_push(&select->group_by, expr);
+	} while (lex->token.tclass == TK_COMMA);
+	return 0;
+}
+
+static int parse_order_by(struct lex *lex, struct pt_select *select)
+{
+	struct pt_order *order;
+
+	assert(lex->token.tclass == TK_ORDER);
+	token_next_skip_space(lex);
+	if (lex->token.tclass != TK_BY) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected BY after ORDER"),
+		       errpos_from_lex(lex));
+		return 1;
 	}
+	vec_init_mem(&select->order_by, 1);
+	do {
+		token_next_skip_space(lex);
+		order = mem_zalloc(sizeof(struct pt_order));
+		if (parse_expr(lex, &order->expr))
+			return 1;
+		if (lex->token.tclass == TK_ASC ||
+		    lex->token.tclass == TK_DESC) {
+			order->desc = lex->token.tclass == TK_DESC;
+			token_next_skip_space(lex);
+		}
+		vec_push(&select->order_by, order);
+	} while (lex->token.tclass == TK_COMMA);
+	return 0;
+}
+
+static int parse_select(struct lex *lex, struct pt_select *select)
+{
+	if (parse_select_exprs(lex, select))
+		return 1;
+	assert(select->select_list.size > 0);
 
-	if (lex->token.tclass != TK_FROM) {
+	if (lex->token.tclass == TK_FROM) {
+		if (parse_tables(lex, select))
+			return 1;
+	} else if (((struct pt_select_expr *)select->select_list.data[0])
+			   ->type == SELECT_EXPR_STAR) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected FROM clause after SELECT *"),
+		       errpos_from_lex(lex));
+		return 1;
+	} else if (lex->token.tclass != TK_SEMICOLON &&
+		   lex->token.tclass != TK_EOF &&
+		   lex->token.tclass != TK_WHERE &&
+		   lex->token.tclass != TK_GROUP &&
+		   lex->token.tclass != TK_ORDER &&
+		   lex->token.tclass != TK_LIMIT &&
+		   lex->token.tclass != TK_OFFSET) {
 		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
 		       errdetail("Expected FROM clause or end of query"),
 		       errpos_from_lex(lex));
 		return 1;
 	}
 
-	if (parse_tables(lex, select))
+	if (lex->token.tclass == TK_WHERE) {
+		token_next_skip_space(lex);
+		if (parse_expr(lex, &select->where))
+			return 1;
+	}
+
+	if (lex->token.tclass == TK_GROUP && parse_group_by(lex, select))
+		return 1;
+
+	if (lex->token.tclass == TK_ORDER && parse_order_by(lex, select))
+		return 1;
+
+	if (parse_limit(lex, select))
 		return 1;
 
 	if (lex->token.tclass != TK_SEMICOLON && lex->token.tclass != TK_EOF) {
@@ -196,7 +614,7 @@ static struct dtype *token_to_dtype(struct lex_token *token)
 
 static int parse_coltype(struct lex *lex, struct pt_table_col *col)
 {
-	if (lex->token.tclass < TK_AS && lex->token.tclass != TK_IDENT) {
+	if (lex->token.tclass < TK_AND && lex->token.tclass != TK_IDENT) {
 		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"), errdetail("Expected type"), errpos_from_lex(lex));
 		return 1;
 	}
@@ -228,6 +646,7 @@ static int parse_column_list(struct lex *lex, struct pt_create *create)
 	struct vec *list = &create->table_columns;
 	struct pt_table_col *col;
 
+	vec_init_mem(list, 1);
 	for (;;) {
 		col = mem_zalloc(sizeof(struct pt_table_col));
 
@@ -289,77 +708,601 @@ static int parse_create(struct lex *lex, struct pt_create *create)
 	return 0;
 }
 
-int make_parse_tree(struct lex *lex, struct pt *pt)
+static int parse_copy_options(struct lex *lex, struct pt_copy *copy)
 {
-	memset(pt, 0, sizeof(struct pt));
-	lex_next_token(lex);
+	if (lex->token.tclass == TK_WITH)
+		token_next_skip_space(lex);
+	if (lex->token.tclass != TK_PAREN_OPEN) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected option list"), errpos_from_lex(lex));
+		return 1;
+	}
+	token_next_skip_space(lex);
 
-	switch (lex->token.tclass) {
-	case TK_SELECT:
-		pt->command = COM_SELECT;
-		return parse_select(lex, &pt->select);
-	case TK_CREATE:
-		pt->command = COM_CREATE;
-		return parse_create(lex, &pt->create);
-	default:
-		errlog(ERROR, errcode(ER_FEATURE_NOT_SUPPORTED),
-		       errmsg("Syntax error"),
-		       errdetail("Only select and create statements supported"),
+	if (lex->token.tclass != TK_IDENT ||
+	    lex->token.val_str.len != strlen("format") ||
+	    strncasecmp(lex->token.val_str.str, "format",
+			lex->token.val_str.len) != 0) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected FORMAT option"),
 		       errpos_from_lex(lex));
 		return 1;
 	}
-}
-
+	token_next_skip_space(lex);
 
-int transform_select_expr(struct pt_select_expr *expr, struct select *select)
-{
-	struct table *table = select->from.size > 0 ? select->from.data[0] :
-						      NULL;
-	struct select_col *scol;
-	struct column	  *col;
-	int		   colno;
+	if (lex->token.tclass != TK_IDENT) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected format name"), errpos_from_lex(lex));
+		return 1;
+	}
+	copy->format = lex->token.val_str;
+	token_next_skip_space(lex);
 
-	switch (expr->type) {
-	case SELECT_EXPR_STAR:
-		for (colno = 0; colno < table->ncols; ++colno) {
-			col  = &table->cols[colno];
-			scol = mem_zalloc(sizeof(struct select_col));
-			memset(scol, 0, sizeof(struct select_col));
-			scol->type	= SELECT_COL_FIELD;
-			scol->typeoid	= col->typeoid;
-			scol->typemod	= col->typemod;
-			scol->fieldname = (char *)col->name;
-			scol->colno	= colno;
-			vec_push(&select->select_list, scol);
-		}
-		break;
-	case SELECT_EXPR_FIELD:
-		for (colno = 0; colno < table->ncols; ++colno) {
-			if (strncmp(expr->fieldname.str,
-				    table->cols[colno].name,
-				    expr->fieldname.len) == 0)
-				break;
+	if (lex->token.tclass != TK_PAREN_CLOSE) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected close parenthesis"),
+		       errpos_from_lex(lex));
+		return 1;
+	}
+	token_next_skip_space(lex);
+	return 0;
+}
+
+static int parse_copy(struct lex *lex, struct pt_copy *copy)
+{
+	assert(lex->token.tclass == TK_COPY);
+	token_next_skip_space(lex);
+
+	if (lex->token.tclass != TK_IDENT) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected table name"), errpos_from_lex(lex));
+		return 1;
+	}
+	copy->table_name = lex->token.val_str;
+	token_next_skip_space(lex);
+
+	if (lex->token.tclass == TK_FROM) {
+		copy->from = 1;
+		token_next_skip_space(lex);
+		if (lex->token.tclass != TK_STDIN) {
+			errlog(ERROR, errcode(ER_FEATURE_NOT_SUPPORTED),
+			       errmsg("Syntax error"),
+			       errdetail("Only COPY FROM STDIN is supported"),
+			       errpos_from_lex(lex));
+			return 1;
 		}
-		if (colno == table->ncols) {
-			char name[1024];
-			memcpy(name, expr->fieldname.str, expr->fieldname.len);
-			name[expr->fieldname.len] = '\0';
-			errlog(ERROR, errcode(ER_UNDEFINED_COLUMN),
-			       errmsg("Unknown column %s", name));
+	} else if (lex->token.tclass == TK_TO) {
+		token_next_skip_space(lex);
+		if (lex->token.tclass != TK_STDOUT) {
+			errlog(ERROR, errcode(ER_FEATURE_NOT_SUPPORTED),
+			       errmsg("Syntax error"),
+			       errdetail("Only COPY TO STDOUT is supported"),
+			       errpos_from_lex(lex));
 			return 1;
 		}
-		col  = &table->cols[colno];
+	} else {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected FROM or TO"), errpos_from_lex(lex));
+		return 1;
+	}
+	token_next_skip_space(lex);
+
+	if (lex->token.tclass == TK_WITH ||
+	    lex->token.tclass == TK_PAREN_OPEN) {
+		if (parse_copy_options(lex, copy))
+			return 1;
+	}
+
+	if (lex->token.tclass != TK_SEMICOLON && lex->token.tclass != TK_EOF) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected end of query"),
+		       errpos_from_lex(lex));
+		return 1;
+	}
+	return 0;
+}
+
+/* Parse a row of the VALUES clause, the current token being its open
+ * parenthesis */
+static int parse_values_row(struct lex *lex, struct vec *row)
+{
+	struct pt_expr *expr;
+
+	token_next_skip_space(lex);
+	for (;;) {
+		if (parse_expr(lex, &expr))
+			return 1;
+		vec_push(row, expr);
+		if (lex->token.tclass != TK_COMMA)
+			break;
+		token_next_skip_space(lex);
+	}
+	return expect_token(lex, TK_PAREN_CLOSE,
+			    "Expected close parenthesis or comma");
+}
+
+static int parse_insert(struct lex *lex, struct pt_insert *insert)
+{
+	struct lex_str *col;
+	struct vec     *row;
+
+	assert(lex->token.tclass == TK_INSERT);
+	token_next_skip_space(lex);
+	if (expect_token(lex, TK_INTO, "Expected INTO after INSERT"))
+		return 1;
+
+	if (lex->token.tclass != TK_IDENT) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected table name"), errpos_from_lex(lex));
+		return 1;
+	}
+	insert->table_name = lex->token.val_str;
+	token_next_skip_space(lex);
+
+	vec_init_mem(&insert->columns, 1);
+	if (lex->token.tclass == TK_PAREN_OPEN) {
+		do {
+			token_next_skip_space(lex);
+			if (lex->token.tclass != TK_IDENT) {
+				errlog(ERROR, errcode(ER_SYNTAX_ERROR),
+				       errmsg("Syntax error"),
+				       errdetail("Expected column name"),
+				       errpos_from_lex(lex));
+				return 1;
+			}
+			col  = mem_alloc(sizeof(struct lex_str));
+			*col = lex->token.val_str;
+			vec_push(&insert->columns, col);
+			token_next_skip_space(lex);
+		} while (lex->token.tclass == TK_COMMA);
+		if (expect_token(lex, TK_PAREN_CLOSE,
+				 "Expected close parenthesis or comma"))
+			return 1;
+	}
+
+	insert->pos = lex->token.begin + 1;
+	if (expect_token(lex, TK_VALUES, "Expected VALUES"))
+		return 1;
+	vec_init_mem(&insert->rows, 1);
+	for (;;) {
+		if (lex->token.tclass != TK_PAREN_OPEN) {
+			errlog(ERROR, errcode(ER_SYNTAX_ERROR),
+			       errmsg("Syntax error"),
+			       errdetail("Expected open parenthesis"),
+			       errpos_from_lex(lex));
+			return 1;
+		}
+		row = mem_alloc(sizeof(struct vec));
+		vec_init_mem(row, insert->columns.size > 0 ?
+					  insert->columns.size :
+					  1);
+		if (parse_values_row(lex, row))
+			return 1;
+		vec_push(&insert->rows, row);
+		if (lex->token.tclass != TK_COMMA)
+			break;
+		token_next_skip_space(lex);
+	}
+
+	if (lex->token.tclass != TK_SEMICOLON && lex->token.tclass != TK_EOF) {
+		errlog(ERROR, errcode(ER_SYNTAX_ERROR), errmsg("Syntax error"),
+		       errdetail("Expected end of query"),
+		       errpos_from_lex(lex));
+		return 1;
+	}
+	return 0;
+}
+
+int make_parse_tree(struct lex *lex, struct pt *pt)
+{
+	memset(pt, 0, sizeof(struct pt));
+	lex_next_token(lex);
+
+	switch (lex->token.tclass) {
+	case TK_SELECT:
+		pt->command = COM_SELECT;
+		return parse_select(lex, &pt->select);
+	case TK_CREATE:
+		pt->command = COM_CREATE;
+		return parse_create(lex, &pt->create);
+	case TK_COPY:
+		pt->command = COM_COPY;
+		return parse_copy(lex, &pt->copy);
+	case TK_INSERT:
+		pt->command = COM_INSERT;
+		return parse_insert(lex, &pt->insert);
+	default:
+		errlog(ERROR, errcode(ER_FEATURE_NOT_SUPPORTED),
+		       errmsg("Syntax error"),
+		       errdetail("Only select, insert, create and copy statements supported"),
+		       errpos_from_lex(lex));
+		return 1;
+	}
+}
+
+
+/* Compare an identifier with a name */
+static int ident_eq(const struct lex_str *ident, const char *name)
+{
+	return strlen(name) == ident->len &&
+	       memcmp(ident->str, name, ident->len) == 0;
+}
+
+static char *ident_dup(const struct lex_str *ident)
+{
+	char *str = mem_alloc(ident->len + 1);
+
+	memcpy(str, ident->str, ident->len);
+	str[ident->len] = '\0';
+	return str;
+}
+
+/* Find the column a possibly qualified field name refers to, among the tables
+ * of the from list */
+static int resolve_field(struct select *select, const struct lex_str *tablename,
+			 const struct lex_str *fieldname, u16 *tableno,
+			 u16 *colno)
+{
+	struct table *table;
+	int	      found = 0;
+	u16	      t;
+	u16	      c;
+
+	for (t = 0; t < select->from.size; ++t) {
+		table = select->from.data[t];
+		if (tablename->len > 0 && !ident_eq(tablename, table->name))
+			continue;
+		for (c = 0; c < table->ncols; ++c) {
+			if (!ident_eq(fieldname, table->cols[c].name))
+				continue;
+			if (found) {
+				errlog(ERROR, errcode(ER_AMBIGUOUS_COLUMN),
+				       errmsg("Column reference %s is ambiguous",
+					      ident_dup(fieldname)));
+				return 1;
+			}
+			found	 = 1;
+			*tableno = t;
+			*colno	 = c;
+		}
+		if (tablename->len > 0)
+			break;
+	}
+
+	if (tablename->len > 0 && t == select->from.size) {
+		errlog(ERROR, errcode(ER_UNDEFINED_TABLE),
+		       errmsg("Missing FROM clause entry for table %s",
+			      ident_dup(tablename)));
+		return 1;
+	}
+	if (!found) {
+		errlog(ERROR, errcode(ER_UNDEFINED_COLUMN),
+		       errmsg("Unknown column %s", ident_dup(fieldname)));
+		return 1;
+	}
+	return 0;
+}
+
+static const char *op_name(enum token_class op)
+{
+	switch (op) {
+	case TK_PLUS:
+		return "+";
+	case TK_MINUS:
+		return "-";
+	case TK_STAR:
+		return "*";
+	case TK_SLASH:
+		return "/";
+	case TK_PERCENT:
+		return "%";
+	case TK_EQ:
+		return "=";
+	case TK_NE:
+		return "<>";
+	case TK_LT:
+		return "<";
+	case TK_LE:
+		return "<=";
+	case TK_GT:
+		return ">";
+	case TK_GE:
+		return ">=";
+	case TK_LIKE:
+		return "LIKE";
+	case TK_AND:
+		return "AND";
+	case TK_OR:
+		return "OR";
+	default:
+		return "NOT";
+	}
+}
+
+static enum expr_op token_to_op(enum token_class op, int unary)
+{
+	switch (op) {
+	case TK_PLUS:
+		return EXPR_ADD;
+	case TK_MINUS:
+		return unary ? EXPR_NEG : EXPR_SUB;
+	case TK_STAR:
+		return EXPR_MUL;
+	case TK_SLASH:
+		return EXPR_DIV;
+	case TK_PERCENT:
+		return EXPR_MOD;
+	case TK_EQ:
+		return EXPR_EQ;
+	case TK_NE:
+		return EXPR_NE;
+	case TK_LT:
+		return EXPR_LT;
+	case TK_LE:
+		return EXPR_LE;
+	case TK_GT:
+		return EXPR_GT;
+	case TK_GE:
+		return EXPR_GE;
+	case TK_LIKE:
+		return EXPR_LIKE;
+	case TK_AND:
+		return EXPR_AND;
+	case TK_OR:
+		return EXPR_OR;
+	default:
+		return EXPR_NOT;
+	}
+}
+
+static int is_int_type(u32 typeoid)
+{
+	return typeoid == DTYPE_INT2 || typeoid == DTYPE_INT4 ||
+	       typeoid == DTYPE_INT8;
+}
+
+static int check_bool_arg(struct expr *arg, const char *construct,
+			  size_t pos)
+{
+	if (arg->typeoid == DTYPE_BOOL)
+		return 0;
+	errlog(ERROR, errcode(ER_DATATYPE_MISMATCH),
+	       errmsg("Argument of %s must be type bool, not type %s",
+		      construct, dtypes[arg->typeoid].name),
+	       errpos(pos));
+	return 1;
+}
+
+/* Resolve the fields of an expression and check the types of its operands */
+static int transform_expr(struct pt_expr *pt, struct select *select,
+			  struct expr **res)
+{
+	struct expr *expr = mem_zalloc(sizeof(struct expr));
+	struct table *table;
+	u32	     ltype;
+	u32	     rtype;
+
+	*res = expr;
+	switch (pt->type) {
+	case PT_EXPR_NUM:
+		expr->type    = EXPR_CONST;
+		expr->typeoid = pt->val_int >= INT32_MIN && pt->val_int <= INT32_MAX ?
+					DTYPE_INT4 :
+					DTYPE_INT8;
+		expr->typemod = -1;
+		expr->val_int = pt->val_int;
+		return 0;
+	case PT_EXPR_STR:
+		expr->type    = EXPR_CONST;
+		expr->typeoid = DTYPE_CHAR;
+		expr->typemod = pt->val_str.len;
+		expr->val_str = ident_dup(&pt->val_str);
+		return 0;
+	case PT_EXPR_FIELD:
+		expr->type = EXPR_COLUMN;
+		if (resolve_field(select, &pt->tablename, &pt->fieldname,
+				  &expr->tableno, &expr->colno))
+			return 1;
+		table	      = select->from.data[expr->tableno];
+		expr->typeoid = table->cols[expr->colno].typeoid;
+		expr->typemod = table->cols[expr->colno].typemod;
+		return 0;
+	case PT_EXPR_UNARY:
+	case PT_EXPR_BINARY:
+		break;
+	}
+
+	expr->type    = EXPR_OP;
+	expr->op      = token_to_op(pt->op, pt->right == NULL);
+	expr->typemod = -1;
+	if (transform_expr(pt->left, select, &expr->left))
+		return 1;
+	if (pt->right && transform_expr(pt->right, select, &expr->right))
+		return 1;
+	ltype = expr->left->typeoid;
+	rtype = expr->right ? expr->right->typeoid : DTYPE_INVALID;
+
+	switch (expr->op) {
+	case EXPR_NOT:
+	case EXPR_AND:
+	case EXPR_OR:
+		if (check_bool_arg(expr->left, op_name(pt->op), pt->pos) ||
+		    (expr->right &&
+		     check_bool_arg(expr->right, op_name(pt->op), pt->pos)))
+			return 1;
+		expr->typeoid = DTYPE_BOOL;
+		return 0;
+	case EXPR_NEG:
+		if (!is_int_type(ltype)) {
+			errlog(ERROR, errcode(ER_UNDEFINED_FUNCTION),
+			       errmsg("Operator does not exist: - %s",
+				      dtypes[ltype].name),
+			       errpos(pt->pos));
+			return 1;
+		}
+		expr->typeoid = ltype;
+		return 0;
+	case EXPR_EQ:
+	case EXPR_NE:
+	case EXPR_LT:
+	case EXPR_LE:
+	case EXPR_GT:
+	case EXPR_GE:
+		if ((ltype == DTYPE_CHAR && rtype == DTYPE_CHAR) ||
+		    (is_int_type(ltype) && is_int_type(rtype))) {
+			expr->typeoid = DTYPE_BOOL;
+			return 0;
+		}
+		break;
+	case EXPR_LIKE:
+		if (ltype == DTYPE_CHAR && rtype == DTYPE_CHAR) {
+			expr->typeoid = DTYPE_BOOL;
+			return 0;
+		}
+		break;
+	default:
+		if (is_int_type(ltype) && is_int_type(rtype)) {
+			/* the result has the wider type of the operands */
+			expr->typeoid = dtypes[ltype].len >= dtypes[rtype].len ?
+						ltype :
+						rtype;
+			return 0;
+		}
+		break;
+	}
+	errlog(ERROR, errcode(ER_UNDEFINED_FUNCTION),
+	       errmsg("Operator does not exist: %s %s %s", dtypes[ltype].name,
+		      op_name(pt->op), dtypes[rtype].name),
+	       errpos(pt->pos));
+	return 1;
+}
+
+static const char *agg_names[] = {
+	[AGG_COUNT] = "count", [AGG_SUM] = "sum", [AGG_MIN] = "min",
+	[AGG_MAX] = "max",     [AGG_AVG] = "avg",
+};
+
+/* Resolve an aggregate function from its name and the type of its argument */
+static int transform_agg_call(struct pt_select_expr *pt, struct select *select,
+			      struct agg_call **res)
+{
+	struct agg_call *agg = mem_zalloc(sizeof(struct agg_call));
+	const char	*argname = "*";
+	u32		 argtype = DTYPE_INVALID;
+	int		 f;
+
+	*res = agg;
+	if (pt->arg) {
+		if (transform_expr(pt->arg, select, &agg->arg))
+			return 1;
+		argtype = agg->arg->typeoid;
+		argname = dtypes[argtype].name;
+	}
+	for (f = AGG_COUNT; f <= AGG_AVG; ++f) {
+		if (pt->funcname.len == strlen(agg_names[f]) &&
+		    strncasecmp(pt->funcname.str, agg_names[f],
+				pt->funcname.len) == 0)
+			break;
+	}
+
+	agg->func    = f;
+	agg->typemod = -1;
+	switch (f) {
+	case AGG_COUNT:
+		agg->typeoid = DTYPE_INT8;
+		return 0;
+	case AGG_SUM:
+		if (!is_int_type(argtype))
+			break;
+		agg->typeoid = DTYPE_INT8;
+		return 0;
+	case AGG_AVG:
+		if (!is_int_type(argtype))
+			break;
+		agg->typeoid = DTYPE_FLOAT8;
+		return 0;
+	case AGG_MIN:
+	case AGG_MAX:
+		if (!is_int_type(argtype) && argtype != DTYPE_CHAR)
+			break;
+		agg->typeoid = argtype;
+		agg->typemod = agg->arg->typemod;
+		return 0;
+	default:
+		break;
+	}
+	errlog(ERROR, errcode(ER_UNDEFINED_FUNCTION),
+	       errmsg("Function %s(%s) does not exist",
+		      ident_dup(&pt->funcname), argname),
+	       errpos(pt->pos));
+	return 1;
+}
+
+/* Check that a column referenced by a grouped query is one of the GROUP BY
+ * expressions */
+static int check_grouped(struct select *select, u16 tableno, u16 colno)
+{
+	struct table *table;
+	struct expr  *expr;
+	size_t	      i;
+
+	for (i = 0; i < select->group_by.size; ++i) {
+		expr = select->group_by.data[i];
+		if (expr->type == EXPR_COLUMN && expr->tableno == tableno &&
+		    expr->colno == colno)
+			return 0;
+	}
+	table = select->from.data[tableno];
+	errlog(ERROR, errcode(ER_GROUPING_ERROR),
+	       errmsg("Column %s.%s must appear in the GROUP BY clause or be "
+		      "used in an aggregate function",
+		      table->name, table->cols[colno].name));
+	return 1;
+}
+
+int transform_select_expr(struct pt_select_expr *expr, struct select *select)
+{
+	struct agg_call	  *agg;
+	struct table	  *table;
+	struct select_col *scol;
+	struct column	  *col;
+	u16		   tableno;
+	u16		   colno;
+
+	switch (expr->type) {
+	case SELECT_EXPR_STAR:
+		for (tableno = 0; tableno < select->from.size; ++tableno) {
+			table = select->from.data[tableno];
+			for (colno = 0; colno < table->ncols; ++colno) {
+				col		= &table->cols[colno];
+				scol		= mem_zalloc(sizeof(struct select_col));
+				scol->type	= SELECT_COL_FIELD;
+				scol->typeoid	= col->typeoid;
+				scol->typemod	= col->typemod;
+				scol->fieldname = (char *)col->name;
+				scol->tableoid	= table->oid;
+				scol->tableno	= tableno;
+				scol->colno	= colno;
+				vec_push(&select->select_list, scol);
+			}
+		}
+		break;
+	case SELECT_EXPR_FIELD:
+		if (resolve_field(select, &expr->tablename, &expr->fieldname,
+				  &tableno, &colno))
+			return 1;
+		table		= select->from.data[tableno];
+		col		= &table->cols[colno];
 		scol		= mem_zalloc(sizeof(struct select_col));
 		scol->type	= SELECT_COL_FIELD;
 		scol->typeoid	= col->typeoid;
 		scol->typemod	= col->typemod;
 		scol->fieldname = (char *)col->name;
+		scol->tableoid	= table->oid;
+		scol->tableno	= tableno;
 		scol->colno	= colno;
-		if (expr->name.len > 0) {
-			scol->name = mem_alloc(expr->name.len + 1);
-			memcpy(scol->name, expr->name.str, expr->name.len);
-			scol->name[expr->name.len] = '\0';
-		}
+		if (expr->name.len > 0)
+			scol->name = ident_dup(&expr->name);
 		vec_push(&select->select_list, scol);
 		break;
 	case SELECT_EXPR_NUM:
@@ -368,11 +1311,8 @@ int transform_select_expr(struct pt_select_expr *expr, struct select *select)
 		scol->typeoid = DTYPE_INT4;
 		scol->typemod = -1;
 		scol->val_int = expr->val_int;
-		if (expr->name.len > 0) {
-			scol->name = mem_alloc(expr->name.len + 1);
-			memcpy(scol->name, expr->name.str, expr->name.len);
-			scol->name[expr->name.len] = '\0';
-		}
+		if (expr->name.len > 0)
+			scol->name = ident_dup(&expr->name);
 		vec_push(&select->select_list, scol);
 		break;
 	case SELECT_EXPR_STR:
@@ -380,38 +1320,171 @@ int transform_select_expr(struct pt_select_expr *expr, struct select *select)
 		scol->type    = SELECT_COL_LITERAL;
 		scol->typeoid = DTYPE_CHAR;
 		scol->typemod = expr->val_str.len;
-		scol->val_str = mem_alloc(expr->val_str.len + 1);
-		memcpy(scol->val_str, expr->val_str.str, expr->val_str.len);
-		scol->val_str[expr->val_str.len] = '\0';
-		if (expr->name.len > 0) {
-			scol->name = mem_alloc(expr->name.len + 1);
-			memcpy(scol->name, expr->name.str, expr->name.len);
-			scol->name[expr->name.len] = '\0';
-		}
+		scol->val_str = ident_dup(&expr->val_str);
+		if (expr->name.len > 0)
+			scol->name = ident_dup(&expr->name);
+		vec_push(&select->select_list, scol);
+		break;
+	case SELECT_EXPR_AGG:
+		if (transform_agg_call(expr, select, &agg))
+			return 1;
+		scol	      = mem_zalloc(sizeof(struct select_col));
+		scol->type    = SELECT_COL_AGG;
+		scol->typeoid = agg->typeoid;
+		scol->typemod = agg->typemod;
+		scol->aggno   = select->aggs.size;
+		scol->name    = expr->name.len > 0 ?
+					ident_dup(&expr->name) :
+					(char *)agg_names[agg->func];
+		vec_push(&select->aggs, agg);
 		vec_push(&select->select_list, scol);
 		break;
 	}
 	return 0;
 }
 
+/* Find the column of the select list an ORDER BY item refers to by its
+ * position or its output name, if any */
+static int find_order_col(struct pt_expr *pt, struct select *select,
+			  struct select_col **res)
+{
+	struct select_col *scol;
+	const char	  *name;
+	size_t		   i;
+
+	*res = NULL;
+	if (pt->type == PT_EXPR_NUM) {
+		if (pt->val_int < 1 || pt->val_int > select->select_list.size) {
+			errlog(ERROR, errcode(ER_INVALID_COLUMN_REFERENCE),
+			       errmsg("ORDER BY position %lld is not in select "
+				      "list",
+				      (long long)pt->val_int),
+			       errpos(pt->pos));
+			return 1;
+		}
+		*res = select->select_list.data[pt->val_int - 1];
+		return 0;
+	}
+	if (pt->type != PT_EXPR_FIELD || pt->tablename.len > 0)
+		return 0;
+
+	for (i = 0; i < select->select_list.size; ++i) {
+		scol = select->select_list.data[i];
+		name = scol->name ? scol->name :
+		       scol->type == SELECT_COL_FIELD ? scol->fieldname :
+							NULL;
+		if (name == NULL || !ident_eq(&pt->fieldname, name))
+			continue;
+		if (*res && !(scol->type == SELECT_COL_FIELD &&
+			      (*res)->type == SELECT_COL_FIELD &&
+			      scol->tableno == (*res)->tableno &&
+			      scol->colno == (*res)->colno)) {
+			errlog(ERROR, errcode(ER_AMBIGUOUS_COLUMN),
+			       errmsg("ORDER BY %s is ambiguous", name),
+			       errpos(pt->pos));
+			return 1;
+		}
+		*res = scol;
+	}
+	return 0;
+}
+
+/* Resolve an ORDER BY item. It refers to a column of the select list by its
+ * position or output name, or else is an expression on the tables. Returns
+ * nonzero on error, and sets *res to NULL for a literal column, whose value
+ * leaves the order unchanged. */
+static int transform_order(struct pt_order *pt, struct select *select,
+			   int grouped, struct select_order **res)
+{
+	struct select_order *order;
+	struct select_col   *scol;
+	struct expr	    *expr;
+
+	*res = NULL;
+	if (find_order_col(pt->expr, select, &scol))
+		return 1;
+	if (scol && scol->type == SELECT_COL_LITERAL)
+		return 0;
+
+	order	    = mem_zalloc(sizeof(struct select_order));
+	order->desc = pt->desc;
+	*res	    = order;
+	if (scol && scol->type == SELECT_COL_AGG) {
+		order->aggno = scol->aggno;
+		return 0;
+	}
+	if (scol) {
+		expr	      = mem_zalloc(sizeof(struct expr));
+		expr->type    = EXPR_COLUMN;
+		expr->typeoid = scol->typeoid;
+		expr->typemod = scol->typemod;
+		expr->tableno = scol->tableno;
+		expr->colno   = scol->colno;
+	} else if (transform_expr(pt->expr, select, &expr)) {
+		return 1;
+	}
+	order->expr = expr;
+	if (!grouped)
+		return 0;
+	if (expr->type != EXPR_COLUMN) {
+		errlog(ERROR, errcode(ER_FEATURE_NOT_SUPPORTED),
+		       errmsg("ORDER BY of a grouped query must refer to "
+			      "columns"),
+		       errpos(pt->expr->pos));
+		return 1;
+	}
+	return check_grouped(select, expr->tableno, expr->colno);
+}
+
 int transform_select(struct pt_select *pt_select, struct select *select)
 {
 	int i;
+	int j;
 
 	memset(select, 0, sizeof(struct select));
 	select->sql_command = COM_SELECT;
-
-	vec_init(&select->from, pt_select->from.size);
-	if (pt_select->from.size > 0) {
-		struct pt_table *pt_table = pt_select->from.data[0];
-		struct table *table;
+	select->limit	    = pt_select->limit;
+	select->offset	    = pt_select->offset > 0 ? pt_select->offset : 0;
+
+	vec_init_mem(&select->from, pt_select->from.size);
+	vec_init_mem(&select->joins, pt_select->from.size);
+	vec_init_mem(&select->group_by, pt_select->group_by.size);
+	vec_init_mem(&select->aggs, 1);
+	vec_init_mem(&select->order_by, pt_select->order_by.size);
+	for (i = 0; i < pt_select->from.size; ++i) {
+		struct pt_table	   *pt_table = pt_select->from.data[i];
+		struct select_join *join;
+		struct table	   *table;
+
+		for (j = 0; j < i; ++j) {
+			struct pt_table *prev = pt_select->from.data[j];
+
+			if (prev->name.len == pt_table->name.len &&
+			    memcmp(prev->name.str, pt_table->name.str,
+				   prev->name.len) == 0) {
+				errlog(ERROR, errcode(ER_DUPLICATE_ALIAS),
+				       errmsg("Table name %s specified more "
+					      "than once",
+					      ident_dup(&pt_table->name)));
+				return 1;
+			}
+		}
 		table = open_table(&pt_table->name);
 		if (table == NULL)
 			return 1;
 		vec_push(&select->from, table);
+
+		/* the condition may only reference the tables joined so far */
+		join	   = mem_zalloc(sizeof(struct select_join));
+		join->type = pt_table->join;
+		vec_push(&select->joins, join);
+		if (pt_table->on &&
+		    (transform_expr(pt_table->on, select, &join->on) ||
+		     check_bool_arg(join->on, "JOIN/ON", pt_table->on->pos)))
+			return 1;
 	}
-	assert(select->from.size < 2);
 
+	vec_init_mem(&select->select_list, pt_select->select_list.size);
 	for (i = 0; i < pt_select->select_list.size; ++i) {
 		struct pt_select_expr *expr =
 			(struct pt_select_expr *)pt_select->select_list.data[i];
@@ -419,6 +1492,43 @@ int transform_select(struct pt_select *pt_select, struct select *select)
 		if (transform_select_expr(expr, select))
 			return 1;
 	}
+
+	if (pt_select->where) {
+		if (transform_expr(pt_select->where, select, &select->where))
+			return 1;
+		if (check_bool_arg(select->where, "WHERE",
+				   pt_select->where->pos))
+			return 1;
+	}
+
+	for (i = 0; i < pt_select->group_by.size; ++i) {
+		struct expr *expr;
+
+		if (transform_expr(pt_select->group_by.data[i], select, &expr))
+			return 1;
+		vec_push(&select->group_by, expr);
+	}
+	if (select->group_by.size > 0 || select->aggs.size > 0) {
+		for (i = 0; i < select->select_list.size; ++i) {
+			struct select_col *scol = select->select_list.data[i];
+
+			if (scol->type == SELECT_COL_FIELD &&
+			    check_grouped(select, scol->tableno, scol->colno))
+				return 1;
+		}
+	}
+
+	for (i = 0; i < pt_select->order_by.size; ++i) {
+		struct select_order *order;
+
+		if (transform_order(pt_select->order_by.data[i], select,
+				    select->group_by.size > 0 ||
+					    select->aggs.size > 0,
+				    &order))
+			return 1;
+		if (order)
+			vec_push(&select->order_by, order);
+	}
 	return 0;
 }
 
@@ -433,7 +1543,7 @@ int transform_create(struct pt_create *pt_create, struct create *create)
 	memcpy(create->table_name, pt_create->table_name.str, pt_create->table_name.len);
 	create->table_name[pt_create->table_name.len] = '\0';
 
-	vec_init(&create->table_columns, pt_create->table_columns.size);
+	vec_init_mem(&create->table_columns, pt_create->table_columns.size);
 
 	for (i = 0; i < pt_create->table_columns.size; ++i) {
 		struct pt_table_col *pt_col = pt_create->table_columns.data[i];
@@ -465,6 +1575,158 @@ int transform_create(struct pt_create *pt_create, struct create *create)
 	return 0;
 }
 
+static int lex_str_eq(const struct lex_str *lstr, const char *str)
+{
+	return lstr->len == strlen(str) &&
+	       strncasecmp(lstr->str, str, lstr->len) == 0;
+}
+
+int transform_copy(struct pt_copy *pt_copy, struct copy *copy)
+{
+	memset(copy, 0, sizeof(struct copy));
+	copy->command = COM_COPY;
+	copy->from    = pt_copy->from;
+
+	if (pt_copy->format.len == 0 || lex_str_eq(&pt_copy->format, "text")) {
+		copy->format = COPY_FORMAT_TEXT;
+	} else if (lex_str_eq(&pt_copy->format, "csv")) {
+		copy->format = COPY_FORMAT_CSV;
+	} else if (lex_str_eq(&pt_copy->format, "binary")) {
+		copy->format = COPY_FORMAT_BINARY;
+	} else {
+		char name[1024];
+		snprintf(name, sizeof(name), "%.*s", (int)pt_copy->format.len,
+			 pt_copy->format.str);
+		errlog(ERROR, errcode(ER_INVALID_PARAMETER_VALUE),
+		       errmsg("COPY format %s not recognized", name));
+		return 1;
+	}
+
+	copy->table = open_table(&pt_copy->table_name);
+	if (copy->table == NULL)
+		return 1;
+	return 0;
+}
+
+/* Find the column of the table each value of a row goes to, in colnos */
+static int transform_insert_columns(struct pt_insert *pt_insert,
+				    struct table *table, u16 *colnos)
+{
+	u8	       *given = mem_zalloc(table->ncols);
+	struct lex_str *name;
+	u16		i;
+	u16		c;
+
+	if (pt_insert->columns.size == 0) {
+		for (c = 0; c < table->ncols; ++c)
+			colnos[c] = c;
+		return 0;
+	}
+
+	for (i = 0; i < pt_insert->columns.size; ++i) {
+		name = pt_insert->columns.data[i];
+		for (c = 0; c < table->ncols; ++c) {
+			if (ident_eq(name, table->cols[c].name))
+				break;
+		}
+		if (c == table->ncols) {
+			errlog(ERROR, errcode(ER_UNDEFINED_COLUMN),
+			       errmsg("Unknown column %s", ident_dup(name)));
+			return 1;
+		}
+		if (given[c]) {
+			errlog(ERROR, errcode(ER_DUPLICATE_COLUMN),
+			       errmsg("Column %s specified more than once",
+				      ident_dup(name)));
+			return 1;
+		}
+		given[c]  = 1;
+		colnos[i] = c;
+	}
+	/* the heap has no room for nulls */
+	for (c = 0; c < table->ncols; ++c) {
+		if (!given[c]) {
+			errlog(ERROR, errcode(ER_FEATURE_NOT_SUPPORTED),
+			       errmsg("Null value in column %s is not supported",
+				      table->cols[c].name));
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Check that a value can be stored in a column */
+static int check_insert_value(struct expr *expr, struct column *col,
+			      size_t pos)
+{
+	if (col->typeoid == DTYPE_CHAR && expr->typeoid == DTYPE_CHAR) {
+		if (expr->typemod <= col->typemod)
+			return 0;
+		errlog(ERROR, errcode(ER_STRING_DATA_RIGHT_TRUNCATION),
+		       errmsg("Value too long for type char(%d)",
+			      col->typemod),
+		       errpos(pos));
+		return 1;
+	}
+	if (is_int_type(col->typeoid) && is_int_type(expr->typeoid))
+		return 0;
+	errlog(ERROR, errcode(ER_DATATYPE_MISMATCH),
+	       errmsg("Column %s is of type %s but expression is of type %s",
+		      col->name, dtypes[col->typeoid].name,
+		      dtypes[expr->typeoid].name),
+	       errpos(pos));
+	return 1;
+}
+
+int transform_insert(struct pt_insert *pt_insert, struct insert *insert)
+{
+	struct select	nofrom;
+	struct table   *table;
+	struct vec     *row;
+	struct pt_expr *pt;
+	struct expr   **value;
+	u16	       *colnos;
+	u32		r;
+	u16		i;
+
+	memset(insert, 0, sizeof(struct insert));
+	insert->command = COM_INSERT;
+
+	insert->table = table = open_table(&pt_insert->table_name);
+	if (table == NULL)
+		return 1;
+	colnos = mem_alloc(sizeof(u16) * table->ncols);
+	if (transform_insert_columns(pt_insert, table, colnos))
+		return 1;
+
+	/* the values are constant expressions, with no table to refer to */
+	memset(&nofrom, 0, sizeof(nofrom));
+	insert->nrows  = pt_insert->rows.size;
+	insert->values = mem_alloc(sizeof(struct expr *) * table->ncols *
+				   insert->nrows);
+	for (r = 0; r < insert->nrows; ++r) {
+		row = pt_insert->rows.data[r];
+		if (row->size != table->ncols) {
+			errlog(ERROR, errcode(ER_SYNTAX_ERROR),
+			       errmsg(row->size > table->ncols ?
+					      "INSERT has more expressions than target columns" :
+					      "INSERT has more target columns than expressions"),
+			       errpos(((struct pt_expr *)row->data[0])->pos));
+			return 1;
+		}
+		value = insert->values + (size_t)r * table->ncols;
+		for (i = 0; i < row->size; ++i) {
+			pt = row->data[i];
+			if (transform_expr(pt, &nofrom, &value[colnos[i]]) ||
+			    check_insert_value(value[colnos[i]],
+					       &table->cols[colnos[i]],
+					       pt->pos))
+				return 1;
+		}
+	}
+	return 0;
+}
+
 int transform(struct pt *pt, void **query_tree)
 {
 	switch (pt->command) {
@@ -476,6 +1738,13 @@ int transform(struct pt *pt, void **query_tree)
 		*query_tree = mem_alloc(sizeof(struct create));
 		return transform_create(&pt->create,
 					(struct create *)*query_tree);
+	case COM_COPY:
+		*query_tree = mem_alloc(sizeof(struct copy));
+		return transform_copy(&pt->copy, (struct copy *)*query_tree);
+	case COM_INSERT:
+		*query_tree = mem_alloc(sizeof(struct insert));
+		return transform_insert(&pt->insert,
+					(struct insert *)*query_tree);
 	default:
 		assert(0);
 	}
@@ -483,13 +1752,20 @@ int transform(struct pt *pt, void **query_tree)
 
 int parse(struct conn *conn, void **query_tree)
 {
-	struct lex	  lex;
-	struct pt parse_tree;
+	if (!conn->query)
+		return 1;
+	return parse_query(conn->query, query_tree);
+}
+
+int parse_query(const char *query, void **query_tree)
+{
+	struct lex lex;
+	struct pt  parse_tree;
 
-	if (!conn->query || conn->query[0] == '\0')
+	if (query[0] == '\0')
 		return 1;
 
-	lex_init(&lex, conn->query);
+	lex_init(&lex, query);
 
 	if (make_parse_tree(&lex, &parse_tree))
 		return 1;
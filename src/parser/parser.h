@@ -4,10 +4,19 @@
 #include "connection.h"
 
 enum sql_command {
+	COM_COPY,
 	COM_CREATE,
+	COM_INSERT,
 	COM_SELECT
 };
 
+/* How a table of the from list is joined to the tables before it */
+enum join_type { JOIN_INNER, JOIN_LEFT };
+
 int parse(struct conn *con, void **query_tree);
 
+/* Parse a query into a query tree allocated on the current memory root, which
+ * may point into the text of the query */
+int parse_query(const char *query, void **query_tree);
+
 #endif // PARSE_H
@@ -0,0 +1,231 @@
+#include "parser/plancache.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser/parser.h"
+#include "util/mem.h"
+
+#define NBUCKETS 512
+
+struct plancache_entry {
+	/* normalized text of the query */
+	char *key;
+	u32   hash;
+	void *query_tree;
+	/* root of the key and of the tree */
+	struct mem_root mem_root;
+	/* number of portals using the tree */
+	u32 refs;
+	/* set while the entry is in the cache */
+	int cached;
+	/* next entry of the bucket */
+	struct plancache_entry *next;
+	/* neighbours in the list of entries, the most recently used first */
+	struct plancache_entry *lru_prev;
+	struct plancache_entry *lru_next;
+};
+
+static struct {
+	pthread_mutex_t		lock;
+	struct plancache_entry *buckets[NBUCKETS];
+	struct plancache_entry *lru_head;
+	struct plancache_entry *lru_tail;
+	u32			nentries;
+	size_t			nbytes;
+	/* bumped by each invalidation, so that trees parsed before one are
+	 * not added after it */
+	u64 generation;
+} cache = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/* Collapse the runs of blanks outside of quotes into a single space, and drop
+ * the leading and trailing ones. out must hold strlen(query) + 1 bytes. */
+static size_t normalize(const char *query, char *out)
+{
+	char *ptr   = out;
+	char  quote = '\0';
+	int   blank = 0;
+
+	for (; *query; ++query) {
+		if (quote == '\0' && (*query == ' ' || *query == '\t' ||
+				      *query == '\n' || *query == '\r')) {
+			blank = ptr > out;
+			continue;
+		}
+		if (blank)
+			*ptr++ = ' ';
+		blank = 0;
+		if (quote == '\0' && (*query == '\'' || *query == '"'))
+			quote = *query;
+		else if (*query == quote)
+			quote = '\0';
+		*ptr++ = *query;
+	}
+	*ptr = '\0';
+	return ptr - out;
+}
+
+static u32 hash_key(const char *key, size_t len)
+{
+	u32 hash = 2166136261u;
+
+	while (len-- > 0) {
+		hash ^= (u8)*key++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void lru_unlink(struct plancache_entry *entry)
+{
+	if (entry->lru_prev)
+		entry->lru_prev->lru_next = entry->lru_next;
+	else
+		cache.lru_head = entry->lru_next;
+	if (entry->lru_next)
+		entry->lru_next->lru_prev = entry->lru_prev;
+	else
+		cache.lru_tail = entry->lru_prev;
+}
+
+static void lru_push(struct plancache_entry *entry)
+{
+	entry->lru_prev = NULL;
+	entry->lru_next = cache.lru_head;
+	if (cache.lru_head)
+		cache.lru_head->lru_prev = entry;
+	else
+		cache.lru_tail = entry;
+	cache.lru_head = entry;
+}
+
+static void free_entry(struct plancache_entry *entry)
+{
+	mem_root_clear(&entry->mem_root);
+	free(entry);
+}
+
+/* Take an entry out of the cache, freeing it unless a portal still uses it.
+ * Called with the lock held. */
+static void remove_entry(struct plancache_entry *entry)
+{
+	struct plancache_entry **link = &cache.buckets[entry->hash % NBUCKETS];
+
+	while (*link != entry)
+		link = &(*link)->next;
+	*link = entry->next;
+	lru_unlink(entry);
+	cache.nentries--;
+	cache.nbytes -= mem_root_reserved(&entry->mem_root);
+	entry->cached = 0;
+	if (entry->refs == 0)
+		free_entry(entry);
+}
+
+static struct plancache_entry *lookup(const char *key, u32 hash)
+{
+	struct plancache_entry *entry;
+
+	for (entry = cache.buckets[hash % NBUCKETS]; entry;
+	     entry = entry->next) {
+		if (entry->hash == hash && strcmp(entry->key, key) == 0)
+			return entry;
+	}
+	return NULL;
+}
+
+static void insert(struct plancache_entry *entry)
+{
+	struct plancache_entry **bucket;
+
+	bucket	      = &cache.buckets[entry->hash % NBUCKETS];
+	entry->next   = *bucket;
+	entry->cached = 1;
+	*bucket	      = entry;
+	lru_push(entry);
+	cache.nentries++;
+	cache.nbytes += mem_root_reserved(&entry->mem_root);
+	while (cache.nentries > PLANCACHE_MAX_ENTRIES ||
+	       (cache.nbytes > PLANCACHE_MAX_BYTES && cache.lru_tail != entry))
+		remove_entry(cache.lru_tail);
+}
+
+int plancache_parse(const char *query, void **query_tree,
+		    struct plancache_entry **entry)
+{
+	struct plancache_entry *found;
+	struct plancache_entry *new_entry;
+	struct mem_root	       *previous;
+	char		       *key;
+	size_t			len;
+	u32			hash;
+	u64			generation;
+	int			rc;
+
+	key  = mem_alloc(strlen(query) + 1);
+	len  = normalize(query, key);
+	hash = hash_key(key, len);
+
+	pthread_mutex_lock(&cache.lock);
+	found = lookup(key, hash);
+	if (found) {
+		found->refs++;
+		lru_unlink(found);
+		lru_push(found);
+	}
+	generation = cache.generation;
+	pthread_mutex_unlock(&cache.lock);
+	if (found) {
+		*query_tree = found->query_tree;
+		*entry	    = found;
+		return 0;
+	}
+
+	/* the tree is parsed from its own copy of the text, as it may point
+	 * into it */
+	new_entry = calloc(1, sizeof(struct plancache_entry));
+	if (new_entry == NULL)
+		exit(EXIT_FAILURE);
+	mem_root_init(&new_entry->mem_root);
+	previous	= mem_root_set(&new_entry->mem_root);
+	new_entry->key	= strcpy(mem_alloc(len + 1), key);
+	new_entry->hash = hash;
+	new_entry->refs = 1;
+	rc = parse_query(strcpy(mem_alloc(strlen(query) + 1), query),
+			 &new_entry->query_tree);
+	mem_root_set(previous);
+	if (rc) {
+		free_entry(new_entry);
+		return 1;
+	}
+
+	/* only selects are worth keeping, the other commands change what
+	 * they run on */
+	pthread_mutex_lock(&cache.lock);
+	if (*(u8 *)new_entry->query_tree == COM_SELECT &&
+	    generation == cache.generation && lookup(key, hash) == NULL)
+		insert(new_entry);
+	pthread_mutex_unlock(&cache.lock);
+
+	*query_tree = new_entry->query_tree;
+	*entry	    = new_entry;
+	return 0;
+}
+
+void plancache_release(struct plancache_entry *entry)
+{
+	pthread_mutex_lock(&cache.lock);
+	if (--entry->refs == 0 && !entry->cached)
+		free_entry(entry);
+	pthread_mutex_unlock(&cache.lock);
+}
+
+void plancache_invalidate(void)
+{
+	pthread_mutex_lock(&cache.lock);
+	while (cache.lru_head)
+		remove_entry(cache.lru_head);
+	cache.generation++;
+	pthread_mutex_unlock(&cache.lock);
+}
@@ -0,0 +1,27 @@
+/* Cache of the query trees of simple queries, shared by all connections */
+
+#ifndef PLANCACHE_H
+#define PLANCACHE_H
+
+#include "univ.h"
+
+/* Bounds of the cache, beyond which the least recently used trees are
+ * evicted */
+#define PLANCACHE_MAX_ENTRIES 256
+#define PLANCACHE_MAX_BYTES (16 * 1024 * 1024)
+
+struct plancache_entry;
+
+/* Get the query tree of a query, parsing it on a miss. Queries differing only
+ * in blanks outside of quotes share their tree. The tree is held in entry and
+ * must not be modified. Returns nonzero if the query could not be parsed. */
+int plancache_parse(const char *query, void **query_tree,
+		    struct plancache_entry **entry);
+
+/* Let go of a tree obtained from plancache_parse */
+void plancache_release(struct plancache_entry *entry);
+
+/* Drop every tree, as a change to the catalog may change what queries mean */
+void plancache_invalidate(void);
+
+#endif // PLANCACHE_H
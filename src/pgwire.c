@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -11,24 +12,52 @@
 #include <unistd.h>
 
 #include "connection.h"
-#include "executor/select.h"
+#include "executor/copy.h"
 #include "executor/create.h"
+#include "executor/insert.h"
+#include "executor/select.h"
 #include "util/mem.h"
+#include "parser/lex.h"
 #include "parser/parser.h"
 #include "util/bytes.h"
 #include "util/error.h"
+#include "util/num.h"
 #include "dtype.h"
 
 enum tag {
+	/* Backend messages */
 	TAG_AUTHENTICATION_REQUEST = 'R',
 	TAG_PARAMETER_STATUS	   = 'S',
 	TAG_ERROR_RESPONSE	   = 'E',
-	TAG_QUERY		   = 'Q',
 	TAG_ROW_DESCRIPTION	   = 'T',
 	TAG_DATA_ROW		   = 'D',
 	TAG_COMMAND_COMPLETE	   = 'C',
+	TAG_EMPTY_QUERY_RESPONSE   = 'I',
 	TAG_READY_FOR_QUERY	   = 'Z',
-	TAG_TERMINATE		   = 'X'
+	TAG_PARSE_COMPLETE	   = '1',
+	TAG_BIND_COMPLETE	   = '2',
+	TAG_CLOSE_COMPLETE	   = '3',
+	TAG_NO_DATA		   = 'n',
+	TAG_PARAMETER_DESCRIPTION  = 't',
+	TAG_PORTAL_SUSPENDED	   = 's',
+	TAG_COPY_IN_RESPONSE	   = 'G',
+	TAG_COPY_OUT_RESPONSE	   = 'H',
+
+	/* Frontend messages */
+	TAG_QUERY    = 'Q',
+	TAG_PARSE    = 'P',
+	TAG_BIND     = 'B',
+	TAG_DESCRIBE = 'D',
+	TAG_EXECUTE  = 'E',
+	TAG_CLOSE    = 'C',
+	TAG_SYNC     = 'S',
+	TAG_FLUSH    = 'H',
+	TAG_COPY_FAIL = 'f',
+
+	/* Sent by both sides */
+	TAG_COPY_DATA = 'd',
+	TAG_COPY_DONE = 'c',
+	TAG_TERMINATE = 'X'
 };
 
 struct protocol_version {
@@ -59,54 +88,134 @@ struct message {
 	u8   *payload;
 };
 
+/* Refill the receive buffer from the socket. If no data is available yet, any
+ * buffered output is flushed first, since the client may be waiting for it
+ * before sending more. */
+static int recv_more(struct conn *conn)
+{
+	ssize_t nread;
+
+	if (conn->recvbuf_start > 0) {
+		memmove(conn->recvbuf, conn->recvbuf + conn->recvbuf_start,
+			conn->recvbuf_end - conn->recvbuf_start);
+		conn->recvbuf_end -= conn->recvbuf_start;
+		conn->recvbuf_start = 0;
+	}
+
+	nread = recv(conn->socket, conn->recvbuf + conn->recvbuf_end,
+		     CONN_BUFFER_SIZE - conn->recvbuf_end, MSG_DONTWAIT);
+	if (nread < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+		if (pgwire_flush(conn))
+			return 1;
+		nread = recv(conn->socket, conn->recvbuf + conn->recvbuf_end,
+			     CONN_BUFFER_SIZE - conn->recvbuf_end, 0);
+	}
+	if (nread <= 0)
+		return 1;
+	conn->recvbuf_end += nread;
+	return 0;
+}
+
+static int recv_bytes(struct conn *conn, u8 *dst, size_t len)
+{
+	size_t n;
+
+	while (len > 0) {
+		if (conn->recvbuf_start == conn->recvbuf_end && recv_more(conn))
+			return 1;
+		n = conn->recvbuf_end - conn->recvbuf_start;
+		if (n > len)
+			n = len;
+		memcpy(dst, conn->recvbuf + conn->recvbuf_start, n);
+		conn->recvbuf_start += n;
+		dst += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int send_bytes(struct conn *conn, const u8 *src, size_t len)
+{
+	ssize_t nwritten;
+
+	while (len > 0) {
+		nwritten = write(conn->socket, src, len);
+		if (nwritten < 0 && errno == EINTR)
+			continue;
+		if (nwritten <= 0)
+			return 1;
+		src += nwritten;
+		len -= nwritten;
+	}
+	return 0;
+}
+
+int pgwire_flush(struct conn *conn)
+{
+	size_t len = conn->sendbuf_len;
+
+	conn->sendbuf_len = 0;
+	return send_bytes(conn, conn->sendbuf, len);
+}
+
 static u32 pgwire_read_packet_length(struct conn *conn)
 {
 	u8   buf[4];
 	u32  len;
 
-	if (read(conn->socket, buf, 4) < 4)
+	if (recv_bytes(conn, buf, 4))
 		return 0;
 	if (!ut_read_4(buf, &len))
 		return 0;
 	return len;
 }
 
+/* Read a message from the client. Its payload is allocated on the current
+ * memory root. */
 static int read_message(struct conn *conn, struct message *message)
 {
-	ssize_t nread;
-	u32	payload_len;
+	u32 payload_len;
 
-	nread = read(conn->socket, &message->type, 1);
-	if (nread < 1)
+	if (recv_bytes(conn, &message->type, 1))
 		return 1;
 
 	message->len = pgwire_read_packet_length(conn);
-	if (message->len == 0)
+	if (message->len < sizeof(message->len))
 		return 1;
 
 	payload_len	 = message->len - sizeof(message->len);
-	message->payload = malloc(payload_len);
-	nread		 = read(conn->socket, message->payload, payload_len);
-	if (nread < payload_len) {
-		free(message->payload);
-		return 1;
-	}
-	return 0;
+	message->payload = mem_alloc(payload_len);
+	return recv_bytes(conn, message->payload, payload_len);
 }
 
+/* Queue a message in the send buffer. Messages are only written to the socket
+ * when the buffer fills up or is explicitly flushed, so that the responses to
+ * a pipeline of queries go out together. */
 static int write_message(struct conn *conn, struct message *message)
 {
-	u8   buf[4];
-	u32  payload_len;
+	u32 payload_len = message->len - sizeof(message->len);
+	u8 *ptr;
 
-	if (write(conn->socket, &message->type, 1) < 1)
-		return 1;
-	ut_write_4(buf, message->len);
-	if (write(conn->socket, buf, 4) < 4)
-		return 1;
-	payload_len = message->len - sizeof(message->len);
-	if (write(conn->socket, message->payload, payload_len) < payload_len)
-		return 1;
+	if (conn->sendbuf_len + 1 + message->len > CONN_BUFFER_SIZE) {
+		if (pgwire_flush(conn))
+			return 1;
+	}
+
+	ptr    = conn->sendbuf + conn->sendbuf_len;
+	*ptr++ = message->type;
+	ptr    = ut_write_4(ptr, message->len);
+	conn->sendbuf_len += 1 + sizeof(message->len);
+
+	if (1 + message->len > CONN_BUFFER_SIZE) {
+		/* Too large to buffer, send it directly */
+		if (pgwire_flush(conn))
+			return 1;
+		return send_bytes(conn, message->payload, payload_len);
+	}
+
+	if (payload_len > 0)
+		memcpy(ptr, message->payload, payload_len);
+	conn->sendbuf_len += payload_len;
 	return 0;
 }
 
@@ -151,7 +260,7 @@ int pgwire_flush_errors(struct conn *conn)
 int pgwire_send_error(struct conn *conn, struct err *err)
 {
 	struct message message;
-	u8	       buffer[1024];
+	u8	       buffer[ERR_MESSAGE_SIZE + 1024];
 	u8	      *ptr;
 
 	message.type = TAG_ERROR_RESPONSE;
@@ -175,7 +284,7 @@ int pgwire_send_error(struct conn *conn, struct err *err)
 	}
 	if (err->position > 0) {
 		char buffer[1024];
-		sprintf(buffer, "%lu", err->position);
+		sprintf(buffer, "%lu", err->position + conn->query_offset);
 		*ptr++ = 'P';
 		ptr    = ut_write_str(ptr, buffer);
 	}
@@ -196,8 +305,7 @@ int pgwire_send_error(struct conn *conn, struct err *err)
 	*ptr++ = '\0';
 
 	message.len	= (ptr - buffer) + sizeof(message.len);
-	message.payload = malloc(ptr - buffer);
-	memcpy(message.payload, buffer, ptr - buffer);
+	message.payload = buffer;
 	return write_message(conn, &message);
 }
 
@@ -208,10 +316,13 @@ static int read_startup_message(struct conn	       *conn,
 	u8	   *buf;
 	const u8   *ptr;
 
-	len = pgwire_read_packet_length(conn) - sizeof(len);
+	len = pgwire_read_packet_length(conn);
+	if (len < sizeof(len))
+		return 1;
+	len -= sizeof(len);
 	buf = malloc(len);
 
-	if (read(conn->socket, buf, len) < len)
+	if (recv_bytes(conn, buf, len))
 		goto err;
 
 	if ((ptr = ut_read_4(buf, (u32 *)&message->protocol_version)) == NULL)
@@ -241,10 +352,11 @@ err:
 static int write_auth_ok(struct conn *conn)
 {
 	struct message message;
+	u8	       payload[4];
 
 	message.type	= TAG_AUTHENTICATION_REQUEST;
 	message.len	= 8;
-	message.payload = malloc(4);
+	message.payload = payload;
 	ut_write_4(message.payload, 0);
 
 	return write_message(conn, &message);
@@ -260,7 +372,7 @@ static int write_parameter_status(struct conn *conn, const char *key,
 
 	message.type	= TAG_PARAMETER_STATUS;
 	message.len	= sizeof(message.len) + keylen + vallen;
-	message.payload = malloc(keylen + vallen);
+	message.payload = mem_alloc(keylen + vallen);
 	ptr		= message.payload;
 	ptr		= ut_write_str(ptr, key);
 	ptr		= ut_write_str(ptr, val);
@@ -283,7 +395,9 @@ static int pgwire_close(struct conn *conn)
 	message.type	= TAG_TERMINATE;
 	message.payload = NULL;
 	message.len	= sizeof(message.len);
-	return write_message(conn, &message);
+	if (write_message(conn, &message))
+		return 1;
+	return pgwire_flush(conn);
 }
 
 static int pgwire_startup(struct conn *conn)
@@ -308,39 +422,84 @@ static int pgwire_startup(struct conn *conn)
 static int pgwire_ready_for_query(struct conn *conn)
 {
 	struct message message;
+	u8	       status = 'I';
 
 	conn->state = CONN_IDLE;
 
-	message.type	   = TAG_READY_FOR_QUERY;
-	message.len	   = 5;
-	message.payload	   = malloc(1);
-	message.payload[0] = 'I';
+	message.type	= TAG_READY_FOR_QUERY;
+	message.len	= 5;
+	message.payload = &status;
 	return write_message(conn, &message);
 }
 
-int pgwire_read_query(struct conn *conn)
+/* Read the fields of a message received from the client. Each returns nonzero
+ * if the field would extend past the end of the payload. */
+static int msg_read_2(struct message *message, u32 *off, u16 *val)
 {
-	struct message message;
+	if (*off + 2 > message->len - sizeof(message->len))
+		return 1;
+	ut_read_2(message->payload + *off, val);
+	*off += 2;
+	return 0;
+}
+
+static int msg_read_4(struct message *message, u32 *off, u32 *val)
+{
+	if (*off + 4 > message->len - sizeof(message->len))
+		return 1;
+	ut_read_4(message->payload + *off, val);
+	*off += 4;
+	return 0;
+}
+
+static int msg_read_str(struct message *message, u32 *off, const char **str)
+{
+	u32 payload_len = message->len - sizeof(message->len);
+	u8 *end;
 
-	if (read_message(conn, &message))
+	if (*off >= payload_len)
 		return 1;
-	if (message.type != 'Q')
+	end = memchr(message->payload + *off, '\0', payload_len - *off);
+	if (end == NULL)
 		return 1;
-	conn->query = (char *)message.payload;
+	*str = (const char *)message->payload + *off;
+	*off = end - message->payload + 1;
 	return 0;
 }
 
+static int invalid_message(struct message *message)
+{
+	errlog(ERROR, errcode(ER_PROTOCOL_VIOLATION),
+	       errmsg("Invalid message format"),
+	       errdetail("Message was truncated or malformed"));
+	return 1;
+}
+
+static int write_empty_message(struct conn *conn, u8 type)
+{
+	struct message message;
+
+	message.type	= type;
+	message.len	= sizeof(message.len);
+	message.payload = NULL;
+	return write_message(conn, &message);
+}
+
+/* The message is allocated on the current memory root, sized for the name of
+ * each field and the 18 bytes that follow it */
 int pgwire_send_metadata(struct conn *conn, struct pgwire_rowdesc *row_desc)
 {
 	struct message message;
-	u8	       buffer[1024];
+	size_t	       len = 2;
 	u8	      *ptr;
 	int	       i;
 
-	message.type = TAG_ROW_DESCRIPTION;
+	for (i = 0; i < row_desc->numfields; ++i)
+		len += strlen(row_desc->fields[i].col) + 1 + 18;
 
-	ptr = buffer;
-	ptr = ut_write_2(ptr, row_desc->numfields);
+	message.type	= TAG_ROW_DESCRIPTION;
+	message.payload = mem_alloc(len);
+	ptr		= ut_write_2(message.payload, row_desc->numfields);
 	for (i = 0; i < row_desc->numfields; ++i) {
 		const struct pgwire_fielddesc *field = &row_desc->fields[i];
 		ptr = ut_write_str(ptr, field->col);
@@ -352,50 +511,7 @@ int pgwire_send_metadata(struct conn *conn, struct pgwire_rowdesc *row_desc)
 		ptr = ut_write_2(ptr, field->format);
 	}
 
-	message.payload = malloc(ptr - buffer);
-	memcpy(message.payload, buffer, ptr - buffer);
-	message.len = (ptr - buffer) + sizeof(message.len);
-
-	return write_message(conn, &message);
-}
-
-int pgwire_send_data(struct conn *conn, struct pgwire_datarow *row)
-{
-	struct message message;
-	u8	       buffer[1024];
-	u8	      *ptr;
-	int	       i;
-
-	message.type = TAG_DATA_ROW;
-
-	ptr = buffer;
-	ptr = ut_write_2(ptr, row->numfields);
-	for (i = 0; i < row->numfields; ++i) {
-		const struct pgwire_datarow_field *field = &row->fields[i];
-		ptr = ut_write_4(ptr, field->fieldlen);
-		memcpy(ptr, field->data, field->fieldlen);
-		ptr += field->fieldlen;
-	}
-
-	message.payload = malloc(ptr - buffer);
-	memcpy(message.payload, buffer, ptr - buffer);
-	message.len = (ptr - buffer) + sizeof(message.len);
-
-	return write_message(conn, &message);
-}
-
-static int pgwire_complete_command(struct conn *conn, void *query_tree)
-{
-	struct message message;
-
-	message.type	= TAG_COMMAND_COMPLETE;
-	if (*(u8 *)query_tree == COM_SELECT) {
-		message.payload = (u8 *)"SELECT 1";
-	} else {
-		assert(*(u8 *)query_tree == COM_CREATE);
-		message.payload = (u8 *)"CREATE TABLE";
-	}
-	message.len = strlen((char *)message.payload) + 1 + sizeof(message.len);
+	message.len = (ptr - message.payload) + sizeof(message.len);
 
 	return write_message(conn, &message);
 }
@@ -432,110 +548,784 @@ static void make_row_desc(struct select *select, struct pgwire_rowdesc *rowdesc)
 		rowdesc->fields[colno].typeoid = col->typeoid;
 		rowdesc->fields[colno].typelen = dtype_len(col->typeoid, -1);
 		rowdesc->fields[colno].typmod  = col->typemod;
-		rowdesc->fields[colno].format  = 0;
+		rowdesc->fields[colno].format  = FORMAT_TEXT;
 	}
 }
 
-static void to_text(u32 typeoid, i32 typemod, const u8 *data, char **out)
+/* Upper bound of the length of the text of a field, with a terminating NUL,
+ * which also bounds its binary representation */
+static size_t text_width(u32 typeoid, const struct row_field *field)
 {
-	*out = mem_alloc(1024);
 	switch (typeoid) {
 	case DTYPE_INT2:
+		return sizeof("-32768");
 	case DTYPE_INT4:
+		return sizeof("-2147483648");
 	case DTYPE_INT8:
-		snprintf(*out, 1024, "%d", *(int *)data);
+		return sizeof("-9223372036854775808");
+	case DTYPE_FLOAT8:
+		return 32;
+	default:
+		return field->len + 1;
+	}
+}
+
+/* Write the length and the text of a field */
+static u8 *to_text(u32 typeoid, const struct row_field *field, u8 *ptr)
+{
+	char  *text = (char *)ptr + 4;
+	size_t len  = 0;
+	i16    v2;
+	i32    v4;
+	i64    v8;
+	double f8;
+	int    prec;
+
+	switch (typeoid) {
+	case DTYPE_INT2:
+		memcpy(&v2, field->data, sizeof(v2));
+		len = ut_format_int(text, v2) - text;
+		break;
+	case DTYPE_INT4:
+		memcpy(&v4, field->data, sizeof(v4));
+		len = ut_format_int(text, v4) - text;
+		break;
+	case DTYPE_INT8:
+		memcpy(&v8, field->data, sizeof(v8));
+		len = ut_format_int(text, v8) - text;
+		break;
+	case DTYPE_FLOAT8:
+		/* the shortest representation reading back as the same value */
+		memcpy(&f8, field->data, sizeof(f8));
+		for (prec = 1; prec < 17; ++prec) {
+			len = snprintf(text, 32, "%.*g", prec, f8);
+			if (strtod(text, NULL) == f8)
+				break;
+		}
+		if (prec == 17)
+			len = snprintf(text, 32, "%.17g", f8);
 		break;
 	case DTYPE_CHAR:
-		snprintf(*out, typemod + 1, "%s", (char *)data);
+		/* values fill the whole field when they are not NUL-padded */
+		len = strnlen((const char *)field->data, field->len);
+		memcpy(text, field->data, len);
 		break;
 	default:
 		errlog(PANIC, errmsg("Serialization for dtype %u not implemented", typeoid));
 		break;
 	}
+	ut_write_4(ptr, len);
+	return (u8 *)text + len;
 }
 
-static void serialize_row(struct pgwire_rowdesc *rowdesc, struct row *row,
-			  struct pgwire_datarow *dr)
+static u8 *to_binary(u32 typeoid, const struct row_field *field, u8 *ptr)
 {
-	int colno;
+	i16    v2;
+	i32    v4;
+	i64    v8;
+	size_t len;
 
-	dr->numfields = row->nfields;
-	dr->fields =
-		mem_alloc(sizeof(struct pgwire_datarow_field) * row->nfields);
-	for (colno = 0; colno < row->nfields; ++colno) {
-		to_text(rowdesc->fields[colno].typeoid,
-			rowdesc->fields[colno].typmod, row->fields[colno].data,
-			(char **)&dr->fields[colno].data);
-		dr->fields[colno].fieldlen =
-			strlen((char *)dr->fields[colno].data);
+	switch (typeoid) {
+	case DTYPE_INT2:
+		memcpy(&v2, field->data, sizeof(v2));
+		ptr = ut_write_4(ptr, sizeof(v2));
+		return ut_write_2(ptr, v2);
+	case DTYPE_INT4:
+		memcpy(&v4, field->data, sizeof(v4));
+		ptr = ut_write_4(ptr, sizeof(v4));
+		return ut_write_4(ptr, v4);
+	case DTYPE_INT8:
+		memcpy(&v8, field->data, sizeof(v8));
+		ptr = ut_write_4(ptr, sizeof(v8));
+		return ut_write_8(ptr, v8);
+	case DTYPE_FLOAT8:
+		memcpy(&v8, field->data, sizeof(v8));
+		ptr = ut_write_4(ptr, sizeof(v8));
+		return ut_write_8(ptr, v8);
+	case DTYPE_CHAR:
+		len = strnlen((const char *)field->data, field->len);
+		ptr = ut_write_4(ptr, len);
+		memcpy(ptr, field->data, len);
+		return ptr + len;
+	default:
+		errlog(PANIC, errmsg("Serialization for dtype %u not implemented",
+				     typeoid));
+		return ptr;
 	}
 }
 
-static int pgwire_execute_command(struct conn *conn)
+/* Write the fields of a DataRow message */
+static u8 *write_row(const struct pgwire_rowdesc *rowdesc,
+		     const struct row *row, u8 *ptr)
 {
-	void		     *query_tree;
-	struct cursor	      cur;
-	struct pgwire_rowdesc rowdesc;
+	const struct pgwire_fielddesc *desc;
+	int			       i;
+
+	ptr = ut_write_2(ptr, row->nfields);
+	for (i = 0; i < row->nfields; ++i) {
+		desc = &rowdesc->fields[i];
+		if (row->fields[i].data == NULL)
+			ptr = ut_write_4(ptr, -1);
+		else if (desc->format == FORMAT_BINARY)
+			ptr = to_binary(desc->typeoid, &row->fields[i], ptr);
+		else
+			ptr = to_text(desc->typeoid, &row->fields[i], ptr);
+	}
+	return ptr;
+}
 
-	assert(conn->query);
-	assert(conn->state == CONN_IDLE);
+/* Rows are encoded straight into the send buffer, in a single pass over their
+ * fields. Only rows that could not fit in the buffer are encoded apart, on
+ * the current memory root, and sent on their own. */
+int pgwire_send_data(struct conn *conn, struct pgwire_rowdesc *rowdesc,
+		     struct row *row)
+{
+	struct message message;
+	size_t	       bound = 2;
+	u8	      *start;
+	u8	      *end;
+	int	       i;
 
-	conn->state = CONN_RUN;
+	for (i = 0; i < row->nfields; ++i)
+		bound += 4 + text_width(rowdesc->fields[i].typeoid,
+					&row->fields[i]);
 
-	if (parse(conn, &query_tree))
+	if (1 + sizeof(message.len) + bound > CONN_BUFFER_SIZE) {
+		message.type	= TAG_DATA_ROW;
+		message.payload = mem_alloc(bound);
+		end		= write_row(rowdesc, row, message.payload);
+		message.len	= (end - message.payload) + sizeof(message.len);
+		return write_message(conn, &message);
+	}
+
+	if (conn->sendbuf_len + 1 + sizeof(message.len) + bound >
+	    CONN_BUFFER_SIZE) {
+		if (pgwire_flush(conn))
+			return 1;
+	}
+	start  = conn->sendbuf + conn->sendbuf_len;
+	end    = write_row(rowdesc, row, start + 1 + sizeof(message.len));
+	*start = TAG_DATA_ROW;
+	ut_write_4(start + 1, end - start - 1);
+	conn->sendbuf_len = end - conn->sendbuf;
+	return 0;
+}
+
+static int pgwire_complete_command(struct conn		*conn,
+				   struct pgwire_portal *portal)
+{
+	struct message message;
+	char	       tag[64];
+
+	message.type = TAG_COMMAND_COMPLETE;
+	if (*(u8 *)portal->query_tree == COM_SELECT) {
+		snprintf(tag, sizeof(tag), "SELECT %llu",
+			 (unsigned long long)portal->nrows);
+	} else if (*(u8 *)portal->query_tree == COM_COPY) {
+		snprintf(tag, sizeof(tag), "COPY %llu",
+			 (unsigned long long)portal->nrows);
+	} else if (*(u8 *)portal->query_tree == COM_INSERT) {
+		snprintf(tag, sizeof(tag), "INSERT 0 %llu",
+			 (unsigned long long)portal->nrows);
+	} else {
+		assert(*(u8 *)portal->query_tree == COM_CREATE);
+		strcpy(tag, "CREATE TABLE");
+	}
+	message.payload = (u8 *)tag;
+	message.len	= strlen(tag) + 1 + sizeof(message.len);
+
+	return write_message(conn, &message);
+}
+
+/* Apply the result format codes requested in a Bind message. Zero codes means
+ * all text, a single code applies to every field, otherwise there must be one
+ * code per field. */
+static int set_result_formats(struct pgwire_rowdesc *rowdesc,
+			      struct message *message, u32 *off)
+{
+	u16 nformats;
+	u16 format = FORMAT_TEXT;
+	int i;
+
+	if (msg_read_2(message, off, &nformats))
+		return invalid_message(message);
+	if (nformats > 1 && nformats != rowdesc->numfields) {
+		errlog(ERROR, errcode(ER_PROTOCOL_VIOLATION),
+		       errmsg("Bind message has %u result formats but query has %u columns",
+			      nformats, rowdesc->numfields));
+		return 1;
+	}
+	for (i = 0; i < rowdesc->numfields; ++i) {
+		if (i < nformats && msg_read_2(message, off, &format))
+			return invalid_message(message);
+		if (format != FORMAT_TEXT && format != FORMAT_BINARY) {
+			errlog(ERROR, errcode(ER_PROTOCOL_VIOLATION),
+			       errmsg("Unsupported format code: %u", format));
+			return 1;
+		}
+		rowdesc->fields[i].format = format;
+	}
+	return 0;
+}
+
+static struct pgwire_portal *find_portal(struct conn *conn, const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < conn->portals.size; ++i) {
+		struct pgwire_portal *portal = conn->portals.data[i];
+		if (strcmp(portal->name, name) == 0)
+			return portal;
+	}
+	return NULL;
+}
+
+/* Stop a portal that has not run to completion, and let go of its query
+ * tree */
+static void close_portal(struct pgwire_portal *portal)
+{
+	if (portal->started && !portal->done &&
+	    *(u8 *)portal->query_tree == COM_SELECT)
+		cursor_close(&portal->cur);
+	portal->done = 1;
+	if (portal->cached)
+		plancache_release(portal->cached);
+	portal->cached = NULL;
+}
+
+static void drop_portal(struct conn *conn, struct pgwire_portal *portal)
+{
+	size_t i;
+
+	close_portal(portal);
+	for (i = 0; i < conn->portals.size; ++i) {
+		if (conn->portals.data[i] != portal)
+			continue;
+		conn->portals.data[i] =
+			conn->portals.data[conn->portals.size - 1];
+		conn->portals.size--;
+		break;
+	}
+}
+
+/* Create a portal for the query in conn->query, taking its tree from the plan
+ * cache if cached is set. Any existing unnamed portal is replaced. */
+static struct pgwire_portal *create_portal(struct conn *conn, const char *name,
+					   int cached)
+{
+	struct pgwire_portal   *portal;
+	struct plancache_entry *entry = NULL;
+	void		       *query_tree;
+
+	portal = find_portal(conn, name);
+	if (portal != NULL && name[0] != '\0') {
+		errlog(ERROR, errcode(ER_DUPLICATE_CURSOR),
+		       errmsg("Portal %s already exists", name));
+		return NULL;
+	}
+	if (portal != NULL)
+		drop_portal(conn, portal);
+
+	if (cached ? plancache_parse(conn->query, &query_tree, &entry) :
+		     parse(conn, &query_tree))
+		return NULL;
+
+	portal		   = mem_zalloc(sizeof(struct pgwire_portal));
+	portal->name	   = mem_alloc(strlen(name) + 1);
+	portal->query_tree = query_tree;
+	portal->cached	   = entry;
+	strcpy((char *)portal->name, name);
+	if (*(u8 *)query_tree == COM_SELECT)
+		make_row_desc(query_tree, &portal->rowdesc);
+	vec_push(&conn->portals, portal);
+	return portal;
+}
+
+/* Send a CopyInResponse or CopyOutResponse describing the format of the
+ * data */
+static int write_copy_response(struct conn *conn, u8 type, struct copy *copy)
+{
+	struct message message;
+	u8	      *ptr;
+	u16	       colno;
+
+	message.type	= type;
+	message.len	= sizeof(message.len) + 3 + 2 * copy->table->ncols;
+	message.payload = mem_alloc(message.len - sizeof(message.len));
+	ptr		= message.payload;
+	*ptr++		= copy->format == COPY_FORMAT_BINARY ? FORMAT_BINARY :
+							      FORMAT_TEXT;
+	ptr		= ut_write_2(ptr, copy->table->ncols);
+	for (colno = 0; colno < copy->table->ncols; ++colno)
+		ptr = ut_write_2(ptr, message.payload[0]);
+	return write_message(conn, &message);
+}
+
+/* Stream the rows of a table to the client in CopyData messages, each packed
+ * with as many rows as fit in a chunk */
+static int pgwire_copy_out(struct conn *conn, struct pgwire_portal *portal)
+{
+	struct copy	*copy = portal->query_tree;
+	struct copy_out	 out;
+	struct message	 message;
+	size_t		 len;
+
+	if (write_copy_response(conn, TAG_COPY_OUT_RESPONSE, copy))
 		return 1;
 
-	if (*(u8 *)query_tree == COM_SELECT) {
-		if (sql_select(query_tree, &cur))
+	message.type	= TAG_COPY_DATA;
+	message.payload = mem_alloc(COPY_CHUNK_SIZE);
+
+	copy_out_begin(&out, copy);
+	while ((len = copy_out_next(&out, message.payload)) > 0) {
+		message.len = sizeof(message.len) + len;
+		if (write_message(conn, &message)) {
+			copy_out_end(&out);
 			return 1;
+		}
+	}
+	copy_out_end(&out);
+	portal->nrows = out.nrows;
 
-		make_row_desc(query_tree, &rowdesc);
-		if (pgwire_send_metadata(conn, &rowdesc))
+	return write_empty_message(conn, TAG_COPY_DONE);
+}
+
+/* Load the rows sent by the client in CopyData messages into a table. After
+ * an error the remaining messages are discarded up to CopyDone or CopyFail, so
+ * the connection stays in sync with the client. */
+static int pgwire_copy_in(struct conn *conn, struct pgwire_portal *portal)
+{
+	struct copy_in	 in;
+	struct message	 message;
+	struct mem_root *previous;
+	const char	*reason;
+	u32		 off;
+	int		 err  = 0;
+	int		 done = 0;
+	int		 rc;
+
+	if (write_copy_response(conn, TAG_COPY_IN_RESPONSE,
+				portal->query_tree))
+		return 1;
+
+	copy_in_begin(&in, portal->query_tree);
+	while (!done) {
+		/* the data is only needed until it is loaded */
+		previous = mem_root_set(&conn->row_mem);
+		rc	 = read_message(conn, &message);
+		mem_root_set(previous);
+		if (rc) {
+			copy_in_abort(&in);
 			return 1;
+		}
 
-		for (;;) {
-			struct row	      row;
-			struct pgwire_datarow pg_row;
+		switch (message.type) {
+		case TAG_COPY_DATA:
+			if (!err)
+				err = copy_in_data(&in, message.payload,
+						   message.len - sizeof(message.len));
+			break;
+		case TAG_COPY_DONE:
+			done = 1;
+			break;
+		case TAG_COPY_FAIL:
+			off = 0;
+			if (msg_read_str(&message, &off, &reason))
+				reason = "";
+			if (!err)
+				errlog(ERROR, errcode(ER_QUERY_CANCELED),
+				       errmsg("COPY from stdin failed: %s",
+					      reason));
+			err  = 1;
+			done = 1;
+			break;
+		case TAG_FLUSH:
+		case TAG_SYNC:
+			break;
+		default:
+			if (!err)
+				errlog(ERROR, errcode(ER_PROTOCOL_VIOLATION),
+				       errmsg("Unexpected message type 0x%02X "
+					      "during COPY from stdin",
+					      message.type));
+			err  = 1;
+			done = 1;
+			break;
+		}
+		mem_root_reset(&conn->row_mem);
+	}
 
-			if (cursor_next(&cur, &row))
-				break;
+	if (err) {
+		copy_in_abort(&in);
+		return 1;
+	}
+	if (copy_in_end(&in))
+		return 1;
+	portal->nrows = in.nrows;
+	return 0;
+}
 
-			serialize_row(&rowdesc, &row, &pg_row);
-			if (pgwire_send_data(conn, &pg_row))
+/* Run a portal, sending at most maxrows rows (0 for no limit). The portal is
+ * suspended if the limit is reached and can be resumed by executing it
+ * again. */
+static int pgwire_execute_portal(struct conn	      *conn,
+				 struct pgwire_portal *portal, u32 maxrows)
+{
+	struct mem_root *previous;
+	struct row	 row;
+	int		 rc;
+
+	if (!portal->started) {
+		portal->started = 1;
+		if (*(u8 *)portal->query_tree == COM_SELECT) {
+			if (sql_select(portal->query_tree, &portal->cur))
 				return 1;
+		} else if (*(u8 *)portal->query_tree == COM_COPY) {
+			struct copy *copy = portal->query_tree;
+
+			if (copy->from ? pgwire_copy_in(conn, portal) :
+					 pgwire_copy_out(conn, portal))
+				return 1;
+			portal->done = 1;
+		} else if (*(u8 *)portal->query_tree == COM_INSERT) {
+			struct insert *insert = portal->query_tree;
+
+			if (sql_insert(insert))
+				return 1;
+			portal->nrows = insert->nrows;
+			portal->done  = 1;
+		} else {
+			assert(*(u8 *)portal->query_tree == COM_CREATE);
+			if (sql_create_table(portal->query_tree))
+				return 1;
+			portal->done = 1;
 		}
-	} else {
-		assert(*(u8 *)query_tree == COM_CREATE);
+	}
 
-		if (sql_create_table(query_tree))
+	/* like PostgreSQL, the tag of a resumed portal only counts the rows
+	 * of this Execute */
+	if (*(u8 *)portal->query_tree == COM_SELECT)
+		portal->nrows = 0;
+	while (!portal->done) {
+		if (maxrows > 0 && portal->nrows == maxrows)
+			return write_empty_message(conn, TAG_PORTAL_SUSPENDED);
+		rc = cursor_next(&portal->cur, &row);
+		if (rc != 0) {
+			portal->done = 1;
+			if (rc < 0)
+				return 1;
+			break;
+		}
+		/* what serializing a row allocates is released once it is
+		 * sent */
+		previous = mem_root_set(&conn->row_mem);
+		rc	 = pgwire_send_data(conn, &portal->rowdesc, &row);
+		mem_root_set(previous);
+		mem_root_reset(&conn->row_mem);
+		if (rc)
 			return 1;
+		portal->nrows++;
 	}
 
 	pgwire_flush_errors(conn);
 
-	if (pgwire_complete_command(conn, query_tree))
+	return pgwire_complete_command(conn, portal);
+}
+
+static int pgwire_execute_command(struct conn *conn)
+{
+	struct pgwire_portal *portal;
+
+	assert(conn->query);
+
+	conn->state = CONN_RUN;
+
+	portal = create_portal(conn, "", 1);
+	if (portal == NULL)
 		return 1;
 
-	return 0;
+	if (*(u8 *)portal->query_tree == COM_SELECT) {
+		if (pgwire_send_metadata(conn, &portal->rowdesc))
+			return 1;
+	}
+
+	return pgwire_execute_portal(conn, portal, 0);
+}
+
+static void close_portals(struct conn *conn)
+{
+	size_t i;
+
+	for (i = 0; i < conn->portals.size; ++i)
+		close_portal(conn->portals.data[i]);
+	conn->portals.size = 0;
+}
+
+/* End the current query and report to the client that a new one can be
+ * sent. */
+static int pgwire_end_query(struct conn *conn)
+{
+	close_portals(conn);
+	mem_root_reset(&conn->query_mem);
+	return pgwire_ready_for_query(conn);
+}
+
+/* Run the statements of a query string one after the other, each one on
+ * memory released before the next, up to the first that fails. */
+static int pgwire_simple_query(struct conn *conn, struct message *message)
+{
+	const char *query = (const char *)message->payload;
+	size_t	    begin;
+	size_t	    end;
+	int	    nstatements = 0;
+	int	    rc		= 0;
+
+	errlog(DEBUG, errmsg("query: %s", query));
+
+	mem_root_set(&conn->stmt_mem);
+	for (; !rc && *query != '\0'; query += end) {
+		if (!lex_split_statement(query, &begin, &end))
+			continue;
+		nstatements++;
+		conn->query = mem_alloc(end - begin + 1);
+		memcpy(conn->query, query + begin, end - begin);
+		conn->query[end - begin] = '\0';
+		conn->query_offset	 = query + begin - (char *)message->payload;
+
+		rc = pgwire_execute_command(conn);
+		pgwire_flush_errors(conn);
+		close_portals(conn);
+		mem_root_reset(&conn->stmt_mem);
+	}
+	mem_root_set(&conn->query_mem);
+	conn->query	   = NULL;
+	conn->query_offset = 0;
+
+	if (nstatements == 0)
+		write_empty_message(conn, TAG_EMPTY_QUERY_RESPONSE);
+	return pgwire_end_query(conn);
+}
+
+static int pgwire_parse_message(struct conn *conn, struct message *message)
+{
+	const char *name;
+	const char *query;
+	void	   *query_tree;
+	u16	    nparams;
+	u32	    off = 0;
+
+	if (msg_read_str(message, &off, &name) ||
+	    msg_read_str(message, &off, &query) ||
+	    msg_read_2(message, &off, &nparams))
+		return invalid_message(message);
+	errlog(DEBUG, errmsg("parse %s: %s", name, query));
+
+	if (name[0] != '\0' && kvmap_get(&conn->statements, name) != NULL) {
+		errlog(ERROR, errcode(ER_DUPLICATE_PREPARED_STATEMENT),
+		       errmsg("Prepared statement %s already exists", name));
+		return 1;
+	}
+
+	/* Parameter types are accepted but the parser does not support
+	 * parameter references yet. */
+	conn->query = (char *)query;
+	if (parse(conn, &query_tree))
+		return 1;
+
+	kvmap_put(&conn->statements, name, query);
+	return write_empty_message(conn, TAG_PARSE_COMPLETE);
+}
+
+static int pgwire_bind_message(struct conn *conn, struct message *message)
+{
+	const char	     *portal_name;
+	const char	     *stmt_name;
+	const char	     *query;
+	struct pgwire_portal *portal;
+	u16		      nformats;
+	u16		      nparams;
+	u32		      off = 0;
+
+	if (msg_read_str(message, &off, &portal_name) ||
+	    msg_read_str(message, &off, &stmt_name) ||
+	    msg_read_2(message, &off, &nformats))
+		return invalid_message(message);
+	off += 2 * nformats;
+	if (msg_read_2(message, &off, &nparams))
+		return invalid_message(message);
+	if (nparams > 0) {
+		errlog(ERROR, errcode(ER_FEATURE_NOT_SUPPORTED),
+		       errmsg("Bind parameters are not supported"));
+		return 1;
+	}
+
+	query = kvmap_get(&conn->statements, stmt_name);
+	if (query == NULL) {
+		errlog(ERROR, errcode(ER_INVALID_SQL_STATEMENT_NAME),
+		       errmsg("Unknown prepared statement %s", stmt_name));
+		return 1;
+	}
+
+	conn->query = (char *)query;
+	portal	    = create_portal(conn, portal_name, 0);
+	if (portal == NULL)
+		return 1;
+	if (set_result_formats(&portal->rowdesc, message, &off))
+		return 1;
+
+	return write_empty_message(conn, TAG_BIND_COMPLETE);
+}
+
+static int pgwire_describe_message(struct conn *conn, struct message *message)
+{
+	struct pgwire_rowdesc rowdesc;
+	struct pgwire_portal *portal;
+	struct message	      reply;
+	const char	     *name;
+	void		     *query_tree;
+	u8		      params[2];
+	u32		      off = 1;
+
+	if (message->len < sizeof(message->len) + 1 ||
+	    msg_read_str(message, &off, &name))
+		return invalid_message(message);
+
+	switch (message->payload[0]) {
+	case 'S':
+		conn->query = (char *)kvmap_get(&conn->statements, name);
+		if (conn->query == NULL) {
+			errlog(ERROR, errcode(ER_INVALID_SQL_STATEMENT_NAME),
+			       errmsg("Unknown prepared statement %s", name));
+			return 1;
+		}
+		if (parse(conn, &query_tree))
+			return 1;
+
+		reply.type    = TAG_PARAMETER_DESCRIPTION;
+		reply.len     = sizeof(reply.len) + sizeof(params);
+		reply.payload = params;
+		ut_write_2(params, 0);
+		if (write_message(conn, &reply))
+			return 1;
+
+		if (*(u8 *)query_tree != COM_SELECT)
+			return write_empty_message(conn, TAG_NO_DATA);
+		make_row_desc(query_tree, &rowdesc);
+		return pgwire_send_metadata(conn, &rowdesc);
+	case 'P':
+		portal = find_portal(conn, name);
+		if (portal == NULL) {
+			errlog(ERROR, errcode(ER_INVALID_CURSOR_NAME),
+			       errmsg("Unknown portal %s", name));
+			return 1;
+		}
+		if (*(u8 *)portal->query_tree != COM_SELECT)
+			return write_empty_message(conn, TAG_NO_DATA);
+		return pgwire_send_metadata(conn, &portal->rowdesc);
+	default:
+		return invalid_message(message);
+	}
+}
+
+static int pgwire_execute_message(struct conn *conn, struct message *message)
+{
+	struct pgwire_portal *portal;
+	const char	     *name;
+	u32		      maxrows;
+	u32		      off = 0;
+
+	if (msg_read_str(message, &off, &name) ||
+	    msg_read_4(message, &off, &maxrows))
+		return invalid_message(message);
+
+	portal = find_portal(conn, name);
+	if (portal == NULL) {
+		errlog(ERROR, errcode(ER_INVALID_CURSOR_NAME),
+		       errmsg("Unknown portal %s", name));
+		return 1;
+	}
+	return pgwire_execute_portal(conn, portal, maxrows);
+}
+
+static int pgwire_close_message(struct conn *conn, struct message *message)
+{
+	struct pgwire_portal *portal;
+	const char	     *name;
+	u32		      off = 1;
+
+	if (message->len < sizeof(message->len) + 1 ||
+	    msg_read_str(message, &off, &name))
+		return invalid_message(message);
+
+	switch (message->payload[0]) {
+	case 'S':
+		kvmap_put(&conn->statements, name, NULL);
+		break;
+	case 'P':
+		portal = find_portal(conn, name);
+		if (portal != NULL)
+			drop_portal(conn, portal);
+		break;
+	default:
+		return invalid_message(message);
+	}
+	return write_empty_message(conn, TAG_CLOSE_COMPLETE);
+}
+
+static int pgwire_process_message(struct conn *conn, struct message *message)
+{
+	if (message->type != TAG_SYNC)
+		conn->state = CONN_RUN;
+
+	switch (message->type) {
+	case TAG_QUERY:
+		return pgwire_simple_query(conn, message);
+	case TAG_PARSE:
+		return pgwire_parse_message(conn, message);
+	case TAG_BIND:
+		return pgwire_bind_message(conn, message);
+	case TAG_DESCRIBE:
+		return pgwire_describe_message(conn, message);
+	case TAG_EXECUTE:
+		return pgwire_execute_message(conn, message);
+	case TAG_CLOSE:
+		return pgwire_close_message(conn, message);
+	case TAG_SYNC:
+		conn->skip_till_sync = 0;
+		return pgwire_end_query(conn);
+	case TAG_FLUSH:
+		return pgwire_flush(conn);
+	default:
+		errlog(ERROR, errcode(ER_PROTOCOL_VIOLATION),
+		       errmsg("Unexpected message type %c", message->type));
+		return 1;
+	}
 }
 
 void pgwire_handle_connection(struct conn *conn)
 {
+	struct message message;
+
 	pgwire_startup(conn);
 	if (conn->state == CONN_CLOSED)
 		return;
 	assert(conn->state == CONN_IDLE);
 
-	for (;;) {
-		mem_root_clear(&conn->mem_root);
+	pgwire_ready_for_query(conn);
 
-		pgwire_ready_for_query(conn);
-
-		if (pgwire_read_query(conn))
+	for (;;) {
+		if (read_message(conn, &message))
+			break;
+		if (message.type == TAG_TERMINATE)
 			break;
-		errlog(DEBUG, errmsg("query: %s", conn->query));
 
-		pgwire_execute_command(conn);
+		/* After an error in an extended query message, everything up to
+		 * the next Sync is discarded */
+		if (!conn->skip_till_sync || message.type == TAG_SYNC) {
+			if (pgwire_process_message(conn, &message) &&
+			    message.type != TAG_QUERY)
+				conn->skip_till_sync = 1;
+		}
 
 		if (pgwire_flush_errors(conn))
 			break;
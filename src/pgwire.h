@@ -4,9 +4,14 @@
 #define PGWIRE_H
 
 #include "connection.h"
+#include "executor/select.h"
+#include "parser/plancache.h"
 #include "univ.h"
 #include "util/error.h"
 
+/* Format codes of field values */
+enum pgwire_format { FORMAT_TEXT = 0, FORMAT_BINARY = 1 };
+
 struct pgwire_fielddesc {
 	/* The field name. */
 	const char *col;
@@ -55,10 +60,34 @@ struct pgwire_datarow {
 	struct pgwire_datarow_field *fields;
 };
 
+/* A statement bound by the extended query protocol, ready for execution */
+struct pgwire_portal {
+	/* Name of the portal, empty for the unnamed portal */
+	const char *name;
+	/* Transformed query tree of the bound statement */
+	void *query_tree;
+	/* Entry of the plan cache holding the query tree, NULL if the tree
+	 * is on the memory of the query */
+	struct plancache_entry *cached;
+	/* Result row description, with the format requested by the client for
+	 * each field */
+	struct pgwire_rowdesc rowdesc;
+	/* Cursor over the result rows, valid once execution has started */
+	struct cursor cur;
+	/* Whether execution has started, and whether it has completed */
+	int started;
+	int done;
+	/* Number of rows sent by the last Execute, or copied or inserted */
+	u64 nrows;
+};
+
 void pgwire_handle_connection(struct conn *conn);
 
 int pgwire_flush_errors(struct conn *conn);
 
+/* Write out all buffered messages to the client */
+int pgwire_flush(struct conn *conn);
+
 int pgwire_send_error(struct conn *conn, struct err *err);
 
 #endif // PGWIRE_H
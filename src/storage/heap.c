@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -21,12 +22,23 @@ u16 heap_page_slot_count(struct heap_page *page)
 	return (page->free_low - HEAP_HEADER_SIZE) / sizeof(struct heap_slot);
 }
 
+size_t heap_page_free_space(struct heap_page *page)
+{
+	size_t free = page->free_high - page->free_low;
+
+	if (free < sizeof(struct heap_slot))
+		return 0;
+	return free - sizeof(struct heap_slot);
+}
+
 void heap_page_add_tuple(struct heap_page *page, const u8 *data, size_t size)
 {
 	u16		  slotno;
 	struct heap_slot *slot;
 	u8		 *tup;
 
+	assert(size <= heap_page_free_space(page));
+
 	slotno	  = heap_page_slot_count(page);
 	slot	  = &page->slots[slotno];
 	slot->off = page->free_high - size;
@@ -39,6 +51,31 @@ void heap_page_add_tuple(struct heap_page *page, const u8 *data, size_t size)
 	memcpy(tup, data, size);
 }
 
+size_t heap_page_add_tuples(struct heap_page *page, const u8 *data,
+			    size_t size, size_t ntuples)
+{
+	size_t n = (page->free_high - page->free_low) /
+		   (size + sizeof(struct heap_slot));
+	u16    slotno;
+	size_t i;
+
+	if (n > ntuples)
+		n = ntuples;
+	if (n == 0)
+		return 0;
+
+	/* the tuples go in as one block, in the order of their slots */
+	slotno = heap_page_slot_count(page);
+	page->free_high -= n * size;
+	for (i = 0; i < n; ++i) {
+		page->slots[slotno + i].off = page->free_high + i * size;
+		page->slots[slotno + i].sz  = size;
+	}
+	page->free_low += n * sizeof(struct heap_slot);
+	memcpy((u8 *)page + page->free_high, data, n * size);
+	return n;
+}
+
 u16 heap_page_read_tuple(struct heap_page *page, u16 slotno, u8 **data)
 {
 	struct heap_slot *slot;
@@ -51,3 +88,92 @@ u16 heap_page_read_tuple(struct heap_page *page, u16 slotno, u8 **data)
 	*data = tup;
 	return slot->sz;
 }
+
+void heap_init(struct heap *heap)
+{
+	vec_init(&heap->pages, 1);
+	pthread_mutex_init(&heap->lock, NULL);
+}
+
+void heap_add_tuple(struct heap *heap, const u8 *data, size_t size)
+{
+	struct heap_page *page = NULL;
+
+	pthread_mutex_lock(&heap->lock);
+	if (heap->pages.size > 0)
+		page = heap->pages.data[heap->pages.size - 1];
+	if (page == NULL || heap_page_free_space(page) < size) {
+		page = malloc(PAGE_SIZE);
+		heap_page_init(page);
+		vec_push(&heap->pages, page);
+	}
+	heap_page_add_tuple(page, data, size);
+	pthread_mutex_unlock(&heap->lock);
+}
+
+void heap_add_tuples(struct heap *heap, const u8 *data, size_t size,
+		     size_t ntuples)
+{
+	struct heap_page *page;
+	size_t		  n = 0;
+
+	pthread_mutex_lock(&heap->lock);
+	if (heap->pages.size > 0) {
+		page = heap->pages.data[heap->pages.size - 1];
+		n    = heap_page_add_tuples(page, data, size, ntuples);
+	}
+	pthread_mutex_unlock(&heap->lock);
+
+	/* the new pages are filled before the readers can see them */
+	while (n < ntuples) {
+		data += n * size;
+		ntuples -= n;
+		page = malloc(PAGE_SIZE);
+		heap_page_init(page);
+		n = heap_page_add_tuples(page, data, size, ntuples);
+		assert(n > 0);
+		heap_add_page(heap, page);
+	}
+}
+
+void heap_add_page(struct heap *heap, struct heap_page *page)
+{
+	pthread_mutex_lock(&heap->lock);
+	vec_push(&heap->pages, page);
+	pthread_mutex_unlock(&heap->lock);
+}
+
+struct heap_page *heap_get_page(struct heap *heap, size_t pageno, u16 *slotcnt)
+{
+	struct heap_page *page = NULL;
+
+	pthread_mutex_lock(&heap->lock);
+	if (pageno < heap->pages.size) {
+		page	 = heap->pages.data[pageno];
+		*slotcnt = heap_page_slot_count(page);
+	}
+	pthread_mutex_unlock(&heap->lock);
+	return page;
+}
+
+size_t heap_count_pages(struct heap *heap)
+{
+	size_t npages;
+
+	pthread_mutex_lock(&heap->lock);
+	npages = heap->pages.size;
+	pthread_mutex_unlock(&heap->lock);
+	return npages;
+}
+
+size_t heap_count_tuples(struct heap *heap)
+{
+	size_t ntuples = 0;
+	size_t pageno;
+
+	pthread_mutex_lock(&heap->lock);
+	for (pageno = 0; pageno < heap->pages.size; ++pageno)
+		ntuples += heap_page_slot_count(heap->pages.data[pageno]);
+	pthread_mutex_unlock(&heap->lock);
+	return ntuples;
+}
@@ -1,7 +1,10 @@
 #ifndef HEAP_H
 #define HEAP_H
 
+#include <pthread.h>
+
 #include "univ.h"
+#include "util/vec.h"
 
 struct heap_slot {
 	/* offset from the beginning of the page to the tuple data */
@@ -20,16 +23,61 @@ struct heap_page {
 	struct heap_slot slots[];
 };
 
+/* The heap of a table, made of a list of pages. Tuples are only ever
+ * appended, so readers only need the lock to find a page and the number of
+ * tuples it holds. */
+struct heap {
+	/* list of struct heap_page */
+	struct vec pages;
+	/* protects pages and the slot counts of the pages */
+	pthread_mutex_t lock;
+};
+
 /* Initialize a blank page as an empty heap page */
 void heap_page_init(struct heap_page *page);
 
 /* Count the number of actively used slots on the heap page */
 u16 heap_page_slot_count(struct heap_page *page);
 
+/* Number of bytes available on the page for a new tuple */
+size_t heap_page_free_space(struct heap_page *page);
+
 /* Add a new tuple to the end of the page, in the first free slot */
 void heap_page_add_tuple(struct heap_page *page, const u8 *data, size_t size);
 
+/* Add as many as fit of ntuples tuples of size bytes each, laid out one after
+ * the other in data. Returns the number of tuples added. */
+size_t heap_page_add_tuples(struct heap_page *page, const u8 *data,
+			    size_t size, size_t ntuples);
+
 /* Read a tuple from the specified slot number */
 u16 heap_page_read_tuple(struct heap_page *page, u16 slotno, u8 **data);
 
+/* Initialize an empty heap */
+void heap_init(struct heap *heap);
+
+/* Add a new tuple to the last page of the heap, allocating a new page if it
+ * does not fit */
+void heap_add_tuple(struct heap *heap, const u8 *data, size_t size);
+
+/* Add ntuples tuples of size bytes each, laid out one after the other in data,
+ * filling up the last page of the heap before allocating new ones. The lock is
+ * taken and the free space checked once per page rather than per tuple. */
+void heap_add_tuples(struct heap *heap, const u8 *data, size_t size,
+		     size_t ntuples);
+
+/* Add a filled page to the end of the heap. The heap takes ownership of the
+ * page. */
+void heap_add_page(struct heap *heap, struct heap_page *page);
+
+/* Get a page of the heap along with the number of tuples it currently holds,
+ * or NULL past the last page */
+struct heap_page *heap_get_page(struct heap *heap, size_t pageno, u16 *slotcnt);
+
+/* Number of pages in the heap */
+size_t heap_count_pages(struct heap *heap);
+
+/* Number of tuples in the heap */
+size_t heap_count_tuples(struct heap *heap);
+
 #endif
@@ -1,15 +1,19 @@
 #include "sys.h"
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "dtype.h"
 #include "executor/tablescan.h"
+#include "parser/plancache.h"
 #include "storage/heap.h"
 #include "table.h"
 #include "univ.h"
 #include "util/bytes.h"
 #include "util/error.h"
+#include "util/mem.h"
 #include "util/vec.h"
 
 #define NAME_LENGTH 64
@@ -17,14 +21,18 @@
 static struct table tables;
 static struct table columns;
 
-struct heap_page *tables_heap	 = NULL;
-struct heap_page *columns_heap = NULL;
+static struct heap tables_heap;
+static struct heap columns_heap;
 
 static u32 table_oid_seq  = 1;
 static u32 column_oid_seq = 1;
 
+/* Taken for writing while a table is being added, so that lookups never see
+ * a table without its columns or heap */
+static pthread_rwlock_t sys_lock = PTHREAD_RWLOCK_INITIALIZER;
+
 /* Indexed by table oid */
-struct heap_page *heap_pages[1024];
+struct heap *heaps[1024];
 
 struct table table_foo;
 
@@ -43,11 +51,8 @@ struct columns_tup {
 
 void sys_bootstrap(void)
 {
-	tables_heap = malloc(PAGE_SIZE);
-	heap_page_init(tables_heap);
-
-	columns_heap = malloc(PAGE_SIZE);
-	heap_page_init(columns_heap);
+	heap_init(&tables_heap);
+	heap_init(&columns_heap);
 
 	/* Create the tables table */
 	table_init(&tables, "tables", 2);
@@ -57,10 +62,9 @@ void sys_bootstrap(void)
 	tables.cols[1].name    = "name";
 	tables.cols[1].typeoid = DTYPE_CHAR;
 	tables.cols[1].typemod = NAME_LENGTH;
-	if (sys_add_table(&tables))
+	if (sys_add_table(&tables, &tables_heap))
 		errlog(PANIC, errmsg("Sys bootstrap failed"),
 		       errdetail("Could not add tables table"));
-	heap_pages[tables.oid] = tables_heap;
 
 	/* Create the columns table */
 	table_init(&columns, "columns", 5);
@@ -79,16 +83,15 @@ void sys_bootstrap(void)
 	columns.cols[4].name    = "typemod";
 	columns.cols[4].typeoid = DTYPE_INT4;
 	columns.cols[4].typemod = -1;
-	if (sys_add_table(&columns))
+	if (sys_add_table(&columns, &columns_heap))
 		errlog(PANIC, errmsg("Sys bootstrap failed"),
 		       errdetail("Could not add columns table"));
-	heap_pages[columns.oid] = columns_heap;
 }
 
 void init_dummy_tables(void)
 {
 	u8 tup[1024];
-	struct heap_page *heap;
+	struct heap *heap;
 
 	table_init(&table_foo, "foo", /*ncols=*/2);
 	table_foo.cols[0].name = "a";
@@ -97,37 +100,38 @@ void init_dummy_tables(void)
 	table_foo.cols[1].name = "b";
 	table_foo.cols[1].typeoid = DTYPE_INT4;
 	table_foo.cols[1].typemod = -1;
-	sys_add_table(&table_foo);
+	heap = malloc(sizeof(struct heap));
+	heap_init(heap);
+	sys_add_table(&table_foo, heap);
 
-	heap = malloc(PAGE_SIZE);
-	heap_page_init(heap);
-	heap_pages[table_foo.oid] = heap;
 	memset(tup, 0, sizeof(tup));
 	strcpy((char *)tup, "one");
 	*(tup + 5) = 1;
-	heap_page_add_tuple(heap, tup, 9);
+	heap_add_tuple(heap, tup, 9);
 	memset(tup, 0, sizeof(tup));
 	strcpy((char *)tup, "two");
 	*(tup + 5) = 2;
-	heap_page_add_tuple(heap, tup, 9);
+	heap_add_tuple(heap, tup, 9);
 	memset(tup, 0, sizeof(tup));
 	strcpy((char *)tup, "three");
 	*(tup + 5) = 3;
-	heap_page_add_tuple(heap, tup, 9);
+	heap_add_tuple(heap, tup, 9);
 }
 
-int sys_add_table(struct table *tab)
+int sys_add_table(struct table *tab, struct heap *heap)
 {
 	struct tables_tup ttup;
 	struct columns_tup ctup;
 	u16   colno;
 
+	pthread_rwlock_wrlock(&sys_lock);
 	tab->oid = table_oid_seq++;
+	heaps[tab->oid] = heap;
 
 	memset(&ttup, 0, sizeof(ttup));
 	ttup.oid = tab->oid;
 	strncpy(ttup.name, tab->name, NAME_LENGTH);
-	heap_page_add_tuple(tables_heap, (u8 *)&ttup, sizeof(ttup));
+	heap_add_tuple(&tables_heap, (u8 *)&ttup, sizeof(ttup));
 
 	for (colno = 0; colno < tab->ncols; ++colno) {
 		struct column *col = &tab->cols[colno];
@@ -137,8 +141,10 @@ int sys_add_table(struct table *tab)
 		strncpy(ctup.name, col->name, NAME_LENGTH);
 		ctup.typeoid = col->typeoid;
 		ctup.typemod = col->typemod;
-		heap_page_add_tuple(columns_heap, (u8 *)&ctup, sizeof(ctup));
+		heap_add_tuple(&columns_heap, (u8 *)&ctup, sizeof(ctup));
 	}
+	pthread_rwlock_unlock(&sys_lock);
+	plancache_invalidate();
 
 	return 0;
 }
@@ -152,21 +158,25 @@ struct table *sys_load_table_by_name(const char *tab_name)
 	struct vec    cols;
 	u16	      colno;
 
+	pthread_rwlock_rdlock(&sys_lock);
 	tablescan_begin(&iter, &tables);
 	while (tablescan_next(&iter) != -1) {
 		assert(iter.tupsize == sizeof(struct tables_tup));
 		ttup = (struct tables_tup *)iter.tup;
 		if (strcmp(ttup->name, tab_name) != 0)
 			continue;
-		table	    = malloc(sizeof(struct table));
+		table	    = mem_alloc(sizeof(struct table));
 		table->oid  = ttup->oid;
-		table->name = strdup(ttup->name);
+		table->name = strcpy(mem_alloc(strlen(ttup->name) + 1),
+				     ttup->name);
 		break;
 	}
 	tablescan_end(&iter);
 
-	if (table == NULL)
+	if (table == NULL) {
+		pthread_rwlock_unlock(&sys_lock);
 		return NULL;
+	}
 
 	vec_init(&cols, 1);
 	tablescan_begin(&iter, &columns);
@@ -177,18 +187,19 @@ struct table *sys_load_table_by_name(const char *tab_name)
 		ctup = (struct columns_tup *)iter.tup;
 		if (ctup->tableoid != table->oid)
 			continue;
-		col	  = malloc(sizeof(struct column));
-		col->name = malloc(NAME_LENGTH);
+		col	  = mem_alloc(sizeof(struct column));
+		col->name = mem_alloc(NAME_LENGTH);
 		strncpy((char *)col->name, ctup->name, NAME_LENGTH);
 		col->typeoid = ctup->typeoid;
 		col->typemod = ctup->typemod;
 		vec_push(&cols, col);
 	}
 	tablescan_end(&iter);
+	pthread_rwlock_unlock(&sys_lock);
 	assert(cols.size > 0);
 
 	table->ncols = cols.size;
-	table->cols  = malloc(sizeof(struct column) * cols.size);
+	table->cols  = mem_alloc(sizeof(struct column) * cols.size);
 	for (colno = 0; colno < table->ncols; ++colno) {
 		struct column *col = (struct column *)cols.data[colno];
 		table->cols[colno] = *col;
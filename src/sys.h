@@ -3,14 +3,17 @@
 #ifndef SYS_H
 #define SYS_H
 
+#include "storage/heap.h"
 #include "table.h"
 
 /* Initialize the system schema with basic tables. */
 void sys_bootstrap(void);
 
-/* Add a table to the table catalog */
-int sys_add_table(struct table *tab);
+/* Add a table to the table catalog, along with the heap holding its rows */
+int sys_add_table(struct table *tab, struct heap *heap);
 
+/* Look up a table in the catalog. It is allocated on the current memory root,
+ * NULL if there is no such table. */
 struct table *sys_load_table_by_name(const char *name);
 
 #endif // SYS_H
@@ -1,4 +1,11 @@
 #include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,78 +14,456 @@
 #include <unistd.h>
 
 #include "connection.h"
+#include "executor/plan.h"
 #include "pgwire.h"
 #include "sys.h"
 #include "util/error.h"
 #include "util/mem.h"
 
-static int create_server(struct sockaddr_un *sockname, int *sock)
+/* Maximum number of TCP sockets a worker listens on */
+#define MAX_LISTEN_SOCKETS 16
+
+struct server_config {
+	/* comma-separated list of addresses to listen on for TCP connections,
+	 * "*" for all addresses, or empty to disable TCP */
+	const char *listen_addresses;
+	/* directory of the Unix socket, or empty to disable it */
+	const char *unix_socket_dir;
+	int	    port;
+	/* length of the queue of pending connections of each socket */
+	int backlog;
+	/* number of threads accepting connections */
+	int nworkers;
+	/* maximum number of threads scanning a table for a query */
+	int nscanworkers;
+	/* megabytes each operator may use before spilling to disk */
+	int work_mem;
+	/* megabytes a query may use in all, 0 for no limit */
+	int max_query_mem;
+};
+
+/* A thread accepting connections on its sockets. Each worker has its own TCP
+ * sockets bound with SO_REUSEPORT so that the kernel spreads incoming
+ * connections across workers, while the Unix socket is shared. */
+struct worker {
+	pthread_t thread;
+	int	  socks[MAX_LISTEN_SOCKETS + 1];
+	/* the socket is a TCP socket */
+	int	  tcp[MAX_LISTEN_SOCKETS + 1];
+	int	  nsocks;
+};
+
+static void usage(const char *progname)
 {
-	int	  new_sock;
-	int	  opt	   = 1;
-	socklen_t name_len = SUN_LEN(sockname);
-	struct conn conn;
+	fprintf(stderr,
+		"Usage: %s [-h addresses] [-p port] [-k directory] "
+		"[-b backlog] [-j workers] [-w workers] [-m megabytes] "
+		"[-M megabytes]\n"
+		"  -h  TCP addresses to listen on, comma-separated, \"*\" for "
+		"all (default localhost)\n"
+		"  -p  port number (default 5432)\n"
+		"  -k  directory of the Unix socket (default .)\n"
+		"  -b  maximum number of pending connections (default %d)\n"
+		"  -j  number of threads accepting connections (default number "
+		"of CPUs)\n"
+		"  -w  maximum number of threads scanning a table for a query "
+		"(default number of CPUs)\n"
+		"  -m  megabytes each operator may use before spilling to disk "
+		"(default %d)\n"
+		"  -M  megabytes a query may use in all, 0 for no limit "
+		"(default 0)\n",
+		progname, SOMAXCONN, WORK_MEM / (1024 * 1024));
+}
 
-	if ((*sock = socket(PF_LOCAL, SOCK_STREAM, 0)) < 0) {
-		perror("socket failed");
+static int parse_int_option(const char *arg, int min, int *val)
+{
+	char *end;
+	long  v = strtol(arg, &end, 10);
+
+	if (*arg == '\0' || *end != '\0' || v < min || v > 65535)
+		return 1;
+	*val = v;
+	return 0;
+}
+
+static int parse_options(int argc, char **argv, struct server_config *config)
+{
+	int opt;
+
+	config->listen_addresses = "localhost";
+	config->unix_socket_dir	 = ".";
+	config->port		 = 5432;
+	config->backlog		 = SOMAXCONN;
+	config->nworkers	 = sysconf(_SC_NPROCESSORS_ONLN);
+	if (config->nworkers < 1)
+		config->nworkers = 1;
+	config->nscanworkers  = config->nworkers;
+	config->work_mem      = WORK_MEM / (1024 * 1024);
+	config->max_query_mem = 0;
+
+	while ((opt = getopt(argc, argv, "h:p:k:b:j:w:m:M:")) != -1) {
+		switch (opt) {
+		case 'h':
+			config->listen_addresses = optarg;
+			break;
+		case 'k':
+			config->unix_socket_dir = optarg;
+			break;
+		case 'p':
+			if (parse_int_option(optarg, 1, &config->port))
+				goto bad_value;
+			break;
+		case 'b':
+			if (parse_int_option(optarg, 1, &config->backlog))
+				goto bad_value;
+			break;
+		case 'j':
+			if (parse_int_option(optarg, 1, &config->nworkers))
+				goto bad_value;
+			break;
+		case 'w':
+			if (parse_int_option(optarg, 1, &config->nscanworkers))
+				goto bad_value;
+			break;
+		case 'm':
+			if (parse_int_option(optarg, 1, &config->work_mem))
+				goto bad_value;
+			break;
+		case 'M':
+			if (parse_int_option(optarg, 0, &config->max_query_mem))
+				goto bad_value;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (optind < argc) {
+		usage(argv[0]);
 		return 1;
 	}
-	if (setsockopt(*sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
+	return 0;
+
+bad_value:
+	fprintf(stderr, "%s: invalid value for -%c: %s\n", argv[0], opt,
+		optarg);
+	return 1;
+}
+
+static int set_sock_options(int sock)
+{
+	int opt = 1;
+
+	if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
 		perror("setsockopt");
 		return 1;
 	}
-	if (setsockopt(*sock, SOL_SOCKET, SO_NOSIGPIPE, &opt, sizeof(opt))) {
+#ifdef SO_NOSIGPIPE
+	if (setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &opt, sizeof(opt))) {
 		perror("setsockopt");
 		return 1;
 	}
-	if (bind(*sock, (struct sockaddr *)sockname, name_len) < 0) {
+#endif
+	/* a worker must not block in accept if another worker took the
+	 * connection first */
+	if (fcntl(sock, F_SETFL, O_NONBLOCK)) {
+		perror("fcntl");
+		return 1;
+	}
+	return 0;
+}
+
+static int create_unix_socket(struct server_config *config, int *sock)
+{
+	struct sockaddr_un name;
+
+	name.sun_family = AF_LOCAL;
+	if (snprintf(name.sun_path, sizeof(name.sun_path), "%s/.s.PGSQL.%d",
+		     config->unix_socket_dir,
+		     config->port) >= sizeof(name.sun_path)) {
+		fprintf(stderr, "Unix socket path is too long\n");
+		return 1;
+	}
+	if (unlink(name.sun_path) && errno != ENOENT) {
+		perror("unlink");
+		return 1;
+	}
+
+	if ((*sock = socket(PF_LOCAL, SOCK_STREAM, 0)) < 0) {
+		perror("socket failed");
+		return 1;
+	}
+	if (set_sock_options(*sock))
+		return 1;
+	if (bind(*sock, (struct sockaddr *)&name, SUN_LEN(&name)) < 0) {
 		perror("bind failed");
 		return 1;
 	}
-	if (listen(*sock, 3) < 0) {
+	if (listen(*sock, config->backlog) < 0) {
 		perror("listen");
 		return 1;
 	}
+	errlog(LOG, errmsg("listening on Unix socket \"%s\"", name.sun_path));
+	return 0;
+}
+
+/* Create a listening socket for an address. Nothing is left open on
+ * failure. */
+static int create_tcp_socket(struct server_config *config, struct addrinfo *ai,
+			     int *sock)
+{
+	int opt = 1;
+
+	if ((*sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) <
+	    0) {
+		perror("socket failed");
+		return 1;
+	}
+	if (set_sock_options(*sock))
+		goto fail;
+	if (setsockopt(*sock, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt))) {
+		perror("setsockopt");
+		goto fail;
+	}
+	/* let IPv4 addresses be bound separately */
+	if (ai->ai_family == AF_INET6 &&
+	    setsockopt(*sock, IPPROTO_IPV6, IPV6_V6ONLY, &opt, sizeof(opt))) {
+		perror("setsockopt");
+		goto fail;
+	}
+	if (bind(*sock, ai->ai_addr, ai->ai_addrlen) < 0) {
+		perror("bind failed");
+		goto fail;
+	}
+	if (listen(*sock, config->backlog) < 0) {
+		perror("listen");
+		goto fail;
+	}
+	return 0;
+
+fail:
+	close(*sock);
+	*sock = -1;
+	return 1;
+}
+
+/* Bind the TCP sockets of every worker to each of the listen addresses.
+ * Addresses that cannot be bound are skipped, as long as one of them can or
+ * the workers already listen on the Unix socket. */
+static int create_tcp_sockets(struct server_config *config,
+			      struct worker *workers)
+{
+	char		 port[8];
+	char		*addresses;
+	char		*host;
+	char		*saveptr;
+	struct addrinfo	 hints;
+	struct addrinfo *res;
+	struct addrinfo *ai;
+	int		 rc;
+	int		 w;
+	int		 err	= 0;
+	int		 nbound = 0;
+	int		 nbefore;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family	  = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags	  = AI_PASSIVE;
+	snprintf(port, sizeof(port), "%d", config->port);
+
+	addresses = strdup(config->listen_addresses);
+	for (host = strtok_r(addresses, ", ", &saveptr); host && !err;
+	     host = strtok_r(NULL, ", ", &saveptr)) {
+		rc = getaddrinfo(strcmp(host, "*") == 0 ? NULL : host, port,
+				 &hints, &res);
+		if (rc != 0) {
+			errlog(WARNING, errmsg("could not resolve \"%s\": %s",
+					       host, gai_strerror(rc)));
+			continue;
+		}
+		nbefore = nbound;
+		for (ai = res; ai && !err; ai = ai->ai_next) {
+			for (w = 0; w < config->nworkers; ++w) {
+				struct worker *worker = &workers[w];
+				int	       sock;
+
+				if (worker->nsocks == MAX_LISTEN_SOCKETS) {
+					fprintf(stderr,
+						"too many listen addresses\n");
+					err = 1;
+					break;
+				}
+				if (create_tcp_socket(config, ai, &sock)) {
+					/* a worker other than the first one
+					 * failing means the address is used
+					 * by another server */
+					err = w > 0;
+					break;
+				}
+				worker->socks[worker->nsocks] = sock;
+				worker->tcp[worker->nsocks++] = 1;
+			}
+			if (w == config->nworkers)
+				nbound++;
+		}
+		freeaddrinfo(res);
+		if (!err && nbound > nbefore)
+			errlog(LOG, errmsg("listening on %s port %d", host,
+					   config->port));
+	}
+	free(addresses);
+	if (!err && nbound == 0 && *config->listen_addresses != '\0') {
+		if (workers[0].nsocks > 0) {
+			errlog(WARNING, errmsg("could not listen on any TCP "
+					       "address, only on the Unix "
+					       "socket"));
+		} else {
+			fprintf(stderr,
+				"could not listen on any TCP address\n");
+			err = 1;
+		}
+	}
+	return err;
+}
+
+static void *connection_main(void *arg)
+{
+	struct conn *conn = arg;
+
+	mem_root_set(&conn->query_mem);
+	pgwire_handle_connection(conn);
+	close(conn->socket);
+	conn_free(conn);
+	free(conn);
+	return NULL;
+}
+
+/* Serve a new connection on its own thread, so that a long-lived session does
+ * not hold up the connections queued behind it */
+static void start_connection(int sock, int tcp)
+{
+	struct conn   *conn;
+	pthread_t      thread;
+	pthread_attr_t attr;
+	int	       opt = 1;
+
+	/* responses are buffered and flushed explicitly, so Nagle's algorithm
+	 * would only add latency */
+	if (tcp && setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt)))
+		errlog(WARNING, errmsg("could not set TCP_NODELAY: %s",
+				       strerror(errno)));
+
+	conn = malloc(sizeof(struct conn));
+	conn_init(conn, sock);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&thread, &attr, connection_main, conn)) {
+		errlog(WARNING, errmsg("could not start connection thread"));
+		close(sock);
+		conn_free(conn);
+		free(conn);
+	}
+	pthread_attr_destroy(&attr);
+}
+
+static void *worker_main(void *arg)
+{
+	struct worker *worker = arg;
+	struct pollfd  fds[MAX_LISTEN_SOCKETS + 1];
+	int	       new_sock;
+	int	       i;
+
+	for (i = 0; i < worker->nsocks; ++i) {
+		fds[i].fd     = worker->socks[i];
+		fds[i].events = POLLIN;
+	}
+
 	for (;;) {
-		if ((new_sock = accept(*sock, (struct sockaddr *)sockname,
-				       &name_len)) < 0) {
-			fprintf(stderr, "accept fail\n");
-			perror("accept");
-			return 1;
+		if (poll(fds, worker->nsocks, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			exit(EXIT_FAILURE);
+		}
+		for (i = 0; i < worker->nsocks; ++i) {
+			if (!(fds[i].revents & POLLIN))
+				continue;
+			if ((new_sock = accept(fds[i].fd, NULL, NULL)) < 0) {
+				/* another worker took the connection, or we
+				 * are out of file descriptors for now */
+				if (errno != EAGAIN && errno != EWOULDBLOCK &&
+				    errno != EINTR)
+					errlog(WARNING,
+					       errmsg("accept failed: %s",
+						      strerror(errno)));
+				continue;
+			}
+			/* accepted sockets may inherit O_NONBLOCK */
+			fcntl(new_sock, F_SETFL, 0);
+			start_connection(new_sock, worker->tcp[i]);
 		}
-		conn_init(&conn, new_sock);
-		mem_root_set(&conn.mem_root);
-		pgwire_handle_connection(&conn);
-		close(new_sock);
 	}
-	return 0;
+	return NULL;
 }
 
 extern void init_dummy_tables(void);
 
-int main(void)
+int main(int argc, char **argv)
 {
-	int		   sock;
-	struct sockaddr_un name;
+	struct server_config config;
+	struct worker	    *workers;
+	sigset_t	     stop_signals;
+	int		     unix_sock = -1;
+	int		     sig;
+	int		     w;
+
+	if (parse_options(argc, argv, &config))
+		exit(EXIT_FAILURE);
+	max_parallel_workers = config.nscanworkers;
+	work_mem	     = (size_t)config.work_mem * 1024 * 1024;
+	max_query_mem	     = (size_t)config.max_query_mem * 1024 * 1024;
+
+	/* a client going away must not kill the server */
+	signal(SIGPIPE, SIG_IGN);
 
 	sys_bootstrap();
-	sys_load_table_by_name("tables");
 
 	init_dummy_tables();
 
 	errlog(LOG, errmsg("toysqld starting as process %d", getpid()));
 
-	name.sun_family = AF_LOCAL;
-	strcpy(name.sun_path, "./.s.PGSQL.5432");
-
-	if (unlink(name.sun_path) && errno != ENOENT) {
-		perror("unlink");
+	workers = calloc(config.nworkers, sizeof(struct worker));
+	if (*config.unix_socket_dir != '\0') {
+		if (create_unix_socket(&config, &unix_sock))
+			exit(EXIT_FAILURE);
+		for (w = 0; w < config.nworkers; ++w)
+			workers[w].socks[workers[w].nsocks++] = unix_sock;
+	}
+	if (create_tcp_sockets(&config, workers))
+		exit(EXIT_FAILURE);
+	if (workers[0].nsocks == 0) {
+		fprintf(stderr, "no sockets to listen on\n");
 		exit(EXIT_FAILURE);
 	}
 
-	if (create_server(&name, &sock))
-		exit(EXIT_FAILURE);
+	/* the signals asking the server to stop are only taken by the main
+	 * thread, which exits normally so that exit handlers such as the leak
+	 * checker run */
+	sigemptyset(&stop_signals);
+	sigaddset(&stop_signals, SIGTERM);
+	sigaddset(&stop_signals, SIGINT);
+	pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
 
-	close(sock);
-	return 0;
+	for (w = 0; w < config.nworkers; ++w) {
+		if (pthread_create(&workers[w].thread, NULL, worker_main,
+				   &workers[w])) {
+			perror("pthread_create");
+			exit(EXIT_FAILURE);
+		}
+	}
+	sigwait(&stop_signals, &sig);
+	errlog(LOG, errmsg("received signal %d, shutting down", sig));
+	exit(EXIT_SUCCESS);
 }
@@ -5,13 +5,13 @@
 
 #include <string.h>
 
-static inline u8 *ut_read_2(u8 *bytes, u16 *val)
+static inline const u8 *ut_read_2(const u8 *bytes, u16 *val)
 {
 	*val = (bytes[0] << 8) + bytes[1];
-	return bytes + 4;
+	return bytes + 2;
 }
 
-static inline u8 *ut_read_4(u8 *bytes, u32 *val)
+static inline const u8 *ut_read_4(const u8 *bytes, u32 *val)
 {
 	*val = (bytes[0] << 24) + (bytes[1] << 16) + (bytes[2] << 8) + bytes[3];
 	return bytes + 4;
@@ -33,6 +33,12 @@ static inline u8 *ut_write_4(u8 *bytes, u32 val)
 	return bytes + 4;
 }
 
+static inline u8 *ut_write_8(u8 *bytes, u64 val)
+{
+	bytes = ut_write_4(bytes, (u32)(val >> 32));
+	return ut_write_4(bytes, (u32)val);
+}
+
 static inline const u8 *ut_read_str(const u8 *bytes, char *str)
 {
 	size_t len = strlen((char *)bytes);
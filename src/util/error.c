@@ -41,14 +41,11 @@ void errcode(enum errcode c)
 
 void errmsg(const char *fmt, ...)
 {
-	char   *msg = malloc(4096);
 	va_list args;
 
 	va_start(args, fmt);
-	vsnprintf(msg, 4096, fmt, args);
+	vsnprintf(last_err->message, sizeof(last_err->message), fmt, args);
 	va_end(args);
-
-	last_err->message = msg;
 }
 
 void errdetail(const char *detail)
@@ -80,6 +77,12 @@ void errfinish(const char *file, size_t line, const char *routine)
 		exit(EXIT_FAILURE);
 }
 
+void errrestore(const struct err *err)
+{
+	errbuf.tail = errbuf_ptr_next(errbuf.tail);
+	*last_err   = *err;
+}
+
 static const char *sev_to_str(enum errlevel l)
 {
 	switch (l) {
@@ -113,12 +116,56 @@ const char *errcode_to_str(enum errcode c)
 		return "08P01";
 	case ER_FEATURE_NOT_SUPPORTED:
 		return "0A000";
+	case ER_STRING_DATA_RIGHT_TRUNCATION:
+		return "22001";
+	case ER_NUMERIC_VALUE_OUT_OF_RANGE:
+		return "22003";
+	case ER_DIVISION_BY_ZERO:
+		return "22012";
+	case ER_INVALID_ROW_COUNT_IN_LIMIT:
+		return "2201W";
+	case ER_INVALID_ROW_COUNT_IN_RESULT_OFFSET:
+		return "2201X";
+	case ER_INVALID_PARAMETER_VALUE:
+		return "22023";
+	case ER_INVALID_TEXT_REPRESENTATION:
+		return "22P02";
+	case ER_BAD_COPY_FILE_FORMAT:
+		return "22P04";
+	case ER_INVALID_SQL_STATEMENT_NAME:
+		return "26000";
+	case ER_INVALID_CURSOR_NAME:
+		return "34000";
 	case ER_SYNTAX_ERROR:
 		return "42601";
+	case ER_AMBIGUOUS_COLUMN:
+		return "42702";
 	case ER_UNDEFINED_COLUMN:
 		return "42703";
+	case ER_DUPLICATE_COLUMN:
+		return "42701";
+	case ER_DUPLICATE_ALIAS:
+		return "42712";
+	case ER_GROUPING_ERROR:
+		return "42803";
+	case ER_DATATYPE_MISMATCH:
+		return "42804";
+	case ER_UNDEFINED_FUNCTION:
+		return "42883";
 	case ER_UNDEFINED_TABLE:
 		return "42P01";
+	case ER_INVALID_COLUMN_REFERENCE:
+		return "42P10";
+	case ER_DUPLICATE_CURSOR:
+		return "42P03";
+	case ER_DUPLICATE_PREPARED_STATEMENT:
+		return "42P05";
+	case ER_OUT_OF_MEMORY:
+		return "53200";
+	case ER_QUERY_CANCELED:
+		return "57014";
+	case ER_IO_ERROR:
+		return "58030";
 	case ER_INTERNAL_ERROR:
 		return "XX000";
 	default:
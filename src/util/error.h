@@ -12,9 +12,31 @@ enum errcode {
 	ER_NO_DATA,
 	ER_PROTOCOL_VIOLATION,
 	ER_FEATURE_NOT_SUPPORTED,
+	ER_STRING_DATA_RIGHT_TRUNCATION,
+	ER_NUMERIC_VALUE_OUT_OF_RANGE,
+	ER_DIVISION_BY_ZERO,
+	ER_INVALID_ROW_COUNT_IN_LIMIT,
+	ER_INVALID_ROW_COUNT_IN_RESULT_OFFSET,
+	ER_INVALID_PARAMETER_VALUE,
+	ER_INVALID_TEXT_REPRESENTATION,
+	ER_BAD_COPY_FILE_FORMAT,
+	ER_INVALID_SQL_STATEMENT_NAME,
+	ER_INVALID_CURSOR_NAME,
 	ER_SYNTAX_ERROR,
+	ER_AMBIGUOUS_COLUMN,
 	ER_UNDEFINED_COLUMN,
+	ER_DUPLICATE_COLUMN,
+	ER_DUPLICATE_ALIAS,
+	ER_GROUPING_ERROR,
+	ER_DATATYPE_MISMATCH,
+	ER_UNDEFINED_FUNCTION,
 	ER_UNDEFINED_TABLE,
+	ER_INVALID_COLUMN_REFERENCE,
+	ER_DUPLICATE_CURSOR,
+	ER_DUPLICATE_PREPARED_STATEMENT,
+	ER_OUT_OF_MEMORY,
+	ER_QUERY_CANCELED,
+	ER_IO_ERROR,
 	ER_INTERNAL_ERROR
 };
 
@@ -24,11 +46,15 @@ struct err_srcloc {
 	const char *routine;
 };
 
+/* Size of the buffer of an error message, longer messages are truncated */
+#define ERR_MESSAGE_SIZE 512
+
 struct err {
 	enum errlevel severity;
 	enum errcode  code;
-	/* Primary human-readable error message */
-	const char *message;
+	/* Primary human-readable error message, kept in the error itself so
+	 * that it goes wherever the error is copied */
+	char message[ERR_MESSAGE_SIZE];
 	/* Optional secondary message */
 	const char *detail;
 	/* Optional fix suggestion */
@@ -54,6 +80,9 @@ void errhint(const char *hint);
 void errpos(size_t pos);
 void errfinish(const char *file, size_t line, const char *routine);
 
+/* Push an error raised on another thread, without logging it again */
+void errrestore(const struct err *err);
+
 const char *errcode_to_str(enum errcode c);
 
 struct err *errbuf_pop(void);
@@ -3,24 +3,73 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "util/error.h"
+
 static _Thread_local struct mem_root *mem_root;
 
-void *mem_alloc(size_t size)
+/* Add bytes to the total of a root and of its ancestors */
+static void add_total(struct mem_root *root, i64 bytes)
+{
+	for (; root; root = root->parent)
+		atomic_fetch_add(&root->total, bytes);
+}
+
+static inline size_t align_up(size_t size)
+{
+	return (size + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1);
+}
+
+static struct mem_chunk *new_chunk(struct mem_root *root, size_t size,
+				   int dedicated)
 {
-	void **allocs;
-	size_t new_cap;
-	void  *alloc;
-
-	if (mem_root->size == mem_root->capacity) {
-		new_cap = mem_root->capacity == 0 ? 1 : 2 * mem_root->capacity;
-		allocs	= realloc(mem_root->allocs, sizeof(void *) * new_cap);
-		if (allocs == NULL)
-			exit(EXIT_FAILURE);
-		mem_root->allocs   = allocs;
-		mem_root->capacity = new_cap;
+	struct mem_chunk *chunk = malloc(sizeof(struct mem_chunk) + size);
+
+	if (chunk == NULL)
+		exit(EXIT_FAILURE);
+	root->reserved += size;
+	add_total(root, size);
+	chunk->size	 = size;
+	chunk->dedicated = dedicated;
+	/* dedicated chunks go behind the current one, which stays in use */
+	if (dedicated && root->chunks) {
+		chunk->prev	    = root->chunks->prev;
+		root->chunks->prev = chunk;
+	} else {
+		chunk->prev  = root->chunks;
+		root->chunks = chunk;
 	}
-	alloc				   = malloc(size);
-	mem_root->allocs[mem_root->size++] = alloc;
+	return chunk;
+}
+
+static void *alloc_slow(struct mem_root *root, size_t size)
+{
+	struct mem_chunk *chunk;
+
+	if (size > MEM_CHUNK_MAX / 4)
+		return new_chunk(root, size, 1) + 1;
+
+	if (root->next_size == 0)
+		root->next_size = MEM_CHUNK_MIN;
+	while (root->next_size < size)
+		root->next_size *= 2;
+	chunk = new_chunk(root, root->next_size, 0);
+	if (root->next_size < MEM_CHUNK_MAX)
+		root->next_size *= 2;
+	root->ptr = (u8 *)(chunk + 1) + size;
+	root->end = (u8 *)(chunk + 1) + chunk->size;
+	return chunk + 1;
+}
+
+void *mem_alloc(size_t size)
+{
+	void *alloc;
+
+	size = align_up(size > 0 ? size : 1);
+	mem_root->used += size;
+	if (size > (size_t)(mem_root->end - mem_root->ptr))
+		return alloc_slow(mem_root, size);
+	alloc	       = mem_root->ptr;
+	mem_root->ptr += size;
 	return alloc;
 }
 
@@ -36,16 +85,130 @@ void mem_root_init(struct mem_root *mem_root)
 	memset(mem_root, 0, sizeof(struct mem_root));
 }
 
+void mem_root_init_child(struct mem_root *mem_root, struct mem_root *parent)
+{
+	mem_root_init(mem_root);
+	mem_root->parent  = parent;
+	mem_root->sibling = parent->children;
+	parent->children  = mem_root;
+}
+
+/* Bytes of the chunks of a root and of its children */
+static size_t chunk_bytes(const struct mem_root *mem_root)
+{
+	const struct mem_root *child;
+	size_t		       bytes = mem_root->reserved;
+
+	for (child = mem_root->children; child; child = child->sibling)
+		bytes += chunk_bytes(child);
+	return bytes;
+}
+
+void mem_root_detach(struct mem_root *mem_root)
+{
+	struct mem_root **link;
+
+	if (mem_root->parent == NULL)
+		return;
+	/* the chunks kept by the root no longer count for its ancestors,
+	 * while bytes charged are given back by whoever charged them */
+	add_total(mem_root->parent, -(i64)chunk_bytes(mem_root));
+	for (link = &mem_root->parent->children; *link != mem_root;
+	     link = &(*link)->sibling)
+		;
+	*link		  = mem_root->sibling;
+	mem_root->parent  = NULL;
+	mem_root->sibling = NULL;
+}
+
+/* Free the chunks of a root, keeping warm if not NULL */
+static void free_chunks(struct mem_root *mem_root, struct mem_chunk *warm)
+{
+	struct mem_chunk *chunk;
+
+	add_total(mem_root, -(i64)mem_root->reserved);
+	while ((chunk = mem_root->chunks) != NULL) {
+		mem_root->chunks = chunk->prev;
+		if (chunk != warm)
+			free(chunk);
+	}
+	mem_root->chunks    = warm;
+	mem_root->ptr	    = NULL;
+	mem_root->end	    = NULL;
+	mem_root->used	    = 0;
+	mem_root->reserved  = 0;
+	if (warm == NULL) {
+		mem_root->next_size = 0;
+		return;
+	}
+	warm->prev	   = NULL;
+	mem_root->ptr	   = (u8 *)(warm + 1);
+	mem_root->end	   = mem_root->ptr + warm->size;
+	mem_root->reserved = warm->size;
+	add_total(mem_root, warm->size);
+}
+
 void mem_root_clear(struct mem_root *mem_root)
 {
-	size_t i;
+	struct mem_root *child;
+
+	for (child = mem_root->children; child; child = child->sibling)
+		mem_root_clear(child);
+	free_chunks(mem_root, NULL);
+}
+
+void mem_root_reset(struct mem_root *mem_root)
+{
+	struct mem_chunk *warm = mem_root->chunks;
+	struct mem_root	 *child;
+
+	for (child = mem_root->children; child; child = child->sibling)
+		mem_root_reset(child);
+	/* the most recent chunk is the largest, unless it is dedicated */
+	free_chunks(mem_root, warm && !warm->dedicated ? warm : NULL);
+}
+
+size_t mem_root_used(const struct mem_root *mem_root)
+{
+	const struct mem_root *child;
+	size_t		       used = mem_root->used;
+
+	for (child = mem_root->children; child; child = child->sibling)
+		used += mem_root_used(child);
+	return used;
+}
+
+size_t mem_root_reserved(const struct mem_root *mem_root)
+{
+	return atomic_load(&mem_root->total);
+}
+
+void mem_charge(i64 bytes)
+{
+	add_total(mem_root, bytes);
+}
 
-	for (i = 0; i < mem_root->size; ++i)
-		free(mem_root->allocs[i]);
-	free(mem_root->allocs);
-	mem_root->allocs   = NULL;
-	mem_root->size	   = 0;
-	mem_root->capacity = 0;
+void mem_recharge(size_t *charged, size_t bytes)
+{
+	add_total(mem_root, (i64)bytes - (i64)*charged);
+	*charged = bytes;
+}
+
+int mem_check_limit(void)
+{
+	struct mem_root *root;
+	size_t		 total;
+
+	for (root = mem_root; root; root = root->parent) {
+		total = atomic_load(&root->total);
+		if (root->limit == 0 || total <= root->limit)
+			continue;
+		errlog(ERROR, errcode(ER_OUT_OF_MEMORY),
+		       errmsg("Out of memory, the query needs more than %zu kB",
+			      root->limit / 1024));
+		return 1;
+	}
+	return 0;
 }
 
 struct mem_root *mem_root_set(struct mem_root *new_mem_root)
@@ -54,3 +217,8 @@ struct mem_root *mem_root_set(struct mem_root *new_mem_root)
 	mem_root		  = new_mem_root;
 	return previous;
 }
+
+struct mem_root *mem_root_get(void)
+{
+	return mem_root;
+}
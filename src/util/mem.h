@@ -1,13 +1,54 @@
 #ifndef MEM_H
 #define MEM_H
 
+#include <stdatomic.h>
+#include <stddef.h>
+
 #include "univ.h"
 
-/* A container for dynamic memory allocations */
-struct mem_root {
-	void **allocs;
+/* Allocations are aligned for any type */
+#define MEM_ALIGN (_Alignof(max_align_t))
+/* Size of the first chunk of a root. The following ones double in size up to
+ * MEM_CHUNK_MAX, and allocations larger than a quarter of that get a chunk
+ * of their own. */
+#define MEM_CHUNK_MIN (8 * 1024)
+#define MEM_CHUNK_MAX (1024 * 1024)
+
+/* A block of memory of a root, allocations following the header */
+struct mem_chunk {
+	struct mem_chunk *prev;
+	/* usable bytes after the header */
 	size_t size;
-	size_t capacity;
+	/* the chunk holds a single large allocation */
+	int dedicated;
+} __attribute__((aligned(MEM_ALIGN)));
+
+/* A container for dynamic memory allocations. They are carved out of chunks
+ * by bumping a pointer, and are only released all at once. A root may have
+ * children with shorter lifetimes, whose memory is released along with
+ * its own. */
+struct mem_root {
+	/* chunks of the root, most recent first */
+	struct mem_chunk *chunks;
+	/* free space of the chunk allocations are carved from */
+	u8 *ptr;
+	u8 *end;
+	/* size of the next chunk */
+	size_t next_size;
+	/* bytes handed out by the root, and taken by its chunks */
+	size_t used;
+	size_t reserved;
+	/* bytes taken by the chunks of the root and of its children, and
+	 * charged to them by mem_charge. Children may be used by other
+	 * threads. */
+	_Atomic size_t total;
+	/* cap on total, 0 for none */
+	size_t limit;
+	/* the root this one is a child of, NULL if none, its first child and
+	 * its next sibling */
+	struct mem_root *parent;
+	struct mem_root *children;
+	struct mem_root *sibling;
 };
 
 void *mem_alloc(size_t size);
@@ -16,8 +57,42 @@ void *mem_zalloc(size_t size);
 
 void mem_root_init(struct mem_root *mem_root);
 
+/* Initialize a root as a child of parent. It must be detached before it goes
+ * away if the parent outlives it. */
+void mem_root_init_child(struct mem_root *mem_root, struct mem_root *parent);
+
+/* Remove a root from the children of its parent */
+void mem_root_detach(struct mem_root *mem_root);
+
+/* Release all the memory of a root and of its children */
 void mem_root_clear(struct mem_root *mem_root);
 
+/* Release the allocations of a root and of its children, but keep the last
+ * chunk of each for the next ones */
+void mem_root_reset(struct mem_root *mem_root);
+
+/* Bytes handed out by a root and its children since they were last reset */
+size_t mem_root_used(const struct mem_root *mem_root);
+
+/* Bytes taken by the chunks of a root and of its children, and charged to
+ * them */
+size_t mem_root_reserved(const struct mem_root *mem_root);
+
+/* Charge bytes allocated outside of the roots to the current root, or credit
+ * them back if negative, so that they count towards its limit */
+void mem_charge(i64 bytes);
+
+/* Charge the current root for bytes allocated outside of the roots, in place
+ * of *charged, the bytes last charged for the same buffers */
+void mem_recharge(size_t *charged, size_t bytes);
+
+/* Check that neither the current root nor its ancestors are over their
+ * limit. Returns nonzero with an error if one is. */
+int mem_check_limit(void);
+
 struct mem_root *mem_root_set(struct mem_root *mem_root);
 
+/* The root of the allocations of the thread */
+struct mem_root *mem_root_get(void);
+
 #endif // MEM_H
@@ -0,0 +1,93 @@
+#include "util/num.h"
+
+#include <string.h>
+
+/* The two digits of each number below 100, so that digits are produced two
+ * at a time */
+static const char digit_pairs[201] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static int count_digits(u64 v)
+{
+	int n = 1;
+
+	for (;;) {
+		if (v < 10)
+			return n;
+		if (v < 100)
+			return n + 1;
+		if (v < 1000)
+			return n + 2;
+		if (v < 10000)
+			return n + 3;
+		v /= 10000;
+		n += 4;
+	}
+}
+
+char *ut_format_int(char *buf, i64 val)
+{
+	u64   v = val < 0 ? 0 - (u64)val : (u64)val;
+	char *end;
+
+	if (val < 0)
+		*buf++ = '-';
+	end = buf + count_digits(v);
+	buf = end;
+	while (v >= 100) {
+		buf -= 2;
+		memcpy(buf, digit_pairs + (v % 100) * 2, 2);
+		v /= 100;
+	}
+	if (v >= 10)
+		memcpy(buf - 2, digit_pairs + v * 2, 2);
+	else
+		buf[-1] = '0' + v;
+	return end;
+}
+
+int ut_parse_int(const char *str, size_t len, i64 min, i64 max, i64 *res)
+{
+	const char *end = str + len;
+	int	    neg = 0;
+	u64	    val = 0;
+	u64	    lim;
+	u8	    d;
+
+	while (str < end && (*str == ' ' || *str == '\t'))
+		str++;
+	while (end > str && (end[-1] == ' ' || end[-1] == '\t'))
+		end--;
+	if (str < end && (*str == '-' || *str == '+'))
+		neg = *str++ == '-';
+	if (str == end)
+		return 1;
+
+	lim = neg ? (u64)-(min + 1) + 1 : (u64)max;
+	if (end - str <= 18) {
+		/* too few digits to overflow, the range is checked once */
+		for (; str < end; ++str) {
+			d = *str - '0';
+			if (d > 9)
+				return 1;
+			val = val * 10 + d;
+		}
+		if (val > lim)
+			return 2;
+	} else {
+		for (; str < end; ++str) {
+			d = *str - '0';
+			if (d > 9)
+				return 1;
+			if (val > (lim - d) / 10)
+				return 2;
+			val = val * 10 + d;
+		}
+	}
+	*res = neg ? (i64)(0 - val) : (i64)val;
+	return 0;
+}
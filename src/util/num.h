@@ -0,0 +1,18 @@
+#ifndef NUM_H
+#define NUM_H
+
+#include "univ.h"
+
+/* Longest text of a 64-bit integer, "-9223372036854775808" */
+#define INT_TEXT_MAX 20
+
+/* Write the decimal text of an integer, without a terminating NUL. Returns
+ * the end of the text. */
+char *ut_format_int(char *buf, i64 val);
+
+/* Parse a decimal integer within [min, max], allowing a sign and surrounding
+ * blanks. Returns 1 if the text is not an integer and 2 if it is out of
+ * range. */
+int ut_parse_int(const char *str, size_t len, i64 min, i64 max, i64 *res);
+
+#endif
@@ -2,23 +2,43 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "univ.h"
+#include "util/mem.h"
 
 void vec_init(struct vec *v, size_t capacity)
 {
 	v->data	    = malloc(capacity * sizeof(void *));
 	v->size	    = 0;
 	v->capacity = capacity;
+	v->mem_root = NULL;
+}
+
+void vec_init_mem(struct vec *v, size_t capacity)
+{
+	v->data	    = mem_alloc(capacity * sizeof(void *));
+	v->size	    = 0;
+	v->capacity = capacity;
+	v->mem_root = mem_root_get();
 }
 
 static int vec_reserve(struct vec *v, size_t capacity)
 {
-	void *data;
+	struct mem_root *previous;
+	void		*data;
 
 	if (capacity <= v->capacity)
 		return 0;
-	data = realloc(v->data, capacity * sizeof(void *));
+	if (v->mem_root != NULL) {
+		/* the vector may grow while another root is current */
+		previous = mem_root_set(v->mem_root);
+		data	 = mem_alloc(capacity * sizeof(void *));
+		mem_root_set(previous);
+		memcpy(data, v->data, v->size * sizeof(void *));
+	} else {
+		data = realloc(v->data, capacity * sizeof(void *));
+	}
 	if (data == NULL)
 		return 1;
 	v->data	    = data;
@@ -45,6 +65,6 @@ void *vec_pop(struct vec *v)
 
 void vec_free(struct vec *v)
 {
-	if (v->data != NULL)
+	if (v->data != NULL && v->mem_root == NULL)
 		free(v->data);
 }
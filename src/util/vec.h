@@ -3,13 +3,21 @@
 
 #include <stddef.h>
 
+struct mem_root;
+
 struct vec {
 	void **data;
 	size_t size;
 	size_t capacity;
+
+	/* root the data is allocated on, NULL if allocated with malloc */
+	struct mem_root *mem_root;
 };
 
 void  vec_init(struct vec *v, size_t capacity);
+/* Initialize a vector whose data is allocated on the current memory root, and
+ * goes away with it */
+void  vec_init_mem(struct vec *v, size_t capacity);
 void  vec_push(struct vec *v, void *item);
 void *vec_pop(struct vec *v);
 void  vec_free(struct vec *v);
@@ -0,0 +1,109 @@
+/* Microbenchmark of the filter kernels: 100M values of each type compared
+ * with a constant, with each instruction set the CPU supports */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dtype.h"
+#include "executor/kernel.h"
+
+/* the values are cycled through, so that they stay in the caches and the
+ * benchmark measures the kernels rather than the memory bandwidth */
+#define NVALUES (100 * 1000 * 1000)
+#define NDISTINCT (BATCH_SIZE * 256)
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static u64 run(struct column_pred *pred, u32 typeoid, u32 width, u8 *data,
+	       double *secs)
+{
+	struct vector vec = { .typeoid = typeoid, .typemod = width, .width = width };
+	u64	      bits[BITMAP_WORDS];
+	u64	      nsel  = 0;
+	double	      start = now();
+	size_t	      done;
+	size_t	      off;
+	u16	      w;
+
+	for (done = 0; done < NVALUES; done += BATCH_SIZE) {
+		off	 = done % NDISTINCT;
+		vec.data = data + off * width;
+		kernel_filter(pred, &vec, BATCH_SIZE, bits);
+		for (w = 0; w < BITMAP_WORDS; ++w)
+			nsel += __builtin_popcountll(bits[w]);
+	}
+	*secs = now() - start;
+	return nsel;
+}
+
+static void bench(const char *name, struct column_pred *pred, u32 typeoid,
+		  u32 width, u8 *data)
+{
+	enum kernel_isa isa;
+	double		scalar = 0;
+	double		secs;
+	u64		nsel;
+
+	for (isa = KERNEL_SCALAR; isa <= KERNEL_AVX2; ++isa) {
+		if (kernel_use_isa(isa))
+			continue;
+		nsel = run(pred, typeoid, width, data, &secs);
+		if (isa == KERNEL_SCALAR)
+			scalar = secs;
+		printf("%-16s %-7s %8.1f ms %6.2f ns/value %5.1fx  (%llu selected)\n",
+		       name, kernel_isa_name(isa), secs * 1e3,
+		       secs * 1e9 / NVALUES, scalar / secs,
+		       (unsigned long long)nsel);
+	}
+}
+
+int main(void)
+{
+	static const char  *words[] = { "apple", "apricot", "banana", "cherry" };
+	struct column_pred  pred    = { 0 };
+	u8		   *data;
+	size_t		    i;
+
+	/* room for the widest values, plus the padding of a vector */
+	data = malloc((size_t)NDISTINCT * 8 + VECTOR_PADDING);
+	srand(1);
+
+	for (i = 0; i < NDISTINCT; ++i)
+		((i16 *)data)[i] = rand() % 2000 - 1000;
+	pred.op	     = EXPR_GT;
+	pred.val_int = 0;
+	bench("int2 > 0", &pred, DTYPE_INT2, 2, data);
+
+	for (i = 0; i < NDISTINCT; ++i)
+		((i32 *)data)[i] = rand() - RAND_MAX / 2;
+	bench("int4 > 0", &pred, DTYPE_INT4, 4, data);
+	pred.op = EXPR_EQ;
+	bench("int4 = 0", &pred, DTYPE_INT4, 4, data);
+
+	for (i = 0; i < NDISTINCT; ++i)
+		((i64 *)data)[i] = ((i64)rand() << 32) - ((i64)RAND_MAX << 31);
+	pred.op = EXPR_LE;
+	bench("int8 <= 0", &pred, DTYPE_INT8, 8, data);
+
+	for (i = 0; i < NDISTINCT; ++i)
+		strncpy((char *)data + i * 8, words[rand() % 4], 8);
+	pred.op	 = EXPR_EQ;
+	pred.str = (const u8 *)"banana";
+	pred.len = 6;
+	bench("char(8) = const", &pred, DTYPE_CHAR, 8, data);
+	pred.op	 = EXPR_LIKE;
+	pred.str = (const u8 *)"ap";
+	pred.len = 2;
+	bench("char(8) LIKE ap%", &pred, DTYPE_CHAR, 8, data);
+
+	free(data);
+	return 0;
+}
@@ -0,0 +1,83 @@
+/* Microbenchmark of the lexer: a few MB of SQL text made of typical queries,
+ * tokenized over and over */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "parser/lex.h"
+
+/* the text is small enough to stay in the caches, so that the benchmark
+ * measures the lexer rather than the memory bandwidth */
+#define TEXT_SIZE (4 * 1024 * 1024)
+#define NPASSES 64
+
+static const char *queries[] = {
+	"SELECT a, b, count(*) FROM orders WHERE a > 10 AND b <> 'x' "
+	"GROUP BY a, b ORDER BY a DESC LIMIT 100;\n",
+	"select o.id, c.name from orders as o inner join customers as c "
+	"on o.customer = c.id where o.amount >= -250 order by o.id;\n",
+	"CREATE TABLE lineitem (orderkey BIGINT, partkey INT, "
+	"quantity SMALLINT, comment CHAR(44));\n",
+	"SELECT sum(quantity * 2 + 1) / 3 % 7 FROM lineitem "
+	"WHERE comment LIKE 'fast%' OR NOT partkey != 12345678;\n",
+	"COPY lineitem FROM STDIN WITH (FORMAT text);\n",
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void)
+{
+	char	  *text = malloc(TEXT_SIZE + 1);
+	size_t	   len	= 0;
+	size_t	   qlen;
+	u64	   ntokens  = 0;
+	u64	   nkeyword = 0;
+	struct lex lex;
+	double	   start;
+	double	   secs;
+	int	   i;
+
+	for (i = 0;; i = (i + 1) % (sizeof(queries) / sizeof(queries[0]))) {
+		qlen = strlen(queries[i]);
+		if (len + qlen > TEXT_SIZE)
+			break;
+		memcpy(text + len, queries[i], qlen);
+		len += qlen;
+	}
+	text[len] = '\0';
+
+	start = now();
+	for (i = 0; i < NPASSES; ++i) {
+		lex_init(&lex, text);
+		for (;;) {
+			lex_next_token(&lex);
+			if (lex.token.tclass == TK_EOF ||
+			    lex.token.tclass == TK_INVALID)
+				break;
+			ntokens++;
+			nkeyword += lex.token.tclass >= TK_AND;
+		}
+		if (lex.token.tclass == TK_INVALID) {
+			fprintf(stderr, "invalid token at %zu\n",
+				lex.token.begin);
+			return 1;
+		}
+	}
+	secs = now() - start;
+	printf("lex %8.1f ms %7.1f MB/s %6.2f ns/token  "
+	       "(%llu tokens, %llu keywords)\n",
+	       secs * 1e3, (double)len * NPASSES / secs / 1e6,
+	       secs * 1e9 / ntokens, (unsigned long long)ntokens,
+	       (unsigned long long)nkeyword);
+
+	free(text);
+	return 0;
+}
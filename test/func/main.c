@@ -45,7 +45,7 @@ static void self_exe_path(char *buf, size_t buflen)
 		exit(EXIT_FAILURE);
 	}
 #elif __unix__
-	if (readlink("/proc/self/exe", buf, buflen - 1) < buflen) {
+	if (readlink("/proc/self/exe", buf, buflen - 1) < 0) {
 		perror("readlink");
 		exit(EXIT_FAILURE);
 	}
@@ -56,10 +56,11 @@ static void self_exe_path(char *buf, size_t buflen)
 
 static void init(void)
 {
+	char exepath[MAX_PATH_LEN];
 	char basedir[MAX_PATH_LEN];
 
-	self_exe_path(basedir, sizeof(basedir));
-	strncpy(basedir, dirname(dirname(basedir)), sizeof(basedir));
+	self_exe_path(exepath, sizeof(exepath));
+	strcpy(basedir, dirname(dirname(exepath)));
 
 	strcpy(testdir, basedir);
 	strcat(testdir, "/test/func/test/");
@@ -103,11 +104,6 @@ static void start_server(void)
 	serverpid = pid;
 }
 
-static void stop_server(void)
-{
-	kill(serverpid, SIGTERM);
-}
-
 static void print_file(const char *path)
 {
 	char  c;
@@ -118,6 +114,27 @@ static void print_file(const char *path)
 	fclose(f);
 }
 
+/* Stop the server, returning nonzero if it did not exit cleanly, such as
+ * when LeakSanitizer found leaks */
+static int stop_server(void)
+{
+	int status;
+
+	kill(serverpid, SIGTERM);
+	if (waitpid(serverpid, &status, 0) == -1) {
+		perror("waitpid");
+		return 1;
+	}
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		return 0;
+	if (WIFEXITED(status))
+		printf("server exited with status %d\n", WEXITSTATUS(status));
+	if (WIFSIGNALED(status))
+		printf("server terminated with signal %d\n", WTERMSIG(status));
+	print_file(errlogpath);
+	return 1;
+}
+
 static int check_server_alive(void)
 {
 	int status;
@@ -284,6 +301,8 @@ int main(int argc, char **argv)
 {
 	char  *testnames[1024];
 	size_t ntests;
+	int    failed = 0;
+	int    rc;
 
 	init();
 
@@ -294,14 +313,16 @@ int main(int argc, char **argv)
 	printf("Collected %lu tests\n", ntests);
 
 	for (int i = 0; i < ntests; ++i) {
-		int rc;
-
 		printf("%s...\n", testnames[i]);
 		rc = run_test(testnames[i]);
+		failed += rc != 0;
 		printf("%s...%s\n", testnames[i], rc ? "FAIL" : "OK");
 	}
 
-	stop_server();
+	/* only show what the server reports while shutting down */
+	truncate(errlogpath, 0);
+	rc = stop_server();
+	printf("server shutdown...%s\n", rc ? "FAIL" : "OK");
 
-	return 0;
+	return failed || rc ? EXIT_FAILURE : 0;
 }
@@ -0,0 +1,9 @@
+copy foo to stdout;
+
+copy foo to stdout with (format text);
+
+copy foo to stdout (format xml);
+
+copy bar to stdout;
+
+copy foo to;
@@ -0,0 +1,19 @@
+create table ins (a int, b char(5), c smallint);
+
+insert into ins values (1, 'one', 10), (2, 'two', -20);
+
+insert into ins (c, b, a) values (3 * 4, 'three', 7 - 1);
+
+insert into ins values (4, 'toolong', 1);
+
+insert into ins values (4, 'four', 40000);
+
+insert into ins values (4, 4, 4);
+
+insert into ins (a, b) values (4, 'four');
+
+insert into ins values (4, 'four');
+
+insert ins values (4, 'four', 4);
+
+select * from ins order by a;
@@ -0,0 +1,31 @@
+create table sales (region char(5), qty int);
+
+copy sales from stdin;
+north	3
+south	5
+north	7
+east	1
+south	2
+north	2
+\.
+
+-- aggregates over the whole table
+select count(*), sum(qty), min(qty), max(qty), avg(qty) from sales;
+
+select min(region), max(region) from sales;
+
+select count(*), sum(qty), avg(qty) from sales where qty > 100;
+
+-- groups
+select region, count(*), sum(qty) from sales group by region;
+
+select region, max(qty) as top from sales where qty > 2 group by region;
+
+select count(*) from sales group by qty % 2;
+
+-- errors
+select region, qty from sales group by region;
+
+select sum(region) from sales;
+
+select count(*) from sales group qty;
@@ -0,0 +1,19 @@
+create table jt (x int);
+
+copy jt from stdin;
+10
+20
+\.
+
+-- every pair of rows
+select * from foo, jt;
+
+-- qualified column names
+select jt.x, foo.a from foo, jt limit 2;
+
+-- bad references
+select oid from tables, columns;
+
+select t2.x from foo, jt;
+
+select * from foo, foo;
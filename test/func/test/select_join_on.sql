@@ -0,0 +1,53 @@
+create table authors (id int, name char(8));
+
+create table books (author smallint, title char(10), pages int);
+
+copy authors from stdin;
+1	austen
+2	bronte
+3	dickens
+4	eliot
+\.
+
+copy books from stdin;
+1	emma	474
+3	bleak	1017
+1	persuasion	249
+3	hard times	352
+2	jane eyre	507
+5	anonymous	120
+\.
+
+-- inner joins
+select name, title from authors join books on id = author;
+
+select name, title from authors inner join books on books.author = authors.id where pages > 400;
+
+select name, title from authors join books on id = author and pages < 300;
+
+select name, title from authors, books where id = author and name = 'dickens';
+
+-- left joins
+select name, title from authors left join books on id = author;
+
+select name, title, pages from authors left outer join books on id = author and pages > 400;
+
+select name, title from authors left join books on id = author where pages < 400;
+
+select name, count(title), sum(pages) from authors left join books on id = author group by name;
+
+select title, name from books left join authors on author = id;
+
+-- joins without equality
+select name, title from authors join books on id > author where pages < 400;
+
+select name, title from authors left join books on id < author and pages < 200;
+
+-- errors
+select name from authors join books;
+
+select name from authors left books on id = author;
+
+select name from authors join books on id;
+
+select name from authors join books on id = missing;
@@ -0,0 +1,1828 @@
+-- tables too large for the memory budget are joined by sorting and merging
+create table mja (k int, pad char(8000));
+
+create table mjb (k int, pad char(8000));
+
+create table mjc (k int, pad char(8000));
+
+copy mja from stdin;
+0	mja
+7	mja
+14	mja
+21	mja
+28	mja
+35	mja
+42	mja
+49	mja
+56	mja
+63	mja
+70	mja
+77	mja
+84	mja
+91	mja
+98	mja
+105	mja
+112	mja
+119	mja
+126	mja
+133	mja
+140	mja
+147	mja
+154	mja
+161	mja
+168	mja
+175	mja
+182	mja
+189	mja
+196	mja
+203	mja
+210	mja
+217	mja
+224	mja
+231	mja
+238	mja
+245	mja
+252	mja
+259	mja
+266	mja
+273	mja
+280	mja
+287	mja
+294	mja
+301	mja
+308	mja
+315	mja
+322	mja
+329	mja
+336	mja
+343	mja
+350	mja
+357	mja
+364	mja
+371	mja
+378	mja
+385	mja
+392	mja
+399	mja
+406	mja
+413	mja
+420	mja
+427	mja
+434	mja
+441	mja
+448	mja
+455	mja
+462	mja
+469	mja
+476	mja
+483	mja
+490	mja
+497	mja
+504	mja
+511	mja
+518	mja
+525	mja
+532	mja
+539	mja
+546	mja
+553	mja
+560	mja
+567	mja
+574	mja
+581	mja
+588	mja
+595	mja
+2	mja
+9	mja
+16	mja
+23	mja
+30	mja
+37	mja
+44	mja
+51	mja
+58	mja
+65	mja
+72	mja
+79	mja
+86	mja
+93	mja
+100	mja
+107	mja
+114	mja
+121	mja
+128	mja
+135	mja
+142	mja
+149	mja
+156	mja
+163	mja
+170	mja
+177	mja
+184	mja
+191	mja
+198	mja
+205	mja
+212	mja
+219	mja
+226	mja
+233	mja
+240	mja
+247	mja
+254	mja
+261	mja
+268	mja
+275	mja
+282	mja
+289	mja
+296	mja
+303	mja
+310	mja
+317	mja
+324	mja
+331	mja
+338	mja
+345	mja
+352	mja
+359	mja
+366	mja
+373	mja
+380	mja
+387	mja
+394	mja
+401	mja
+408	mja
+415	mja
+422	mja
+429	mja
+436	mja
+443	mja
+450	mja
+457	mja
+464	mja
+471	mja
+478	mja
+485	mja
+492	mja
+499	mja
+506	mja
+513	mja
+520	mja
+527	mja
+534	mja
+541	mja
+548	mja
+555	mja
+562	mja
+569	mja
+576	mja
+583	mja
+590	mja
+597	mja
+4	mja
+11	mja
+18	mja
+25	mja
+32	mja
+39	mja
+46	mja
+53	mja
+60	mja
+67	mja
+74	mja
+81	mja
+88	mja
+95	mja
+102	mja
+109	mja
+116	mja
+123	mja
+130	mja
+137	mja
+144	mja
+151	mja
+158	mja
+165	mja
+172	mja
+179	mja
+186	mja
+193	mja
+200	mja
+207	mja
+214	mja
+221	mja
+228	mja
+235	mja
+242	mja
+249	mja
+256	mja
+263	mja
+270	mja
+277	mja
+284	mja
+291	mja
+298	mja
+305	mja
+312	mja
+319	mja
+326	mja
+333	mja
+340	mja
+347	mja
+354	mja
+361	mja
+368	mja
+375	mja
+382	mja
+389	mja
+396	mja
+403	mja
+410	mja
+417	mja
+424	mja
+431	mja
+438	mja
+445	mja
+452	mja
+459	mja
+466	mja
+473	mja
+480	mja
+487	mja
+494	mja
+501	mja
+508	mja
+515	mja
+522	mja
+529	mja
+536	mja
+543	mja
+550	mja
+557	mja
+564	mja
+571	mja
+578	mja
+585	mja
+592	mja
+599	mja
+6	mja
+13	mja
+20	mja
+27	mja
+34	mja
+41	mja
+48	mja
+55	mja
+62	mja
+69	mja
+76	mja
+83	mja
+90	mja
+97	mja
+104	mja
+111	mja
+118	mja
+125	mja
+132	mja
+139	mja
+146	mja
+153	mja
+160	mja
+167	mja
+174	mja
+181	mja
+188	mja
+195	mja
+202	mja
+209	mja
+216	mja
+223	mja
+230	mja
+237	mja
+244	mja
+251	mja
+258	mja
+265	mja
+272	mja
+279	mja
+286	mja
+293	mja
+300	mja
+307	mja
+314	mja
+321	mja
+328	mja
+335	mja
+342	mja
+349	mja
+356	mja
+363	mja
+370	mja
+377	mja
+384	mja
+391	mja
+398	mja
+405	mja
+412	mja
+419	mja
+426	mja
+433	mja
+440	mja
+447	mja
+454	mja
+461	mja
+468	mja
+475	mja
+482	mja
+489	mja
+496	mja
+503	mja
+510	mja
+517	mja
+524	mja
+531	mja
+538	mja
+545	mja
+552	mja
+559	mja
+566	mja
+573	mja
+580	mja
+587	mja
+594	mja
+1	mja
+8	mja
+15	mja
+22	mja
+29	mja
+36	mja
+43	mja
+50	mja
+57	mja
+64	mja
+71	mja
+78	mja
+85	mja
+92	mja
+99	mja
+106	mja
+113	mja
+120	mja
+127	mja
+134	mja
+141	mja
+148	mja
+155	mja
+162	mja
+169	mja
+176	mja
+183	mja
+190	mja
+197	mja
+204	mja
+211	mja
+218	mja
+225	mja
+232	mja
+239	mja
+246	mja
+253	mja
+260	mja
+267	mja
+274	mja
+281	mja
+288	mja
+295	mja
+302	mja
+309	mja
+316	mja
+323	mja
+330	mja
+337	mja
+344	mja
+351	mja
+358	mja
+365	mja
+372	mja
+379	mja
+386	mja
+393	mja
+400	mja
+407	mja
+414	mja
+421	mja
+428	mja
+435	mja
+442	mja
+449	mja
+456	mja
+463	mja
+470	mja
+477	mja
+484	mja
+491	mja
+498	mja
+505	mja
+512	mja
+519	mja
+526	mja
+533	mja
+540	mja
+547	mja
+554	mja
+561	mja
+568	mja
+575	mja
+582	mja
+589	mja
+596	mja
+3	mja
+10	mja
+17	mja
+24	mja
+31	mja
+38	mja
+45	mja
+52	mja
+59	mja
+66	mja
+73	mja
+80	mja
+87	mja
+94	mja
+101	mja
+108	mja
+115	mja
+122	mja
+129	mja
+136	mja
+143	mja
+150	mja
+157	mja
+164	mja
+171	mja
+178	mja
+185	mja
+192	mja
+199	mja
+206	mja
+213	mja
+220	mja
+227	mja
+234	mja
+241	mja
+248	mja
+255	mja
+262	mja
+269	mja
+276	mja
+283	mja
+290	mja
+297	mja
+304	mja
+311	mja
+318	mja
+325	mja
+332	mja
+339	mja
+346	mja
+353	mja
+360	mja
+367	mja
+374	mja
+381	mja
+388	mja
+395	mja
+402	mja
+409	mja
+416	mja
+423	mja
+430	mja
+437	mja
+444	mja
+451	mja
+458	mja
+465	mja
+472	mja
+479	mja
+486	mja
+493	mja
+500	mja
+507	mja
+514	mja
+521	mja
+528	mja
+535	mja
+542	mja
+549	mja
+556	mja
+563	mja
+570	mja
+577	mja
+584	mja
+591	mja
+598	mja
+5	mja
+12	mja
+19	mja
+26	mja
+33	mja
+40	mja
+47	mja
+54	mja
+61	mja
+68	mja
+75	mja
+82	mja
+89	mja
+96	mja
+103	mja
+110	mja
+117	mja
+124	mja
+131	mja
+138	mja
+145	mja
+152	mja
+159	mja
+166	mja
+173	mja
+180	mja
+187	mja
+194	mja
+201	mja
+208	mja
+215	mja
+222	mja
+229	mja
+236	mja
+243	mja
+250	mja
+257	mja
+264	mja
+271	mja
+278	mja
+285	mja
+292	mja
+299	mja
+306	mja
+313	mja
+320	mja
+327	mja
+334	mja
+341	mja
+348	mja
+355	mja
+362	mja
+369	mja
+376	mja
+383	mja
+390	mja
+397	mja
+404	mja
+411	mja
+418	mja
+425	mja
+432	mja
+439	mja
+446	mja
+453	mja
+460	mja
+467	mja
+474	mja
+481	mja
+488	mja
+495	mja
+502	mja
+509	mja
+516	mja
+523	mja
+530	mja
+537	mja
+544	mja
+551	mja
+558	mja
+565	mja
+572	mja
+579	mja
+586	mja
+593	mja
+\.
+
+copy mjb from stdin;
+0	mjb
+11	mjb
+22	mjb
+33	mjb
+44	mjb
+55	mjb
+66	mjb
+77	mjb
+88	mjb
+99	mjb
+110	mjb
+121	mjb
+132	mjb
+143	mjb
+154	mjb
+165	mjb
+176	mjb
+187	mjb
+198	mjb
+209	mjb
+220	mjb
+231	mjb
+242	mjb
+253	mjb
+264	mjb
+275	mjb
+286	mjb
+297	mjb
+308	mjb
+319	mjb
+330	mjb
+341	mjb
+352	mjb
+363	mjb
+374	mjb
+385	mjb
+396	mjb
+407	mjb
+418	mjb
+429	mjb
+440	mjb
+451	mjb
+462	mjb
+473	mjb
+484	mjb
+495	mjb
+506	mjb
+517	mjb
+528	mjb
+539	mjb
+550	mjb
+561	mjb
+572	mjb
+583	mjb
+594	mjb
+5	mjb
+16	mjb
+27	mjb
+38	mjb
+49	mjb
+60	mjb
+71	mjb
+82	mjb
+93	mjb
+104	mjb
+115	mjb
+126	mjb
+137	mjb
+148	mjb
+159	mjb
+170	mjb
+181	mjb
+192	mjb
+203	mjb
+214	mjb
+225	mjb
+236	mjb
+247	mjb
+258	mjb
+269	mjb
+280	mjb
+291	mjb
+302	mjb
+313	mjb
+324	mjb
+335	mjb
+346	mjb
+357	mjb
+368	mjb
+379	mjb
+390	mjb
+401	mjb
+412	mjb
+423	mjb
+434	mjb
+445	mjb
+456	mjb
+467	mjb
+478	mjb
+489	mjb
+500	mjb
+511	mjb
+522	mjb
+533	mjb
+544	mjb
+555	mjb
+566	mjb
+577	mjb
+588	mjb
+599	mjb
+10	mjb
+21	mjb
+32	mjb
+43	mjb
+54	mjb
+65	mjb
+76	mjb
+87	mjb
+98	mjb
+109	mjb
+120	mjb
+131	mjb
+142	mjb
+153	mjb
+164	mjb
+175	mjb
+186	mjb
+197	mjb
+208	mjb
+219	mjb
+230	mjb
+241	mjb
+252	mjb
+263	mjb
+274	mjb
+285	mjb
+296	mjb
+307	mjb
+318	mjb
+329	mjb
+340	mjb
+351	mjb
+362	mjb
+373	mjb
+384	mjb
+395	mjb
+406	mjb
+417	mjb
+428	mjb
+439	mjb
+450	mjb
+461	mjb
+472	mjb
+483	mjb
+494	mjb
+505	mjb
+516	mjb
+527	mjb
+538	mjb
+549	mjb
+560	mjb
+571	mjb
+582	mjb
+593	mjb
+4	mjb
+15	mjb
+26	mjb
+37	mjb
+48	mjb
+59	mjb
+70	mjb
+81	mjb
+92	mjb
+103	mjb
+114	mjb
+125	mjb
+136	mjb
+147	mjb
+158	mjb
+169	mjb
+180	mjb
+191	mjb
+202	mjb
+213	mjb
+224	mjb
+235	mjb
+246	mjb
+257	mjb
+268	mjb
+279	mjb
+290	mjb
+301	mjb
+312	mjb
+323	mjb
+334	mjb
+345	mjb
+356	mjb
+367	mjb
+378	mjb
+389	mjb
+400	mjb
+411	mjb
+422	mjb
+433	mjb
+444	mjb
+455	mjb
+466	mjb
+477	mjb
+488	mjb
+499	mjb
+510	mjb
+521	mjb
+532	mjb
+543	mjb
+554	mjb
+565	mjb
+576	mjb
+587	mjb
+598	mjb
+9	mjb
+20	mjb
+31	mjb
+42	mjb
+53	mjb
+64	mjb
+75	mjb
+86	mjb
+97	mjb
+108	mjb
+119	mjb
+130	mjb
+141	mjb
+152	mjb
+163	mjb
+174	mjb
+185	mjb
+196	mjb
+207	mjb
+218	mjb
+229	mjb
+240	mjb
+251	mjb
+262	mjb
+273	mjb
+284	mjb
+295	mjb
+306	mjb
+317	mjb
+328	mjb
+339	mjb
+350	mjb
+361	mjb
+372	mjb
+383	mjb
+394	mjb
+405	mjb
+416	mjb
+427	mjb
+438	mjb
+449	mjb
+460	mjb
+471	mjb
+482	mjb
+493	mjb
+504	mjb
+515	mjb
+526	mjb
+537	mjb
+548	mjb
+559	mjb
+570	mjb
+581	mjb
+592	mjb
+3	mjb
+14	mjb
+25	mjb
+36	mjb
+47	mjb
+58	mjb
+69	mjb
+80	mjb
+91	mjb
+102	mjb
+113	mjb
+124	mjb
+135	mjb
+146	mjb
+157	mjb
+168	mjb
+179	mjb
+190	mjb
+201	mjb
+212	mjb
+223	mjb
+234	mjb
+245	mjb
+256	mjb
+267	mjb
+278	mjb
+289	mjb
+300	mjb
+311	mjb
+322	mjb
+333	mjb
+344	mjb
+355	mjb
+366	mjb
+377	mjb
+388	mjb
+399	mjb
+410	mjb
+421	mjb
+432	mjb
+443	mjb
+454	mjb
+465	mjb
+476	mjb
+487	mjb
+498	mjb
+509	mjb
+520	mjb
+531	mjb
+542	mjb
+553	mjb
+564	mjb
+575	mjb
+586	mjb
+597	mjb
+8	mjb
+19	mjb
+30	mjb
+41	mjb
+52	mjb
+63	mjb
+74	mjb
+85	mjb
+96	mjb
+107	mjb
+118	mjb
+129	mjb
+140	mjb
+151	mjb
+162	mjb
+173	mjb
+184	mjb
+195	mjb
+206	mjb
+217	mjb
+228	mjb
+239	mjb
+250	mjb
+261	mjb
+272	mjb
+283	mjb
+294	mjb
+305	mjb
+316	mjb
+327	mjb
+338	mjb
+349	mjb
+360	mjb
+371	mjb
+382	mjb
+393	mjb
+404	mjb
+415	mjb
+426	mjb
+437	mjb
+448	mjb
+459	mjb
+470	mjb
+481	mjb
+492	mjb
+503	mjb
+514	mjb
+525	mjb
+536	mjb
+547	mjb
+558	mjb
+569	mjb
+580	mjb
+591	mjb
+2	mjb
+13	mjb
+24	mjb
+35	mjb
+46	mjb
+57	mjb
+68	mjb
+79	mjb
+90	mjb
+101	mjb
+112	mjb
+123	mjb
+134	mjb
+145	mjb
+156	mjb
+167	mjb
+178	mjb
+189	mjb
+200	mjb
+211	mjb
+222	mjb
+233	mjb
+244	mjb
+255	mjb
+266	mjb
+277	mjb
+288	mjb
+299	mjb
+310	mjb
+321	mjb
+332	mjb
+343	mjb
+354	mjb
+365	mjb
+376	mjb
+387	mjb
+398	mjb
+409	mjb
+420	mjb
+431	mjb
+442	mjb
+453	mjb
+464	mjb
+475	mjb
+486	mjb
+497	mjb
+508	mjb
+519	mjb
+530	mjb
+541	mjb
+552	mjb
+563	mjb
+574	mjb
+585	mjb
+596	mjb
+7	mjb
+18	mjb
+29	mjb
+40	mjb
+51	mjb
+62	mjb
+73	mjb
+84	mjb
+95	mjb
+106	mjb
+117	mjb
+128	mjb
+139	mjb
+150	mjb
+161	mjb
+172	mjb
+183	mjb
+194	mjb
+205	mjb
+216	mjb
+227	mjb
+238	mjb
+249	mjb
+260	mjb
+271	mjb
+282	mjb
+293	mjb
+304	mjb
+315	mjb
+326	mjb
+337	mjb
+348	mjb
+359	mjb
+370	mjb
+381	mjb
+392	mjb
+403	mjb
+414	mjb
+425	mjb
+436	mjb
+447	mjb
+458	mjb
+469	mjb
+480	mjb
+491	mjb
+502	mjb
+513	mjb
+524	mjb
+535	mjb
+546	mjb
+557	mjb
+568	mjb
+579	mjb
+590	mjb
+1	mjb
+12	mjb
+23	mjb
+34	mjb
+45	mjb
+56	mjb
+67	mjb
+78	mjb
+89	mjb
+100	mjb
+111	mjb
+122	mjb
+133	mjb
+144	mjb
+155	mjb
+166	mjb
+177	mjb
+188	mjb
+199	mjb
+210	mjb
+221	mjb
+232	mjb
+243	mjb
+254	mjb
+265	mjb
+276	mjb
+287	mjb
+298	mjb
+309	mjb
+320	mjb
+331	mjb
+342	mjb
+353	mjb
+364	mjb
+375	mjb
+386	mjb
+397	mjb
+408	mjb
+419	mjb
+430	mjb
+441	mjb
+452	mjb
+463	mjb
+474	mjb
+485	mjb
+496	mjb
+507	mjb
+518	mjb
+529	mjb
+540	mjb
+551	mjb
+562	mjb
+573	mjb
+584	mjb
+595	mjb
+6	mjb
+17	mjb
+28	mjb
+39	mjb
+50	mjb
+61	mjb
+72	mjb
+83	mjb
+94	mjb
+105	mjb
+116	mjb
+127	mjb
+138	mjb
+149	mjb
+160	mjb
+171	mjb
+182	mjb
+193	mjb
+204	mjb
+215	mjb
+226	mjb
+237	mjb
+248	mjb
+259	mjb
+270	mjb
+281	mjb
+292	mjb
+303	mjb
+314	mjb
+325	mjb
+336	mjb
+347	mjb
+358	mjb
+369	mjb
+380	mjb
+391	mjb
+402	mjb
+413	mjb
+424	mjb
+435	mjb
+446	mjb
+457	mjb
+468	mjb
+479	mjb
+490	mjb
+501	mjb
+512	mjb
+523	mjb
+534	mjb
+545	mjb
+556	mjb
+567	mjb
+578	mjb
+589	mjb
+\.
+
+copy mjc from stdin;
+300	mjc
+313	mjc
+326	mjc
+339	mjc
+352	mjc
+365	mjc
+378	mjc
+391	mjc
+404	mjc
+417	mjc
+430	mjc
+443	mjc
+456	mjc
+469	mjc
+482	mjc
+495	mjc
+508	mjc
+521	mjc
+534	mjc
+547	mjc
+560	mjc
+573	mjc
+586	mjc
+599	mjc
+612	mjc
+625	mjc
+638	mjc
+651	mjc
+664	mjc
+677	mjc
+690	mjc
+703	mjc
+716	mjc
+729	mjc
+742	mjc
+755	mjc
+768	mjc
+781	mjc
+794	mjc
+807	mjc
+820	mjc
+833	mjc
+846	mjc
+859	mjc
+872	mjc
+885	mjc
+898	mjc
+311	mjc
+324	mjc
+337	mjc
+350	mjc
+363	mjc
+376	mjc
+389	mjc
+402	mjc
+415	mjc
+428	mjc
+441	mjc
+454	mjc
+467	mjc
+480	mjc
+493	mjc
+506	mjc
+519	mjc
+532	mjc
+545	mjc
+558	mjc
+571	mjc
+584	mjc
+597	mjc
+610	mjc
+623	mjc
+636	mjc
+649	mjc
+662	mjc
+675	mjc
+688	mjc
+701	mjc
+714	mjc
+727	mjc
+740	mjc
+753	mjc
+766	mjc
+779	mjc
+792	mjc
+805	mjc
+818	mjc
+831	mjc
+844	mjc
+857	mjc
+870	mjc
+883	mjc
+896	mjc
+309	mjc
+322	mjc
+335	mjc
+348	mjc
+361	mjc
+374	mjc
+387	mjc
+400	mjc
+413	mjc
+426	mjc
+439	mjc
+452	mjc
+465	mjc
+478	mjc
+491	mjc
+504	mjc
+517	mjc
+530	mjc
+543	mjc
+556	mjc
+569	mjc
+582	mjc
+595	mjc
+608	mjc
+621	mjc
+634	mjc
+647	mjc
+660	mjc
+673	mjc
+686	mjc
+699	mjc
+712	mjc
+725	mjc
+738	mjc
+751	mjc
+764	mjc
+777	mjc
+790	mjc
+803	mjc
+816	mjc
+829	mjc
+842	mjc
+855	mjc
+868	mjc
+881	mjc
+894	mjc
+307	mjc
+320	mjc
+333	mjc
+346	mjc
+359	mjc
+372	mjc
+385	mjc
+398	mjc
+411	mjc
+424	mjc
+437	mjc
+450	mjc
+463	mjc
+476	mjc
+489	mjc
+502	mjc
+515	mjc
+528	mjc
+541	mjc
+554	mjc
+567	mjc
+580	mjc
+593	mjc
+606	mjc
+619	mjc
+632	mjc
+645	mjc
+658	mjc
+671	mjc
+684	mjc
+697	mjc
+710	mjc
+723	mjc
+736	mjc
+749	mjc
+762	mjc
+775	mjc
+788	mjc
+801	mjc
+814	mjc
+827	mjc
+840	mjc
+853	mjc
+866	mjc
+879	mjc
+892	mjc
+305	mjc
+318	mjc
+331	mjc
+344	mjc
+357	mjc
+370	mjc
+383	mjc
+396	mjc
+409	mjc
+422	mjc
+435	mjc
+448	mjc
+461	mjc
+474	mjc
+487	mjc
+500	mjc
+513	mjc
+526	mjc
+539	mjc
+552	mjc
+565	mjc
+578	mjc
+591	mjc
+604	mjc
+617	mjc
+630	mjc
+643	mjc
+656	mjc
+669	mjc
+682	mjc
+695	mjc
+708	mjc
+721	mjc
+734	mjc
+747	mjc
+760	mjc
+773	mjc
+786	mjc
+799	mjc
+812	mjc
+825	mjc
+838	mjc
+851	mjc
+864	mjc
+877	mjc
+890	mjc
+303	mjc
+316	mjc
+329	mjc
+342	mjc
+355	mjc
+368	mjc
+381	mjc
+394	mjc
+407	mjc
+420	mjc
+433	mjc
+446	mjc
+459	mjc
+472	mjc
+485	mjc
+498	mjc
+511	mjc
+524	mjc
+537	mjc
+550	mjc
+563	mjc
+576	mjc
+589	mjc
+602	mjc
+615	mjc
+628	mjc
+641	mjc
+654	mjc
+667	mjc
+680	mjc
+693	mjc
+706	mjc
+719	mjc
+732	mjc
+745	mjc
+758	mjc
+771	mjc
+784	mjc
+797	mjc
+810	mjc
+823	mjc
+836	mjc
+849	mjc
+862	mjc
+875	mjc
+888	mjc
+301	mjc
+314	mjc
+327	mjc
+340	mjc
+353	mjc
+366	mjc
+379	mjc
+392	mjc
+405	mjc
+418	mjc
+431	mjc
+444	mjc
+457	mjc
+470	mjc
+483	mjc
+496	mjc
+509	mjc
+522	mjc
+535	mjc
+548	mjc
+561	mjc
+574	mjc
+587	mjc
+600	mjc
+613	mjc
+626	mjc
+639	mjc
+652	mjc
+665	mjc
+678	mjc
+691	mjc
+704	mjc
+717	mjc
+730	mjc
+743	mjc
+756	mjc
+769	mjc
+782	mjc
+795	mjc
+808	mjc
+821	mjc
+834	mjc
+847	mjc
+860	mjc
+873	mjc
+886	mjc
+899	mjc
+312	mjc
+325	mjc
+338	mjc
+351	mjc
+364	mjc
+377	mjc
+390	mjc
+403	mjc
+416	mjc
+429	mjc
+442	mjc
+455	mjc
+468	mjc
+481	mjc
+494	mjc
+507	mjc
+520	mjc
+533	mjc
+546	mjc
+559	mjc
+572	mjc
+585	mjc
+598	mjc
+611	mjc
+624	mjc
+637	mjc
+650	mjc
+663	mjc
+676	mjc
+689	mjc
+702	mjc
+715	mjc
+728	mjc
+741	mjc
+754	mjc
+767	mjc
+780	mjc
+793	mjc
+806	mjc
+819	mjc
+832	mjc
+845	mjc
+858	mjc
+871	mjc
+884	mjc
+897	mjc
+310	mjc
+323	mjc
+336	mjc
+349	mjc
+362	mjc
+375	mjc
+388	mjc
+401	mjc
+414	mjc
+427	mjc
+440	mjc
+453	mjc
+466	mjc
+479	mjc
+492	mjc
+505	mjc
+518	mjc
+531	mjc
+544	mjc
+557	mjc
+570	mjc
+583	mjc
+596	mjc
+609	mjc
+622	mjc
+635	mjc
+648	mjc
+661	mjc
+674	mjc
+687	mjc
+700	mjc
+713	mjc
+726	mjc
+739	mjc
+752	mjc
+765	mjc
+778	mjc
+791	mjc
+804	mjc
+817	mjc
+830	mjc
+843	mjc
+856	mjc
+869	mjc
+882	mjc
+895	mjc
+308	mjc
+321	mjc
+334	mjc
+347	mjc
+360	mjc
+373	mjc
+386	mjc
+399	mjc
+412	mjc
+425	mjc
+438	mjc
+451	mjc
+464	mjc
+477	mjc
+490	mjc
+503	mjc
+516	mjc
+529	mjc
+542	mjc
+555	mjc
+568	mjc
+581	mjc
+594	mjc
+607	mjc
+620	mjc
+633	mjc
+646	mjc
+659	mjc
+672	mjc
+685	mjc
+698	mjc
+711	mjc
+724	mjc
+737	mjc
+750	mjc
+763	mjc
+776	mjc
+789	mjc
+802	mjc
+815	mjc
+828	mjc
+841	mjc
+854	mjc
+867	mjc
+880	mjc
+893	mjc
+306	mjc
+319	mjc
+332	mjc
+345	mjc
+358	mjc
+371	mjc
+384	mjc
+397	mjc
+410	mjc
+423	mjc
+436	mjc
+449	mjc
+462	mjc
+475	mjc
+488	mjc
+501	mjc
+514	mjc
+527	mjc
+540	mjc
+553	mjc
+566	mjc
+579	mjc
+592	mjc
+605	mjc
+618	mjc
+631	mjc
+644	mjc
+657	mjc
+670	mjc
+683	mjc
+696	mjc
+709	mjc
+722	mjc
+735	mjc
+748	mjc
+761	mjc
+774	mjc
+787	mjc
+800	mjc
+813	mjc
+826	mjc
+839	mjc
+852	mjc
+865	mjc
+878	mjc
+891	mjc
+304	mjc
+317	mjc
+330	mjc
+343	mjc
+356	mjc
+369	mjc
+382	mjc
+395	mjc
+408	mjc
+421	mjc
+434	mjc
+447	mjc
+460	mjc
+473	mjc
+486	mjc
+499	mjc
+512	mjc
+525	mjc
+538	mjc
+551	mjc
+564	mjc
+577	mjc
+590	mjc
+603	mjc
+616	mjc
+629	mjc
+642	mjc
+655	mjc
+668	mjc
+681	mjc
+694	mjc
+707	mjc
+720	mjc
+733	mjc
+746	mjc
+759	mjc
+772	mjc
+785	mjc
+798	mjc
+811	mjc
+824	mjc
+837	mjc
+850	mjc
+863	mjc
+876	mjc
+889	mjc
+302	mjc
+315	mjc
+328	mjc
+341	mjc
+354	mjc
+367	mjc
+380	mjc
+393	mjc
+406	mjc
+419	mjc
+432	mjc
+445	mjc
+458	mjc
+471	mjc
+484	mjc
+497	mjc
+510	mjc
+523	mjc
+536	mjc
+549	mjc
+562	mjc
+575	mjc
+588	mjc
+601	mjc
+614	mjc
+627	mjc
+640	mjc
+653	mjc
+666	mjc
+679	mjc
+692	mjc
+705	mjc
+718	mjc
+731	mjc
+744	mjc
+757	mjc
+770	mjc
+783	mjc
+796	mjc
+809	mjc
+822	mjc
+835	mjc
+848	mjc
+861	mjc
+874	mjc
+887	mjc
+\.
+
+select mja.k, mjb.k from mja join mjb on mja.k = mjb.k limit 3;
+
+select count(*), min(mjb.k), max(mjb.k) from mja join mjb on mja.k = mjb.k;
+
+-- the output of the first join is already sorted for the second one
+select mja.k, mjb.k, mjc.k from mja join mjb on mja.k = mjb.k join mjc on mjb.k = mjc.k limit 3;
+
+select count(*), min(mjc.k), max(mja.k) from mja join mjb on mja.k = mjb.k join mjc on mja.k = mjc.k;
+
+select count(*), count(mjc.k) from mja join mjb on mja.k = mjb.k left join mjc on mja.k = mjc.k;
+
+select mja.k, mjc.pad from mja left join mjc on mja.k = mjc.k join mjb on mjb.k = mja.k limit 3;
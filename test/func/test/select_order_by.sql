@@ -0,0 +1,65 @@
+create table players (name char(8), team char(5), score int, age smallint);
+
+create table coaches (team char(5), coach char(8));
+
+copy players from stdin;
+ana	red	31	24
+bo	blue	17	31
+cy	red	12	19
+dee	green	25	28
+eli	blue	31	22
+fay	red	8	27
+\.
+
+copy coaches from stdin;
+red	kim
+blue	lou
+\.
+
+-- single keys
+select name, score from players order by score;
+
+select name, score from players order by score desc;
+
+select name from players order by name desc;
+
+-- several keys, positions and output names
+select name, score, age from players order by score desc, age;
+
+select team, name from players order by 1, 2 desc;
+
+select name as player, age from players order by player;
+
+select name from players order by score + age, name;
+
+-- top-N
+select name, score from players order by score desc limit 3;
+
+select name, score from players order by score limit 2 offset 2;
+
+select name from players where team = 'red' order by age limit 1;
+
+-- nulls come last, or first in descending order
+select name, coach from players left join coaches on players.team = coaches.team order by coach, name;
+
+select name, coach from players left join coaches on players.team = coaches.team order by coach desc, name;
+
+-- grouped queries
+select team, count(*), max(score) from players group by team order by team;
+
+select team, sum(score) as total from players group by team order by total desc;
+
+select team, count(*) from players group by team order by 2, 1 desc;
+
+-- errors
+select name from players order by 3;
+
+select name from players order by missing;
+
+select name as age, age from players order by age;
+
+select team, count(*) from players group by team order by score;
+
+select age, count(*) from players group by age order by age + 1;
+
+select name from players order score;
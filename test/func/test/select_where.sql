@@ -0,0 +1,39 @@
+create table nums (n int, m bigint);
+
+copy nums from stdin;
+1	10
+2	20
+3	30
+4	40
+\.
+
+-- comparisons
+select * from nums where n = 2;
+
+select n from nums where n >= 3;
+
+select a from foo where a <> 'two';
+
+select a from foo where a like 't%';
+
+select a from foo where a like '_n%';
+
+-- boolean operators
+select n from nums where n = 1 or n > 3 and m < 40;
+
+select n from nums where not (n = 1 or n = 4);
+
+-- arithmetic
+select n from nums where n * 10 = m and m / 10 - 1 = 2;
+
+select n from nums where -n % 2 = -1;
+
+-- conditions over several tables
+select a, n from foo, nums where b = n and m > 10;
+
+-- errors
+select n from nums where n;
+
+select n from nums where n = 'one';
+
+select n from nums where m / (n - 2) > 0;
@@ -0,0 +1,88 @@
+#include "executor/batch.h"
+#include "executor/tablescan.h"
+#include "fixture.h"
+#include "test.h"
+
+#include "dtype.h"
+#include "storage/heap.h"
+#include "table.h"
+#include "univ.h"
+#include "util/mem.h"
+
+struct test_tup {
+	i16  a;
+	char b[3];
+	i64  c;
+} __attribute__((packed));
+
+static const struct test_col cols[] = {
+	{ DTYPE_INT2, 0 },
+	{ DTYPE_CHAR, 3 },
+	{ DTYPE_INT8, 0 },
+};
+
+static void fill(u8 *tup, int i)
+{
+	struct test_tup *t = (struct test_tup *)tup;
+
+	t->a = i;
+	memcpy(t->b, "xyz", 3);
+	t->c = -i;
+}
+
+static void test_scan_batches()
+{
+	struct mem_root	      r;
+	struct table	      table;
+	struct heap	      heap;
+	struct tablescan_iter iter;
+	struct batch	      batch;
+	i64		      c;
+	u16		      n;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&table, &heap, TEST_TABLE_OID, 3, cols, BATCH_SIZE + 10,
+		   fill);
+
+	tablescan_begin(&iter, &table);
+	batch_init(&batch, table.ncols);
+	vector_init(&batch.cols[2], DTYPE_INT8, -1);
+
+	n = tablescan_next_batch(&iter, &batch, NULL);
+	EXPECT_EQ(n, BATCH_SIZE);
+	EXPECT_EQ(batch_count(&batch), BATCH_SIZE);
+	/* columns without a vector are not decoded */
+	EXPECT_TRUE((batch.cols[0].data == NULL));
+	memcpy(&c, vector_at(&batch.cols[2], 7), sizeof(c));
+	EXPECT_EQ(c, -7);
+
+	n = tablescan_next_batch(&iter, &batch, NULL);
+	EXPECT_EQ(n, 10);
+	memcpy(&c, vector_at(&batch.cols[2], 9), sizeof(c));
+	EXPECT_EQ(c, -(BATCH_SIZE + 9));
+
+	n = tablescan_next_batch(&iter, &batch, NULL);
+	EXPECT_EQ(n, 0);
+	tablescan_end(&iter);
+	free_table(&table, &heap);
+	mem_root_clear(&r);
+}
+
+static void test_selection()
+{
+	struct batch batch;
+	u16	     sel[] = { 2, 5 };
+
+	batch.nrows = 8;
+	batch.sel   = NULL;
+	EXPECT_EQ(batch_count(&batch), 8);
+	EXPECT_EQ(batch_row(&batch, 3), 3);
+
+	batch.sel  = sel;
+	batch.nsel = 2;
+	EXPECT_EQ(batch_count(&batch), 2);
+	EXPECT_EQ(batch_row(&batch, 1), 5);
+}
+
+TEST_SUITE(batch, TEST(test_scan_batches), TEST(test_selection));
@@ -0,0 +1,38 @@
+#include "test.h"
+#include "util/bytes.h"
+
+static void test_read_write_2()
+{
+	u8  buf[2];
+	u16 val;
+
+	EXPECT_EQ(ut_write_2(buf, 0x1234) - buf, 2);
+	EXPECT_EQ(buf[0], 0x12);
+	EXPECT_EQ(ut_read_2(buf, &val) - buf, 2);
+	EXPECT_EQ(val, 0x1234);
+}
+
+static void test_read_write_4()
+{
+	u8  buf[4];
+	u32 val;
+
+	EXPECT_EQ(ut_write_4(buf, 0x12345678) - buf, 4);
+	EXPECT_EQ(buf[0], 0x12);
+	EXPECT_EQ(buf[3], 0x78);
+	EXPECT_EQ(ut_read_4(buf, &val) - buf, 4);
+	EXPECT_EQ(val, 0x12345678);
+}
+
+static void test_write_8()
+{
+	u8 buf[8];
+
+	EXPECT_EQ(ut_write_8(buf, 0x0102030405060708) - buf, 8);
+	EXPECT_EQ(buf[0], 0x01);
+	EXPECT_EQ(buf[4], 0x05);
+	EXPECT_EQ(buf[7], 0x08);
+}
+
+TEST_SUITE(bytes, TEST(test_read_write_2), TEST(test_read_write_4),
+	   TEST(test_write_8));
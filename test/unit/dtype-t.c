@@ -8,9 +8,15 @@ static void test_ints()
 	EXPECT_EQ(dtype_len(DTYPE_INT8, -1), 8);
 }
 
+static void test_float()
+{
+	EXPECT_EQ(dtype_len(DTYPE_FLOAT8, -1), 8);
+}
+
 static void test_char()
 {
 	EXPECT_EQ(dtype_len(DTYPE_CHAR, 10), 10);
 }
 
-TEST_SUITE(dtype, TEST(test_ints), TEST(test_char));
+TEST_SUITE(dtype, TEST(test_ints), TEST(test_float),
+	   TEST(test_char));
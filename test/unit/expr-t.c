@@ -0,0 +1,224 @@
+#include "executor/expr.h"
+#include "fixture.h"
+#include "test.h"
+
+#include "dtype.h"
+#include "table.h"
+#include "univ.h"
+#include "util/mem.h"
+
+struct test_tup {
+	i16  a;
+	char b[4];
+	i32  c;
+} __attribute__((packed));
+
+static struct expr *make_const(u32 typeoid, i64 val)
+{
+	struct expr *expr = mem_zalloc(sizeof(struct expr));
+
+	expr->type    = EXPR_CONST;
+	expr->typeoid = typeoid;
+	expr->typemod = -1;
+	expr->val_int = val;
+	return expr;
+}
+
+static struct expr *make_str(const char *str)
+{
+	struct expr *expr = mem_zalloc(sizeof(struct expr));
+
+	expr->type    = EXPR_CONST;
+	expr->typeoid = DTYPE_CHAR;
+	expr->typemod = strlen(str);
+	expr->val_str = str;
+	return expr;
+}
+
+/* Columns of struct test_tup, the tables being left empty */
+static const struct test_col cols[] = {
+	{ DTYPE_INT2, 0 },
+	{ DTYPE_CHAR, 4 },
+	{ DTYPE_INT4, 0 },
+};
+
+static void test_tuple()
+{
+	struct mem_root	  r;
+	struct table	  table;
+	struct heap	  heap;
+	struct test_tup	  tup = { 7, { 'a', 'b', '\0', '\0' }, -3 };
+	u8		 *src = (u8 *)&tup;
+	struct expr	 *expr;
+	struct expr_prog *prog;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&table, &heap, TEST_TABLE_OID, 3, cols, 0, NULL);
+
+	/* a * 2 + c = 11 AND b = 'ab' */
+	expr = make_op(
+		EXPR_AND, DTYPE_BOOL,
+		make_op(EXPR_EQ, DTYPE_BOOL,
+			make_op(EXPR_ADD, DTYPE_INT4,
+				make_op(EXPR_MUL, DTYPE_INT2,
+					make_column(&table, 0),
+					make_const(DTYPE_INT2, 2)),
+				make_column(&table, 2)),
+			make_const(DTYPE_INT4, 11)),
+		make_op(EXPR_EQ, DTYPE_BOOL, make_column(&table, 1),
+			make_str("ab")));
+	prog = expr_compile_tuple(expr, &table);
+	EXPECT_EQ(expr_eval_bool(prog, &src, NULL, 0), 1);
+
+	tup.c = 0;
+	EXPECT_EQ(expr_eval_bool(prog, &src, NULL, 0), 0);
+
+	/* char values compare without their padding */
+	expr = make_op(EXPR_LT, DTYPE_BOOL, make_column(&table, 1),
+		       make_str("ab "));
+	prog = expr_compile_tuple(expr, &table);
+	EXPECT_EQ(expr_eval_bool(prog, &src, NULL, 0), 0);
+	tup.b[1] = 'a';
+	EXPECT_EQ(expr_eval_bool(prog, &src, NULL, 0), 1);
+
+	free_table(&table, &heap);
+	mem_root_clear(&r);
+}
+
+static void test_errors()
+{
+	struct mem_root	  r;
+	struct table	  table;
+	struct heap	  heap;
+	struct test_tup	  tup = { 30000, { 0 }, 0 };
+	u8		 *src = (u8 *)&tup;
+	struct expr	 *expr;
+	struct expr_prog *prog;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&table, &heap, TEST_TABLE_OID, 3, cols, 0, NULL);
+
+	/* a + a overflows int2 */
+	expr = make_op(EXPR_GT, DTYPE_BOOL,
+		       make_op(EXPR_ADD, DTYPE_INT2, make_column(&table, 0),
+			       make_column(&table, 0)),
+		       make_const(DTYPE_INT2, 0));
+	prog = expr_compile_tuple(expr, &table);
+	EXPECT_EQ(expr_eval_bool(prog, &src, NULL, 0), -1);
+
+	/* a / c divides by zero, unless c = 0 short-circuits it */
+	expr = make_op(EXPR_EQ, DTYPE_BOOL,
+		       make_op(EXPR_DIV, DTYPE_INT4, make_column(&table, 0),
+			       make_column(&table, 2)),
+		       make_const(DTYPE_INT4, 1));
+	prog = expr_compile_tuple(expr, &table);
+	EXPECT_EQ(expr_eval_bool(prog, &src, NULL, 0), -1);
+
+	expr = make_op(EXPR_AND, DTYPE_BOOL,
+		       make_op(EXPR_NE, DTYPE_BOOL, make_column(&table, 2),
+			       make_const(DTYPE_INT4, 0)),
+		       expr);
+	prog = expr_compile_tuple(expr, &table);
+	EXPECT_EQ(expr_eval_bool(prog, &src, NULL, 0), 0);
+
+	free_table(&table, &heap);
+	mem_root_clear(&r);
+}
+
+static void test_batch()
+{
+	struct mem_root	  r;
+	struct table	  table;
+	struct heap	  heap;
+	u16		  offsets[1] = { 0 };
+	i16		  a[4]	     = { 1, 2, 3, 4 };
+	i32		  c[4]	     = { 4, 3, 2, 1 };
+	u8		 *srcs[3]    = { (u8 *)a, NULL, (u8 *)c };
+	struct expr	 *expr;
+	struct expr_prog *prog;
+	u16		  row;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&table, &heap, TEST_TABLE_OID, 3, cols, 0, NULL);
+
+	/* NOT a < c OR a = 1 */
+	expr = make_op(EXPR_OR, DTYPE_BOOL,
+		       make_op(EXPR_NOT, DTYPE_BOOL,
+			       make_op(EXPR_LT, DTYPE_BOOL,
+				       make_column(&table, 0),
+				       make_column(&table, 2)),
+			       NULL),
+		       make_op(EXPR_EQ, DTYPE_BOOL, make_column(&table, 0),
+			       make_const(DTYPE_INT2, 1)));
+	prog = expr_compile_batch(expr, offsets, NULL);
+	for (row = 0; row < 4; ++row)
+		EXPECT_EQ(expr_eval_bool(prog, srcs, NULL, row), (row != 1));
+
+	free_table(&table, &heap);
+	mem_root_clear(&r);
+}
+
+/* Nulls follow three-valued logic */
+static void test_nulls()
+{
+	struct mem_root	  r;
+	struct table	  table;
+	struct heap	  heap;
+	u16		  offsets[1]  = { 0 };
+	u8		  nullable[1] = { 1 };
+	i16		  a[4]	      = { 1, 2, 3, 4 };
+	i32		  c[4]	      = { 4, 3, 2, 1 };
+	u8		  anulls[4]   = { 0, 1, 0, 1 };
+	u8		  cnulls[4]   = { 0, 0, 1, 1 };
+	u8		 *srcs[3]     = { (u8 *)a, NULL, (u8 *)c };
+	u8		 *nulls[3]    = { anulls, NULL, cnulls };
+	struct expr	 *lt, *expr;
+	struct expr_prog *prog;
+	u8		  isnull;
+	u16		  row;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&table, &heap, TEST_TABLE_OID, 3, cols, 0, NULL);
+	lt = make_op(EXPR_LT, DTYPE_BOOL, make_column(&table, 0),
+		     make_column(&table, 2));
+
+	/* NOT a < c OR a = 1 */
+	expr = make_op(EXPR_OR, DTYPE_BOOL,
+		       make_op(EXPR_NOT, DTYPE_BOOL, lt, NULL),
+		       make_op(EXPR_EQ, DTYPE_BOOL, make_column(&table, 0),
+			       make_const(DTYPE_INT2, 1)));
+	prog = expr_compile_batch(expr, offsets, nullable);
+	for (row = 0; row < 4; ++row)
+		EXPECT_EQ(expr_eval_bool(prog, srcs, nulls, row), (row == 0));
+
+	/* NOT (a < c AND a = 1): null AND false is false */
+	expr = make_op(EXPR_NOT, DTYPE_BOOL,
+		       make_op(EXPR_AND, DTYPE_BOOL, lt,
+			       make_op(EXPR_EQ, DTYPE_BOOL,
+				       make_column(&table, 0),
+				       make_const(DTYPE_INT2, 1))),
+		       NULL);
+	prog = expr_compile_batch(expr, offsets, nullable);
+	for (row = 0; row < 4; ++row)
+		EXPECT_EQ(expr_eval_bool(prog, srcs, nulls, row), (row == 2));
+
+	/* a + c */
+	expr = make_op(EXPR_ADD, DTYPE_INT4, make_column(&table, 0),
+		       make_column(&table, 2));
+	prog = expr_compile_batch(expr, offsets, nullable);
+	for (row = 0; row < 4; ++row) {
+		EXPECT_TRUE(expr_eval(prog, srcs, nulls, row, &isnull));
+		EXPECT_EQ(isnull, (row != 0));
+	}
+	EXPECT_EQ(expr_eval(prog, srcs, nulls, 0, &isnull)->val_int, 5);
+
+	free_table(&table, &heap);
+	mem_root_clear(&r);
+}
+
+TEST_SUITE(expr, TEST(test_tuple), TEST(test_errors), TEST(test_batch),
+	   TEST(test_nulls));
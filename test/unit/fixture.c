@@ -0,0 +1,98 @@
+#include "fixture.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtype.h"
+#include "util/mem.h"
+
+extern struct heap *heaps[];
+
+void make_table(struct table *table, struct heap *heap, u32 oid, u16 ncols,
+		const struct test_col *cols, int ntups,
+		void (*fill)(u8 *tup, int i))
+{
+	size_t tupsize = 0;
+	u8    *tup;
+	u16    colno;
+	int    i;
+
+	table_init(table, "t", ncols);
+	table->oid = oid;
+	heap_init(heap);
+	heaps[oid] = heap;
+	for (colno = 0; colno < ncols; ++colno) {
+		table->cols[colno].typeoid = cols[colno].typeoid;
+		table->cols[colno].typemod = cols[colno].typemod;
+		tupsize += dtype_len(cols[colno].typeoid, cols[colno].typemod);
+	}
+	tup = malloc(tupsize);
+	for (i = 0; i < ntups; ++i) {
+		memset(tup, 0, tupsize);
+		fill(tup, i);
+		heap_add_tuple(heap, tup, tupsize);
+	}
+	free(tup);
+}
+
+void free_table(struct table *table, struct heap *heap)
+{
+	size_t pageno;
+
+	for (pageno = 0; pageno < heap->pages.size; ++pageno)
+		free(heap->pages.data[pageno]);
+	vec_free(&heap->pages);
+	pthread_mutex_destroy(&heap->lock);
+	heaps[table->oid] = NULL;
+	free(table->cols);
+}
+
+struct expr *make_column(struct table *table, u16 colno)
+{
+	struct expr *expr = mem_zalloc(sizeof(struct expr));
+
+	expr->type    = EXPR_COLUMN;
+	expr->typeoid = table->cols[colno].typeoid;
+	expr->typemod = table->cols[colno].typemod;
+	expr->colno   = colno;
+	return expr;
+}
+
+struct expr *make_op(enum expr_op op, u32 typeoid, struct expr *left,
+		     struct expr *right)
+{
+	struct expr *expr = mem_zalloc(sizeof(struct expr));
+
+	expr->type    = EXPR_OP;
+	expr->op      = op;
+	expr->typeoid = typeoid;
+	expr->typemod = -1;
+	expr->left    = left;
+	expr->right   = right;
+	return expr;
+}
+
+i64 get_int(struct batch *batch, u16 colno, u16 row)
+{
+	struct vector *vec = &batch->cols[colno];
+	i16	       v2;
+	i32	       v4;
+	i64	       v8;
+
+	switch (vec->width) {
+	case 2:
+		memcpy(&v2, vector_at(vec, row), 2);
+		return v2;
+	case 4:
+		memcpy(&v4, vector_at(vec, row), 4);
+		return v4;
+	default:
+		memcpy(&v8, vector_at(vec, row), 8);
+		return v8;
+	}
+}
+
+int is_null(struct batch *batch, u16 colno, u16 row)
+{
+	return batch->cols[colno].nulls && batch->cols[colno].nulls[row];
+}
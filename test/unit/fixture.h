@@ -0,0 +1,41 @@
+/* Tables, expressions and batch accessors shared by the executor tests */
+
+#ifndef FIXTURE_H
+#define FIXTURE_H
+
+#include "executor/batch.h"
+#include "executor/expr.h"
+#include "storage/heap.h"
+#include "table.h"
+#include "univ.h"
+
+/* Oid of the tables of the tests, and the one after it for a second table */
+#define TEST_TABLE_OID 1000
+
+/* Type of a column of a test table, typemod being the length of chars */
+struct test_col {
+	u32 typeoid;
+	i32 typemod;
+};
+
+/* Make the table "t" of the columns, registered under oid with its heap. Each
+ * of its ntups rows is written by fill as a zeroed tuple, the columns laid out
+ * one after the other. */
+void make_table(struct table *table, struct heap *heap, u32 oid, u16 ncols,
+		const struct test_col *cols, int ntups,
+		void (*fill)(u8 *tup, int i));
+
+/* Release the columns and the pages of a table made by make_table */
+void free_table(struct table *table, struct heap *heap);
+
+struct expr *make_column(struct table *table, u16 colno);
+
+struct expr *make_op(enum expr_op op, u32 typeoid, struct expr *left,
+		     struct expr *right);
+
+/* The integer of a 2, 4 or 8 byte column of a batch */
+i64 get_int(struct batch *batch, u16 colno, u16 row);
+
+int is_null(struct batch *batch, u16 colno, u16 row);
+
+#endif
@@ -0,0 +1,193 @@
+#include "executor/operator.h"
+#include "fixture.h"
+#include "test.h"
+
+#include "dtype.h"
+#include "storage/heap.h"
+#include "table.h"
+#include "univ.h"
+#include "util/error.h"
+#include "util/mem.h"
+
+#define NROWS 100000
+#define NWORKERS 4
+
+struct test_tup {
+	i32 a;
+	i64 b;
+} __attribute__((packed));
+
+/* Columns of struct test_tup */
+static const struct test_col cols[] = {
+	{ DTYPE_INT4, 0 },
+	{ DTYPE_INT8, 0 },
+};
+
+/* Row (i % 100, i), the NROWS of them spanning many pages */
+static void fill(u8 *tup, int i)
+{
+	struct test_tup *t = (struct test_tup *)tup;
+
+	t->a = i % 100;
+	t->b = i;
+}
+
+/* Scans sharing a parallel scan read every tuple exactly once between
+ * them */
+static void test_parallel_tablescan()
+{
+	struct table	      table;
+	struct heap	      heap;
+	struct parallel_scan  pscan;
+	struct tablescan_iter iters[3];
+	struct test_tup	      tup;
+	u8		      seen[NROWS] = { 0 };
+	int		      nrows	  = 0;
+	int		      live	  = 3;
+	int		      i;
+	struct mem_root	      r;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&table, &heap, TEST_TABLE_OID, 2, cols, NROWS, fill);
+	EXPECT_TRUE((heap_count_pages(&heap) > 3 * PARALLEL_SCAN_CHUNK));
+	parallel_scan_init(&pscan, &table);
+	for (i = 0; i < 3; ++i)
+		tablescan_begin_parallel(&iters[i], &table, &pscan);
+
+	/* take turns so that the scans claim chunks in between each other */
+	while (live > 0) {
+		live = 0;
+		for (i = 0; i < 3; ++i) {
+			if (tablescan_next(&iters[i]) == -1)
+				continue;
+			live++;
+			memcpy(&tup, iters[i].tup, sizeof(tup));
+			EXPECT_TRUE((tup.b >= 0 && tup.b < NROWS &&
+				     !seen[tup.b]));
+			seen[tup.b] = 1;
+			nrows++;
+		}
+	}
+	EXPECT_EQ(nrows, NROWS);
+	for (i = 0; i < 3; ++i)
+		tablescan_end(&iters[i]);
+	free_table(&table, &heap);
+	mem_root_clear(&r);
+}
+
+static struct expr *make_expr(enum expr_type type, u32 typeoid)
+{
+	struct expr *expr = mem_zalloc(sizeof(struct expr));
+
+	expr->type    = type;
+	expr->typeoid = typeoid;
+	expr->typemod = -1;
+	return expr;
+}
+
+/* a % 7 = 0, or a / (b - fail_at) = 0 to fail on the row b = fail_at */
+static struct expr *make_cond(int fail, i64 fail_at)
+{
+	struct expr *a	   = make_expr(EXPR_COLUMN, DTYPE_INT4);
+	struct expr *b	   = make_expr(EXPR_COLUMN, DTYPE_INT8);
+	struct expr *seven = make_expr(EXPR_CONST, DTYPE_INT4);
+	struct expr *at	   = make_expr(EXPR_CONST, DTYPE_INT8);
+	struct expr *zero  = make_expr(EXPR_CONST, DTYPE_INT8);
+	struct expr *lhs;
+
+	b->colno       = 1;
+	seven->val_int = 7;
+	at->val_int    = fail_at;
+	if (fail)
+		lhs = make_op(EXPR_DIV, DTYPE_INT8, a,
+			      make_op(EXPR_SUB, DTYPE_INT8, b, at));
+	else
+		lhs = make_op(EXPR_MOD, DTYPE_INT4, a, seven);
+	return make_op(EXPR_EQ, DTYPE_BOOL, lhs, zero);
+}
+
+/* Gather the rows of NWORKERS filtered scans of the table. Returns the number
+ * of rows, or -1 if the gather failed. */
+static int run_gather(struct table *table, int fail)
+{
+	struct parallel_scan *pscan = mem_alloc(sizeof(struct parallel_scan));
+	struct operator	     *plans[NWORKERS];
+	struct operator	     *op;
+	struct batch	     *batch;
+	u16		      offsets[] = { 0 };
+	u8		      needed[]	= { 1, 1 };
+	i32		      a;
+	int		      nrows = 0;
+	int		      rc;
+	u16		      i;
+
+	parallel_scan_init(pscan, table);
+	for (i = 0; i < NWORKERS; ++i)
+		plans[i] = filter_op_create(
+			parallel_scan_op_create(table, needed, NULL, pscan),
+			expr_compile_batch(make_cond(fail, NROWS / 2), offsets,
+					   NULL));
+	op = gather_op_create(plans, NWORKERS);
+
+	if (op_open(op))
+		return -1;
+	for (;;) {
+		if ((rc = op_next(op, &batch)) != 0 || batch == NULL)
+			break;
+		for (i = 0; i < batch_count(batch); ++i) {
+			memcpy(&a,
+			       vector_at(&batch->cols[0], batch_row(batch, i)),
+			       sizeof(a));
+			if (!fail && a % 7 != 0)
+				rc = 1;
+			nrows++;
+		}
+	}
+	op_close(op);
+	return rc ? -1 : nrows;
+}
+
+static void test_gather()
+{
+	struct table	table;
+	struct heap	heap;
+	struct mem_root r;
+	int		expected = 0;
+	int		i;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&table, &heap, TEST_TABLE_OID, 2, cols, NROWS, fill);
+	for (i = 0; i < NROWS; ++i)
+		expected += i % 100 % 7 == 0;
+	EXPECT_EQ(run_gather(&table, 0), expected);
+	free_table(&table, &heap);
+	mem_root_clear(&r);
+}
+
+/* An error raised on a worker is reported by the gather */
+static void test_worker_error()
+{
+	struct table	table;
+	struct heap	heap;
+	struct mem_root r;
+	struct err     *err;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&table, &heap, TEST_TABLE_OID, 2, cols, NROWS, fill);
+	while (errbuf_pop() != NULL)
+		;
+	EXPECT_EQ(run_gather(&table, 1), -1);
+	err = errbuf_pop();
+	EXPECT_TRUE((err != NULL));
+	EXPECT_EQ(err->code, ER_DIVISION_BY_ZERO);
+	while (errbuf_pop() != NULL)
+		;
+	free_table(&table, &heap);
+	mem_root_clear(&r);
+}
+
+TEST_SUITE(gather, TEST(test_parallel_tablescan), TEST(test_gather),
+	   TEST(test_worker_error));
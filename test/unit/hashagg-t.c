@@ -0,0 +1,213 @@
+#include "executor/operator.h"
+#include "fixture.h"
+#include "test.h"
+
+#include "dtype.h"
+#include "storage/heap.h"
+#include "table.h"
+#include "univ.h"
+#include "util/mem.h"
+
+#define NGROUPS 1000
+#define NPERGROUP 50
+#define NWORKERS 4
+
+struct test_tup {
+	i16 a;
+	i64 b;
+} __attribute__((packed));
+
+/* Columns of struct test_tup */
+static const struct test_col cols[] = {
+	{ DTYPE_INT2, 0 },
+	{ DTYPE_INT8, 0 },
+};
+
+/* Row (i % NGROUPS, -i) */
+static void fill(u8 *tup, int i)
+{
+	struct test_tup *t = (struct test_tup *)tup;
+
+	t->a = i % NGROUPS;
+	t->b = -i;
+}
+
+static struct agg_call *make_agg(enum agg_func func, struct expr *arg)
+{
+	struct agg_call *agg = mem_zalloc(sizeof(struct agg_call));
+
+	agg->func    = func;
+	agg->arg     = arg;
+	agg->typeoid = func == AGG_MIN || func == AGG_MAX ? arg->typeoid :
+							    DTYPE_INT8;
+	agg->typemod = -1;
+	return agg;
+}
+
+/* Aggregate the rows into NGROUPS groups of NPERGROUP rows, within a budget
+ * of work_mem bytes, on nworkers threads if nonzero */
+static void check_groups(size_t work_mem, u16 nworkers)
+{
+	struct mem_root	 r;
+	struct table	 table;
+	struct heap	 heap;
+	struct operator *op;
+	struct operator *plans[NWORKERS];
+	struct batch	*batch;
+	struct expr	*keys[1];
+	struct agg_call *aggs[4];
+	u16		 offsets[] = { 0 };
+	u8		 needed[]  = { 1, 1 };
+	u8		 seen[NGROUPS] = { 0 };
+	int		 ngroups = 0;
+	i64		 k;
+	u16		 i;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&table, &heap, TEST_TABLE_OID, 2, cols, NPERGROUP * NGROUPS,
+		   fill);
+	keys[0] = make_column(&table, 0);
+	aggs[0] = make_agg(AGG_COUNT, NULL);
+	aggs[1] = make_agg(AGG_SUM, make_column(&table, 1));
+	aggs[2] = make_agg(AGG_MIN, make_column(&table, 1));
+	aggs[3] = make_agg(AGG_MAX, make_column(&table, 1));
+	if (nworkers > 0) {
+		struct parallel_scan *pscan =
+			mem_alloc(sizeof(struct parallel_scan));
+
+		parallel_scan_init(pscan, &table);
+		for (i = 0; i < nworkers; ++i)
+			plans[i] = parallel_scan_op_create(&table, needed, NULL,
+							   pscan);
+		op = parallel_hashagg_op_create(plans, nworkers, offsets, NULL,
+						1, keys, 4, aggs, work_mem);
+	} else {
+		op = hashagg_op_create(scan_op_create(&table, needed, NULL),
+				       offsets, NULL, 1, keys, 4, aggs,
+				       work_mem);
+	}
+
+	EXPECT_EQ(op_open(op), 0);
+	for (;;) {
+		EXPECT_EQ(op_next(op, &batch), 0);
+		if (batch == NULL)
+			break;
+		for (i = 0; i < batch_count(batch); ++i) {
+			k = get_int(batch, 0, i);
+			EXPECT_TRUE((k >= 0 && k < NGROUPS && !seen[k]));
+			seen[k] = 1;
+			ngroups++;
+			EXPECT_EQ(get_int(batch, 1, i), NPERGROUP);
+			EXPECT_EQ(get_int(batch, 2, i),
+				  -(NPERGROUP * k +
+				    NPERGROUP * (NPERGROUP - 1) / 2 * NGROUPS));
+			EXPECT_EQ(get_int(batch, 3, i),
+				  -(k + (NPERGROUP - 1) * NGROUPS));
+			EXPECT_EQ(get_int(batch, 4, i), -k);
+		}
+	}
+	EXPECT_EQ(ngroups, NGROUPS);
+	op_close(op);
+	free_table(&table, &heap);
+	mem_root_clear(&r);
+}
+
+static void test_in_memory()
+{
+	check_groups(WORK_MEM, 0);
+}
+
+/* Most groups go through temporary files */
+static void test_small_budget()
+{
+	check_groups(1024, 0);
+}
+
+static void test_parallel()
+{
+	check_groups(WORK_MEM, NWORKERS);
+}
+
+/* The tables of the workers are flushed, and the merges spill */
+static void test_parallel_small_budget()
+{
+	check_groups(1024 * NWORKERS, NWORKERS);
+}
+
+/* Without keys, an empty input still gives one row */
+static void test_no_rows()
+{
+	struct mem_root	 r;
+	struct table	 table;
+	struct heap	 heap;
+	struct operator *op;
+	struct batch	*batch;
+	struct agg_call *aggs[2];
+	u16		 offsets[] = { 0 };
+	u8		 needed[]  = { 0, 1 };
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&table, &heap, TEST_TABLE_OID, 2, cols, 0, NULL);
+	aggs[0] = make_agg(AGG_COUNT, NULL);
+	aggs[1] = make_agg(AGG_SUM, make_column(&table, 1));
+	op	= hashagg_op_create(scan_op_create(&table, needed, NULL), offsets,
+				    NULL, 0, NULL, 2, aggs, WORK_MEM);
+
+	EXPECT_EQ(op_open(op), 0);
+	EXPECT_EQ(op_next(op, &batch), 0);
+	EXPECT_TRUE((batch != NULL));
+	EXPECT_EQ(batch_count(batch), 1);
+	EXPECT_EQ(get_int(batch, 0, 0), 0);
+	EXPECT_TRUE((batch->cols[1].nulls && batch->cols[1].nulls[0]));
+	EXPECT_EQ(op_next(op, &batch), 0);
+	EXPECT_TRUE((batch == NULL));
+	op_close(op);
+	free_table(&table, &heap);
+	mem_root_clear(&r);
+}
+
+/* Without keys, the groups of the workers are merged into one */
+static void test_parallel_no_keys()
+{
+	struct mem_root	      r;
+	struct table	      table;
+	struct heap	      heap;
+	struct parallel_scan  pscan;
+	struct operator	     *plans[NWORKERS];
+	struct operator	     *op;
+	struct batch	     *batch;
+	struct agg_call	     *aggs[2];
+	u16		      offsets[] = { 0 };
+	u8		      needed[]	= { 0, 1 };
+	u16		      i;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&table, &heap, TEST_TABLE_OID, 2, cols, NPERGROUP * NGROUPS,
+		   fill);
+	aggs[0] = make_agg(AGG_COUNT, NULL);
+	aggs[1] = make_agg(AGG_MIN, make_column(&table, 1));
+	parallel_scan_init(&pscan, &table);
+	for (i = 0; i < NWORKERS; ++i)
+		plans[i] = parallel_scan_op_create(&table, needed, NULL, &pscan);
+	op = parallel_hashagg_op_create(plans, NWORKERS, offsets, NULL, 0, NULL,
+					2, aggs, WORK_MEM);
+
+	EXPECT_EQ(op_open(op), 0);
+	EXPECT_EQ(op_next(op, &batch), 0);
+	EXPECT_TRUE((batch != NULL));
+	EXPECT_EQ(batch_count(batch), 1);
+	EXPECT_EQ(get_int(batch, 0, 0), NPERGROUP * NGROUPS);
+	EXPECT_EQ(get_int(batch, 1, 0), -(NPERGROUP * NGROUPS - 1));
+	EXPECT_EQ(op_next(op, &batch), 0);
+	EXPECT_TRUE((batch == NULL));
+	op_close(op);
+	free_table(&table, &heap);
+	mem_root_clear(&r);
+}
+
+TEST_SUITE(hashagg, TEST(test_in_memory), TEST(test_small_budget),
+	   TEST(test_no_rows), TEST(test_parallel),
+	   TEST(test_parallel_small_budget), TEST(test_parallel_no_keys));
@@ -1,6 +1,9 @@
 #include "storage/heap.h"
 #include "test.h"
 
+#include <pthread.h>
+#include <stdlib.h>
+
 #include "univ.h"
 
 static void test_empty_page()
@@ -36,4 +39,128 @@ static void test_add_tuple()
 	EXPECT_STREQ((char *)stored_tup, (char *)tup2);
 }
 
-TEST_SUITE(heap, TEST(test_empty_page), TEST(test_add_tuple));
+/* Tuples added in bulk fill the last page before going to new ones, and keep
+ * their order */
+static void test_add_tuples()
+{
+	struct heap	  heap;
+	struct heap_page *page;
+	u32		  tups[3000];
+	u32		  one = 12345;
+	u32		 *stored;
+	u16		  slotcnt;
+	size_t		  pageno;
+	size_t		  n = 0;
+	u16		  i;
+
+	for (i = 0; i < 3000; ++i)
+		tups[i] = i;
+	heap_init(&heap);
+	heap_add_tuple(&heap, (u8 *)&one, sizeof(one));
+	heap_add_tuples(&heap, (u8 *)tups, sizeof(u32), 3000);
+	EXPECT_EQ(heap_count_tuples(&heap), 3001);
+	EXPECT_TRUE((heap_count_pages(&heap) > 1));
+
+	for (pageno = 0; (page = heap_get_page(&heap, pageno, &slotcnt));
+	     ++pageno) {
+		/* every page but the last one is full */
+		if (pageno + 1 < heap_count_pages(&heap))
+			EXPECT_TRUE((heap_page_free_space(page) < sizeof(u32)));
+		for (i = 0; i < slotcnt; ++i, ++n) {
+			EXPECT_EQ(heap_page_read_tuple(page, i, (u8 **)&stored),
+				  sizeof(u32));
+			EXPECT_EQ(*stored, (n == 0 ? one : n - 1));
+		}
+		free(page);
+	}
+	EXPECT_EQ(n, 3001);
+	vec_free(&heap.pages);
+}
+
+#define NWRITERS 4
+#define NAPPENDS 20000
+
+struct writer_tup {
+	u32 writer;
+	u32 seq;
+};
+
+struct writer {
+	pthread_t    thread;
+	struct heap *heap;
+	u32	     id;
+};
+
+static void *append_tuples(void *arg)
+{
+	struct writer	 *w = arg;
+	struct writer_tup tup;
+
+	tup.writer = w->id;
+	for (tup.seq = 0; tup.seq < NAPPENDS; ++tup.seq)
+		heap_add_tuple(w->heap, (u8 *)&tup, sizeof(tup));
+	return NULL;
+}
+
+/* Walk the pages of the heap as it is now, checking that the tuples of each
+ * writer come in the order they were appended. Returns the number of tuples
+ * seen, or -1 if one is out of place. */
+static long walk_pages(struct heap *heap)
+{
+	struct heap_page  *page;
+	struct writer_tup *tup;
+	u32		   next[NWRITERS] = { 0 };
+	u16		   slotcnt;
+	size_t		   pageno;
+	long		   n = 0;
+	u16		   i;
+
+	for (pageno = 0; (page = heap_get_page(heap, pageno, &slotcnt));
+	     ++pageno) {
+		for (i = 0; i < slotcnt; ++i, ++n) {
+			heap_page_read_tuple(page, i, (u8 **)&tup);
+			if (tup->writer >= NWRITERS ||
+			    tup->seq != next[tup->writer]++)
+				return -1;
+		}
+	}
+	return n;
+}
+
+/* Readers walking the pages while several threads append only see whole
+ * tuples, in the order of each writer */
+static void test_concurrent_append()
+{
+	struct heap   heap;
+	struct writer writers[NWRITERS];
+	long	      n = 0;
+	long	      seen;
+	size_t	      pageno;
+	int	      i;
+
+	heap_init(&heap);
+	for (i = 0; i < NWRITERS; ++i) {
+		writers[i].heap = &heap;
+		writers[i].id	= i;
+		pthread_create(&writers[i].thread, NULL, append_tuples,
+			       &writers[i]);
+	}
+	while (n < NWRITERS * NAPPENDS) {
+		seen = walk_pages(&heap);
+		EXPECT_TRUE((seen >= n));
+		if (seen < n)
+			break;
+		n = seen;
+	}
+	for (i = 0; i < NWRITERS; ++i)
+		pthread_join(writers[i].thread, NULL);
+	EXPECT_EQ(walk_pages(&heap), NWRITERS * NAPPENDS);
+	EXPECT_EQ(heap_count_tuples(&heap), NWRITERS * NAPPENDS);
+
+	for (pageno = 0; pageno < heap.pages.size; ++pageno)
+		free(heap.pages.data[pageno]);
+	vec_free(&heap.pages);
+}
+
+TEST_SUITE(heap, TEST(test_empty_page), TEST(test_add_tuple),
+	   TEST(test_add_tuples), TEST(test_concurrent_append));
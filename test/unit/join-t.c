@@ -0,0 +1,179 @@
+#include "executor/operator.h"
+#include "fixture.h"
+#include "test.h"
+
+#include "dtype.h"
+#include "storage/heap.h"
+#include "table.h"
+#include "univ.h"
+#include "util/mem.h"
+
+#define NKEYS 1000
+#define NPROBE (3 * NKEYS)
+#define NBUILD (NKEYS + NKEYS / 2)
+
+enum join_strategy {
+	HASH_BUILD_RIGHT,
+	HASH_BUILD_LEFT,
+	MERGE,
+};
+
+struct test_tup {
+	i16 a;
+	i64 b;
+} __attribute__((packed));
+
+/* Columns of struct test_tup */
+static const struct test_col cols[] = {
+	{ DTYPE_INT2, 0 },
+	{ DTYPE_INT8, 0 },
+};
+
+/* Row (i % NKEYS, -i) of the probe side */
+static void fill_probe(u8 *tup, int i)
+{
+	struct test_tup *t = (struct test_tup *)tup;
+
+	t->a = i % NKEYS;
+	t->b = -i;
+}
+
+/* Row (i, i) of the build side */
+static void fill_build(u8 *tup, int i)
+{
+	struct test_tup *t = (struct test_tup *)tup;
+
+	t->a = i;
+	t->b = i;
+}
+
+/* A scan of the table, sorted on key for a merge join */
+static struct operator *join_input(struct table *table, struct expr *key,
+				   enum join_strategy strategy)
+{
+	static const u16 offsets[] = { 0 };
+	static const u8	 needed[]  = { 1, 1 };
+	static const u8	 desc[]	   = { 0 };
+	struct operator *scan	   = scan_op_create(table, needed, NULL);
+
+	if (strategy != MERGE)
+		return scan;
+	return sort_op_create(scan, offsets, NULL, 1, &key, desc, -1,
+			      WORK_MEM);
+}
+
+/* Join the rows (i % NKEYS, -i) for i in [0, NPROBE) with the rows (j, j) for
+ * j in [0, NBUILD) on their first column, within a budget of work_mem bytes.
+ * Each left row matches exactly one right row, and half of the right keys
+ * have no match. With outer set, the right table is preserved instead. A
+ * merge join returns the rows in the order of the keys. */
+static void check_join(enum join_strategy strategy, int outer,
+		       size_t work_mem)
+{
+	struct mem_root	 r;
+	struct table	 ltable, rtable;
+	struct heap	 lheap, rheap;
+	struct operator *left, *right, *op;
+	struct batch	*batch;
+	struct expr	*lexpr, *rexpr;
+	struct join_keys lkeys, rkeys;
+	u16		 offsets[] = { 0 };
+	u8		 seen[NPROBE] = { 0 };
+	int		 build_left   = strategy == HASH_BUILD_LEFT;
+	int		 nmatched = 0, nunmatched = 0;
+	i64		 b, k, key, last = -1;
+	u16		 i;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&ltable, &lheap, TEST_TABLE_OID, 2, cols, NPROBE, fill_probe);
+	make_table(&rtable, &rheap, TEST_TABLE_OID + 1, 2, cols, NBUILD,
+		   fill_build);
+	lexpr = make_column(&ltable, 0);
+	rexpr = make_column(&rtable, 0);
+	lkeys = (struct join_keys){ 1, &lexpr, offsets, NULL };
+	rkeys = (struct join_keys){ 1, &rexpr, offsets, NULL };
+	left  = join_input(&ltable, lexpr, strategy);
+	right = join_input(&rtable, rexpr, strategy);
+	/* an outer join preserves its left input */
+	if (strategy == MERGE && outer)
+		op = mergejoin_op_create(right, left, &rkeys, &lkeys, NULL, 1);
+	else if (strategy == MERGE)
+		op = mergejoin_op_create(left, right, &lkeys, &rkeys, NULL, 0);
+	else if (outer)
+		op = hashjoin_op_create(right, left, &rkeys, &lkeys, NULL, 1,
+					!build_left, work_mem);
+	else
+		op = hashjoin_op_create(left, right, &lkeys, &rkeys, NULL, 0,
+					build_left, work_mem);
+
+	EXPECT_EQ(op_open(op), 0);
+	for (;;) {
+		EXPECT_EQ(op_next(op, &batch), 0);
+		if (batch == NULL)
+			break;
+		for (i = 0; i < batch_count(batch); ++i) {
+			k = get_int(batch, 0, i);
+			if (strategy == MERGE) {
+				EXPECT_TRUE((k >= last));
+				last = k;
+			}
+			if (outer && is_null(batch, 2, i)) {
+				EXPECT_TRUE((k >= NKEYS && k < NBUILD));
+				EXPECT_TRUE(is_null(batch, 3, i));
+				nunmatched++;
+				continue;
+			}
+			b = outer ? get_int(batch, 3, i) :
+				    get_int(batch, 1, i);
+			if (!outer)
+				k = get_int(batch, 2, i);
+			EXPECT_TRUE((b <= 0 && b > -NPROBE && !seen[-b]));
+			seen[-b] = 1;
+			key = -b % NKEYS;
+			EXPECT_EQ(k, key);
+			nmatched++;
+		}
+	}
+	EXPECT_EQ(nmatched, NPROBE);
+	EXPECT_EQ(nunmatched, (outer ? NBUILD - NKEYS : 0));
+	op_close(op);
+	free_table(&ltable, &lheap);
+	free_table(&rtable, &rheap);
+	mem_root_clear(&r);
+}
+
+static void test_hash_in_memory()
+{
+	check_join(HASH_BUILD_RIGHT, 0, WORK_MEM);
+	check_join(HASH_BUILD_LEFT, 0, WORK_MEM);
+}
+
+static void test_hash_outer()
+{
+	check_join(HASH_BUILD_RIGHT, 1, WORK_MEM);
+	check_join(HASH_BUILD_LEFT, 1, WORK_MEM);
+}
+
+/* Most rows go through temporary files */
+static void test_hash_small_budget()
+{
+	check_join(HASH_BUILD_RIGHT, 0, 1024);
+	check_join(HASH_BUILD_LEFT, 0, 1024);
+	check_join(HASH_BUILD_RIGHT, 1, 1024);
+	check_join(HASH_BUILD_LEFT, 1, 1024);
+}
+
+static void test_merge_inner()
+{
+	check_join(MERGE, 0, WORK_MEM);
+}
+
+static void test_merge_outer()
+{
+	check_join(MERGE, 1, WORK_MEM);
+}
+
+TEST_SUITE(join, TEST(test_hash_in_memory), TEST(test_hash_outer),
+	   TEST(test_hash_small_budget), TEST(test_merge_inner),
+	   TEST(test_merge_outer));
@@ -0,0 +1,149 @@
+#include "executor/kernel.h"
+#include "test.h"
+
+#include <stdlib.h>
+
+#include "dtype.h"
+#include "util/mem.h"
+
+static const enum expr_op ops[] = { EXPR_EQ, EXPR_NE, EXPR_LT,
+				    EXPR_LE, EXPR_GT, EXPR_GE };
+
+static int compare(enum expr_op op, i64 a, i64 b)
+{
+	switch (op) {
+	case EXPR_EQ:
+		return a == b;
+	case EXPR_NE:
+		return a != b;
+	case EXPR_LT:
+		return a < b;
+	case EXPR_LE:
+		return a <= b;
+	case EXPR_GT:
+		return a > b;
+	default:
+		return a >= b;
+	}
+}
+
+static int bit(const u64 *bits, u16 i)
+{
+	return (bits[i / 64] >> (i % 64)) & 1;
+}
+
+/* Check the kernels of every instruction set the CPU supports on one type,
+ * with row counts that are not a multiple of the register width */
+static void check_ints(u32 typeoid)
+{
+	static const u16   counts[] = { BATCH_SIZE, 1000, 37, 0 };
+	struct column_pred pred	    = { 0 };
+	struct vector	   vec;
+	u64		   bits[BITMAP_WORDS];
+	enum kernel_isa	   best = kernel_isa();
+	enum kernel_isa	   isa;
+	i64		   val;
+	size_t		   o;
+	size_t		   k;
+	u16		   i;
+
+	vector_init(&vec, typeoid, -1);
+	for (i = 0; i < BATCH_SIZE; ++i) {
+		val = rand() % 7 - 3;
+		if (typeoid == DTYPE_INT8 && i % 5 == 0)
+			val *= (i64)1 << 40;
+		memcpy(vector_at(&vec, i), &val, vec.width);
+	}
+	pred.val_int = 1;
+
+	for (isa = KERNEL_SCALAR; isa <= KERNEL_AVX2; ++isa) {
+		if (kernel_use_isa(isa))
+			continue;
+		for (o = 0; o < sizeof(ops) / sizeof(ops[0]); ++o) {
+			pred.op = ops[o];
+			for (k = 0; k < sizeof(counts) / sizeof(counts[0]);
+			     ++k) {
+				kernel_filter(&pred, &vec, counts[k], bits);
+				for (i = 0; i < BATCH_SIZE; ++i) {
+					val = 0;
+					memcpy(&val, vector_at(&vec, i),
+					       vec.width);
+					if (vec.width == 2)
+						val = (i16)val;
+					else if (vec.width == 4)
+						val = (i32)val;
+					EXPECT_EQ(bit(bits, i),
+						  (i < counts[k] &&
+						   compare(pred.op, val, 1)));
+				}
+			}
+		}
+	}
+	kernel_use_isa(best);
+}
+
+static void test_ints()
+{
+	struct mem_root r;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	srand(1);
+	check_ints(DTYPE_INT2);
+	check_ints(DTYPE_INT4);
+	check_ints(DTYPE_INT8);
+	mem_root_clear(&r);
+}
+
+static void test_chars()
+{
+	static const char vals[][4] = { "ab", "ab ", "abc", "", "a", "ab\0\0" };
+	struct mem_root	   r;
+	struct column_pred pred = { 0 };
+	struct vector	   vec;
+	u64		   bits[BITMAP_WORDS];
+	enum kernel_isa	   best = kernel_isa();
+	enum kernel_isa	   isa;
+	int		   kind;
+	u16		   i;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	vector_init(&vec, DTYPE_CHAR, 4);
+	for (i = 0; i < BATCH_SIZE; ++i)
+		memcpy(vector_at(&vec, i), vals[i % 6], 4);
+	pred.str = (const u8 *)"ab";
+	pred.len = 2;
+
+	for (isa = KERNEL_SCALAR; isa <= KERNEL_AVX2; ++isa) {
+		if (kernel_use_isa(isa))
+			continue;
+		/* padding may be spaces or zeroes */
+		pred.op = EXPR_EQ;
+		kernel_filter(&pred, &vec, 100, bits);
+		for (i = 0; i < 100; ++i) {
+			kind = i % 6;
+			EXPECT_EQ(bit(bits, i), (kind <= 1 || kind == 5));
+		}
+		EXPECT_EQ(bit(bits, 102), 0);
+
+		pred.op = EXPR_NE;
+		kernel_filter(&pred, &vec, 100, bits);
+		for (i = 0; i < 100; ++i) {
+			kind = i % 6;
+			EXPECT_EQ(bit(bits, i), (kind > 1 && kind != 5));
+		}
+		EXPECT_EQ(bit(bits, 102), 0);
+
+		pred.op = EXPR_LIKE;
+		kernel_filter(&pred, &vec, BATCH_SIZE, bits);
+		for (i = 0; i < BATCH_SIZE; ++i) {
+			kind = i % 6;
+			EXPECT_EQ(bit(bits, i), (kind <= 2 || kind == 5));
+		}
+	}
+	kernel_use_isa(best);
+	mem_root_clear(&r);
+}
+
+TEST_SUITE(kernel, TEST(test_ints), TEST(test_chars));
@@ -62,11 +62,81 @@ static void test_keywords()
 	lex_next_token(&lex);
 	EXPECT_EQ(lex.token.tclass, TK_TABLE);
 
+	lex_init(&lex, "and");
+	lex_next_token(&lex);
+	EXPECT_EQ(lex.token.tclass, TK_AND);
+
+	lex_init(&lex, "ORDER");
+	lex_next_token(&lex);
+	EXPECT_EQ(lex.token.tclass, TK_ORDER);
+
+	lex_init(&lex, "ORDERS");
+	lex_next_token(&lex);
+	EXPECT_EQ(lex.token.tclass, TK_IDENT);
+
 	lex_init(&lex, "TABLES");
 	lex_next_token(&lex);
 	EXPECT_EQ(lex.token.tclass, TK_IDENT);
 }
 
+/* Every keyword is found in the group of its length, while words close to one
+ * are not keywords */
+static void test_all_keywords()
+{
+	static const char *names[] = {
+		"AND",	 "AS",	  "ASC",   "BIGINT", "BY",     "CHAR",
+		"COPY",	 "CREATE", "DESC",  "FROM",   "GROUP",  "INNER",
+		"INSERT", "INT",  "INTO",  "JOIN",   "LEFT",   "LIKE",
+		"LIMIT", "NOT",	  "OFFSET", "ON",    "OR",     "ORDER",
+		"OUTER", "SELECT", "SMALLINT", "STDIN", "STDOUT", "TABLE",
+		"TO",	 "VALUES", "WHERE", "WITH"
+	};
+	struct lex lex;
+	char	   word[16];
+	size_t	   len;
+	int	   i;
+
+	for (i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+		lex_init(&lex, names[i]);
+		lex_next_token(&lex);
+		EXPECT_EQ(lex.token.tclass, TK_AND + i);
+
+		/* a prefix, and the keyword with one more character */
+		len = strlen(names[i]);
+		memcpy(word, names[i], len - 1);
+		word[len - 1] = '\0';
+		lex_init(&lex, word);
+		lex_next_token(&lex);
+		EXPECT_TRUE((lex.token.tclass != TK_AND + i));
+		memcpy(word, names[i], len);
+		word[len]     = 'x';
+		word[len + 1] = '\0';
+		lex_init(&lex, word);
+		lex_next_token(&lex);
+		EXPECT_EQ(lex.token.tclass, TK_IDENT);
+	}
+}
+
+static void test_operators()
+{
+	static const enum token_class expected[] = {
+		TK_EQ, TK_NE, TK_NE, TK_LT, TK_LE, TK_GT, TK_GE, TK_SLASH,
+		TK_PERCENT, TK_EOF
+	};
+	struct lex lex;
+	int	   i;
+
+	lex_init(&lex, "=<>!=<<=>>=/%");
+	for (i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i) {
+		lex_next_token(&lex);
+		EXPECT_EQ(lex.token.tclass, expected[i]);
+	}
+
+	lex_init(&lex, "!");
+	lex_next_token(&lex);
+	EXPECT_EQ(lex.token.tclass, TK_INVALID);
+}
+
 static void test_quoted_ident()
 {
 	struct lex lex;
@@ -82,5 +152,33 @@ static void test_quoted_ident()
 	EXPECT_TRUE(strncmp(lex.token.val_str.str, "AS", sizeof("AS")));
 }
 
+/* Statements end at semicolons outside of quotes */
+static void test_split_statement()
+{
+	const char *str = "  SELECT ';' ;SELECT \"a;b\"\n; ;\t";
+	size_t	    begin;
+	size_t	    end;
+
+	EXPECT_EQ(lex_split_statement(str, &begin, &end), 1);
+	EXPECT_EQ(begin, 2);
+	EXPECT_EQ(end, 14);
+	str += end;
+	EXPECT_EQ(lex_split_statement(str, &begin, &end), 1);
+	EXPECT_EQ(begin, 0);
+	EXPECT_EQ(end, 14);
+	str += end;
+	EXPECT_EQ(lex_split_statement(str, &begin, &end), 0);
+	EXPECT_EQ(end, 2);
+	str += end;
+	EXPECT_EQ(lex_split_statement(str, &begin, &end), 0);
+	EXPECT_EQ(end, 1);
+
+	/* an unterminated quote runs to the end */
+	str = "SELECT 'a; SELECT 1";
+	EXPECT_EQ(lex_split_statement(str, &begin, &end), 1);
+	EXPECT_EQ(end, strlen(str));
+}
+
 TEST_SUITE(lex, TEST(test_empty), TEST(test_int), TEST(test_str),
-	   TEST(test_keywords), TEST(test_quoted_ident));
+	   TEST(test_keywords), TEST(test_all_keywords), TEST(test_operators),
+	   TEST(test_quoted_ident), TEST(test_split_statement));
@@ -35,10 +35,20 @@ static void run_test(const char *suite, struct _test *test)
 
 int main(void)
 {
+	RUN_TEST_SUITE(bytes);
+	RUN_TEST_SUITE(batch);
 	RUN_TEST_SUITE(dtype);
+	RUN_TEST_SUITE(expr);
+	RUN_TEST_SUITE(gather);
+	RUN_TEST_SUITE(hashagg);
 	RUN_TEST_SUITE(heap);
+	RUN_TEST_SUITE(join);
+	RUN_TEST_SUITE(kernel);
 	RUN_TEST_SUITE(kvmap);
 	RUN_TEST_SUITE(lex);
 	RUN_TEST_SUITE(mem);
+	RUN_TEST_SUITE(num);
+	RUN_TEST_SUITE(pgwire);
+	RUN_TEST_SUITE(sort);
 	RUN_TEST_SUITE(vec);
 }
@@ -1,6 +1,9 @@
 #include "test.h"
+#include "util/error.h"
 #include "util/mem.h"
 
+#define ALIGNED(n) (((n) + MEM_ALIGN - 1) / MEM_ALIGN * MEM_ALIGN)
+
 static void test_alloc()
 {
 	struct mem_root r;
@@ -17,6 +20,7 @@ static void test_alloc()
 	strcpy((char *)str, "123456789");
 
 	EXPECT_EQ(*sentinel, 0xFF);
+	mem_root_clear(&r);
 }
 
 static void test_zalloc()
@@ -29,6 +33,7 @@ static void test_zalloc()
 	str = mem_zalloc(sizeof(char) * 10);
 
 	EXPECT_EQ(strlen(str), 0);
+	mem_root_clear(&r);
 }
 
 static void test_clear()
@@ -44,7 +49,142 @@ static void test_clear()
 	mem_alloc(10000);
 
 	mem_root_clear(&r);
-	EXPECT_EQ(r.size, 0);
+	EXPECT_TRUE((r.chunks == NULL));
+}
+
+static void test_align()
+{
+	struct mem_root r;
+	unsigned long	misalign;
+	int		i;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	for (i = 1; i < 100; ++i) {
+		misalign = (uintptr_t)mem_alloc(i) % MEM_ALIGN;
+		EXPECT_EQ(misalign, 0);
+	}
+	misalign = (uintptr_t)mem_alloc(MEM_CHUNK_MAX) % MEM_ALIGN;
+	EXPECT_EQ(misalign, 0);
+	mem_root_clear(&r);
+}
+
+/* Allocations larger than the chunks do not overlap the others */
+static void test_large()
+{
+	struct mem_root r;
+	char	       *small;
+	char	       *large;
+	char	       *next;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	small = mem_alloc(10);
+	large = mem_alloc(2 * MEM_CHUNK_MAX);
+	next  = mem_alloc(10);
+	memset(large, 0xAA, 2 * MEM_CHUNK_MAX);
+	memset(small, 1, 10);
+	memset(next, 2, 10);
+	EXPECT_EQ(large[0], (char)0xAA);
+	EXPECT_EQ(large[2 * MEM_CHUNK_MAX - 1], (char)0xAA);
+	EXPECT_EQ(small[9], 1);
+	/* the chunk of small is still used after the large allocation */
+	EXPECT_EQ(next - small, MEM_ALIGN);
+	mem_root_clear(&r);
+}
+
+/* A reset root allocates from its last chunk again */
+static void test_reset()
+{
+	struct mem_root r;
+	int		i;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	for (i = 0; i < 1000; ++i)
+		mem_alloc(100);
+	mem_alloc(MEM_CHUNK_MAX);
+	mem_root_reset(&r);
+	EXPECT_TRUE((r.chunks != NULL));
+	EXPECT_TRUE((r.chunks->prev == NULL));
+	EXPECT_TRUE((mem_alloc(100) == (void *)(r.chunks + 1)));
+	mem_root_clear(&r);
+}
+
+/* Resetting a root resets its children, and the bytes they hand out are
+ * counted in it */
+static void test_children()
+{
+	struct mem_root parent;
+	struct mem_root query;
+	struct mem_root row;
+	int		i;
+
+	mem_root_init(&parent);
+	mem_root_init_child(&query, &parent);
+	mem_root_init_child(&row, &query);
+	mem_root_set(&query);
+	mem_alloc(100);
+	mem_root_set(&row);
+	for (i = 0; i < 1000; ++i) {
+		mem_alloc(1000);
+		EXPECT_EQ(mem_root_used(&row), ALIGNED(1000));
+		EXPECT_TRUE((mem_root_reserved(&row) <= MEM_CHUNK_MIN));
+		mem_root_reset(&row);
+	}
+	mem_alloc(1000);
+	EXPECT_EQ(mem_root_used(&query), ALIGNED(100) + ALIGNED(1000));
+	EXPECT_EQ(mem_root_used(&parent), ALIGNED(100) + ALIGNED(1000));
+	mem_root_reset(&parent);
+	EXPECT_EQ(mem_root_used(&parent), 0);
+	EXPECT_EQ(row.used, 0);
+
+	mem_root_detach(&row);
+	EXPECT_TRUE((query.children == NULL));
+	mem_root_clear(&row);
+	mem_root_clear(&parent);
+	EXPECT_TRUE((query.chunks == NULL));
+	EXPECT_EQ(mem_root_reserved(&parent), 0);
+}
+
+/* Bytes charged on a child count towards the limit of its parent, and are
+ * given back when recharged to 0 */
+static void test_limit()
+{
+	struct mem_root query;
+	struct mem_root worker;
+	struct err     *err;
+	size_t		charged = 0;
+
+	mem_root_init(&query);
+	mem_root_init_child(&worker, &query);
+	query.limit = 1024 * 1024;
+	while (errbuf_pop() != NULL)
+		;
+
+	mem_root_set(&worker);
+	mem_recharge(&charged, 512 * 1024);
+	EXPECT_EQ(mem_check_limit(), 0);
+	mem_recharge(&charged, 2 * 1024 * 1024);
+	EXPECT_EQ(mem_root_reserved(&query), 2 * 1024 * 1024);
+	EXPECT_EQ(mem_check_limit(), 1);
+	err = errbuf_pop();
+	EXPECT_TRUE((err != NULL));
+	EXPECT_EQ(err->code, ER_OUT_OF_MEMORY);
+	while (errbuf_pop() != NULL)
+		;
+
+	/* the charge may be given back on another root of the query */
+	mem_root_set(&query);
+	mem_recharge(&charged, 0);
+	EXPECT_EQ(mem_root_reserved(&query), 0);
+	EXPECT_EQ(mem_check_limit(), 0);
+
+	mem_root_detach(&worker);
+	mem_root_clear(&worker);
+	mem_root_clear(&query);
 }
 
-TEST_SUITE(mem, TEST(test_alloc), TEST(test_zalloc), TEST(test_clear));
+TEST_SUITE(mem, TEST(test_alloc), TEST(test_zalloc), TEST(test_clear),
+	   TEST(test_align), TEST(test_large), TEST(test_reset),
+	   TEST(test_children), TEST(test_limit));
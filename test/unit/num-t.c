@@ -0,0 +1,75 @@
+#include "test.h"
+#include "util/num.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void check_format(i64 val)
+{
+	char expected[32];
+	char buf[INT_TEXT_MAX];
+	int  len = snprintf(expected, sizeof(expected), "%lld", (long long)val);
+
+	EXPECT_EQ(ut_format_int(buf, val) - buf, len);
+	EXPECT_TRUE((memcmp(buf, expected, len) == 0));
+}
+
+static void test_format()
+{
+	i64 p = 1;
+	int i;
+
+	check_format(0);
+	check_format(INT16_MIN);
+	check_format(INT32_MIN);
+	check_format(INT64_MIN);
+	check_format(INT64_MAX);
+	/* around every number of digits */
+	for (i = 0; i < 18; ++i, p *= 10) {
+		check_format(p - 1);
+		check_format(p);
+		check_format(p + 1);
+		check_format(-p);
+		check_format(-p + 1);
+	}
+}
+
+static int parse(const char *str, i64 min, i64 max, i64 *res)
+{
+	return ut_parse_int(str, strlen(str), min, max, res);
+}
+
+static void test_parse()
+{
+	i64 val = 0;
+
+	EXPECT_EQ(parse("0", INT64_MIN, INT64_MAX, &val), 0);
+	EXPECT_EQ(val, 0);
+	EXPECT_EQ(parse(" -42\t", INT64_MIN, INT64_MAX, &val), 0);
+	EXPECT_EQ(val, -42);
+	EXPECT_EQ(parse("+7", INT64_MIN, INT64_MAX, &val), 0);
+	EXPECT_EQ(val, 7);
+	EXPECT_EQ(parse("-32768", INT16_MIN, INT16_MAX, &val), 0);
+	EXPECT_EQ(val, INT16_MIN);
+	EXPECT_EQ(parse("-9223372036854775808", INT64_MIN, INT64_MAX, &val),
+		  0);
+	EXPECT_EQ(val, INT64_MIN);
+	EXPECT_EQ(parse("9223372036854775807", INT64_MIN, INT64_MAX, &val), 0);
+	EXPECT_EQ(val, INT64_MAX);
+	EXPECT_EQ(parse("000000000000000000000012", INT16_MIN, INT16_MAX,
+			&val),
+		  0);
+	EXPECT_EQ(val, 12);
+
+	EXPECT_EQ(parse("", INT64_MIN, INT64_MAX, &val), 1);
+	EXPECT_EQ(parse("-", INT64_MIN, INT64_MAX, &val), 1);
+	EXPECT_EQ(parse("12a", INT64_MIN, INT64_MAX, &val), 1);
+	EXPECT_EQ(parse("1 2", INT64_MIN, INT64_MAX, &val), 1);
+	EXPECT_EQ(parse("32768", INT16_MIN, INT16_MAX, &val), 2);
+	EXPECT_EQ(parse("-2147483649", INT32_MIN, INT32_MAX, &val), 2);
+	EXPECT_EQ(parse("9223372036854775808", INT64_MIN, INT64_MAX, &val), 2);
+	EXPECT_EQ(parse("99999999999999999999", INT64_MIN, INT64_MAX, &val),
+		  2);
+}
+
+TEST_SUITE(num, TEST(test_format), TEST(test_parse));
@@ -0,0 +1,236 @@
+#include "pgwire.h"
+#include "test.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sys.h"
+#include "univ.h"
+#include "util/bytes.h"
+#include "util/mem.h"
+
+/* Messages of a client, sent to the server in a single write */
+struct client {
+	u8     buf[4096];
+	size_t len;
+};
+
+/* What the server sent back after its first ReadyForQuery */
+struct response {
+	/* type of each message */
+	char types[64];
+	/* first field of each DataRow, followed by a space */
+	char rows[64];
+	/* tag of each CommandComplete, followed by a semicolon */
+	char tags[128];
+	/* SQLSTATE of the last ErrorResponse */
+	char code[6];
+};
+
+static void add_message(struct client *c, u8 type, const void *payload,
+			u32 len)
+{
+	c->buf[c->len++] = type;
+	ut_write_4(c->buf + c->len, len + 4);
+	memcpy(c->buf + c->len + 4, payload, len);
+	c->len += len + 4;
+}
+
+static void add_startup(struct client *c)
+{
+	static const char params[] = "user\0test\0";
+	u8		  *p	    = c->buf + c->len;
+
+	p = ut_write_4(p, 8 + sizeof(params));
+	p = ut_write_4(p, 196608);
+	memcpy(p, params, sizeof(params));
+	c->len += 8 + sizeof(params);
+}
+
+/* Parse of the unnamed statement */
+static void add_parse(struct client *c, const char *query)
+{
+	u8     payload[256];
+	size_t len = strlen(query) + 1;
+
+	payload[0] = '\0';
+	memcpy(payload + 1, query, len);
+	ut_write_2(payload + 1 + len, 0);
+	add_message(c, 'P', payload, len + 3);
+}
+
+/* Bind of the unnamed statement to the unnamed portal, with no parameters
+ * and text results */
+static void add_bind(struct client *c)
+{
+	static const u8 payload[] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+	add_message(c, 'B', payload, sizeof(payload));
+}
+
+static void add_execute(struct client *c, const char *portal, u32 maxrows)
+{
+	u8     payload[64];
+	size_t len = strlen(portal) + 1;
+
+	memcpy(payload, portal, len);
+	ut_write_4(payload + len, maxrows);
+	add_message(c, 'E', payload, len + 4);
+}
+
+/* Run a connection on the messages of the client followed by Terminate, as
+ * sent all at once, and collect the response */
+static void run_connection(struct client *c, struct response *res)
+{
+	static u8   out[16384];
+	struct conn conn;
+	int	    sv[2];
+	size_t	    len = 0;
+	size_t	    off;
+	ssize_t	    n;
+	u32	    msglen;
+	u8	   *msg;
+	int	    ready = 0;
+
+	add_message(c, 'X', NULL, 0);
+	memset(res, 0, sizeof(*res));
+	socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+	write(sv[1], c->buf, c->len);
+
+	conn_init(&conn, sv[0]);
+	mem_root_set(&conn.query_mem);
+	pgwire_handle_connection(&conn);
+	close(sv[0]);
+	conn_free(&conn);
+
+	while ((n = read(sv[1], out + len, sizeof(out) - len)) > 0)
+		len += n;
+	close(sv[1]);
+
+	for (off = 0; off + 5 <= len; off += 1 + msglen) {
+		ut_read_4(out + off + 1, &msglen);
+		msg = out + off + 5;
+		if (!ready) {
+			ready = out[off] == 'Z';
+			continue;
+		}
+		res->types[strlen(res->types)] = out[off];
+		/* field count, then length of the first field */
+		if (out[off] == 'D') {
+			strncat(res->rows, (char *)msg + 6, msglen - 10);
+			strcat(res->rows, " ");
+		}
+		if (out[off] == 'C')
+			strcat(strcat(res->tags, (char *)msg), ";");
+		/* fields of an error, each a type byte and a string */
+		while (out[off] == 'E' && *msg) {
+			if (*msg == 'C')
+				strcpy(res->code, (char *)msg + 1);
+			msg += strlen((char *)msg) + 1;
+		}
+	}
+}
+
+/* Several extended query messages sent in one go are answered in order, and
+ * after an error the messages up to the next Sync are skipped */
+static void test_pipeline()
+{
+	struct client	c = { .len = 0 };
+	struct response res;
+
+	add_startup(&c);
+	add_parse(&c, "select 1");
+	add_bind(&c);
+	add_execute(&c, "", 0);
+	add_parse(&c, "select 2");
+	add_bind(&c);
+	add_execute(&c, "missing", 0);
+	add_parse(&c, "select 5");
+	add_bind(&c);
+	add_execute(&c, "", 0);
+	add_message(&c, 'S', NULL, 0);
+	add_parse(&c, "select 3");
+	add_bind(&c);
+	add_execute(&c, "", 0);
+	add_message(&c, 'S', NULL, 0);
+	run_connection(&c, &res);
+
+	EXPECT_STREQ(res.types, "12DC12EZ12DCZX");
+	EXPECT_STREQ(res.rows, "1 3 ");
+	EXPECT_STREQ(res.tags, "SELECT 1;SELECT 1;");
+	EXPECT_STREQ(res.code, "34000");
+}
+
+/* A bad message is skipped along with the rest of its pipeline, and the
+ * connection goes on after the Sync */
+static void test_skip_till_sync()
+{
+	struct client	c = { .len = 0 };
+	struct response res;
+
+	add_startup(&c);
+	add_parse(&c, "select from");
+	add_bind(&c);
+	add_execute(&c, "", 0);
+	add_message(&c, 'S', NULL, 0);
+	add_parse(&c, "select 4");
+	add_bind(&c);
+	add_execute(&c, "", 0);
+	add_message(&c, 'S', NULL, 0);
+	run_connection(&c, &res);
+
+	EXPECT_STREQ(res.types, "EZ12DCZX");
+	EXPECT_STREQ(res.rows, "4 ");
+	EXPECT_STREQ(res.code, "42601");
+}
+
+/* The description of a select of many columns is sent whole */
+static void test_many_columns()
+{
+	struct client	c = { .len = 0 };
+	struct response res;
+	char		query[256] = "select 1";
+	int		i;
+
+	/* each field takes 27 bytes with its name "?column?" */
+	for (i = 1; i < 100; ++i)
+		strcat(query, ",1");
+	add_startup(&c);
+	add_parse(&c, query);
+	add_bind(&c);
+	add_message(&c, 'D', "P", 2);
+	add_execute(&c, "", 0);
+	add_message(&c, 'S', NULL, 0);
+	run_connection(&c, &res);
+
+	EXPECT_STREQ(res.types, "12TDCZX");
+	EXPECT_STREQ(res.rows, "1 ");
+	EXPECT_STREQ(res.tags, "SELECT 1;");
+}
+
+extern void init_dummy_tables(void);
+
+/* A portal suspended by the row limit of an Execute is resumed by the next
+ * one, and each tag counts the rows of its own Execute */
+static void test_suspend()
+{
+	struct client	c = { .len = 0 };
+	struct response res;
+
+	sys_bootstrap();
+	init_dummy_tables();
+	add_startup(&c);
+	add_parse(&c, "select b from foo");
+	add_bind(&c);
+	add_execute(&c, "", 2);
+	add_execute(&c, "", 2);
+	add_message(&c, 'S', NULL, 0);
+	run_connection(&c, &res);
+
+	EXPECT_STREQ(res.types, "12DDsDCZX");
+	EXPECT_STREQ(res.rows, "1 2 3 ");
+	EXPECT_STREQ(res.tags, "SELECT 1;");
+}
+
+TEST_SUITE(pgwire, TEST(test_pipeline), TEST(test_skip_till_sync),
+	   TEST(test_many_columns), TEST(test_suspend));
@@ -0,0 +1,151 @@
+#include "executor/operator.h"
+#include "fixture.h"
+#include "test.h"
+
+#include "dtype.h"
+#include "storage/heap.h"
+#include "table.h"
+#include "univ.h"
+#include "util/mem.h"
+
+#define NROWS 5000
+#define NVALUES 100
+
+struct test_tup {
+	i16  a;
+	i64  b;
+	char c[4];
+} __attribute__((packed));
+
+/* Columns of struct test_tup */
+static const struct test_col cols[] = {
+	{ DTYPE_INT2, 0 },
+	{ DTYPE_INT8, 0 },
+	{ DTYPE_CHAR, 4 },
+};
+
+/* Row (i * 37 % NVALUES - NVALUES / 2, i, "x" followed by i % 3 letters 'y') */
+static void fill(u8 *tup, int i)
+{
+	struct test_tup *t = (struct test_tup *)tup;
+
+	t->a = i * 37 % NVALUES - NVALUES / 2;
+	t->b = i;
+	memset(t->c, 'y', i % 3 + 1);
+	t->c[0] = 'x';
+}
+
+/* Sort the rows on (c DESC, a, b) within a budget of work_mem bytes, keeping
+ * the first bound rows, and check that they come in order */
+static void check_sort(i64 bound, size_t work_mem)
+{
+	struct mem_root	 r;
+	struct table	 table;
+	struct heap	 heap;
+	struct operator *op;
+	struct batch	*batch;
+	struct expr	*keys[3];
+	u16		 offsets[] = { 0 };
+	u8		 needed[]  = { 1, 1, 1 };
+	u8		 desc[]	   = { 1, 0, 0 };
+	u8		 seen[NROWS] = { 0 };
+	char		 prev_c[5]   = "zzzz";
+	i64		 prev_a	     = 0;
+	i64		 prev_b	     = 0;
+	int		 nrows	     = 0;
+	i64		 a, b, expect;
+	int		 cmp;
+	u16		 i;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&table, &heap, TEST_TABLE_OID, 3, cols, NROWS, fill);
+	keys[0] = make_column(&table, 2);
+	keys[1] = make_column(&table, 0);
+	keys[2] = make_column(&table, 1);
+	op	= sort_op_create(scan_op_create(&table, needed, NULL), offsets,
+				 NULL, 3, keys, desc, bound, work_mem);
+
+	EXPECT_EQ(op_open(op), 0);
+	for (;;) {
+		EXPECT_EQ(op_next(op, &batch), 0);
+		if (batch == NULL)
+			break;
+		for (i = 0; i < batch_count(batch); ++i) {
+			a = get_int(batch, 0, i);
+			b = get_int(batch, 1, i);
+			EXPECT_TRUE((b >= 0 && b < NROWS && !seen[b]));
+			seen[b] = 1;
+			expect = b * 37 % NVALUES - NVALUES / 2;
+			EXPECT_EQ(a, expect);
+			cmp = strncmp(prev_c,
+				      (char *)vector_at(&batch->cols[2], i),
+				      4);
+			EXPECT_TRUE((cmp >= 0));
+			EXPECT_TRUE((cmp > 0 || a > prev_a ||
+				     (a == prev_a && b > prev_b)));
+			strncpy(prev_c, (char *)vector_at(&batch->cols[2], i),
+				4);
+			prev_a = a;
+			prev_b = b;
+			nrows++;
+		}
+	}
+	EXPECT_EQ(nrows, (bound >= 0 && bound < NROWS ? bound : NROWS));
+	op_close(op);
+	free_table(&table, &heap);
+	mem_root_clear(&r);
+}
+
+static void test_in_memory()
+{
+	check_sort(-1, WORK_MEM);
+}
+
+/* Runs are merged in several passes */
+static void test_small_budget()
+{
+	check_sort(-1, 1024);
+	check_sort(-1, 16 * 1024);
+}
+
+/* Only the first rows are kept, in a heap if they fit */
+static void test_bound()
+{
+	check_sort(0, WORK_MEM);
+	check_sort(10, WORK_MEM);
+	check_sort(NROWS + 1, WORK_MEM);
+	check_sort(1000, 1024);
+}
+
+/* The records in memory never take more than the budget, even when it holds
+ * just over a power of two of them, the records being 42 bytes with their
+ * pointers. The memory root has room for the budget and the batches. */
+static void test_budget_kept()
+{
+	struct mem_root	 r;
+	struct table	 table;
+	struct heap	 heap;
+	struct operator *op;
+	struct expr	*key;
+	u16		 offsets[] = { 0 };
+	u8		 needed[]  = { 1, 1, 1 };
+	u8		 desc[]	   = { 0 };
+	size_t		 work_mem  = 42 * 4100;
+
+	mem_root_init(&r);
+	mem_root_set(&r);
+	make_table(&table, &heap, TEST_TABLE_OID, 3, cols, NROWS, fill);
+	key	= make_column(&table, 1);
+	op	= sort_op_create(scan_op_create(&table, needed, NULL), offsets,
+				 NULL, 1, &key, desc, -1, work_mem);
+	r.limit = r.total + work_mem + 128 * 1024;
+	EXPECT_EQ(op_open(op), 0);
+	EXPECT_EQ(mem_check_limit(), 0);
+	op_close(op);
+	free_table(&table, &heap);
+	mem_root_clear(&r);
+}
+
+TEST_SUITE(sort, TEST(test_in_memory), TEST(test_small_budget),
+	   TEST(test_bound), TEST(test_budget_kept));